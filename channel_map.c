@@ -0,0 +1,450 @@
+#include "channel_map.h"
+
+/* Slice of the scan wait after which a stop request is checked */
+#define SCAN_WAIT_SLICE 100
+#define FILE_NAME_SIZE 256
+
+typedef struct ChannelMapping {
+	void* address;
+	size_t size;
+} ChannelMapping;
+
+/***********************************************************************
+* @brief    Revalidation thread, compares the live PAT with the map and
+* 			rescans if they differ
+*
+***********************************************************************/
+static void* Revalidation_Thread(void* arg);
+
+/***********************************************************************
+* @brief    Section callback for the live PAT
+*
+***********************************************************************/
+static int32_t Live_PAT_Received(const uint8_t* section, uint16_t pid, void* userData);
+
+/***********************************************************************
+* @brief    Timer callback, ends the wait for the live PAT or the scan
+*
+***********************************************************************/
+static void Revalidation_Timeout(void* argument);
+
+/***********************************************************************
+* @brief    Runs a channel scan and saves its results with the service
+* 			database metadata
+*
+* @return   EXIT_SUCCESS - new map is saved and loaded
+* @return   EXIT_FAILURE - scan did not complete or saving failed
+*
+***********************************************************************/
+static int32_t Rescan_And_Save();
+
+static ChannelMapping currentMap = {NULL, 0};
+/* Previous map stays mapped for readers which still hold its pointer */
+static ChannelMapping retiredMap = {NULL, 0};
+static const ChannelMapHeader* mapHeader = NULL;
+static ChannelMapStatistics statistics;
+static char mapFileName[FILE_NAME_SIZE];
+static Channel_Map_Callback ChannelMapCallback = NULL;
+static pthread_t revalidationThread;
+static uint8_t threadRunning = 0;
+static uint8_t stopRequested = 0;
+static uint8_t livePatReceived = 0;
+/* Set by the timer thread when the PAT wait or the scan takes too long */
+static uint8_t timedOut = 0;
+static TimerEntry timeoutTimer;
+static uint32_t patFilterHandle;
+static uint16_t liveTransportStreamId;
+static uint8_t livePatVersion;
+/* Big, kept out of the thread stack */
+static ChannelScanResult scanResult;
+static ChannelMapEntry scannedChannels[CHANNEL_MAP_MAX_CHANNELS];
+static pthread_mutex_t mapMutex;
+static pthread_cond_t mapCondition;
+
+int32_t Channel_Map_Init()
+{
+	pthread_condattr_t conditionAttributes;
+
+	if (Timer_Service_Init())
+	{
+		printf("%s(%d): Error initializing timer service!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+	Timer_Init(&timeoutTimer, Revalidation_Timeout, NULL);
+
+	if (pthread_mutex_init(&mapMutex, NULL))
+	{
+		printf("%s(%d): Error initializing channel map mutex!\n", __FUNCTION__, __LINE__);
+		Timer_Service_Deinit();
+		return EXIT_FAILURE;
+	}
+
+	pthread_condattr_init(&conditionAttributes);
+	pthread_condattr_setclock(&conditionAttributes, CLOCK_MONOTONIC);
+	if (pthread_cond_init(&mapCondition, &conditionAttributes))
+	{
+		printf("%s(%d): Error initializing channel map condition!\n", __FUNCTION__, __LINE__);
+		pthread_condattr_destroy(&conditionAttributes);
+		pthread_mutex_destroy(&mapMutex);
+		Timer_Service_Deinit();
+		return EXIT_FAILURE;
+	}
+	pthread_condattr_destroy(&conditionAttributes);
+
+	memset(&statistics, 0, sizeof(statistics));
+	statistics.state = CHANNEL_MAP_NONE;
+	return EXIT_SUCCESS;
+}
+
+int32_t Channel_Map_Deinit()
+{
+	Channel_Map_Stop_Revalidation();
+
+	if (currentMap.address != NULL)
+	{
+		munmap(currentMap.address, currentMap.size);
+	}
+	if (retiredMap.address != NULL)
+	{
+		munmap(retiredMap.address, retiredMap.size);
+	}
+	currentMap.address = NULL;
+	retiredMap.address = NULL;
+	mapHeader = NULL;
+
+	pthread_cond_destroy(&mapCondition);
+	pthread_mutex_destroy(&mapMutex);
+	Timer_Service_Deinit();
+	return EXIT_SUCCESS;
+}
+
+int32_t Channel_Map_Load(const char* fileName)
+{
+	struct timespec start;
+	struct timespec end;
+	struct stat fileStatus;
+	const ChannelMapHeader* header;
+	void* address;
+	int32_t fileDescriptor;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	fileDescriptor = open(fileName, O_RDONLY);
+	if (fileDescriptor < 0)
+	{
+		return EXIT_FAILURE;
+	}
+	if (fstat(fileDescriptor, &fileStatus) || fileStatus.st_size < (off_t)sizeof(ChannelMapHeader))
+	{
+		printf("%s(%d): Channel map %s is too short!\n", __FUNCTION__, __LINE__, fileName);
+		close(fileDescriptor);
+		return EXIT_FAILURE;
+	}
+
+	address = mmap(NULL, fileStatus.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	close(fileDescriptor);
+	if (address == MAP_FAILED)
+	{
+		printf("%s(%d): Error mapping channel map: %s!\n", __FUNCTION__, __LINE__, strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	/* Entries are not parsed, only their checksum is checked */
+	header = (const ChannelMapHeader*)address;
+	if (header->magic != CHANNEL_MAP_MAGIC || header->formatVersion != CHANNEL_MAP_FORMAT_VERSION
+		|| header->entrySize != sizeof(ChannelMapEntry) || header->numOfChannels > CHANNEL_MAP_MAX_CHANNELS
+		|| (size_t)fileStatus.st_size < sizeof(ChannelMapHeader) + header->numOfChannels * sizeof(ChannelMapEntry)
+		|| Crc32_Calculate((const uint8_t*)(header + 1), header->numOfChannels * sizeof(ChannelMapEntry)) != header->checksum)
+	{
+		printf("%s(%d): Channel map %s has a wrong format or checksum!\n", __FUNCTION__, __LINE__, fileName);
+		munmap(address, fileStatus.st_size);
+		return EXIT_FAILURE;
+	}
+
+	pthread_mutex_lock(&mapMutex);
+	if (retiredMap.address != NULL)
+	{
+		munmap(retiredMap.address, retiredMap.size);
+	}
+	retiredMap = currentMap;
+	currentMap.address = address;
+	currentMap.size = fileStatus.st_size;
+	mapHeader = header;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	statistics.state = CHANNEL_MAP_UNVERIFIED;
+	statistics.numOfChannels = header->numOfChannels;
+	statistics.transportStreamId = header->transportStreamId;
+	statistics.patVersion = header->patVersion;
+	statistics.loadTime = Time_Difference(&start, &end);
+	pthread_mutex_unlock(&mapMutex);
+	return EXIT_SUCCESS;
+}
+
+uint32_t Channel_Map_Get_Channels(const ChannelMapEntry** channels)
+{
+	uint32_t numOfChannels = 0;
+
+	pthread_mutex_lock(&mapMutex);
+	if (mapHeader != NULL)
+	{
+		*channels = (const ChannelMapEntry*)(mapHeader + 1);
+		numOfChannels = mapHeader->numOfChannels;
+	}
+	pthread_mutex_unlock(&mapMutex);
+	return numOfChannels;
+}
+
+int32_t Channel_Map_Save(const char* fileName, uint16_t transportStreamId, uint8_t patVersion,
+						 const ChannelMapEntry* channels, uint32_t numOfChannels)
+{
+	ChannelMapHeader header;
+	char temporaryName[FILE_NAME_SIZE + 4];
+	int32_t fileDescriptor;
+	size_t entriesSize = numOfChannels * sizeof(ChannelMapEntry);
+
+	if (numOfChannels > CHANNEL_MAP_MAX_CHANNELS)
+	{
+		return EXIT_FAILURE;
+	}
+
+	memset(&header, 0, sizeof(header));
+	header.magic = CHANNEL_MAP_MAGIC;
+	header.formatVersion = CHANNEL_MAP_FORMAT_VERSION;
+	header.entrySize = sizeof(ChannelMapEntry);
+	header.numOfChannels = numOfChannels;
+	header.transportStreamId = transportStreamId;
+	header.patVersion = patVersion;
+	header.checksum = Crc32_Calculate((const uint8_t*)channels, entriesSize);
+
+	/* Readers never see a half written file, it is renamed over the old one */
+	snprintf(temporaryName, sizeof(temporaryName), "%s.tmp", fileName);
+	fileDescriptor = open(temporaryName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fileDescriptor < 0)
+	{
+		printf("%s(%d): Error creating %s: %s!\n", __FUNCTION__, __LINE__, temporaryName, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	if (write(fileDescriptor, &header, sizeof(header)) != sizeof(header)
+		|| write(fileDescriptor, channels, entriesSize) != (ssize_t)entriesSize
+		|| fsync(fileDescriptor))
+	{
+		printf("%s(%d): Error writing %s!\n", __FUNCTION__, __LINE__, temporaryName);
+		close(fileDescriptor);
+		unlink(temporaryName);
+		return EXIT_FAILURE;
+	}
+	close(fileDescriptor);
+
+	if (rename(temporaryName, fileName))
+	{
+		printf("%s(%d): Error renaming %s: %s!\n", __FUNCTION__, __LINE__, temporaryName, strerror(errno));
+		unlink(temporaryName);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+int32_t Channel_Map_Start_Revalidation(const char* fileName, Channel_Map_Callback callback)
+{
+	if (threadRunning)
+	{
+		Channel_Map_Stop_Revalidation();
+	}
+
+	pthread_mutex_lock(&mapMutex);
+	snprintf(mapFileName, sizeof(mapFileName), "%s", fileName);
+	ChannelMapCallback = callback;
+	stopRequested = 0;
+	livePatReceived = 0;
+	timedOut = 0;
+	pthread_mutex_unlock(&mapMutex);
+
+	/* Filter is set before returning so that no PAT is missed */
+	if (Ts_Demux_Set_Section_Filter(PAT_PID, PAT_TABLE_ID, 0xFF, Live_PAT_Received, NULL, &patFilterHandle))
+	{
+		printf("%s(%d): Error setting PAT filter!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+	if (pthread_create(&revalidationThread, NULL, Revalidation_Thread, NULL))
+	{
+		printf("%s(%d): Error creating revalidation thread!\n", __FUNCTION__, __LINE__);
+		Ts_Demux_Free_Section_Filter(patFilterHandle);
+		return EXIT_FAILURE;
+	}
+	threadRunning = 1;
+	return EXIT_SUCCESS;
+}
+
+void Channel_Map_Stop_Revalidation()
+{
+	if (!threadRunning)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&mapMutex);
+	stopRequested = 1;
+	pthread_cond_broadcast(&mapCondition);
+	pthread_mutex_unlock(&mapMutex);
+
+	pthread_join(revalidationThread, NULL);
+	threadRunning = 0;
+}
+
+uint32_t Channel_Map_Get_State()
+{
+	uint32_t state;
+
+	pthread_mutex_lock(&mapMutex);
+	state = statistics.state;
+	pthread_mutex_unlock(&mapMutex);
+	return state;
+}
+
+void Channel_Map_Get_Statistics(ChannelMapStatistics* outStatistics)
+{
+	pthread_mutex_lock(&mapMutex);
+	*outStatistics = statistics;
+	pthread_mutex_unlock(&mapMutex);
+}
+
+void* Revalidation_Thread(void* arg)
+{
+	struct timespec start;
+	struct timespec end;
+	uint32_t state;
+	uint8_t patMatches;
+	Channel_Map_Callback callback;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	Timer_Start(&timeoutTimer, CHANNEL_MAP_PAT_TIMEOUT);
+
+	pthread_mutex_lock(&mapMutex);
+	while (!livePatReceived && !stopRequested && !timedOut)
+	{
+		pthread_cond_wait(&mapCondition, &mapMutex);
+	}
+	patMatches = livePatReceived && mapHeader != NULL && mapHeader->transportStreamId == liveTransportStreamId
+				 && mapHeader->patVersion == livePatVersion;
+	state = livePatReceived ? CHANNEL_MAP_VALID : CHANNEL_MAP_FAILED;
+	pthread_mutex_unlock(&mapMutex);
+
+	/* Demux calls the callback with its lock held, so it is not freed under the map mutex */
+	Timer_Stop(&timeoutTimer);
+	Ts_Demux_Free_Section_Filter(patFilterHandle);
+
+	if (stopRequested)
+	{
+		return NULL;
+	}
+	if (livePatReceived && !patMatches)
+	{
+		state = (Rescan_And_Save() == EXIT_SUCCESS) ? CHANNEL_MAP_UPDATED : CHANNEL_MAP_FAILED;
+		if (stopRequested)
+		{
+			return NULL;
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	pthread_mutex_lock(&mapMutex);
+	statistics.state = state;
+	statistics.validationTime = Time_Difference(&start, &end) / 1000;
+	callback = ChannelMapCallback;
+	pthread_mutex_unlock(&mapMutex);
+
+	if (callback != NULL)
+	{
+		callback(state);
+	}
+	return NULL;
+}
+
+int32_t Live_PAT_Received(const uint8_t* section, uint16_t pid, void* userData)
+{
+	/* Next PAT (current_next_indicator 0) does not count */
+	if (!(section[5] & 0x01) || Crc32_Check_Section(section))
+	{
+		return EXIT_SUCCESS;
+	}
+
+	pthread_mutex_lock(&mapMutex);
+	if (!livePatReceived)
+	{
+		liveTransportStreamId = (section[3] << 8) | section[4];
+		livePatVersion = (section[5] >> 1) & 0x1F;
+		livePatReceived = 1;
+		pthread_cond_broadcast(&mapCondition);
+	}
+	pthread_mutex_unlock(&mapMutex);
+	return EXIT_SUCCESS;
+}
+
+void Revalidation_Timeout(void* argument)
+{
+	pthread_mutex_lock(&mapMutex);
+	timedOut = 1;
+	pthread_cond_broadcast(&mapCondition);
+	pthread_mutex_unlock(&mapMutex);
+}
+
+int32_t Rescan_And_Save()
+{
+	ServiceEntry service;
+	uint32_t numOfChannels = 0;
+	uint32_t i;
+
+	if (Channel_Scan_Start(CHANNEL_SCAN_ALL_FILTERS))
+	{
+		return EXIT_FAILURE;
+	}
+
+	/* Waited in slices so that a stop request or the timeout is not delayed by the scan */
+	pthread_mutex_lock(&mapMutex);
+	timedOut = 0;
+	pthread_mutex_unlock(&mapMutex);
+	Timer_Start(&timeoutTimer, CHANNEL_MAP_SCAN_TIMEOUT);
+	while (!__atomic_load_n(&stopRequested, __ATOMIC_RELAXED) && !__atomic_load_n(&timedOut, __ATOMIC_RELAXED))
+	{
+		if (Channel_Scan_Wait(SCAN_WAIT_SLICE) == EXIT_SUCCESS)
+		{
+			break;
+		}
+	}
+	Timer_Stop(&timeoutTimer);
+	Channel_Scan_Stop();
+	Channel_Scan_Get_Result(&scanResult);
+	if (scanResult.state != CHANNEL_SCAN_COMPLETE)
+	{
+		printf("%s(%d): Channel scan did not complete!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+
+	memset(scannedChannels, 0, sizeof(scannedChannels));
+	for (i = 0; i < scanResult.numOfPrograms; i++)
+	{
+		scannedChannels[numOfChannels].programNumber = scanResult.programs[i].pat.programNumber;
+		scannedChannels[numOfChannels].programMapPID = scanResult.programs[i].pat.programMapPID;
+		scannedChannels[numOfChannels].videoPID = scanResult.programs[i].pmt.videoPID;
+		scannedChannels[numOfChannels].audioPID = scanResult.programs[i].pmt.audioPID;
+		scannedChannels[numOfChannels].pcrPID = scanResult.programs[i].pmt.pcrPID;
+		scannedChannels[numOfChannels].teletextPID = scanResult.programs[i].pmt.teletextPID;
+		scannedChannels[numOfChannels].visible = 1;
+		/* Names and numbers are there if SDT and NIT were already received */
+		if (Service_Db_Find_By_Program(scanResult.programs[i].pat.programNumber, &service) == EXIT_SUCCESS)
+		{
+			scannedChannels[numOfChannels].logicalChannelNumber = service.logicalChannelNumber;
+			scannedChannels[numOfChannels].serviceType = service.serviceType;
+			scannedChannels[numOfChannels].visible = service.visible;
+			memcpy(scannedChannels[numOfChannels].serviceName, service.serviceName, SERVICE_NAME_SIZE);
+		}
+		numOfChannels++;
+	}
+
+	if (Channel_Map_Save(mapFileName, liveTransportStreamId, livePatVersion, scannedChannels, numOfChannels))
+	{
+		return EXIT_FAILURE;
+	}
+	return Channel_Map_Load(mapFileName);
+}
@@ -0,0 +1,180 @@
+#ifndef _CHANNEL_MAP_H_
+#define _CHANNEL_MAP_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ts_demux.h"
+#include "table_parse.h"
+#include "channel_scan.h"
+#include "service_db.h"
+#include "timer_service.h"
+
+/* "CMAP" in the first four bytes of the file */
+#define CHANNEL_MAP_MAGIC 0x50414D43
+/* Increased whenever ChannelMapHeader or ChannelMapEntry change */
+#define CHANNEL_MAP_FORMAT_VERSION 3
+#define CHANNEL_MAP_MAX_CHANNELS CHANNEL_SCAN_MAX_PROGRAMS
+
+/* Milliseconds the revalidation waits for the live PAT and the rescan */
+#define CHANNEL_MAP_PAT_TIMEOUT 3000
+#define CHANNEL_MAP_SCAN_TIMEOUT 15000
+
+/* Channel map states */
+#define CHANNEL_MAP_NONE 0
+#define CHANNEL_MAP_UNVERIFIED 1
+#define CHANNEL_MAP_VALID 2
+#define CHANNEL_MAP_UPDATED 3
+#define CHANNEL_MAP_FAILED 4
+
+/* Layout of the file, it is used in place after mmap */
+typedef struct ChannelMapHeader {
+	uint32_t magic;
+	uint16_t formatVersion;
+	/* sizeof(ChannelMapEntry) of the writer */
+	uint16_t entrySize;
+	uint32_t numOfChannels;
+	uint16_t transportStreamId;
+	uint8_t patVersion;
+	uint8_t reserved;
+	/* CRC_32 of the channel entries */
+	uint32_t checksum;
+} ChannelMapHeader;
+
+/*
+ * Fields are copied from the PAT and PMT instead of embedding their
+ * structures, so changes of the parser structures do not change the file
+ */
+typedef struct ChannelMapEntry {
+	uint16_t programNumber;
+	uint16_t programMapPID;
+	uint16_t videoPID;
+	uint16_t audioPID;
+	uint16_t pcrPID;
+	/* 0 if the program has no teletext */
+	uint16_t teletextPID;
+	uint16_t logicalChannelNumber;
+	uint8_t serviceType;
+	uint8_t visible;
+	char serviceName[SERVICE_NAME_SIZE];
+} ChannelMapEntry;
+
+typedef struct ChannelMapStatistics {
+	uint32_t state;
+	uint32_t numOfChannels;
+	uint16_t transportStreamId;
+	uint8_t patVersion;
+	/* Microseconds spent mapping and checking the file */
+	uint32_t loadTime;
+	/* Milliseconds from the start of the revalidation to its result */
+	uint32_t validationTime;
+} ChannelMapStatistics;
+
+/* Called from the revalidation thread with the new state */
+typedef void(*Channel_Map_Callback)(uint32_t state);
+
+/***********************************************************************
+* @brief    Channel map initialization function
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Channel_Map_Init();
+
+/***********************************************************************
+* @brief    Channel map deinitialization function, stops the
+* 			revalidation and unmaps the file
+*
+* @return   EXIT_SUCCESS - no error
+*
+***********************************************************************/
+int32_t Channel_Map_Deinit();
+
+/***********************************************************************
+* @brief    Maps the channel map file read-only. Nothing is parsed, the
+* 			header is checked and the entries are used in place
+*
+* @param    [in] fileName - path to the channel map
+*
+* @return   EXIT_SUCCESS - map is usable, state is CHANNEL_MAP_UNVERIFIED
+* @return   EXIT_FAILURE - no file, or wrong format version or checksum
+*
+***********************************************************************/
+int32_t Channel_Map_Load(const char* fileName);
+
+/***********************************************************************
+* @brief    Returns the mapped channels. The pointer stays valid until
+* 			the map is updated twice or deinitialized, it has to be
+* 			fetched again after CHANNEL_MAP_UPDATED
+*
+* @param    [out] channels - pointer to the first channel
+*
+* @return   numOfChannels - number of channels, 0 if there is no map
+*
+***********************************************************************/
+uint32_t Channel_Map_Get_Channels(const ChannelMapEntry** channels);
+
+/***********************************************************************
+* @brief    Writes a channel map file, the old file is replaced
+* 			atomically
+*
+* @param    [in] fileName - path to the channel map
+* @param    [in] transportStreamId - transport_stream_id of the PAT
+* @param    [in] patVersion - version_number of the PAT
+* @param    [in] channels - channels to save
+* @param    [in] numOfChannels - number of channels
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Channel_Map_Save(const char* fileName, uint16_t transportStreamId, uint8_t patVersion,
+						 const ChannelMapEntry* channels, uint32_t numOfChannels);
+
+/***********************************************************************
+* @brief    Starts a thread which compares the live PAT with the map.
+* 			If transport_stream_id or version differ, or there is no
+* 			map, it runs a channel scan, saves and maps the new file.
+* 			Service names and numbers are taken from the service
+* 			database. Channel scan and service database have to be
+* 			initialized
+*
+* @param    [in] fileName - path to the channel map
+* @param    [in] callback - called with the result, may be NULL
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Channel_Map_Start_Revalidation(const char* fileName, Channel_Map_Callback callback);
+
+/***********************************************************************
+* @brief    Stops the revalidation thread if it is still running
+*
+***********************************************************************/
+void Channel_Map_Stop_Revalidation();
+
+/***********************************************************************
+* @brief    Returns the state of the channel map
+*
+***********************************************************************/
+uint32_t Channel_Map_Get_State();
+
+/***********************************************************************
+* @brief    Copies the channel map counters
+*
+* @param    [out] statistics - structure where the counters are saved
+*
+***********************************************************************/
+void Channel_Map_Get_Statistics(ChannelMapStatistics* statistics);
+
+#endif
@@ -0,0 +1,393 @@
+#include "channel_scan.h"
+
+typedef struct ScanFilter {
+	uint16_t pid;
+	uint8_t open;
+	/* All programs carried on the PID have their PMT */
+	uint8_t done;
+	uint32_t handle;
+} ScanFilter;
+
+/***********************************************************************
+* @brief    Section callback for the PAT, adds the programs and opens
+* 			their PMT filters right away
+*
+***********************************************************************/
+static int32_t PAT_Section_Received(const uint8_t* section, uint16_t pid, void* userData);
+
+/***********************************************************************
+* @brief    Section callback for the PMT PIDs, userData is the ScanFilter
+*
+***********************************************************************/
+static int32_t PMT_Section_Received(const uint8_t* section, uint16_t pid, void* userData);
+
+/***********************************************************************
+* @brief    Opens filters for the PMT PIDs which are still waited for,
+* 			until the limit or the demux runs out of filters. Called
+* 			with the scan mutex locked
+*
+***********************************************************************/
+static void Open_Pending_Filters();
+
+/***********************************************************************
+* @brief    Completes the scan when the PAT and every PMT are in.
+* 			Called with the scan mutex locked
+*
+***********************************************************************/
+static void Check_Complete();
+
+/***********************************************************************
+* @brief    Returns milliseconds since the scan was started
+*
+***********************************************************************/
+static uint32_t Elapsed_Time();
+
+static ChannelScanResult scan;
+static ScanFilter pmtFilters[CHANNEL_SCAN_MAX_PROGRAMS];
+static uint32_t numOfPmtFilters = 0;
+static uint32_t numOfOpenFilters = 0;
+static uint32_t filterLimit = 0;
+static uint32_t patFilterHandle;
+static uint8_t patFilterOpen = 0;
+/* Bit per PAT section_number */
+static uint8_t patSections[32];
+static uint8_t active = 0;
+static struct timespec startTime;
+static pthread_mutex_t scanMutex;
+static pthread_cond_t scanCondition;
+
+int32_t Channel_Scan_Init()
+{
+	pthread_condattr_t conditionAttributes;
+
+	if (pthread_mutex_init(&scanMutex, NULL))
+	{
+		printf("%s(%d): Error initializing scan mutex!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+
+	/* Timeouts are measured on the monotonic clock */
+	pthread_condattr_init(&conditionAttributes);
+	pthread_condattr_setclock(&conditionAttributes, CLOCK_MONOTONIC);
+	if (pthread_cond_init(&scanCondition, &conditionAttributes))
+	{
+		printf("%s(%d): Error initializing scan condition!\n", __FUNCTION__, __LINE__);
+		pthread_condattr_destroy(&conditionAttributes);
+		pthread_mutex_destroy(&scanMutex);
+		return EXIT_FAILURE;
+	}
+	pthread_condattr_destroy(&conditionAttributes);
+
+	memset(&scan, 0, sizeof(scan));
+	return EXIT_SUCCESS;
+}
+
+int32_t Channel_Scan_Deinit()
+{
+	Channel_Scan_Stop();
+	pthread_cond_destroy(&scanCondition);
+	pthread_mutex_destroy(&scanMutex);
+	return EXIT_SUCCESS;
+}
+
+int32_t Channel_Scan_Start(uint32_t maxPmtFilters)
+{
+	uint32_t filterHandle;
+	uint8_t closeFilter = 0;
+
+	Channel_Scan_Stop();
+
+	pthread_mutex_lock(&scanMutex);
+	memset(&scan, 0, sizeof(scan));
+	memset(patSections, 0, sizeof(patSections));
+	numOfPmtFilters = 0;
+	numOfOpenFilters = 0;
+	/* One demux filter is used by the PAT */
+	filterLimit = (maxPmtFilters == CHANNEL_SCAN_ALL_FILTERS) ? TS_MAX_SECTION_FILTERS - 1 : maxPmtFilters;
+	scan.state = CHANNEL_SCAN_WAITING_PAT;
+	active = 1;
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	pthread_mutex_unlock(&scanMutex);
+
+	/* Demux calls the callbacks with its lock held, so it is not called under the scan mutex */
+	if (Ts_Demux_Set_Section_Filter(PAT_PID, PAT_TABLE_ID, 0xFF, PAT_Section_Received, NULL, &filterHandle))
+	{
+		printf("%s(%d): Error setting PAT filter!\n", __FUNCTION__, __LINE__);
+		pthread_mutex_lock(&scanMutex);
+		scan.state = CHANNEL_SCAN_IDLE;
+		active = 0;
+		pthread_mutex_unlock(&scanMutex);
+		return EXIT_FAILURE;
+	}
+
+	pthread_mutex_lock(&scanMutex);
+	/* PAT may already be complete if packets are fed from another thread */
+	if (active && scan.state == CHANNEL_SCAN_WAITING_PAT)
+	{
+		patFilterHandle = filterHandle;
+		patFilterOpen = 1;
+	}
+	else
+	{
+		closeFilter = 1;
+	}
+	pthread_mutex_unlock(&scanMutex);
+
+	if (closeFilter)
+	{
+		Ts_Demux_Free_Section_Filter(filterHandle);
+	}
+	return EXIT_SUCCESS;
+}
+
+void Channel_Scan_Stop()
+{
+	uint32_t handles[CHANNEL_SCAN_MAX_PROGRAMS + 1];
+	uint32_t numOfHandles = 0;
+	uint32_t i;
+
+	pthread_mutex_lock(&scanMutex);
+	active = 0;
+	if (patFilterOpen)
+	{
+		handles[numOfHandles++] = patFilterHandle;
+		patFilterOpen = 0;
+	}
+	for (i = 0; i < numOfPmtFilters; i++)
+	{
+		if (pmtFilters[i].open)
+		{
+			handles[numOfHandles++] = pmtFilters[i].handle;
+			pmtFilters[i].open = 0;
+		}
+	}
+	numOfOpenFilters = 0;
+	pthread_cond_broadcast(&scanCondition);
+	pthread_mutex_unlock(&scanMutex);
+
+	for (i = 0; i < numOfHandles; i++)
+	{
+		Ts_Demux_Free_Section_Filter(handles[i]);
+	}
+}
+
+int32_t Channel_Scan_Wait(uint32_t timeout)
+{
+	struct timespec deadline;
+	int32_t ret = EXIT_SUCCESS;
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += timeout / 1000;
+	deadline.tv_nsec += (timeout % 1000) * 1000000;
+	if (deadline.tv_nsec >= 1000000000)
+	{
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	pthread_mutex_lock(&scanMutex);
+	while (active && scan.state != CHANNEL_SCAN_COMPLETE)
+	{
+		if (pthread_cond_timedwait(&scanCondition, &scanMutex, &deadline) == ETIMEDOUT)
+		{
+			break;
+		}
+	}
+	if (scan.state != CHANNEL_SCAN_COMPLETE)
+	{
+		ret = EXIT_FAILURE;
+	}
+	pthread_mutex_unlock(&scanMutex);
+	return ret;
+}
+
+uint32_t Channel_Scan_Get_State()
+{
+	uint32_t state;
+
+	pthread_mutex_lock(&scanMutex);
+	state = scan.state;
+	pthread_mutex_unlock(&scanMutex);
+	return state;
+}
+
+void Channel_Scan_Get_Result(ChannelScanResult* result)
+{
+	pthread_mutex_lock(&scanMutex);
+	*result = scan;
+	pthread_mutex_unlock(&scanMutex);
+}
+
+int32_t PAT_Section_Received(const uint8_t* section, uint16_t pid, void* userData)
+{
+	PATTable programTable[PAT_MAX_PROGRAMS];
+	uint32_t count;
+	uint32_t i;
+	uint32_t j;
+	uint8_t sectionNumber = section[6];
+	uint8_t lastSectionNumber = section[7];
+
+	pthread_mutex_lock(&scanMutex);
+	if (!active || scan.state != CHANNEL_SCAN_WAITING_PAT
+		|| (patSections[sectionNumber / 8] & (1 << (sectionNumber % 8))))
+	{
+		pthread_mutex_unlock(&scanMutex);
+		return EXIT_SUCCESS;
+	}
+	/* Sections with wrong CRC_32 are waited for again */
+	if (Crc32_Check_Section(section))
+	{
+		pthread_mutex_unlock(&scanMutex);
+		return EXIT_SUCCESS;
+	}
+	patSections[sectionNumber / 8] |= 1 << (sectionNumber % 8);
+
+	count = PAT_Decode_Programs(section, programTable, PAT_MAX_PROGRAMS);
+	for (i = 0; i < count && scan.numOfPrograms < CHANNEL_SCAN_MAX_PROGRAMS; i++)
+	{
+		for (j = 0; j < scan.numOfPrograms; j++)
+		{
+			if (scan.programs[j].pat.programNumber == programTable[i].programNumber)
+			{
+				break;
+			}
+		}
+		if (j < scan.numOfPrograms)
+		{
+			continue;
+		}
+		scan.programs[scan.numOfPrograms].pat = programTable[i];
+		scan.programs[scan.numOfPrograms].pmtReceived = 0;
+		scan.numOfPrograms++;
+
+		/* Several programs can share one PMT PID */
+		for (j = 0; j < numOfPmtFilters; j++)
+		{
+			if (pmtFilters[j].pid == programTable[i].programMapPID)
+			{
+				pmtFilters[j].done = 0;
+				break;
+			}
+		}
+		if (j == numOfPmtFilters)
+		{
+			pmtFilters[j].pid = programTable[i].programMapPID;
+			pmtFilters[j].open = 0;
+			pmtFilters[j].done = 0;
+			numOfPmtFilters++;
+		}
+	}
+
+	/* Later PAT sections are waited for with the PMT filters already open */
+	Open_Pending_Filters();
+
+	for (i = 0; i <= lastSectionNumber; i++)
+	{
+		if (!(patSections[i / 8] & (1 << (i % 8))))
+		{
+			break;
+		}
+	}
+	if (i > lastSectionNumber)
+	{
+		scan.patTime = Elapsed_Time();
+		scan.state = CHANNEL_SCAN_WAITING_PMT;
+		if (patFilterOpen)
+		{
+			Ts_Demux_Free_Section_Filter(patFilterHandle);
+			patFilterOpen = 0;
+		}
+		Check_Complete();
+	}
+	pthread_mutex_unlock(&scanMutex);
+	return EXIT_SUCCESS;
+}
+
+int32_t PMT_Section_Received(const uint8_t* section, uint16_t pid, void* userData)
+{
+	ScanFilter* filter = (ScanFilter*)userData;
+	uint16_t programNumber = (section[3] << 8) | section[4];
+	uint32_t i;
+	uint8_t pidDone = 1;
+
+	pthread_mutex_lock(&scanMutex);
+	if (!active || !filter->open)
+	{
+		pthread_mutex_unlock(&scanMutex);
+		return EXIT_SUCCESS;
+	}
+
+	for (i = 0; i < scan.numOfPrograms; i++)
+	{
+		if (scan.programs[i].pat.programMapPID != pid || scan.programs[i].pmtReceived)
+		{
+			continue;
+		}
+		if (scan.programs[i].pat.programNumber == programNumber
+			&& PMT_Parse(section, &scan.programs[i].pmt) == EXIT_SUCCESS)
+		{
+			scan.programs[i].pmtReceived = 1;
+			scan.numOfReceived++;
+			continue;
+		}
+		pidDone = 0;
+	}
+
+	/* Filter is given to the next PID as soon as its programs are in */
+	if (pidDone)
+	{
+		Ts_Demux_Free_Section_Filter(filter->handle);
+		filter->open = 0;
+		filter->done = 1;
+		numOfOpenFilters--;
+		Open_Pending_Filters();
+	}
+	Check_Complete();
+	pthread_mutex_unlock(&scanMutex);
+	return EXIT_SUCCESS;
+}
+
+void Open_Pending_Filters()
+{
+	uint32_t i;
+
+	for (i = 0; i < numOfPmtFilters && numOfOpenFilters < filterLimit; i++)
+	{
+		if (pmtFilters[i].open || pmtFilters[i].done)
+		{
+			continue;
+		}
+		/* Demux may be out of filters, the PID is retried when one is freed */
+		if (Ts_Demux_Set_Section_Filter(pmtFilters[i].pid, PMT_TABLE_ID, 0xFF, PMT_Section_Received,
+										&pmtFilters[i], &pmtFilters[i].handle))
+		{
+			break;
+		}
+		pmtFilters[i].open = 1;
+		numOfOpenFilters++;
+	}
+
+	if (numOfOpenFilters > scan.maxOpenFilters)
+	{
+		scan.maxOpenFilters = numOfOpenFilters;
+	}
+}
+
+void Check_Complete()
+{
+	if (scan.state == CHANNEL_SCAN_WAITING_PMT && scan.numOfReceived == scan.numOfPrograms)
+	{
+		scan.scanTime = Elapsed_Time();
+		scan.state = CHANNEL_SCAN_COMPLETE;
+		active = 0;
+		pthread_cond_broadcast(&scanCondition);
+	}
+}
+
+uint32_t Elapsed_Time()
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - startTime.tv_sec) * 1000 + (now.tv_nsec - startTime.tv_nsec) / 1000000;
+}
@@ -0,0 +1,111 @@
+#ifndef _CHANNEL_SCAN_H_
+#define _CHANNEL_SCAN_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include "ts_demux.h"
+#include "table_parse.h"
+
+#define CHANNEL_SCAN_MAX_PROGRAMS 256
+/* Opens PMT filters for every program at once, as far as the demux allows */
+#define CHANNEL_SCAN_ALL_FILTERS 0
+
+/* Scan states */
+#define CHANNEL_SCAN_IDLE 0
+#define CHANNEL_SCAN_WAITING_PAT 1
+#define CHANNEL_SCAN_WAITING_PMT 2
+#define CHANNEL_SCAN_COMPLETE 3
+
+typedef struct ScanProgram {
+	PATTable pat;
+	PMTTable pmt;
+	uint8_t pmtReceived;
+} ScanProgram;
+
+typedef struct ChannelScanResult {
+	uint32_t state;
+	uint32_t numOfPrograms;
+	uint32_t numOfReceived;
+	/* Milliseconds from the start until the whole PAT was received */
+	uint32_t patTime;
+	/* Milliseconds from the start until the last PMT was received */
+	uint32_t scanTime;
+	/* Most PMT filters that were open at the same time */
+	uint32_t maxOpenFilters;
+	ScanProgram programs[CHANNEL_SCAN_MAX_PROGRAMS];
+} ChannelScanResult;
+
+/***********************************************************************
+* @brief    Channel scan initialization function
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Channel_Scan_Init();
+
+/***********************************************************************
+* @brief    Channel scan deinitialization function, stops the scan
+*
+* @return   EXIT_SUCCESS - no error
+*
+***********************************************************************/
+int32_t Channel_Scan_Deinit();
+
+/***********************************************************************
+* @brief    Starts a scan of the current transport stream. PMT filters
+* 			are opened as soon as a PAT section lists the programs, so
+* 			the scan waits for the slowest PMT instead of all of them
+* 			one after another
+*
+* @param    [in] maxPmtFilters - PMT filters open at the same time,
+* 								 CHANNEL_SCAN_ALL_FILTERS for no limit,
+* 								 1 scans the PMTs one by one
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Channel_Scan_Start(uint32_t maxPmtFilters);
+
+/***********************************************************************
+* @brief    Stops the scan and closes its filters, results stay
+* 			available
+*
+***********************************************************************/
+void Channel_Scan_Stop();
+
+/***********************************************************************
+* @brief    Waits until the scan is complete
+*
+* @param    [in] timeout - milliseconds to wait
+*
+* @return   EXIT_SUCCESS - scan is complete
+* @return   EXIT_FAILURE - timeout
+*
+***********************************************************************/
+int32_t Channel_Scan_Wait(uint32_t timeout);
+
+/***********************************************************************
+* @brief    Returns the state of the scan without copying the results
+*
+* @return   CHANNEL_SCAN_IDLE, CHANNEL_SCAN_WAITING_PAT,
+* 			CHANNEL_SCAN_WAITING_PMT or CHANNEL_SCAN_COMPLETE
+*
+***********************************************************************/
+uint32_t Channel_Scan_Get_State();
+
+/***********************************************************************
+* @brief    Copies the scan results, complete or not
+*
+* @param    [out] result - structure where the results are saved
+*
+***********************************************************************/
+void Channel_Scan_Get_Result(ChannelScanResult* result);
+
+#endif
@@ -0,0 +1,6 @@
+#include "common.h"
+
+uint64_t Time_Difference(const struct timespec* start, const struct timespec* end)
+{
+	return (uint64_t)(end->tv_sec - start->tv_sec) * 1000000 + (end->tv_nsec - start->tv_nsec) / 1000;
+}
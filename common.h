@@ -0,0 +1,22 @@
+#ifndef _COMMON_H_
+#define _COMMON_H_
+
+#include <stdint.h>
+#include <time.h>
+
+/* Condition of the loops of the worker threads, they leave with break */
+#define NON_STOP 1
+
+/***********************************************************************
+* @brief    Returns microseconds from start to end, shared by all
+* 			modules which measure with clock_gettime
+*
+* @param    [in] start - earlier time
+* @param    [in] end - later time
+*
+* @return   microseconds
+*
+***********************************************************************/
+uint64_t Time_Difference(const struct timespec* start, const struct timespec* end);
+
+#endif
@@ -0,0 +1,197 @@
+#include "crc32.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CRC32_HAVE_CLMUL
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+#endif
+
+typedef uint32_t(*Crc32_Kernel)(uint32_t crc, const uint8_t* data, uint32_t size);
+
+/***********************************************************************
+* @brief    Builds the slice-by-8 tables and selects the kernel
+*
+***********************************************************************/
+static void Crc32_Init();
+
+/***********************************************************************
+* @brief    Table driven kernel which consumes 8 bytes per iteration
+*
+* @param    [in] crc - current CRC register
+* @param    [in] data - pointer to data
+* @param    [in] size - number of bytes
+*
+* @return   crc - CRC register after the data
+*
+***********************************************************************/
+static uint32_t Crc32_Slice_By_8(uint32_t crc, const uint8_t* data, uint32_t size);
+
+#ifdef CRC32_HAVE_CLMUL
+/***********************************************************************
+* @brief    Folds 16 bytes per iteration with carry-less multiplies,
+* 			the folded remainder and the tail go through slice-by-8
+*
+* @param    [in] crc - current CRC register
+* @param    [in] data - pointer to data
+* @param    [in] size - number of bytes
+*
+* @return   crc - CRC register after the data
+*
+***********************************************************************/
+static uint32_t Crc32_Clmul(uint32_t crc, const uint8_t* data, uint32_t size);
+#endif
+
+/***********************************************************************
+* @brief    Calculates x^n mod P, used for the folding constants
+*
+* @param    [in] n - exponent
+*
+* @return   remainder - 32 bit remainder
+*
+***********************************************************************/
+static uint32_t Crc32_X_Pow_Mod(uint32_t n);
+
+static uint32_t crcTable[8][256];
+static Crc32_Kernel crcKernel = Crc32_Slice_By_8;
+/* x^192 mod P and x^128 mod P */
+static uint32_t foldConstantHigh;
+static uint32_t foldConstantLow;
+static pthread_once_t crcInitOnce = PTHREAD_ONCE_INIT;
+
+uint32_t Crc32_Calculate(const uint8_t* data, uint32_t size)
+{
+	pthread_once(&crcInitOnce, Crc32_Init);
+	return crcKernel(CRC32_INITIAL_VALUE, data, size);
+}
+
+int32_t Crc32_Check_Section(const uint8_t* section)
+{
+	uint16_t sectionSize;
+
+	/* CRC_32 is present only in sections with the long header */
+	if (!(section[1] & 0x80))
+	{
+		return EXIT_FAILURE;
+	}
+
+	sectionSize = 3 + (((section[1] & 0x0F) << 8) | section[2]);
+	if (sectionSize < 12)
+	{
+		return EXIT_FAILURE;
+	}
+
+	/* Register is zero when the CRC_32 field is included */
+	return Crc32_Calculate(section, sectionSize) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+void Crc32_Init()
+{
+	uint32_t i;
+	uint32_t j;
+	uint32_t crc;
+
+	for (i = 0; i < 256; i++)
+	{
+		crc = i << 24;
+		for (j = 0; j < 8; j++)
+		{
+			crc = (crc & 0x80000000) ? (crc << 1) ^ CRC32_POLYNOMIAL : crc << 1;
+		}
+		crcTable[0][i] = crc;
+	}
+
+	/* Table k gives the contribution of a byte k positions further back */
+	for (i = 0; i < 256; i++)
+	{
+		for (j = 1; j < 8; j++)
+		{
+			crcTable[j][i] = (crcTable[j - 1][i] << 8) ^ crcTable[0][crcTable[j - 1][i] >> 24];
+		}
+	}
+
+	foldConstantHigh = Crc32_X_Pow_Mod(192);
+	foldConstantLow = Crc32_X_Pow_Mod(128);
+
+#ifdef CRC32_HAVE_CLMUL
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3"))
+	{
+		crcKernel = Crc32_Clmul;
+	}
+#endif
+}
+
+uint32_t Crc32_Slice_By_8(uint32_t crc, const uint8_t* data, uint32_t size)
+{
+	while (size >= 8)
+	{
+		crc ^= ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+		crc = crcTable[7][crc >> 24] ^ crcTable[6][(crc >> 16) & 0xFF]
+			  ^ crcTable[5][(crc >> 8) & 0xFF] ^ crcTable[4][crc & 0xFF]
+			  ^ crcTable[3][data[4]] ^ crcTable[2][data[5]]
+			  ^ crcTable[1][data[6]] ^ crcTable[0][data[7]];
+		data += 8;
+		size -= 8;
+	}
+
+	while (size > 0)
+	{
+		crc = (crc << 8) ^ crcTable[0][(crc >> 24) ^ *data];
+		data++;
+		size--;
+	}
+	return crc;
+}
+
+#ifdef CRC32_HAVE_CLMUL
+__attribute__((target("pclmul,ssse3")))
+uint32_t Crc32_Clmul(uint32_t crc, const uint8_t* data, uint32_t size)
+{
+	/* First message byte is the highest coefficient, so bytes are reversed */
+	const __m128i byteReverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	const __m128i foldConstants = _mm_set_epi32(0, foldConstantHigh, 0, foldConstantLow);
+	uint8_t remainder[16];
+	__m128i accumulator;
+	__m128i block;
+
+	if (size < 32)
+	{
+		return Crc32_Slice_By_8(crc, data, size);
+	}
+
+	/* Register is added to the first 32 message bits */
+	accumulator = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)data), byteReverse);
+	accumulator = _mm_xor_si128(accumulator, _mm_set_epi32(crc, 0, 0, 0));
+	data += 16;
+	size -= 16;
+
+	/* A * x^128 + B == hi(A) * (x^192 mod P) + lo(A) * (x^128 mod P) + B */
+	while (size >= 16)
+	{
+		block = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)data), byteReverse);
+		block = _mm_xor_si128(block, _mm_clmulepi64_si128(accumulator, foldConstants, 0x11));
+		accumulator = _mm_xor_si128(block, _mm_clmulepi64_si128(accumulator, foldConstants, 0x00));
+		data += 16;
+		size -= 16;
+	}
+
+	/* Folded value is a 16 byte message with the same remainder */
+	_mm_storeu_si128((__m128i*)remainder, _mm_shuffle_epi8(accumulator, byteReverse));
+	crc = Crc32_Slice_By_8(0, remainder, 16);
+	return Crc32_Slice_By_8(crc, data, size);
+}
+#endif
+
+uint32_t Crc32_X_Pow_Mod(uint32_t n)
+{
+	/* Starts from x^0 and is multiplied by x n times */
+	uint32_t remainder = 1;
+	uint32_t i;
+
+	for (i = 0; i < n; i++)
+	{
+		remainder = (remainder & 0x80000000) ? (remainder << 1) ^ CRC32_POLYNOMIAL : remainder << 1;
+	}
+	return remainder;
+}
@@ -0,0 +1,38 @@
+#ifndef _CRC32_H_
+#define _CRC32_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/* MPEG-2 CRC_32, ISO/IEC 13818-1 Annex A */
+#define CRC32_POLYNOMIAL 0x04C11DB7
+#define CRC32_INITIAL_VALUE 0xFFFFFFFF
+
+/***********************************************************************
+* @brief    Calculates the MPEG-2 CRC_32 of the data, on x86 with
+* 			PCLMULQDQ a carry-less multiply kernel is used, otherwise
+* 			the slice-by-8 table kernel
+*
+* @param    [in] data - pointer to data
+* @param    [in] size - number of bytes
+*
+* @return   crc - CRC_32 of the data
+*
+***********************************************************************/
+uint32_t Crc32_Calculate(const uint8_t* data, uint32_t size);
+
+/***********************************************************************
+* @brief    Checks the CRC_32 at the end of a section with
+* 			section_syntax_indicator set
+*
+* @param    [in] section - pointer to the section, starting at table_id
+*
+* @return   EXIT_SUCCESS - CRC_32 is correct
+* @return   EXIT_FAILURE - section is corrupted
+*
+***********************************************************************/
+int32_t Crc32_Check_Section(const uint8_t* section);
+
+#endif
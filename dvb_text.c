@@ -0,0 +1,285 @@
+#include "dvb_text.h"
+
+#define TABLE_ISO6937 0
+#define TABLE_ISO8859_1 1
+#define TABLE_ISO8859_2 2
+#define TABLE_ISO8859_5 5
+#define TABLE_ISO8859_15 15
+#define TABLE_UCS2 0x11
+#define TABLE_UTF8 0x15
+#define TABLE_UNSUPPORTED 0xFF
+
+/* Control codes, A.1 */
+#define CONTROL_CR_LF 0x8A
+#define REPLACEMENT_CHARACTER '?'
+
+/***********************************************************************
+* @brief    Maps a character of a single byte table to Unicode
+*
+* @param    [in] table - selected character table
+* @param    [in] character - character code, 0xA0 or higher
+*
+* @return   Unicode code point, 0 if the character is not defined
+*
+***********************************************************************/
+static uint16_t Map_Upper_Half(uint8_t table, uint8_t character);
+
+/***********************************************************************
+* @brief    Writes one code point as UTF-8 if it fits with the
+* 			terminating zero, otherwise marks the output as full so
+* 			that the text is only cut at the end
+*
+* @param    [in] codePoint - Unicode code point
+* @param    [out] output - output buffer
+* @param    [in,out] position - current position in the output buffer
+* @param    [in] outputSize - size of the output buffer
+*
+***********************************************************************/
+static void Put_Utf8(uint16_t codePoint, char* output, uint32_t* position, uint32_t outputSize);
+
+/* ISO/IEC 6937 0xA0 - 0xFF, 0xC1 - 0xCF are non-spacing diacritical marks */
+static const uint16_t iso6937Table[96] = {
+	0x00A0, 0x00A1, 0x00A2, 0x00A3, 0x0024, 0x00A5, 0x0023, 0x00A7,
+	0x00A4, 0x2018, 0x201C, 0x00AB, 0x2190, 0x2191, 0x2192, 0x2193,
+	0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x00D7, 0x00B5, 0x00B6, 0x00B7,
+	0x00F7, 0x2019, 0x201D, 0x00BB, 0x00BC, 0x00BD, 0x00BE, 0x00BF,
+	0x0000, 0x0300, 0x0301, 0x0302, 0x0303, 0x0304, 0x0306, 0x0307,
+	0x0308, 0x0000, 0x030A, 0x0327, 0x0000, 0x030B, 0x0328, 0x030C,
+	0x2015, 0x00B9, 0x00AE, 0x00A9, 0x2122, 0x266A, 0x00AC, 0x00A6,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x215B, 0x215C, 0x215D, 0x215E,
+	0x2126, 0x00C6, 0x0110, 0x00AA, 0x0126, 0x0000, 0x0132, 0x013F,
+	0x0141, 0x00D8, 0x0152, 0x00BA, 0x00DE, 0x0166, 0x014A, 0x0149,
+	0x0138, 0x00E6, 0x0111, 0x00F0, 0x0127, 0x0131, 0x0133, 0x0140,
+	0x0142, 0x00F8, 0x0153, 0x00DF, 0x00FE, 0x0167, 0x014B, 0x00AD
+};
+
+/* ISO/IEC 8859-2 0xA0 - 0xFF */
+static const uint16_t iso8859_2Table[96] = {
+	0x00A0, 0x0104, 0x02D8, 0x0141, 0x00A4, 0x013D, 0x015A, 0x00A7,
+	0x00A8, 0x0160, 0x015E, 0x0164, 0x0179, 0x00AD, 0x017D, 0x017B,
+	0x00B0, 0x0105, 0x02DB, 0x0142, 0x00B4, 0x013E, 0x015B, 0x02C7,
+	0x00B8, 0x0161, 0x015F, 0x0165, 0x017A, 0x02DD, 0x017E, 0x017C,
+	0x0154, 0x00C1, 0x00C2, 0x0102, 0x00C4, 0x0139, 0x0106, 0x00C7,
+	0x010C, 0x00C9, 0x0118, 0x00CB, 0x011A, 0x00CD, 0x00CE, 0x010E,
+	0x0110, 0x0143, 0x0147, 0x00D3, 0x00D4, 0x0150, 0x00D6, 0x00D7,
+	0x0158, 0x016E, 0x00DA, 0x0170, 0x00DC, 0x00DD, 0x0162, 0x00DF,
+	0x0155, 0x00E1, 0x00E2, 0x0103, 0x00E4, 0x013A, 0x0107, 0x00E7,
+	0x010D, 0x00E9, 0x0119, 0x00EB, 0x011B, 0x00ED, 0x00EE, 0x010F,
+	0x0111, 0x0144, 0x0148, 0x00F3, 0x00F4, 0x0151, 0x00F6, 0x00F7,
+	0x0159, 0x016F, 0x00FA, 0x0171, 0x00FC, 0x00FD, 0x0163, 0x02D9
+};
+
+uint32_t Dvb_Text_To_Utf8(const uint8_t* text, uint32_t length, char* output, uint32_t outputSize)
+{
+	uint32_t i = 0;
+	uint32_t position = 0;
+	uint32_t sequenceLength;
+	uint8_t table = TABLE_ISO6937;
+	uint16_t codePoint;
+	uint16_t diacriticalMark = 0;
+
+	if (outputSize == 0)
+	{
+		return 0;
+	}
+
+	/* First byte selects the character table */
+	if (length > 0 && text[0] < 0x20)
+	{
+		if (text[0] >= 0x01 && text[0] <= 0x0B)
+		{
+			table = text[0] + 4;
+			i = 1;
+		}
+		else if (text[0] == 0x10 && length >= 3)
+		{
+			table = text[2];
+			i = 3;
+		}
+		else
+		{
+			table = text[0];
+			i = 1;
+		}
+
+		if (table != TABLE_ISO8859_1 && table != TABLE_ISO8859_2 && table != TABLE_ISO8859_5
+			&& table != TABLE_ISO8859_15 && table != TABLE_UCS2 && table != TABLE_UTF8)
+		{
+			table = TABLE_UNSUPPORTED;
+		}
+	}
+
+	while (i < length)
+	{
+		if (table == TABLE_UTF8)
+		{
+			/* Only whole sequences are copied */
+			if (text[i] < 0x80)
+			{
+				sequenceLength = 1;
+			}
+			else if ((text[i] & 0xE0) == 0xC0)
+			{
+				sequenceLength = 2;
+			}
+			else if ((text[i] & 0xF0) == 0xE0)
+			{
+				sequenceLength = 3;
+			}
+			else if ((text[i] & 0xF8) == 0xF0)
+			{
+				sequenceLength = 4;
+			}
+			else
+			{
+				sequenceLength = 0;
+			}
+
+			if (sequenceLength == 0 || i + sequenceLength > length)
+			{
+				Put_Utf8(REPLACEMENT_CHARACTER, output, &position, outputSize);
+				i++;
+				continue;
+			}
+			if (position + sequenceLength >= outputSize)
+			{
+				break;
+			}
+			while (sequenceLength--)
+			{
+				output[position++] = text[i++];
+			}
+			continue;
+		}
+
+		if (table == TABLE_UCS2)
+		{
+			if (i + 1 >= length)
+			{
+				break;
+			}
+			codePoint = (text[i] << 8) | text[i + 1];
+			i += 2;
+			/* Control codes are mapped to 0xE080 - 0xE09F */
+			if (codePoint == 0xE000 + CONTROL_CR_LF)
+			{
+				codePoint = ' ';
+			}
+			else if (codePoint >= 0xE080 && codePoint <= 0xE09F)
+			{
+				continue;
+			}
+			Put_Utf8(codePoint, output, &position, outputSize);
+			continue;
+		}
+
+		codePoint = text[i++];
+		if (codePoint >= 0x80 && codePoint < 0xA0)
+		{
+			if (codePoint == CONTROL_CR_LF)
+			{
+				Put_Utf8(' ', output, &position, outputSize);
+			}
+			continue;
+		}
+		if (codePoint < 0x20)
+		{
+			continue;
+		}
+
+		if (codePoint >= 0xA0)
+		{
+			codePoint = Map_Upper_Half(table, codePoint);
+			if (codePoint == 0)
+			{
+				codePoint = REPLACEMENT_CHARACTER;
+			}
+		}
+
+		/* 6937 puts the mark before the letter, Unicode after it */
+		if (table == TABLE_ISO6937 && codePoint >= 0x0300 && codePoint <= 0x036F)
+		{
+			diacriticalMark = codePoint;
+			continue;
+		}
+		Put_Utf8(codePoint, output, &position, outputSize);
+		if (diacriticalMark != 0)
+		{
+			Put_Utf8(diacriticalMark, output, &position, outputSize);
+			diacriticalMark = 0;
+		}
+	}
+
+	output[position] = '\0';
+	return position;
+}
+
+uint16_t Map_Upper_Half(uint8_t table, uint8_t character)
+{
+	switch (table)
+	{
+		case TABLE_ISO6937:
+			return iso6937Table[character - 0xA0];
+		case TABLE_ISO8859_1:
+			return character;
+		case TABLE_ISO8859_2:
+			return iso8859_2Table[character - 0xA0];
+		case TABLE_ISO8859_5:
+			/* Cyrillic is contiguous except for these three */
+			if (character == 0xA0 || character == 0xAD)
+			{
+				return character;
+			}
+			if (character == 0xF0)
+			{
+				return 0x2116;
+			}
+			if (character == 0xFD)
+			{
+				return 0x00A7;
+			}
+			return character + 0x0360;
+		case TABLE_ISO8859_15:
+			switch (character)
+			{
+				case 0xA4: return 0x20AC;
+				case 0xA6: return 0x0160;
+				case 0xA8: return 0x0161;
+				case 0xB4: return 0x017D;
+				case 0xB8: return 0x017E;
+				case 0xBC: return 0x0152;
+				case 0xBD: return 0x0153;
+				case 0xBE: return 0x0178;
+				default: return character;
+			}
+		default:
+			return 0;
+	}
+}
+
+void Put_Utf8(uint16_t codePoint, char* output, uint32_t* position, uint32_t outputSize)
+{
+	uint32_t size = codePoint < 0x80 ? 1 : (codePoint < 0x800 ? 2 : 3);
+
+	if (*position + size >= outputSize)
+	{
+		*position = outputSize - 1;
+		return;
+	}
+
+	if (size == 1)
+	{
+		output[(*position)++] = codePoint;
+	}
+	else if (size == 2)
+	{
+		output[(*position)++] = 0xC0 | (codePoint >> 6);
+		output[(*position)++] = 0x80 | (codePoint & 0x3F);
+	}
+	else
+	{
+		output[(*position)++] = 0xE0 | (codePoint >> 12);
+		output[(*position)++] = 0x80 | ((codePoint >> 6) & 0x3F);
+		output[(*position)++] = 0x80 | (codePoint & 0x3F);
+	}
+}
@@ -0,0 +1,25 @@
+#ifndef _DVB_TEXT_H_
+#define _DVB_TEXT_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+/***********************************************************************
+* @brief    Converts a DVB text field (EN 300 468 Annex A) to UTF-8.
+* 			Supported are the default ISO/IEC 6937 table, ISO/IEC
+* 			8859-1, -2, -5 and -15, UCS-2 and UTF-8, characters of other
+* 			tables are replaced by '?'. Emphasis codes are dropped and
+* 			the CR/LF code becomes a space
+*
+* @param    [in] text - pointer to the text field, with the selector
+* @param    [in] length - length of the text field
+* @param    [out] output - buffer for the zero terminated UTF-8 string
+* @param    [in] outputSize - size of the output buffer
+*
+* @return   number of bytes written, without the terminating zero
+*
+***********************************************************************/
+uint32_t Dvb_Text_To_Utf8(const uint8_t* text, uint32_t length, char* output, uint32_t outputSize);
+
+#endif
@@ -0,0 +1,675 @@
+#include "epg_store.h"
+
+#define EPG_STRING_HASH_SIZE (1 << EPG_STRING_HASH_BITS)
+#define EPG_NO_SERVICE 0xFFFF
+#define EPG_NO_STRING 0xFFFFFFFF
+/* Every string has a 4 byte header with the aligned payload length */
+#define STRING_HEADER_SIZE 4
+#define MAX_LIVE_STRINGS (EPG_MAX_SERVICES * EPG_MAX_EVENTS_PER_SERVICE)
+#define MAX_STRINGS (EPG_STRING_HASH_SIZE / 4 * 3)
+/* Compaction runs again only after this much new data was interned, small
+   enough that the arena can still be compacted when it is mostly live */
+#define COMPACTION_THRESHOLD (EPG_STRING_ARENA_SIZE / 16)
+
+/* 16 bytes per event, the strings are kept in the arena */
+typedef struct EpgEvent {
+	uint32_t startTime;
+	uint32_t duration;
+	/* Offset of "name\0text\0" in the arena */
+	uint32_t stringOffset;
+	uint16_t eventId;
+	uint8_t runningStatus;
+	uint8_t reserved;
+} EpgEvent;
+
+typedef struct EpgService {
+	uint16_t serviceId;
+	uint16_t numOfEvents;
+	/* Sorted by start time, events never overlap */
+	EpgEvent events[EPG_MAX_EVENTS_PER_SERVICE];
+} EpgService;
+
+typedef struct EpgStagedEvent {
+	uint16_t serviceId;
+	/* Order of arrival, later events win */
+	uint16_t sequence;
+	EpgEvent event;
+} EpgStagedEvent;
+
+/***********************************************************************
+* @brief    Returns the arena offset of the name and text, adds them if
+* 			they are not there yet. Called with the writer mutex locked
+*
+* @param    [in] eventName - zero terminated event name
+* @param    [in] eventText - zero terminated event description
+*
+* @return   offset of the strings, EPG_NO_STRING if the arena is full
+*
+***********************************************************************/
+static uint32_t Intern_Strings(const char* eventName, const char* eventText);
+
+/***********************************************************************
+* @brief    Copies the strings which are still used to the start of the
+* 			other arena and rebuilds the hash. Readers keep using the
+* 			current arena until the new one and the new offsets are
+* 			published together. Called with the writer mutex locked
+* 			and an empty batch
+*
+***********************************************************************/
+static void Compact_Strings();
+
+/***********************************************************************
+* @brief    Merges the batch into the store. Called with the writer
+* 			mutex locked
+*
+***********************************************************************/
+static void Commit_Batch();
+
+/***********************************************************************
+* @brief    Merges the batched events of one service with its stored
+* 			events, stored events overlapped by new ones are removed
+*
+* @param    [in] service - service to update
+* @param    [in] staged - batched events sorted by start time
+* @param    [in] numOfStaged - number of batched events
+*
+***********************************************************************/
+static void Merge_Events(EpgService* service, EpgStagedEvent* staged, uint32_t numOfStaged);
+
+/***********************************************************************
+* @brief    Copies a stored event with its strings
+*
+* @param    [in] serviceId - service of the event
+* @param    [in] storedEvent - event in the store
+* @param    [out] event - where the event is copied
+*
+***********************************************************************/
+static void Copy_Event(uint16_t serviceId, const EpgEvent* storedEvent, EITEvent* event);
+
+/***********************************************************************
+* @brief    Starts a read, waits while a commit is running
+*
+* @return   sequence number which has to be passed to Read_Retry
+*
+***********************************************************************/
+static uint32_t Read_Begin();
+
+/***********************************************************************
+* @brief    Checks if a commit ran during the read
+*
+* @param    [in] sequence - value returned by Read_Begin
+*
+* @return   1 - data could be torn, read again
+* @return   0 - data is consistent
+*
+***********************************************************************/
+static uint32_t Read_Retry(uint32_t sequence);
+
+static int Compare_Staged_Events(const void* first, const void* second);
+static int Compare_Offsets(const void* first, const void* second);
+
+/* Compaction copies the live strings to the arena which is not read */
+static char stringArenas[2][EPG_STRING_ARENA_SIZE];
+
+/* Data read by the readers, protected by the sequence number */
+static EpgService services[EPG_MAX_SERVICES];
+static uint16_t serviceIndex[65536];
+static char* stringArena = stringArenas[0];
+static uint32_t sequenceNumber = 0;
+
+/* Writer side, protected by the mutex */
+static uint32_t numOfServices = 0;
+static uint32_t arenaUsed = 0;
+static uint32_t compactedSize = 0;
+static uint32_t compactedStrings = 0;
+static uint32_t stringHash[EPG_STRING_HASH_SIZE];
+static EpgStagedEvent batch[EPG_BATCH_SIZE];
+static uint32_t numOfBatched = 0;
+static EpgEvent mergedEvents[2 * EPG_MAX_EVENTS_PER_SERVICE];
+static uint32_t liveOffsets[MAX_LIVE_STRINGS];
+static uint32_t newOffsets[MAX_LIVE_STRINGS];
+/* String offsets of all stored events, in store order */
+static uint32_t eventOffsets[MAX_LIVE_STRINGS];
+static EpgStoreStatistics statistics;
+static pthread_mutex_t epgMutex;
+
+int32_t Epg_Store_Init()
+{
+	if (pthread_mutex_init(&epgMutex, NULL))
+	{
+		printf("%s(%d): Error initializing EPG mutex!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+	Epg_Store_Clear();
+	return EXIT_SUCCESS;
+}
+
+int32_t Epg_Store_Deinit()
+{
+	pthread_mutex_destroy(&epgMutex);
+	return EXIT_SUCCESS;
+}
+
+void Epg_Store_Clear()
+{
+	pthread_mutex_lock(&epgMutex);
+	__atomic_store_n(&sequenceNumber, sequenceNumber + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	/* 0xFF bytes give EPG_NO_SERVICE */
+	memset(serviceIndex, 0xFF, sizeof(serviceIndex));
+	numOfServices = 0;
+	arenaUsed = 0;
+	compactedSize = 0;
+	compactedStrings = 0;
+	memset(stringHash, 0, sizeof(stringHash));
+	numOfBatched = 0;
+	memset(&statistics, 0, sizeof(statistics));
+
+	__atomic_store_n(&sequenceNumber, sequenceNumber + 1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&epgMutex);
+}
+
+int32_t Epg_Store_Add_Events(const EITEvent* eventTable, uint32_t numOfEvents)
+{
+	uint32_t i;
+	uint32_t stringOffset;
+	EpgStagedEvent* staged;
+	int32_t ret = EXIT_SUCCESS;
+
+	pthread_mutex_lock(&epgMutex);
+	for (i = 0; i < numOfEvents; i++)
+	{
+		if (eventTable[i].startTime == 0)
+		{
+			statistics.droppedEvents++;
+			ret = EXIT_FAILURE;
+			continue;
+		}
+
+		/* New strings go after arenaUsed, readers do not see them yet */
+		stringOffset = Intern_Strings(eventTable[i].eventName, eventTable[i].eventText);
+		/* Compacting an arena full of live strings would only waste time */
+		if (stringOffset == EPG_NO_STRING && (arenaUsed - compactedSize >= COMPACTION_THRESHOLD
+			|| statistics.numOfStrings - compactedStrings >= MAX_STRINGS / 8))
+		{
+			Commit_Batch();
+			Compact_Strings();
+			stringOffset = Intern_Strings(eventTable[i].eventName, eventTable[i].eventText);
+		}
+		if (stringOffset == EPG_NO_STRING)
+		{
+			statistics.droppedEvents++;
+			ret = EXIT_FAILURE;
+			continue;
+		}
+
+		staged = &batch[numOfBatched];
+		staged->serviceId = eventTable[i].serviceId;
+		staged->sequence = numOfBatched;
+		staged->event.startTime = eventTable[i].startTime;
+		staged->event.duration = eventTable[i].duration;
+		staged->event.stringOffset = stringOffset;
+		staged->event.eventId = eventTable[i].eventId;
+		staged->event.runningStatus = eventTable[i].runningStatus;
+		staged->event.reserved = 0;
+		if (++numOfBatched == EPG_BATCH_SIZE)
+		{
+			Commit_Batch();
+		}
+	}
+	pthread_mutex_unlock(&epgMutex);
+	return ret;
+}
+
+void Epg_Store_Commit()
+{
+	pthread_mutex_lock(&epgMutex);
+	Commit_Batch();
+	pthread_mutex_unlock(&epgMutex);
+}
+
+int32_t Epg_Store_Get_Event_At(uint16_t serviceId, uint32_t time, EITEvent* event)
+{
+	uint32_t sequence;
+	uint32_t index;
+	uint32_t low;
+	uint32_t high;
+	uint32_t middle;
+	const EpgService* service;
+	int32_t ret;
+
+	do
+	{
+		sequence = Read_Begin();
+		ret = EXIT_FAILURE;
+		index = serviceIndex[serviceId];
+		if (index >= EPG_MAX_SERVICES)
+		{
+			continue;
+		}
+		service = &services[index];
+
+		/* Last event which starts at or before the time */
+		low = 0;
+		high = service->numOfEvents;
+		if (high > EPG_MAX_EVENTS_PER_SERVICE)
+		{
+			continue;
+		}
+		while (low < high)
+		{
+			middle = (low + high) / 2;
+			if (service->events[middle].startTime <= time)
+			{
+				low = middle + 1;
+			}
+			else
+			{
+				high = middle;
+			}
+		}
+		if (low > 0 && time - service->events[low - 1].startTime < service->events[low - 1].duration)
+		{
+			Copy_Event(serviceId, &service->events[low - 1], event);
+			ret = EXIT_SUCCESS;
+		}
+	} while (Read_Retry(sequence));
+
+	return ret;
+}
+
+uint32_t Epg_Store_Get_Events(uint16_t serviceId, uint32_t startTime, uint32_t endTime,
+							  EITEvent* eventTable, uint32_t maxEvents)
+{
+	uint32_t sequence;
+	uint32_t index;
+	uint32_t low;
+	uint32_t high;
+	uint32_t middle;
+	uint32_t count;
+	const EpgService* service;
+	const EpgEvent* storedEvent;
+
+	do
+	{
+		sequence = Read_Begin();
+		count = 0;
+		index = serviceIndex[serviceId];
+		if (index >= EPG_MAX_SERVICES)
+		{
+			continue;
+		}
+		service = &services[index];
+
+		/* Events do not overlap, so the end times are sorted too */
+		low = 0;
+		high = service->numOfEvents;
+		if (high > EPG_MAX_EVENTS_PER_SERVICE)
+		{
+			continue;
+		}
+		while (low < high)
+		{
+			middle = (low + high) / 2;
+			storedEvent = &service->events[middle];
+			if (storedEvent->startTime + storedEvent->duration <= startTime)
+			{
+				low = middle + 1;
+			}
+			else
+			{
+				high = middle;
+			}
+		}
+
+		for (; low < service->numOfEvents && low < EPG_MAX_EVENTS_PER_SERVICE && count < maxEvents; low++)
+		{
+			if (service->events[low].startTime >= endTime)
+			{
+				break;
+			}
+			Copy_Event(serviceId, &service->events[low], &eventTable[count]);
+			count++;
+		}
+	} while (Read_Retry(sequence));
+
+	return count;
+}
+
+void Epg_Store_Get_Statistics(EpgStoreStatistics* outStatistics)
+{
+	pthread_mutex_lock(&epgMutex);
+	*outStatistics = statistics;
+	outStatistics->numOfServices = numOfServices;
+	outStatistics->stringBytes = arenaUsed;
+	outStatistics->readRetries = __atomic_load_n(&statistics.readRetries, __ATOMIC_RELAXED);
+	outStatistics->memorySize = sizeof(services) + sizeof(serviceIndex) + sizeof(stringArenas)
+								+ sizeof(stringHash) + sizeof(batch) + sizeof(mergedEvents)
+								+ sizeof(liveOffsets) + sizeof(newOffsets) + sizeof(eventOffsets);
+	pthread_mutex_unlock(&epgMutex);
+}
+
+uint32_t Intern_Strings(const char* eventName, const char* eventText)
+{
+	uint32_t nameLength = strlen(eventName) + 1;
+	uint32_t textLength = strlen(eventText) + 1;
+	uint32_t payloadLength = (nameLength + textLength + 3) & ~3;
+	uint32_t hash = 2166136261u;
+	uint32_t slot;
+	uint32_t offset;
+	uint32_t i;
+
+	/* FNV-1a over both strings with their terminating zeros */
+	for (i = 0; i < nameLength; i++)
+	{
+		hash = (hash ^ (uint8_t)eventName[i]) * 16777619u;
+	}
+	for (i = 0; i < textLength; i++)
+	{
+		hash = (hash ^ (uint8_t)eventText[i]) * 16777619u;
+	}
+
+	slot = hash & (EPG_STRING_HASH_SIZE - 1);
+	while (stringHash[slot] != 0)
+	{
+		/* Slots keep offset + 1 so that 0 means empty */
+		offset = stringHash[slot] - 1;
+		if (memcmp(stringArena + offset, eventName, nameLength) == 0
+			&& memcmp(stringArena + offset + nameLength, eventText, textLength) == 0)
+		{
+			statistics.internedStrings++;
+			return offset;
+		}
+		slot = (slot + 1) & (EPG_STRING_HASH_SIZE - 1);
+	}
+
+	/* Hash is kept at most 3/4 full so that probing stays short */
+	if (arenaUsed + STRING_HEADER_SIZE + payloadLength > EPG_STRING_ARENA_SIZE
+		|| statistics.numOfStrings >= MAX_STRINGS)
+	{
+		return EPG_NO_STRING;
+	}
+
+	*(uint32_t*)(stringArena + arenaUsed) = payloadLength;
+	offset = arenaUsed + STRING_HEADER_SIZE;
+	memcpy(stringArena + offset, eventName, nameLength);
+	memcpy(stringArena + offset + nameLength, eventText, textLength);
+	arenaUsed = offset + payloadLength;
+	stringHash[slot] = offset + 1;
+	statistics.numOfStrings++;
+	return offset;
+}
+
+void Compact_Strings()
+{
+	uint32_t numOfEvents = 0;
+	uint32_t numOfUnique = 0;
+	uint32_t writeOffset = 0;
+	uint32_t payloadLength;
+	uint32_t i;
+	uint32_t j;
+	uint32_t slot;
+	uint32_t hash;
+	uint32_t* found;
+	const uint8_t* payload;
+	char* newArena = (stringArena == stringArenas[0]) ? stringArenas[1] : stringArenas[0];
+
+	for (i = 0; i < numOfServices; i++)
+	{
+		for (j = 0; j < services[i].numOfEvents; j++)
+		{
+			eventOffsets[numOfEvents++] = services[i].events[j].stringOffset;
+		}
+	}
+	memcpy(liveOffsets, eventOffsets, numOfEvents * sizeof(uint32_t));
+	qsort(liveOffsets, numOfEvents, sizeof(uint32_t), Compare_Offsets);
+	for (i = 0; i < numOfEvents; i++)
+	{
+		if (numOfUnique == 0 || liveOffsets[numOfUnique - 1] != liveOffsets[i])
+		{
+			liveOffsets[numOfUnique++] = liveOffsets[i];
+		}
+	}
+
+	/* Readers do not look at the other arena, nothing is published yet */
+	for (i = 0; i < numOfUnique; i++)
+	{
+		payloadLength = *(uint32_t*)(stringArena + liveOffsets[i] - STRING_HEADER_SIZE);
+		memcpy(newArena + writeOffset, stringArena + liveOffsets[i] - STRING_HEADER_SIZE,
+			   STRING_HEADER_SIZE + payloadLength);
+		newOffsets[i] = writeOffset + STRING_HEADER_SIZE;
+		writeOffset += STRING_HEADER_SIZE + payloadLength;
+	}
+	for (i = 0; i < numOfEvents; i++)
+	{
+		found = bsearch(&eventOffsets[i], liveOffsets, numOfUnique, sizeof(uint32_t), Compare_Offsets);
+		eventOffsets[i] = newOffsets[found - liveOffsets];
+	}
+
+	/* Write section only switches the arena and stores the offsets */
+	__atomic_store_n(&sequenceNumber, sequenceNumber + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	__atomic_store_n(&stringArena, newArena, __ATOMIC_RELAXED);
+	numOfEvents = 0;
+	for (i = 0; i < numOfServices; i++)
+	{
+		for (j = 0; j < services[i].numOfEvents; j++)
+		{
+			services[i].events[j].stringOffset = eventOffsets[numOfEvents++];
+		}
+	}
+
+	__atomic_store_n(&sequenceNumber, sequenceNumber + 1, __ATOMIC_RELEASE);
+
+	/* Hash is writer only, it is rebuilt outside of the write section */
+	memset(stringHash, 0, sizeof(stringHash));
+	for (i = 0; i < numOfUnique; i++)
+	{
+		payload = (const uint8_t*)stringArena + newOffsets[i];
+		payloadLength = strlen((const char*)payload) + 1;
+		payloadLength += strlen((const char*)payload + payloadLength) + 1;
+		hash = 2166136261u;
+		for (j = 0; j < payloadLength; j++)
+		{
+			hash = (hash ^ payload[j]) * 16777619u;
+		}
+		slot = hash & (EPG_STRING_HASH_SIZE - 1);
+		while (stringHash[slot] != 0)
+		{
+			slot = (slot + 1) & (EPG_STRING_HASH_SIZE - 1);
+		}
+		stringHash[slot] = newOffsets[i] + 1;
+	}
+	arenaUsed = writeOffset;
+	compactedSize = writeOffset;
+	compactedStrings = numOfUnique;
+	statistics.numOfStrings = numOfUnique;
+	statistics.compactions++;
+}
+
+void Commit_Batch()
+{
+	uint32_t first;
+	uint32_t last;
+	uint32_t index;
+
+	if (numOfBatched == 0)
+	{
+		return;
+	}
+
+	/* Sorting outside of the write section keeps it short */
+	qsort(batch, numOfBatched, sizeof(EpgStagedEvent), Compare_Staged_Events);
+
+	__atomic_store_n(&sequenceNumber, sequenceNumber + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	for (first = 0; first < numOfBatched; first = last)
+	{
+		for (last = first + 1; last < numOfBatched && batch[last].serviceId == batch[first].serviceId; last++);
+
+		index = serviceIndex[batch[first].serviceId];
+		if (index == EPG_NO_SERVICE)
+		{
+			if (numOfServices == EPG_MAX_SERVICES)
+			{
+				statistics.droppedEvents += last - first;
+				continue;
+			}
+			index = numOfServices++;
+			services[index].serviceId = batch[first].serviceId;
+			services[index].numOfEvents = 0;
+			serviceIndex[batch[first].serviceId] = index;
+		}
+		statistics.numOfEvents -= services[index].numOfEvents;
+		Merge_Events(&services[index], &batch[first], last - first);
+		statistics.numOfEvents += services[index].numOfEvents;
+	}
+
+	__atomic_store_n(&sequenceNumber, sequenceNumber + 1, __ATOMIC_RELEASE);
+
+	numOfBatched = 0;
+	statistics.commits++;
+}
+
+void Merge_Events(EpgService* service, EpgStagedEvent* staged, uint32_t numOfStaged)
+{
+	uint32_t numOfKept = 0;
+	uint32_t numOfMerged = 0;
+	uint32_t i = 0;
+	uint32_t j = 0;
+	uint32_t k;
+	const EpgEvent* storedEvent;
+	const EpgEvent* newEvent;
+
+	/* Overlapping events of one batch, the later one wins */
+	for (k = 0; k < numOfStaged; k++)
+	{
+		if (numOfKept > 0
+			&& staged[k].event.startTime < staged[numOfKept - 1].event.startTime + staged[numOfKept - 1].event.duration)
+		{
+			if (staged[k].sequence > staged[numOfKept - 1].sequence
+				|| staged[k].event.startTime == staged[numOfKept - 1].event.startTime)
+			{
+				staged[numOfKept - 1] = staged[k];
+			}
+			continue;
+		}
+		staged[numOfKept++] = staged[k];
+	}
+
+	/* Both lists are sorted, stored events overlapped by new ones are dropped */
+	while (i < service->numOfEvents || j < numOfKept)
+	{
+		if (j < numOfKept && (i == service->numOfEvents || staged[j].event.startTime <= service->events[i].startTime))
+		{
+			mergedEvents[numOfMerged++] = staged[j++].event;
+			continue;
+		}
+
+		storedEvent = &service->events[i++];
+		if (j > 0)
+		{
+			newEvent = &staged[j - 1].event;
+			if (storedEvent->startTime < newEvent->startTime + newEvent->duration
+				|| storedEvent->startTime == newEvent->startTime)
+			{
+				continue;
+			}
+		}
+		if (j < numOfKept)
+		{
+			newEvent = &staged[j].event;
+			if (newEvent->startTime < storedEvent->startTime + storedEvent->duration)
+			{
+				continue;
+			}
+		}
+		mergedEvents[numOfMerged++] = *storedEvent;
+	}
+
+	/* Oldest events are dropped when the service is full */
+	k = numOfMerged > EPG_MAX_EVENTS_PER_SERVICE ? numOfMerged - EPG_MAX_EVENTS_PER_SERVICE : 0;
+	memcpy(service->events, mergedEvents + k, (numOfMerged - k) * sizeof(EpgEvent));
+	service->numOfEvents = numOfMerged - k;
+}
+
+void Copy_Event(uint16_t serviceId, const EpgEvent* storedEvent, EITEvent* event)
+{
+	const char* arena = __atomic_load_n(&stringArena, __ATOMIC_RELAXED);
+	uint32_t offset = storedEvent->stringOffset;
+	uint32_t i;
+
+	event->serviceId = serviceId;
+	event->eventId = storedEvent->eventId;
+	event->startTime = storedEvent->startTime;
+	event->duration = storedEvent->duration;
+	event->runningStatus = storedEvent->runningStatus;
+
+	/* Offset and arena may be torn by a commit, copies stay inside the arena */
+	for (i = 0; i < EVENT_NAME_SIZE - 1 && offset < EPG_STRING_ARENA_SIZE && arena[offset] != '\0'; i++)
+	{
+		event->eventName[i] = arena[offset++];
+	}
+	event->eventName[i] = '\0';
+	while (offset < EPG_STRING_ARENA_SIZE && arena[offset] != '\0')
+	{
+		offset++;
+	}
+	offset++;
+	for (i = 0; i < EVENT_TEXT_SIZE - 1 && offset < EPG_STRING_ARENA_SIZE && arena[offset] != '\0'; i++)
+	{
+		event->eventText[i] = arena[offset++];
+	}
+	event->eventText[i] = '\0';
+}
+
+uint32_t Read_Begin()
+{
+	uint32_t sequence = __atomic_load_n(&sequenceNumber, __ATOMIC_ACQUIRE);
+
+	/* Odd number means that a commit is running */
+	if (sequence & 1)
+	{
+		__atomic_fetch_add(&statistics.readRetries, 1, __ATOMIC_RELAXED);
+		while ((sequence = __atomic_load_n(&sequenceNumber, __ATOMIC_ACQUIRE)) & 1);
+	}
+	return sequence;
+}
+
+uint32_t Read_Retry(uint32_t sequence)
+{
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if (__atomic_load_n(&sequenceNumber, __ATOMIC_RELAXED) != sequence)
+	{
+		__atomic_fetch_add(&statistics.readRetries, 1, __ATOMIC_RELAXED);
+		return 1;
+	}
+	return 0;
+}
+
+int Compare_Staged_Events(const void* first, const void* second)
+{
+	const EpgStagedEvent* a = (const EpgStagedEvent*)first;
+	const EpgStagedEvent* b = (const EpgStagedEvent*)second;
+
+	if (a->serviceId != b->serviceId)
+	{
+		return a->serviceId < b->serviceId ? -1 : 1;
+	}
+	if (a->event.startTime != b->event.startTime)
+	{
+		return a->event.startTime < b->event.startTime ? -1 : 1;
+	}
+	return a->sequence < b->sequence ? -1 : (a->sequence > b->sequence);
+}
+
+int Compare_Offsets(const void* first, const void* second)
+{
+	uint32_t a = *(const uint32_t*)first;
+	uint32_t b = *(const uint32_t*)second;
+
+	return a < b ? -1 : (a > b ? 1 : 0);
+}
@@ -0,0 +1,122 @@
+#ifndef _EPG_STORE_H_
+#define _EPG_STORE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include "table_parse.h"
+
+/* 7 days of schedule for 200 services with room to spare */
+#define EPG_MAX_SERVICES 256
+#define EPG_MAX_EVENTS_PER_SERVICE 512
+/* Interned event names and descriptions, twice for the compaction */
+#define EPG_STRING_ARENA_SIZE (5 * 1024 * 1024)
+#define EPG_STRING_HASH_BITS 17
+/* Events collected before they are merged into the store */
+#define EPG_BATCH_SIZE 512
+/* Whole store, both arenas included, has to stay under this */
+#define EPG_MEMORY_TARGET (16 * 1024 * 1024)
+
+typedef struct EpgStoreStatistics {
+	uint32_t numOfServices;
+	uint32_t numOfEvents;
+	uint32_t numOfStrings;
+	uint32_t stringBytes;
+	/* Strings which were already in the arena */
+	uint64_t internedStrings;
+	uint32_t commits;
+	uint32_t compactions;
+	uint32_t droppedEvents;
+	/* Reads repeated because a commit was running */
+	uint32_t readRetries;
+	/* Static memory used by the store */
+	uint32_t memorySize;
+} EpgStoreStatistics;
+
+/***********************************************************************
+* @brief    EPG store initialization function
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Epg_Store_Init();
+
+/***********************************************************************
+* @brief    EPG store deinitialization function
+*
+* @return   EXIT_SUCCESS - no error
+*
+***********************************************************************/
+int32_t Epg_Store_Deinit();
+
+/***********************************************************************
+* @brief    Removes all events, used after retuning to another
+* 			transport stream
+*
+***********************************************************************/
+void Epg_Store_Clear();
+
+/***********************************************************************
+* @brief    Adds events to the current batch. The batch is merged into
+* 			the store when it is full or when Epg_Store_Commit is
+* 			called, events replace the stored events they overlap
+*
+* @param    [in] eventTable - EIT_Parse results
+* @param    [in] numOfEvents - number of events
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - some events were dropped
+*
+***********************************************************************/
+int32_t Epg_Store_Add_Events(const EITEvent* eventTable, uint32_t numOfEvents);
+
+/***********************************************************************
+* @brief    Merges the current batch into the store, readers see the
+* 			whole batch at once
+*
+***********************************************************************/
+void Epg_Store_Commit();
+
+/***********************************************************************
+* @brief    Copies the event of the service which runs at the time.
+* 			Never blocks, it is safe to call from the render thread
+*
+* @param    [in] serviceId - service_id / program_number
+* @param    [in] time - UTC seconds since 1970
+* @param    [out] event - where the event is copied
+*
+* @return   EXIT_SUCCESS - event found
+* @return   EXIT_FAILURE - no event at that time
+*
+***********************************************************************/
+int32_t Epg_Store_Get_Event_At(uint16_t serviceId, uint32_t time, EITEvent* event);
+
+/***********************************************************************
+* @brief    Copies the events of the service which overlap the time
+* 			window, in start time order. Never blocks, it is safe to
+* 			call from the render thread
+*
+* @param    [in] serviceId - service_id / program_number
+* @param    [in] startTime - start of the window, UTC seconds
+* @param    [in] endTime - end of the window, UTC seconds
+* @param    [out] eventTable - pointer to array of type EITEvent
+* @param    [in] maxEvents - number of elements in eventTable
+*
+* @return   numOfEvents - number of events copied
+*
+***********************************************************************/
+uint32_t Epg_Store_Get_Events(uint16_t serviceId, uint32_t startTime, uint32_t endTime,
+							  EITEvent* eventTable, uint32_t maxEvents);
+
+/***********************************************************************
+* @brief    Copies the store counters
+*
+* @param    [out] statistics - structure where the counters are saved
+*
+***********************************************************************/
+void Epg_Store_Get_Statistics(EpgStoreStatistics* statistics);
+
+#endif
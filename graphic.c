@@ -1,371 +1,1537 @@
 #include "graphic.h"
 
 /***********************************************************************
-* @brief    Renders the graphic in a loop
+* @brief    Sleeps until a new state is published and renders one frame
+* 			per state. States published while a frame is drawn are
+* 			merged into the next frame, which is presented on the next
+* 			vertical sync, so there is at most one frame per refresh
 *
 ***********************************************************************/
 static void* Render_Loop();
 
+/***********************************************************************
+* @brief    Starts a change of the published state. Producers wait only
+* 			for each other, never for the render thread
+*
+***********************************************************************/
+static void Begin_State_Update();
+
+/***********************************************************************
+* @brief    Publishes the changed state and wakes up the render thread
+* 			if it sleeps
+*
+***********************************************************************/
+static void End_State_Update();
+
+/***********************************************************************
+* @brief    Copies a consistent published state and the times of the
+* 			last changes into changesLocal, retries while a producer
+* 			is changing them
+*
+* @param    [out] state - where the state is copied
+*
+* @return   sequence - even sequence number of the copied state
+*
+***********************************************************************/
+static uint32_t Read_State(graphicElements* state);
+
+/***********************************************************************
+* @brief    Compares the snapshot in graphicLocal with what is on the
+* 			screen, redraws only the damaged rectangles and presents
+* 			them on vsync
+*
+***********************************************************************/
+static void Render_Frame();
+
+/***********************************************************************
+* @brief    Records the latencies of the state changes which reached
+* 			the screen with the presented frame
+*
+* @param    [in] presentTime - when the flip returned
+*
+***********************************************************************/
+static void Record_Presented(const struct timespec* presentTime);
+
+/***********************************************************************
+* @brief    Advances the fade of a layer, renders its cache if the
+* 			contents changed and damages the area it moved or faded in
+*
+* @param	[in] layer - layer to update
+* @param	[in] step - microseconds since the previous frame
+*
+* @return   1 - layer is still fading
+* @return   0 - layer is fully shown or hidden
+*
+***********************************************************************/
+static uint8_t Update_Layer(OsdLayer* layer, uint32_t step);
+
+/***********************************************************************
+* @brief    Adds a rectangle to the damage of the current frame, it is
+* 			merged with the rectangles it overlaps or touches
+*
+* @param	[in] rectangle - damaged area
+*
+***********************************************************************/
+static void Add_Damage(const OsdRectangle* rectangle);
+
+/***********************************************************************
+* @brief    Clears the damaged rectangle and blends the layer caches
+* 			which overlap it
+*
+* @param	[in] rectangle - damaged area
+*
+***********************************************************************/
+static void Redraw_Damage(const OsdRectangle* rectangle);
+
+/***********************************************************************
+* @brief    Returns the bounding box of two rectangles
+*
+***********************************************************************/
+static OsdRectangle Rectangle_Union(const OsdRectangle* first, const OsdRectangle* second);
+
+/***********************************************************************
+* @brief    Checks if two rectangles overlap or touch
+*
+* @return   1 - rectangles overlap
+* @return   0 - rectangles are apart
+*
+***********************************************************************/
+static uint8_t Rectangle_Overlaps(const OsdRectangle* first, const OsdRectangle* second);
+
 /***********************************************************************
 * @brief    Renders the info banner
 *
+* @param	[in] surface - layer cache
+*
 ***********************************************************************/
-static void Render_Info_Banner();
+static void Render_Info_Banner(OsdSurface* surface);
 
 /***********************************************************************
 * @brief    Renders the volume icon
 *
+* @param	[in] surface - layer cache
+*
+***********************************************************************/
+static void Render_Volume(OsdSurface* surface);
+
+/***********************************************************************
+* @brief    Renders the teletext page, the characters are blitted from
+* 			the glyph atlas into a grid and the mosaics are filled
+*
 ***********************************************************************/
-static void Render_Volume();
+static void Render_Teletext(OsdSurface* surface);
 
 /***********************************************************************
-* @brief    Adds the second strign to the first
-* 
-* @param	[in] firstStr - pointer to first string
-* @param	[in] firstStr - pointer to second string
-* 
-* @return   i - number of added characters to the first string
+* @brief    Renders the last subtitle overlay scaled to the screen, the
+* 			layer bounds follow the overlay
 *
 ***********************************************************************/
-static int32_t Add_Strings(char* firstStr, char* secondStr);
+static void Render_Subtitle(OsdSurface* surface);
+
+/***********************************************************************
+* @brief    Loads a font and rasterizes its printable ASCII glyphs into
+* 			an atlas surface
+*
+* @param	[in] atlas - atlas to fill
+* @param	[in] height - font height in pixels
+*
+***********************************************************************/
+static void Load_Glyph_Atlas(GlyphAtlas* atlas, int32_t height);
+
+/***********************************************************************
+* @brief    Decodes all OSD images into one surface in the pixel format
+* 			of the screen, so each is drawn with one blit
+*
+***********************************************************************/
+static void Load_Sprite_Atlas();
+
+/***********************************************************************
+* @brief    Creates the text run surfaces, so no text drawing allocates
+* 			after Graphic_Init
+*
+***********************************************************************/
+static void Create_Text_Runs();
+
+/***********************************************************************
+* @brief    Releases the surfaces and fonts which were created, on
+* 			deinitialization and when the initialization fails
+*
+***********************************************************************/
+static void Release_Resources();
+
+/***********************************************************************
+* @brief    Returns the cached run of the text, rendering it into the
+* 			least recently used run if it is not cached
+*
+* @param	[in] font - GRAPHIC_FONT_LARGE or GRAPHIC_FONT_SMALL
+* @param	[in] text - UTF-8 text, longer text is cut
+*
+* @return   run - rendered text
+*
+***********************************************************************/
+static TextRun* Get_Text_Run(uint8_t font, const char* text);
+
+/***********************************************************************
+* @brief    Draws a text with one blit of its cached run
+*
+* @param	[in] surface - surface to draw on
+* @param	[in] font - GRAPHIC_FONT_LARGE or GRAPHIC_FONT_SMALL
+* @param	[in] text - UTF-8 text
+* @param	[in] x - x coordinate of the anchor
+* @param	[in] y - y coordinate of the top of the text
+* @param	[in] align - GRAPHIC_ALIGN_LEFT, GRAPHIC_ALIGN_CENTER or
+* 						 GRAPHIC_ALIGN_RIGHT
+*
+***********************************************************************/
+static void Draw_Text(OsdSurface* surface, uint8_t font, const char* text, int32_t x, int32_t y, uint8_t align);
+
+/* Teletext colours black, red, green, yellow, blue, magenta, cyan and white */
+static const uint32_t teletextColors[8] = {
+	OSD_COLOR(0xff, 0x00, 0x00, 0x00), OSD_COLOR(0xff, 0xff, 0x00, 0x00),
+	OSD_COLOR(0xff, 0x00, 0xff, 0x00), OSD_COLOR(0xff, 0xff, 0xff, 0x00),
+	OSD_COLOR(0xff, 0x00, 0x00, 0xff), OSD_COLOR(0xff, 0xff, 0x00, 0xff),
+	OSD_COLOR(0xff, 0x00, 0xff, 0xff), OSD_COLOR(0xff, 0xff, 0xff, 0xff)
+};
 
 /* Structure to be used by the main thread */
 static graphicElements graphic;
 /* Structure to be read by the render thread */
 static graphicElements graphicLocal;
+/* What is on the screen now, used only by the render thread */
+static graphicElements graphicShown;
+static TimerEntry infoBannerTimer;
+static TimerEntry volumeTimer;
+static OsdLayer layers[GRAPHIC_NUM_LAYERS];
+/* Damage of the frame being drawn, merged rectangles */
+static OsdRectangle damage[GRAPHIC_MAX_DAMAGE];
+static uint32_t numOfDamaged = 0;
+/* Damage of the previous frame, still old in the back buffer after a swap */
+static OsdRectangle previousDamage[GRAPHIC_MAX_DAMAGE];
+static uint32_t numOfPreviousDamaged = 0;
+static uint8_t backBufferSwapped = 0;
+/* Screen contents are undefined, the whole screen has to be drawn */
+static uint8_t fullRedraw = 1;
+/* A layer is fading, frames are drawn without requests. Used only by the render thread */
+static uint8_t animating = 0;
+static struct timespec previousFrameStart;
+static struct timespec previousAnimationEnd;
 /* Signal for exiting render loop */ 
 static int32_t graphicInit = 0;  
-/* DFB basic variables */
-static IDirectFBSurface *primary = NULL;
-IDirectFB *dfbInterface = NULL;
+/* Seqlock of graphic, odd while a producer changes it. Half of it is
+   the generation of the state */
+static uint32_t stateSequence = 0;
+/* Sequence of the state on the screen, used only by the render thread */
+static uint32_t renderedSequence = 0;
+/* Times of the last changes by generation, published with the state */
+static GraphicChange changes[GRAPHIC_CHANGE_HISTORY];
+/* Copy of the times and the last sequence whose latency was recorded,
+   used only by the render thread */
+static GraphicChange changesLocal[GRAPHIC_CHANGE_HISTORY];
+static uint32_t presentedSequence = 0;
+/* Render thread sleeps, producers have to wake it up */
+static uint8_t renderWaiting = 0;
+static int32_t wakeFileDesc = -1;
+/* Overlay which is not drawn yet, its pixels belong to the producer until they are released.
+   The mutex is not held while the pixels are drawn */
+static pthread_mutex_t subtitleMutex = PTHREAD_MUTEX_INITIALIZER;
+static subtitleElements pendingSubtitle;
+static uint8_t subtitlePending = 0;
+/* Drawing functions, set before Graphic_Init */
+static const OsdBackend* backend = NULL;
+static OsdSurface* screen = NULL;
 /* Default 1920x1080 */
-static int screenWidth = 0;
-static int screenHeight = 0;
-DFBSurfaceDescription surfaceDesc;
-	
+static int32_t screenWidth = 0;
+static int32_t screenHeight = 0;
+
 static pthread_t renderLoopThread;
+/* Protects the statistics, producers never take it */
 static pthread_mutex_t mutex;
-static pthread_mutex_t volumeMutex;
-static pthread_mutex_t infoBannerMutex;
+/* Protected by mutex */
+static GraphicStatistics statistics;
+/* CPU time of the render thread spent in frames, used only by the render thread */
+static uint64_t frameCpuTime = 0;
+static struct timespec startTime;
+static GlyphAtlas atlases[GRAPHIC_NUM_FONTS];
+/* Used only by the render thread */
+static TextRun textRuns[GRAPHIC_TEXT_RUNS];
+static uint32_t textRunClock = 0;
+static OsdSurface* spriteAtlas = NULL;
+static OsdSprite sprites[GRAPHIC_NUM_SPRITES] = {
+	{"volume_0.png"}, {"volume_1.png"}, {"volume_2.png"}, {"volume_3.png"},
+	{"volume_4.png"}, {"volume_5.png"}, {"volume_6.png"}, {"volume_7.png"},
+	{"volume_8.png"}, {"volume_9.png"}, {"volume_10.png"}
+};
+
+int32_t Graphic_Set_Backend(const OsdBackend* osdBackend)
+{
+	if (graphicInit)
+	{
+		printf("%s(%d): Graphic module is already initialized!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+	backend = osdBackend;
+	return EXIT_SUCCESS;
+}
 
 int32_t Graphic_Init()
 {
-	int32_t ret;
-	struct sigevent signalEvent;
+	struct timespec loadStart;
+	struct timespec loadEnd;
+	uint32_t i;
+
+	if (backend == NULL)
+	{
+		printf("%s(%d): No drawing backend is set!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
 
 	/* Erase structures */
 	memset(&graphic, 0, sizeof(graphicElements));
 	memset(&graphicLocal, 0, sizeof(graphicElements));
+	memset(&graphicShown, 0, sizeof(graphicElements));
+	memset(&statistics, 0, sizeof(statistics));
+	memset(atlases, 0, sizeof(atlases));
+	memset(textRuns, 0, sizeof(textRuns));
+	spriteAtlas = NULL;
+	frameCpuTime = 0;
 	
-	/* Tell the OS to call a specified function */
-	signalEvent.sigev_notify = SIGEV_THREAD;
-	/* Function to be called when timer runs out */
-    signalEvent.sigev_notify_function = Hide_Info_Banner; 
-    /* Thread arguments */
-    signalEvent.sigev_value.sival_ptr = NULL;
-    /* Thread attributes - if NULL default attributes are applied */
-    signalEvent.sigev_notify_attributes = NULL; 
-    /* Create Info Banner timer */
-    ret = timer_create(CLOCK_REALTIME, &signalEvent, &graphic.timerInfoBanner);
-	if (ret == ERROR)
-	{
-		printf("Error in info banner timer\n");
+	/* Info banner and volume are hidden by the shared timer service */
+	if (Timer_Service_Init())
+	{
+		printf("%s(%d): Error initializing timer service!\n", __FUNCTION__, __LINE__);
 		return EXIT_FAILURE;
 	}
+	Timer_Init(&infoBannerTimer, Hide_Info_Banner, NULL);
+	Timer_Init(&volumeTimer, Hide_Volume, NULL);
 	
-	/* Function to be called when timer runs out */
-    signalEvent.sigev_notify_function = Hide_Volume; 
-	/* Create Volume timer */
-    ret = timer_create(CLOCK_REALTIME, &signalEvent, &graphic.timerVolume);
-	if (ret == ERROR)
+	/* Producers write it only while the render thread sleeps */
+	wakeFileDesc = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (wakeFileDesc < 0)
 	{
-		printf("Error in volume timer\n");
+		printf("%s(%d): Error creating eventfd (%s)!\n", __FUNCTION__, __LINE__, strerror(errno));
+		Timer_Service_Deinit();
 		return EXIT_FAILURE;
 	}
+	stateSequence = 0;
+	renderedSequence = 0;
+	presentedSequence = 0;
+	memset(changes, 0, sizeof(changes));
+	renderWaiting = 0;
 	
-	/* Initialize DirectFB */
-	DFBCHECK(DirectFBInit(NULL, NULL));
-	/* Fetch the DirectFB interface */
-	DFBCHECK(DirectFBCreate(&dfbInterface));
-	/* Tell the DirectFB to take the full screen for this application */
-	DFBCHECK(dfbInterface->SetCooperativeLevel(dfbInterface, DFSCL_FULLSCREEN));
-
-	/* Create primary surface with double buffering enabled */
-	surfaceDesc.flags = DSDESC_CAPS;
-	surfaceDesc.caps = DSCAPS_PRIMARY | DSCAPS_FLIPPING;
-	DFBCHECK (dfbInterface->CreateSurface(dfbInterface, &surfaceDesc, &primary));
-
-	/* Fetch the screen size */
-    DFBCHECK (primary->GetSize(primary, &screenWidth, &screenHeight));
+	/* Double buffered screen of the backend */
+	if (backend->Init(&screenWidth, &screenHeight))
+	{
+		printf("%s(%d): Error initializing %s backend!\n", __FUNCTION__, __LINE__, backend->name);
+		close(wakeFileDesc);
+		Timer_Service_Deinit();
+		return EXIT_FAILURE;
+	}
+	screen = backend->Get_Screen();
+	
+	/* Layer areas, everything a layer draws has to be inside */
+	memset(layers, 0, sizeof(layers));
+	layers[GRAPHIC_LAYER_INFO_BANNER].bounds.x = screenWidth/4;
+	layers[GRAPHIC_LAYER_INFO_BANNER].bounds.y = 4*screenHeight/5;
+	layers[GRAPHIC_LAYER_INFO_BANNER].bounds.w = screenWidth/2;
+	layers[GRAPHIC_LAYER_INFO_BANNER].bounds.h = screenHeight/6;
+	/* Less than the gap below the banner, so it never leaves the screen */
+	layers[GRAPHIC_LAYER_INFO_BANNER].slide = screenHeight/36;
+	layers[GRAPHIC_LAYER_INFO_BANNER].Render = Render_Info_Banner;
+	layers[GRAPHIC_LAYER_VOLUME].bounds.x = 40;
+	layers[GRAPHIC_LAYER_VOLUME].bounds.y = 40;
+	layers[GRAPHIC_LAYER_VOLUME].Render = Render_Volume;
+	/* Under the other layers, cells of the grid are bounds divided by the rows and columns */
+	layers[GRAPHIC_LAYER_TELETEXT].bounds.x = screenWidth/4;
+	layers[GRAPHIC_LAYER_TELETEXT].bounds.y = screenHeight/12;
+	layers[GRAPHIC_LAYER_TELETEXT].bounds.w = screenWidth/2;
+	layers[GRAPHIC_LAYER_TELETEXT].bounds.h = 5*screenHeight/6;
+	layers[GRAPHIC_LAYER_TELETEXT].Render = Render_Teletext;
+	/* Whole screen for the cache, the bounds shrink to each overlay. Subtitles are on time, without a fade */
+	layers[GRAPHIC_LAYER_SUBTITLE].bounds.w = screenWidth;
+	layers[GRAPHIC_LAYER_SUBTITLE].bounds.h = screenHeight;
+	layers[GRAPHIC_LAYER_SUBTITLE].instant = 1;
+	layers[GRAPHIC_LAYER_SUBTITLE].Render = Render_Subtitle;
+	subtitlePending = 0;
+	
+	/* Images are decoded only here, volume layer is as large as the largest one */
+	clock_gettime(CLOCK_MONOTONIC, &loadStart);
+	Load_Sprite_Atlas();
+	clock_gettime(CLOCK_MONOTONIC, &loadEnd);
+	statistics.spriteLoadTime = Time_Difference(&loadStart, &loadEnd);
+	for (i = GRAPHIC_SPRITE_VOLUME_0; i <= GRAPHIC_SPRITE_VOLUME_10; i++)
+	{
+		if (sprites[i].rectangle.w > layers[GRAPHIC_LAYER_VOLUME].bounds.w)
+		{
+			layers[GRAPHIC_LAYER_VOLUME].bounds.w = sprites[i].rectangle.w;
+		}
+		if (sprites[i].rectangle.h > layers[GRAPHIC_LAYER_VOLUME].bounds.h)
+		{
+			layers[GRAPHIC_LAYER_VOLUME].bounds.h = sprites[i].rectangle.h;
+		}
+	}
+	numOfDamaged = 0;
+	numOfPreviousDamaged = 0;
+	backBufferSwapped = 0;
+	fullRedraw = 1;
+	animating = 0;
 	
+	/* Layers are blended from their caches, which are rendered on changes */
+	for (i = 0; i < GRAPHIC_NUM_LAYERS; i++)
+	{
+		if (layers[i].bounds.w > 0 && layers[i].bounds.h > 0)
+		{
+			layers[i].cache = backend->Create_Surface(layers[i].bounds.w, layers[i].bounds.h, OSD_SURFACE_ARGB);
+			if (layers[i].cache == NULL)
+			{
+				printf("%s(%d): Error creating layer cache!\n", __FUNCTION__, __LINE__);
+				Release_Resources();
+				backend->Deinit();
+				screen = NULL;
+				close(wakeFileDesc);
+				wakeFileDesc = -1;
+				Timer_Service_Deinit();
+				return EXIT_FAILURE;
+			}
+		}
+	}
+	
+	/* Fonts are loaded once, banner text is blitted from the atlases */
+	clock_gettime(CLOCK_MONOTONIC, &loadStart);
+	Load_Glyph_Atlas(&atlases[GRAPHIC_FONT_LARGE], 48);
+	Load_Glyph_Atlas(&atlases[GRAPHIC_FONT_SMALL], 30);
+	Create_Text_Runs();
+	clock_gettime(CLOCK_MONOTONIC, &loadEnd);
+	statistics.fontLoadTime = Time_Difference(&loadStart, &loadEnd);
+	
+	/* First frame clears the screen, fullRedraw draws it without a request */
 	graphicInit = 1;
 	
 	pthread_mutex_init(&mutex, NULL);
-	pthread_mutex_init(&volumeMutex, NULL);
-	pthread_mutex_init(&infoBannerMutex, NULL);
-	pthread_create(&renderLoopThread, NULL, Render_Loop, NULL);
+	
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	if (pthread_create(&renderLoopThread, NULL, Render_Loop, NULL))
+	{
+		printf("%s(%d): Error creating render thread!\n", __FUNCTION__, __LINE__);
+		graphicInit = 0;
+		pthread_mutex_destroy(&mutex);
+		Release_Resources();
+		backend->Deinit();
+		screen = NULL;
+		close(wakeFileDesc);
+		wakeFileDesc = -1;
+		Timer_Service_Deinit();
+		return EXIT_FAILURE;
+	}
 	return EXIT_SUCCESS;
 }
 
 int32_t Graphic_Deinit()
 {
-	pthread_mutex_lock(&mutex);
-	graphicInit = 0;
-	pthread_mutex_unlock(&mutex);
+	uint64_t wake = 1;
+	
+	/* Waits for a callback which is running, it requests a redraw */
+	Timer_Stop(&infoBannerTimer);
+	Timer_Stop(&volumeTimer);
 	
+	__atomic_store_n(&graphicInit, 0, __ATOMIC_SEQ_CST);
+	if (write(wakeFileDesc, &wake, sizeof(wake)) != sizeof(wake))
+	{
+		printf("%s(%d): Error waking render thread!\n", __FUNCTION__, __LINE__);
+	}
 	pthread_join(renderLoopThread, NULL);
+	close(wakeFileDesc);
+	wakeFileDesc = -1;
 	
 	/* Clean up */
-	primary->Release(primary);
-	dfbInterface->Release(dfbInterface);
+	if (subtitlePending)
+	{
+		subtitlePending = 0;
+		pendingSubtitle.Release(pendingSubtitle.releaseArgument);
+	}
+	Release_Resources();
+	backend->Deinit();
+	screen = NULL;
 	
 	pthread_mutex_destroy(&mutex);
-	pthread_mutex_destroy(&volumeMutex);
-	pthread_mutex_destroy(&infoBannerMutex);
-	
-	timer_delete(graphic.timerInfoBanner);
-	timer_delete(graphic.timerVolume);
+	Timer_Service_Deinit();
 	return EXIT_SUCCESS;
 }
 
 int32_t Show_Info_Banner(infoElements inputInfoBanner)
 {
-	int32_t ret;
-	struct itimerspec timerSpec;
-	
-	pthread_mutex_lock(&infoBannerMutex);
+	Begin_State_Update();
 	graphic.infoBanner = SHOW;
 	graphic.infoBannerValue.channel = inputInfoBanner.channel;
 	graphic.infoBannerValue.teletext = inputInfoBanner.teletext;
 	graphic.infoBannerValue.audioPID = inputInfoBanner.audioPID;
 	graphic.infoBannerValue.videoPID = inputInfoBanner.videoPID;
-	pthread_mutex_unlock(&infoBannerMutex);
+	memcpy(graphic.infoBannerValue.serviceName, inputInfoBanner.serviceName, INFO_NAME_SIZE);
+	graphic.infoBannerValue.serviceName[INFO_NAME_SIZE - 1] = '\0';
+	End_State_Update();
 	
-	/* Erase timer */
-	memset(&timerSpec,0,sizeof(timerSpec));
-
-	/* Specify the timer timeout time */
-	timerSpec.it_value.tv_sec = 3;
-	timerSpec.it_value.tv_nsec = 0;
-	
-	/* Set the new timer specificationss */
-	ret = timer_settime(graphic.timerInfoBanner,0,&timerSpec,NULL);
-	if (ret == ERROR)
-	{
-		printf("Error in info banner timer\n");
-		return EXIT_FAILURE;
-	}
-	return EXIT_SUCCESS;
+	return Timer_Start(&infoBannerTimer, GRAPHIC_HIDE_TIME);
 }
 
-void Hide_Info_Banner(union sigval value)
+void Hide_Info_Banner(void* argument)
 {
-	pthread_mutex_lock(&infoBannerMutex);
+	Begin_State_Update();
 	graphic.infoBanner = HIDE;
-	pthread_mutex_unlock(&infoBannerMutex);
+	End_State_Update();
 }
 
 int32_t Show_Volume(uint8_t volume)
 {
-	int32_t ret;
-	struct itimerspec timerSpec;
-	
-	pthread_mutex_lock(&volumeMutex);
+	Begin_State_Update();
 	graphic.volume = SHOW;
 	graphic.volumeValue = volume;
-	pthread_mutex_unlock(&volumeMutex);
-		
-	memset(&timerSpec,0,sizeof(timerSpec));
+	End_State_Update();
+	
+	return Timer_Start(&volumeTimer, GRAPHIC_HIDE_TIME);
+}
+
+void Hide_Volume(void* argument)
+{
+	Begin_State_Update();
+	graphic.volume = HIDE;
+	End_State_Update();
+}
 
-	/* Specify the timer timeout time */
-	timerSpec.it_value.tv_sec = 3;
-	timerSpec.it_value.tv_nsec = 0;
+int32_t Show_Teletext(const teletextElements* page)
+{
+	Begin_State_Update();
+	graphic.teletext = SHOW;
+	memcpy(&graphic.teletextValue, page, sizeof(teletextElements));
+	End_State_Update();
+	
+	return EXIT_SUCCESS;
+}
+
+void Hide_Teletext()
+{
+	Begin_State_Update();
+	graphic.teletext = HIDE;
+	End_State_Update();
+}
+
+int32_t Show_Subtitle(const subtitleElements* overlay)
+{
+	subtitleElements replaced;
+	uint8_t replacing;
 	
-	/* Set the new timer specificationss */
-	ret = timer_settime(graphic.timerVolume,0,&timerSpec,NULL);
-	if (ret == ERROR)
+	if (overlay->Release == NULL)
 	{
-		printf("Error in volume timer\n");
+		printf("%s(%d): Invalid subtitle overlay!\n", __FUNCTION__, __LINE__);
 		return EXIT_FAILURE;
 	}
+	if (overlay->pixels == NULL || overlay->width <= 0 || overlay->height <= 0 ||
+		overlay->displayWidth <= 0 || overlay->displayHeight <= 0)
+	{
+		printf("%s(%d): Invalid subtitle overlay!\n", __FUNCTION__, __LINE__);
+		overlay->Release(overlay->releaseArgument);
+		return EXIT_FAILURE;
+	}
+	
+	/* Overlay which was not drawn yet is never shown, it is given back at once */
+	pthread_mutex_lock(&subtitleMutex);
+	replaced = pendingSubtitle;
+	replacing = subtitlePending;
+	pendingSubtitle = *overlay;
+	subtitlePending = 1;
+	pthread_mutex_unlock(&subtitleMutex);
+	if (replacing)
+	{
+		replaced.Release(replaced.releaseArgument);
+	}
+	
+	Begin_State_Update();
+	graphic.subtitle = SHOW;
+	graphic.subtitleValue++;
+	End_State_Update();
+	
 	return EXIT_SUCCESS;
 }
 
-void Hide_Volume(union sigval value)
+void Hide_Subtitle()
 {
-	pthread_mutex_lock(&volumeMutex);
-	graphic.volume = HIDE;
-	pthread_mutex_unlock(&volumeMutex);
+	subtitleElements hidden;
+	uint8_t hiding;
+	
+	pthread_mutex_lock(&subtitleMutex);
+	hidden = pendingSubtitle;
+	hiding = subtitlePending;
+	subtitlePending = 0;
+	pthread_mutex_unlock(&subtitleMutex);
+	if (hiding)
+	{
+		hidden.Release(hidden.releaseArgument);
+	}
+	
+	Begin_State_Update();
+	graphic.subtitle = HIDE;
+	End_State_Update();
 }  
 
+void Graphic_Get_Statistics(GraphicStatistics* outStatistics)
+{
+	clockid_t threadClock;
+	struct timespec now;
+	struct timespec cpuTime;
+	uint64_t totalCpuTime = 0;
+	uint64_t runTime;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	runTime = Time_Difference(&startTime, &now);
+	if (pthread_getcpuclockid(renderLoopThread, &threadClock) == 0 && clock_gettime(threadClock, &cpuTime) == 0)
+	{
+		totalCpuTime = (uint64_t)cpuTime.tv_sec * 1000000 + cpuTime.tv_nsec / 1000;
+	}
+
+	pthread_mutex_lock(&mutex);
+	*outStatistics = statistics;
+	pthread_mutex_unlock(&mutex);
+
+	/* Every published state is one request */
+	outStatistics->redrawRequests = __atomic_load_n(&stateSequence, __ATOMIC_ACQUIRE) / 2;
+
+	outStatistics->runTime = runTime;
+	outStatistics->cpuTime = totalCpuTime;
+	outStatistics->idleCpuTime = (totalCpuTime > outStatistics->frameCpuTime) ? totalCpuTime - outStatistics->frameCpuTime : 0;
+	outStatistics->averageFrameTime = outStatistics->frames ? outStatistics->totalFrameTime / outStatistics->frames : 0;
+	outStatistics->averageAnimationDrawTime = outStatistics->animationFrames
+		? outStatistics->totalAnimationDrawTime / outStatistics->animationFrames : 0;
+	/* 1000 would be one core busy all the time */
+	outStatistics->idleCpuLoad = runTime ? outStatistics->idleCpuTime * 1000 / runTime : 0;
+}
+
 void* Render_Loop()
-{	
+{
+	struct pollfd wakeDesc;
+	uint64_t wakeCount;
+	uint32_t sequence;
+	uint32_t retries;
+	uint8_t wokenUp;
+	
+	wakeDesc.fd = wakeFileDesc;
+	wakeDesc.events = POLLIN;
+	TRACE_THREAD_NAME("render");
+	
 	while (NON_STOP)
     {
+		wokenUp = 0;
+		/* Fades go on without new states, each frame waits for the vsync */
+		if (!animating && !fullRedraw)
+		{
+			/* Producers see the flag or the sleeping thread sees their state */
+			__atomic_store_n(&renderWaiting, 1, __ATOMIC_SEQ_CST);
+			if (__atomic_load_n(&stateSequence, __ATOMIC_SEQ_CST) == renderedSequence
+				&& __atomic_load_n(&graphicInit, __ATOMIC_SEQ_CST))
+			{
+				TRACE_BEGIN("wait for state");
+				if (poll(&wakeDesc, 1, -1) < 0 && errno != EINTR)
+				{
+					printf("%s(%d): Error waiting for a state (%s)!\n", __FUNCTION__, __LINE__, strerror(errno));
+				}
+				TRACE_END("wait for state");
+				wokenUp = 1;
+			}
+			__atomic_store_n(&renderWaiting, 0, __ATOMIC_SEQ_CST);
+		}
+		/* Only clears the wakeups, the sequence tells what changed */
+		if (read(wakeFileDesc, &wakeCount, sizeof(wakeCount)) < 0)
+		{
+			wakeCount = 0;
+		}
+		if (__atomic_load_n(&graphicInit, __ATOMIC_ACQUIRE) == 0)
+		{
+			return NULL;
+		}
+		
+		retries = 0;
+		sequence = Read_State(&graphicLocal);
+		while (sequence & 1)
+		{
+			/* Producer may have been preempted in the middle of its change */
+			retries++;
+			sched_yield();
+			sequence = Read_State(&graphicLocal);
+		}
+		
 		pthread_mutex_lock(&mutex);
-		if (graphicInit == 0)
+		statistics.wakeups += wokenUp;
+		statistics.stateRetries += retries;
+		/* States published after the last frame are all shown by this one */
+		if ((sequence - renderedSequence) / 2 > 1)
 		{
-			pthread_mutex_unlock(&mutex);
-			return;
+			statistics.mergedRequests += (sequence - renderedSequence) / 2 - 1;
+		}
+		pthread_mutex_unlock(&mutex);
+		
+		if (sequence == renderedSequence && !animating && !fullRedraw)
+		{
+			continue;
+		}
+		renderedSequence = sequence;
+		/* Value of the slice is the number of the shown state */
+		TRACE_BEGIN("render frame");
+		Render_Frame();
+		TRACE_END_VALUE("render frame", sequence / 2);
+		
+		pthread_mutex_lock(&mutex);
+		statistics.renderedRequests = sequence / 2;
+		pthread_mutex_unlock(&mutex);
+	}
+}
+
+void Begin_State_Update()
+{
+	uint32_t sequence;
+	
+	while (NON_STOP)
+	{
+		sequence = __atomic_load_n(&stateSequence, __ATOMIC_RELAXED);
+		if ((sequence & 1) == 0 && __atomic_compare_exchange_n(&stateSequence, &sequence, sequence + 1, 0,
+																  __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+		{
+			break;
+		}
+		/* Another producer is in the middle of its change */
+		sched_yield();
+	}
+	/* Odd sequence is visible before any of the changes */
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void End_State_Update()
+{
+	uint64_t wake = 1;
+	GraphicChange* change;
+	
+	/* Slot of the new generation, the key which caused it is handled by this thread */
+	change = &changes[((__atomic_load_n(&stateSequence, __ATOMIC_RELAXED) + 1) / 2) & (GRAPHIC_CHANGE_HISTORY - 1)];
+	change->inputTime = Latency_Get_Input_Time();
+	change->publishTime = Latency_Now();
+	Latency_Record_Since(LATENCY_KEY_TO_STATE, change->inputTime);
+	
+	__atomic_add_fetch(&stateSequence, 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&renderWaiting, __ATOMIC_SEQ_CST))
+	{
+		if (write(wakeFileDesc, &wake, sizeof(wake)) != sizeof(wake))
+		{
+			printf("%s(%d): Error waking render thread!\n", __FUNCTION__, __LINE__);
+		}
+	}
+}
+
+uint32_t Read_State(graphicElements* state)
+{
+	uint32_t sequence;
+	
+	sequence = __atomic_load_n(&stateSequence, __ATOMIC_ACQUIRE);
+	if (sequence & 1)
+	{
+		return sequence;
+	}
+	memcpy(state, &graphic, sizeof(graphicElements));
+	memcpy(changesLocal, changes, sizeof(changes));
+	/* Copy is finished before the sequence is read again */
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if (__atomic_load_n(&stateSequence, __ATOMIC_RELAXED) != sequence)
+	{
+		return sequence | 1;
+	}
+	return sequence;
+}
+
+void Record_Presented(const struct timespec* presentTime)
+{
+	uint64_t now = (uint64_t)presentTime->tv_sec * 1000000 + presentTime->tv_nsec / 1000;
+	uint32_t numOfChanges = (renderedSequence - presentedSequence) / 2;
+	const GraphicChange* change;
+	uint32_t i;
+	
+	/* Older ones were overwritten, the frame was late by many changes */
+	if (numOfChanges > GRAPHIC_CHANGE_HISTORY)
+	{
+		numOfChanges = GRAPHIC_CHANGE_HISTORY;
+	}
+	for (i = 0; i < numOfChanges; i++)
+	{
+		change = &changesLocal[(renderedSequence / 2 - i) & (GRAPHIC_CHANGE_HISTORY - 1)];
+		if (change->inputTime != 0 && change->inputTime <= now)
+		{
+			Latency_Record(LATENCY_KEY_TO_PHOTON, now - change->inputTime);
+		}
+		if (change->publishTime != 0 && change->publishTime <= now)
+		{
+			Latency_Record(LATENCY_STATE_TO_PHOTON, now - change->publishTime);
+		}
+	}
+	presentedSequence = renderedSequence;
+}
+
+void Render_Frame()
+{
+	struct timespec frameStart;
+	struct timespec frameDrawn;
+	struct timespec frameEnd;
+	struct timespec cpuStart;
+	struct timespec cpuEnd;
+	uint64_t drawTime;
+	uint64_t frameTime;
+	uint32_t damageArea = 0;
+	uint32_t step;
+	uint8_t fullFrame;
+	/* Previous frame was a part of the same fade */
+	uint8_t fadeContinues = animating;
+	uint32_t i;
+	OsdRectangle screenArea;
+	OsdRectangle frameDamage[GRAPHIC_MAX_DAMAGE];
+	uint32_t numOfFrameDamaged;
+	
+	clock_gettime(CLOCK_MONOTONIC, &frameStart);
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpuStart);
+	
+	screenArea.x = 0;
+	screenArea.y = 0;
+	screenArea.w = screenWidth;
+	screenArea.h = screenHeight;
+	numOfDamaged = 0;
+	
+	/* Background is black without video and transparent over it */
+	if (fullRedraw || (graphicLocal.infoBannerValue.videoPID == 0) != (graphicShown.infoBannerValue.videoPID == 0))
+	{
+		Add_Damage(&screenArea);
+		fullRedraw = 0;
+	}
+	
+	/* Caches are rendered again only when their contents change */
+	layers[GRAPHIC_LAYER_INFO_BANNER].visible = (graphicLocal.infoBanner == SHOW);
+	if (memcmp(&graphicLocal.infoBannerValue, &graphicShown.infoBannerValue, sizeof(infoElements)))
+	{
+		layers[GRAPHIC_LAYER_INFO_BANNER].cacheValid = 0;
+	}
+	layers[GRAPHIC_LAYER_VOLUME].visible = (graphicLocal.volume == SHOW);
+	if (graphicLocal.volumeValue != graphicShown.volumeValue)
+	{
+		layers[GRAPHIC_LAYER_VOLUME].cacheValid = 0;
+	}
+	layers[GRAPHIC_LAYER_TELETEXT].visible = (graphicLocal.teletext == SHOW);
+	if (memcmp(&graphicLocal.teletextValue, &graphicShown.teletextValue, sizeof(teletextElements)))
+	{
+		layers[GRAPHIC_LAYER_TELETEXT].cacheValid = 0;
+	}
+	layers[GRAPHIC_LAYER_SUBTITLE].visible = (graphicLocal.subtitle == SHOW);
+	/* Overlay may have been drawn already by the frame before, the cache keeps it */
+	if (graphicLocal.subtitleValue != graphicShown.subtitleValue)
+	{
+		pthread_mutex_lock(&subtitleMutex);
+		if (subtitlePending)
+		{
+			layers[GRAPHIC_LAYER_SUBTITLE].cacheValid = 0;
 		}
+		pthread_mutex_unlock(&subtitleMutex);
+	}
+	graphicShown = graphicLocal;
+	
+	/* Fades advance by the time between frames, the first step by one refresh */
+	step = fadeContinues ? Time_Difference(&previousFrameStart, &frameStart) : GRAPHIC_FADE_FIRST_STEP;
+	previousFrameStart = frameStart;
+	animating = 0;
+	for (i = 0; i < GRAPHIC_NUM_LAYERS; i++)
+	{
+		animating |= Update_Layer(&layers[i], step);
+	}
+	
+	if (numOfDamaged == 0)
+	{
+		pthread_mutex_lock(&mutex);
+		statistics.skippedFrames++;
 		pthread_mutex_unlock(&mutex);
+		/* Changes which did not change the screen have no latency */
+		presentedSequence = renderedSequence;
+		return;
+	}
+	
+	/* Only the changes of this frame have to be presented */
+	fullFrame = (numOfDamaged == 1 && damage[0].w == screenWidth && damage[0].h == screenHeight);
+	memcpy(frameDamage, damage, numOfDamaged * sizeof(OsdRectangle));
+	numOfFrameDamaged = numOfDamaged;
+	
+	/* After a swap the back buffer holds the frame before the last one */
+	if (backBufferSwapped)
+	{
+		for (i = 0; i < numOfPreviousDamaged; i++)
+		{
+			Add_Damage(&previousDamage[i]);
+		}
+	}
+	
+	for (i = 0; i < numOfDamaged; i++)
+	{
+		Redraw_Damage(&damage[i]);
+		damageArea += damage[i].w * damage[i].h;
+	}
+	backend->Set_Clip(screen, NULL);
+	clock_gettime(CLOCK_MONOTONIC, &frameDrawn);
+	
+	/* Presented on the next vertical sync, which also limits the frame rate */
+	if (fullFrame)
+	{
+		backend->Flip(NULL, OSD_FLIP_WAIT_VSYNC);
+		backBufferSwapped = 1;
+	}
+	else
+	{
+		/* Only the changed rectangles are copied to the front buffer, the
+		   back buffer keeps the whole frame */
+		for (i = 0; i < numOfFrameDamaged; i++)
+		{
+			backend->Flip(&frameDamage[i], (i == 0) ? OSD_FLIP_WAIT_VSYNC : OSD_FLIP_NONE);
+		}
+		backBufferSwapped = 0;
+	}
+	memcpy(previousDamage, frameDamage, numOfFrameDamaged * sizeof(OsdRectangle));
+	numOfPreviousDamaged = numOfFrameDamaged;
+	
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpuEnd);
+	clock_gettime(CLOCK_MONOTONIC, &frameEnd);
+	drawTime = Time_Difference(&frameStart, &frameDrawn);
+	frameTime = Time_Difference(&frameStart, &frameEnd);
+	frameCpuTime += Time_Difference(&cpuStart, &cpuEnd);
+	Record_Presented(&frameEnd);
+	
+	pthread_mutex_lock(&mutex);
+	statistics.frames++;
+	if (fullFrame)
+	{
+		statistics.fullFrames++;
+	}
+	/* Last frame of a fade is a part of it as well */
+	if (animating || fadeContinues)
+	{
+		statistics.animationFrames++;
+		statistics.lastAnimationDrawTime = drawTime;
+		statistics.totalAnimationDrawTime += drawTime;
+		if (drawTime > statistics.maxAnimationDrawTime)
+		{
+			statistics.maxAnimationDrawTime = drawTime;
+		}
+		/* Interval from the previous frame of the same fade */
+		if (fadeContinues && Time_Difference(&previousAnimationEnd, &frameEnd) > statistics.maxAnimationInterval)
+		{
+			statistics.maxAnimationInterval = Time_Difference(&previousAnimationEnd, &frameEnd);
+		}
+		previousAnimationEnd = frameEnd;
+	}
+	statistics.lastDamageArea = damageArea;
+	statistics.totalDamageArea += damageArea;
+	statistics.lastDrawTime = drawTime;
+	statistics.lastFrameTime = frameTime;
+	statistics.totalFrameTime += frameTime;
+	statistics.frameCpuTime = frameCpuTime;
+	if (drawTime > statistics.maxDrawTime)
+	{
+		statistics.maxDrawTime = drawTime;
+	}
+	if (frameTime > statistics.maxFrameTime)
+	{
+		statistics.maxFrameTime = frameTime;
+	}
+	pthread_mutex_unlock(&mutex);
+}
+
+uint8_t Update_Layer(OsdLayer* layer, uint32_t step)
+{
+	struct timespec renderStart;
+	struct timespec renderEnd;
+	OsdRectangle cacheArea;
+	uint8_t rendered = 0;
+	
+	if (layer->cache == NULL)
+	{
+		return 0;
+	}
+	
+	if (layer->instant)
+	{
+		layer->progress = layer->visible ? GRAPHIC_FADE_TIME : 0;
+	}
+	else if (layer->visible)
+	{
+		layer->progress = (layer->progress + step < GRAPHIC_FADE_TIME) ? layer->progress + step : GRAPHIC_FADE_TIME;
+	}
+	else
+	{
+		layer->progress = (layer->progress > step) ? layer->progress - step : 0;
+	}
+	layer->alpha = (uint64_t)layer->progress * 0xff / GRAPHIC_FADE_TIME;
+	layer->area = layer->bounds;
+	layer->area.y += (uint64_t)layer->slide * (GRAPHIC_FADE_TIME - layer->progress) / GRAPHIC_FADE_TIME;
+	
+	/* Only what is on the screen needs up to date contents */
+	if (layer->alpha > 0 && !layer->cacheValid)
+	{
+		clock_gettime(CLOCK_MONOTONIC, &renderStart);
+		cacheArea.x = 0;
+		cacheArea.y = 0;
+		cacheArea.w = layer->bounds.w;
+		cacheArea.h = layer->bounds.h;
+		backend->Fill_Rectangle(layer->cache, &cacheArea, OSD_COLOR(0x00, 0x00, 0x00, 0x00));
+		layer->Render(layer->cache);
+		layer->cacheValid = 1;
+		rendered = 1;
+		clock_gettime(CLOCK_MONOTONIC, &renderEnd);
 		
-		pthread_mutex_lock(&infoBannerMutex);
-		pthread_mutex_lock(&volumeMutex);
-		/* Check if local and global graphic structures are different */
-		if (graphicLocal.infoBanner != graphic.infoBanner
-			|| graphicLocal.volume != graphic.volume
-			|| graphicLocal.volumeValue != graphic.volumeValue
-			|| graphicLocal.infoBannerValue.channel != graphic.infoBannerValue.channel)
-		{
-			graphicLocal = graphic;
-			pthread_mutex_unlock(&infoBannerMutex);
-			pthread_mutex_unlock(&volumeMutex);
+		pthread_mutex_lock(&mutex);
+		statistics.cacheRenders++;
+		statistics.cacheRenderTime += Time_Difference(&renderStart, &renderEnd);
+		pthread_mutex_unlock(&mutex);
+	}
+	
+	if (rendered || layer->alpha != layer->shownAlpha || layer->area.y != layer->shownArea.y)
+	{
+		if (layer->shownAlpha > 0)
+		{
+			Add_Damage(&layer->shownArea);
+		}
+		if (layer->alpha > 0)
+		{
+			Add_Damage(&layer->area);
+		}
+	}
+	layer->shownArea = layer->area;
+	layer->shownAlpha = layer->alpha;
+	
+	return layer->progress != 0 && layer->progress != GRAPHIC_FADE_TIME;
+}
+
+void Add_Damage(const OsdRectangle* rectangle)
+{
+	OsdRectangle merged = *rectangle;
+	uint32_t i = 0;
+	
+	/* Merging may make the rectangle overlap the ones already checked */
+	while (i < numOfDamaged)
+	{
+		if (Rectangle_Overlaps(&merged, &damage[i]))
+		{
+			merged = Rectangle_Union(&merged, &damage[i]);
+			damage[i] = damage[--numOfDamaged];
+			i = 0;
+		}
+		else
+		{
+			i++;
+		}
+	}
+	
+	if (numOfDamaged == GRAPHIC_MAX_DAMAGE)
+	{
+		/* Out of rectangles, the last one grows to cover both */
+		merged = Rectangle_Union(&merged, &damage[--numOfDamaged]);
+	}
+	damage[numOfDamaged++] = merged;
+}
+
+void Redraw_Damage(const OsdRectangle* rectangle)
+{
+	OsdRectangle cacheArea;
+	uint32_t i;
+	
+	backend->Set_Clip(screen, rectangle);
+	
+	/* Clear only the damaged area */
+	if (graphicLocal.infoBannerValue.videoPID == 0)
+	{
+		backend->Fill_Rectangle(screen, rectangle, OSD_COLOR(0xff, 0x00, 0x00, 0x00));
+	}
+	else
+	{
+		backend->Fill_Rectangle(screen, rectangle, OSD_COLOR(0x00, 0x00, 0x00, 0x00));
+	}
+	
+	/* No text or rectangles are drawn here, only the caches are blended */
+	for (i = 0; i < GRAPHIC_NUM_LAYERS; i++)
+	{
+		if (layers[i].alpha > 0 && Rectangle_Overlaps(rectangle, &layers[i].area))
+		{
+			cacheArea.x = 0;
+			cacheArea.y = 0;
+			cacheArea.w = layers[i].area.w;
+			cacheArea.h = layers[i].area.h;
+			backend->Blit_Alpha(screen, layers[i].cache, &cacheArea, layers[i].area.x, layers[i].area.y,
+								layers[i].alpha);
+		}
+	}
+}
+
+OsdRectangle Rectangle_Union(const OsdRectangle* first, const OsdRectangle* second)
+{
+	OsdRectangle result;
+	int32_t x2 = first->x + first->w;
+	int32_t y2 = first->y + first->h;
+	
+	result.x = (first->x < second->x) ? first->x : second->x;
+	result.y = (first->y < second->y) ? first->y : second->y;
+	if (second->x + second->w > x2)
+	{
+		x2 = second->x + second->w;
+	}
+	if (second->y + second->h > y2)
+	{
+		y2 = second->y + second->h;
+	}
+	result.w = x2 - result.x;
+	result.h = y2 - result.y;
+	return result;
+}
+
+uint8_t Rectangle_Overlaps(const OsdRectangle* first, const OsdRectangle* second)
+{
+	return first->x <= second->x + second->w && second->x <= first->x + first->w
+		   && first->y <= second->y + second->h && second->y <= first->y + first->h;
+}
+
+void Render_Info_Banner(OsdSurface* surface)
+{
+	OsdRectangle rectangle;
+	int32_t width = layers[GRAPHIC_LAYER_INFO_BANNER].bounds.w;
+	/* Text is blitted from the run cache, nothing is allocated */
+	char text[GRAPHIC_TEXT_RUN_SIZE];
+	
+	TRACE_BEGIN("info banner");
+	/* Outer rectangle drawing */
+	rectangle.x = 0;
+	rectangle.y = 0;
+	rectangle.w = width;
+	rectangle.h = layers[GRAPHIC_LAYER_INFO_BANNER].bounds.h;
+	backend->Fill_Rectangle(surface, &rectangle, OSD_COLOR(0xff, 0x00, 0x88, 0x44));
+	/* Inner rectangle drawing */
+	rectangle.x += 10;
+	rectangle.y += 10;
+	rectangle.w -= 20;
+	rectangle.h -= 20;
+	backend->Fill_Rectangle(surface, &rectangle, OSD_COLOR(0xff, 0x00, 0xCE, 0x67));
+	
+	snprintf(text, sizeof(text), "Channel: %d", graphicLocal.infoBannerValue.channel);
+	Draw_Text(surface, GRAPHIC_FONT_LARGE, text, 20, 10, GRAPHIC_ALIGN_LEFT);
+	
+	/* Service name from the SDT, centered on the banner */
+	if (graphicLocal.infoBannerValue.serviceName[0] != '\0')
+	{
+		Draw_Text(surface, GRAPHIC_FONT_LARGE, graphicLocal.infoBannerValue.serviceName,
+				  width/2, 10, GRAPHIC_ALIGN_CENTER);
+	}
+	
+	snprintf(text, sizeof(text), "Audio PID: %d", graphicLocal.infoBannerValue.audioPID);
+	Draw_Text(surface, GRAPHIC_FONT_SMALL, text, 20, 100, GRAPHIC_ALIGN_LEFT);
+	
+	snprintf(text, sizeof(text), "Video PID: %d", graphicLocal.infoBannerValue.videoPID);
+	Draw_Text(surface, GRAPHIC_FONT_SMALL, text, 20, 130, GRAPHIC_ALIGN_LEFT);
+	if (graphicLocal.infoBannerValue.teletext == SHOW)
+	{
+		Draw_Text(surface, GRAPHIC_FONT_LARGE, "TXT", width-20, 10, GRAPHIC_ALIGN_RIGHT);
+	}
+	TRACE_END("info banner");
+}
+
+void Render_Volume(OsdSurface* surface)
+{
+	OsdSprite* sprite = &sprites[GRAPHIC_SPRITE_VOLUME_0];
+	
+	TRACE_BEGIN("volume");
+	if (graphicLocal.volumeValue <= 10)
+	{
+		sprite = &sprites[GRAPHIC_SPRITE_VOLUME_0 + graphicLocal.volumeValue];
+	}
+	if (sprite->rectangle.w == 0)
+	{
+		TRACE_END("volume");
+		return;
+	}
+	
+	/* Layer is placed at the upper left corner of the screen */
+	backend->Blit(surface, spriteAtlas, &sprite->rectangle, 0, 0, OSD_BLIT_COPY);
+	TRACE_END("volume");
+}
+
+void Render_Teletext(OsdSurface* surface)
+{
+	GlyphAtlas* atlas = &atlases[GRAPHIC_FONT_SMALL];
+	GlyphCell* glyph;
+	OsdRectangle cell;
+	OsdRectangle sextant;
+	int32_t cellWidth = layers[GRAPHIC_LAYER_TELETEXT].bounds.w / GRAPHIC_TELETEXT_COLUMNS;
+	int32_t cellHeight = layers[GRAPHIC_LAYER_TELETEXT].bounds.h / GRAPHIC_TELETEXT_ROWS;
+	uint32_t foreground;
+	uint32_t background;
+	uint8_t mosaic;
+	uint8_t character;
+	uint32_t row;
+	uint32_t column;
+	uint32_t i;
+	
+	TRACE_BEGIN("teletext");
+	cell.x = 0;
+	cell.y = 0;
+	cell.w = layers[GRAPHIC_LAYER_TELETEXT].bounds.w;
+	cell.h = layers[GRAPHIC_LAYER_TELETEXT].bounds.h;
+	backend->Fill_Rectangle(surface, &cell, teletextColors[0]);
+	
+	cell.w = cellWidth;
+	cell.h = cellHeight;
+	for (row = 0; row < GRAPHIC_TELETEXT_ROWS; row++)
+	{
+		/* Every row starts with white alphanumerics on black */
+		foreground = teletextColors[7];
+		background = teletextColors[0];
+		mosaic = 0;
+		cell.y = row * cellHeight;
+		for (column = 0; column < GRAPHIC_TELETEXT_COLUMNS; column++)
+		{
+			character = graphicLocal.teletextValue.rows[row][column];
+			cell.x = column * cellWidth;
 			
-			/* Clear the screen before drawing anything */
-			if (graphicLocal.infoBannerValue.videoPID == 0)
+			/* Background changes take effect at their cell */
+			if (character == 0x1C)
 			{
-				DFBCHECK(primary->SetColor(primary, 0x00, 0x00, 0x00, 0xff));
+				background = teletextColors[0];
 			}
-			else
+			else if (character == 0x1D)
 			{
-				DFBCHECK(primary->SetColor(primary, 0x00, 0x00, 0x00, 0x00));
+				background = foreground;
 			}
-			DFBCHECK(primary->FillRectangle(primary, 0, 0, screenWidth, screenHeight));
-			
-			if (graphicLocal.infoBanner == SHOW)
+			if (background != teletextColors[0])
 			{
-				Render_Info_Banner();
+				backend->Fill_Rectangle(surface, &cell, background);
 			}
 			
-			if(graphicLocal.volume == SHOW)
+			if (character < 0x20)
 			{
-				Render_Volume();
+				/* Attributes are shown as spaces, colours apply from the next cell */
+				if (character <= 0x07)
+				{
+					foreground = teletextColors[character];
+					mosaic = 0;
+				}
+				else if (character >= 0x10 && character <= 0x17)
+				{
+					foreground = teletextColors[character - 0x10];
+					mosaic = 1;
+				}
+			}
+			else if (mosaic && (character & 0x20))
+			{
+				/* 2x3 blocks, bit 0x20 is not a block, 0x40 is the bottom right one */
+				for (i = 0; i < 6; i++)
+				{
+					if (character & ((i < 5) ? (1 << i) : 0x40))
+					{
+						sextant.x = cell.x + (i % 2) * (cellWidth / 2);
+						sextant.y = cell.y + (i / 2) * cellHeight / 3;
+						sextant.w = (i % 2) ? cellWidth - cellWidth / 2 : cellWidth / 2;
+						sextant.h = ((i / 2) + 1) * cellHeight / 3 - (i / 2) * cellHeight / 3;
+						backend->Fill_Rectangle(surface, &sextant, foreground);
+					}
+				}
+			}
+			else if (character == 0x7F)
+			{
+				backend->Fill_Rectangle(surface, &cell, foreground);
+			}
+			else if (character != ' ')
+			{
+				/* Glyphs of the atlas are white, national characters are shown as their ASCII codes */
+				glyph = &atlas->glyphs[character - GLYPH_ATLAS_FIRST];
+				backend->Blit(surface, atlas->surface, &glyph->rectangle,
+							  cell.x + (cellWidth - glyph->advance) / 2 + glyph->bearing, cell.y, OSD_BLIT_BLEND);
 			}
-			
-			DFBCHECK(primary->Flip(primary, NULL, 0));
-		}
-		else
-		{
-			pthread_mutex_unlock(&infoBannerMutex);
-			pthread_mutex_unlock(&volumeMutex);
 		}
 	}
+	TRACE_END("teletext");
 }
 
-void Render_Info_Banner()
+void Render_Subtitle(OsdSurface* surface)
 {
-	/* Outer rectangle drawing */
-	DFBCHECK(primary->SetColor(primary, 0x00, 0x88, 0x44, 0xff));
-	DFBCHECK(primary->FillRectangle(primary, screenWidth/4, 4*screenHeight/5, screenWidth/2, screenHeight/6));
-	/* Inner rectangle drawing */
-	DFBCHECK(primary->SetColor(primary, 0x00, 0xCE, 0x67, 0xff));
-	DFBCHECK(primary->FillRectangle(primary, screenWidth/4+10, 4*screenHeight/5+10, screenWidth/2-20, screenHeight/6-20));
-	
-	/* Draw text */
-	char channel[20] = "Channel: ";
-	char audioPID[20] = "Audio PID: ";
-	char videoPID[20] = "Video PID: ";
-	char teletext[] = "TXT";
-	char temp[6];
-	
-	IDirectFBFont *fontInterface = NULL;
-	DFBFontDescription fontDesc;
-	
-	DFBCHECK(primary->SetColor(primary, 0xff, 0xff, 0xff, 0xff));
-
-	/* Specify the height of the font by raising the appropriate flag and setting the height value */
-	fontDesc.flags = DFDESC_HEIGHT;
-	fontDesc.height = 48;
-	/* Create the font and set the created font for primary surface text drawing */
-	DFBCHECK(dfbInterface->CreateFont(dfbInterface, "/home/galois/fonts/DejaVuSans.ttf", &fontDesc, &fontInterface));
-	DFBCHECK(primary->SetFont(primary, fontInterface));
-	/* Draw the text */
-	sprintf(temp, "%d", graphicLocal.infoBannerValue.channel);
-	Add_Strings(channel, temp);
-	DFBCHECK(primary->DrawString(primary, channel, -1,
-								 /*x coordinate of the top left corner of the resulting text*/ screenWidth/4+20,
-								 /*y coordinate of the top left corner of the resulting text*/ 4*screenHeight/5+10,
-								 /*in case of multiple lines, allign text to left*/ DSTF_TOPLEFT));
-	
-	fontDesc.flags = DFDESC_HEIGHT;
-	fontDesc.height = 30;
-	DFBCHECK(dfbInterface->CreateFont(dfbInterface, "/home/galois/fonts/DejaVuSans.ttf", &fontDesc, &fontInterface));
-	DFBCHECK(primary->SetFont(primary, fontInterface));
-	
-	sprintf(temp, "%d", graphicLocal.infoBannerValue.audioPID);
-	Add_Strings(audioPID, temp);
-	DFBCHECK(primary->DrawString(primary, audioPID, -1, screenWidth/4+20, 4*screenHeight/5+100, DSTF_TOPLEFT));
-	
-	sprintf(temp, "%d", graphicLocal.infoBannerValue.videoPID);
-	Add_Strings(videoPID, temp);
-	DFBCHECK(primary->DrawString(primary, videoPID, -1, screenWidth/4+20, 4*screenHeight/5+130, DSTF_TOPLEFT));
-	if (graphicLocal.infoBannerValue.teletext == SHOW)
+	OsdLayer* layer = &layers[GRAPHIC_LAYER_SUBTITLE];
+	OsdRectangle area;
+	subtitleElements overlay;
+	uint8_t drawing;
+	
+	TRACE_BEGIN("subtitle");
+	/* Taken overlay belongs to the render thread until it is released after the blit */
+	pthread_mutex_lock(&subtitleMutex);
+	overlay = pendingSubtitle;
+	drawing = subtitlePending;
+	subtitlePending = 0;
+	pthread_mutex_unlock(&subtitleMutex);
+	if (drawing)
 	{
-		DFBCHECK(primary->DrawString(primary, teletext, -1, screenWidth-screenWidth/4-20, 4*screenHeight/5+10, DSTF_TOPRIGHT));
+		/* Bounds are set with the pixels, so both are of the same display set */
+		layer->bounds.x = overlay.x * screenWidth / overlay.displayWidth;
+		layer->bounds.y = overlay.y * screenHeight / overlay.displayHeight;
+		layer->bounds.w = (overlay.x + overlay.width) * screenWidth / overlay.displayWidth - layer->bounds.x;
+		layer->bounds.h = (overlay.y + overlay.height) * screenHeight / overlay.displayHeight - layer->bounds.y;
+		layer->area = layer->bounds;
+		
+		area.x = 0;
+		area.y = 0;
+		area.w = layer->bounds.w;
+		area.h = layer->bounds.h;
+		backend->Write_Pixels(surface, &area, overlay.pixels, overlay.width, overlay.height, overlay.width);
+		overlay.Release(overlay.releaseArgument);
 	}
+	TRACE_END_VALUE("subtitle", layer->bounds.w * layer->bounds.h);
 }
 
-void Render_Volume()
+void Load_Sprite_Atlas()
 {
-	/* Draw image from file */
-	IDirectFBImageProvider *provider;
-	IDirectFBSurface *logoSurface = NULL;
-	int32_t logoHeight, logoWidth;
-	char volumeFileName[] = "volume_0.png";
-
-	/* Create the image provider for the specified file */
-	if (graphicLocal.volumeValue >= 1 && graphicLocal.volumeValue <= 9)
+	OsdRectangle atlasArea;
+	int32_t imageWidth;
+	int32_t imageHeight;
+	int32_t atlasWidth = 0;
+	int32_t atlasHeight = 0;
+	uint32_t i;
+	
+	/* Sprites are placed in one row */
+	for (i = 0; i < GRAPHIC_NUM_SPRITES; i++)
 	{
-		volumeFileName[7] = graphicLocal.volumeValue + '0';
-		DFBCHECK(dfbInterface->CreateImageProvider(dfbInterface, volumeFileName, &provider));
+		memset(&sprites[i].rectangle, 0, sizeof(OsdRectangle));
+		if (backend->Get_Image_Size(sprites[i].fileName, &imageWidth, &imageHeight))
+		{
+			printf("%s(%d): Error opening %s!\n", __FUNCTION__, __LINE__, sprites[i].fileName);
+			continue;
+		}
+		sprites[i].rectangle.x = atlasWidth;
+		sprites[i].rectangle.w = imageWidth;
+		sprites[i].rectangle.h = imageHeight;
+		atlasWidth += imageWidth;
+		if (imageHeight > atlasHeight)
+		{
+			atlasHeight = imageHeight;
+		}
 	}
-	else if (graphicLocal.volumeValue == 10)
+	
+	if (atlasWidth == 0)
 	{
-		DFBCHECK(dfbInterface->CreateImageProvider(dfbInterface, "volume_10.png", &provider));
+		return;
 	}
-	else
+	
+	/* Same format as the screen, blits are plain copies */
+	spriteAtlas = backend->Create_Surface(atlasWidth, atlasHeight, OSD_SURFACE_SCREEN_FORMAT);
+	atlasArea.x = 0;
+	atlasArea.y = 0;
+	atlasArea.w = atlasWidth;
+	atlasArea.h = atlasHeight;
+	backend->Fill_Rectangle(spriteAtlas, &atlasArea, OSD_COLOR(0x00, 0x00, 0x00, 0x00));
+	statistics.spriteAtlasSize = backend->Get_Surface_Bytes(spriteAtlas);
+	
+	for (i = 0; i < GRAPHIC_NUM_SPRITES; i++)
 	{
-		DFBCHECK(dfbInterface->CreateImageProvider(dfbInterface, "volume_0.png", &provider));
+		if (sprites[i].rectangle.w != 0 && backend->Render_Image(sprites[i].fileName, spriteAtlas, &sprites[i].rectangle))
+		{
+			printf("%s(%d): Error decoding %s!\n", __FUNCTION__, __LINE__, sprites[i].fileName);
+			memset(&sprites[i].rectangle, 0, sizeof(OsdRectangle));
+		}
 	}
-	
-	/* Get surface descriptor for the surface where the image will be rendered */
-	DFBCHECK(provider->GetSurfaceDescription(provider, &surfaceDesc));
-	/* Create the surface for the image */
-	DFBCHECK(dfbInterface->CreateSurface(dfbInterface, &surfaceDesc, &logoSurface));
-	/* Render the image to the surface */
-	DFBCHECK(provider->RenderTo(provider, logoSurface, NULL));
-
-	/* Cleanup the provider after rendering the image to the surface */
-	provider->Release(provider);
-
-	/* Fetch the logo size and add (blit) it to the screen */
-	DFBCHECK(logoSurface->GetSize(logoSurface, &logoWidth, &logoHeight));
-	DFBCHECK(primary->Blit(primary, logoSurface, NULL,
-						   /* Destination x coordinate of the upper left corner of the image */40,
-						   /* Destination y coordinate of the upper left corner of the image */40));
 }
 
-int32_t Add_Strings(char* firstStr, char* secondStr)
+void Load_Glyph_Atlas(GlyphAtlas* atlas, int32_t height)
 {
-	int i = 0;
-	int j = 0;
+	OsdRectangle ink;
+	OsdRectangle atlasArea;
+	GlyphCell* cell;
+	char character[2];
+	int32_t atlasWidth = 0;
+	int32_t left;
+	int32_t right;
+	uint32_t i;
 	
-	while (firstStr[j] != '\0')
+	atlas->font = backend->Load_Font(height);
+	atlas->height = backend->Get_Font_Height(atlas->font);
+	
+	/* Cells are placed in one row, wide enough for the ink and the advance */
+	for (i = 0; i < GLYPH_ATLAS_SIZE; i++)
 	{
-		j++;
+		cell = &atlas->glyphs[i];
+		backend->Get_Glyph_Extents(atlas->font, GLYPH_ATLAS_FIRST + i, &ink, &cell->advance);
+		left = (ink.x < 0) ? ink.x : 0;
+		right = (ink.x + ink.w > cell->advance) ? ink.x + ink.w : cell->advance;
+		cell->bearing = left;
+		cell->rectangle.x = atlasWidth;
+		cell->rectangle.y = 0;
+		cell->rectangle.w = right - left;
+		cell->rectangle.h = atlas->height;
+		atlasWidth += cell->rectangle.w;
 	}
 	
-	while (secondStr[i] != '\0')
+	atlas->surface = backend->Create_Surface(atlasWidth, atlas->height, OSD_SURFACE_ARGB);
+	atlasArea.x = 0;
+	atlasArea.y = 0;
+	atlasArea.w = atlasWidth;
+	atlasArea.h = atlas->height;
+	backend->Fill_Rectangle(atlas->surface, &atlasArea, OSD_COLOR(0x00, 0x00, 0x00, 0x00));
+	
+	character[1] = '\0';
+	for (i = 0; i < GLYPH_ATLAS_SIZE; i++)
 	{
-		firstStr[j + i] = secondStr[i];
-		i++;
+		cell = &atlas->glyphs[i];
+		character[0] = GLYPH_ATLAS_FIRST + i;
+		backend->Draw_String(atlas->surface, atlas->font, character, cell->rectangle.x - cell->bearing, 0,
+							 OSD_COLOR(0xff, 0xff, 0xff, 0xff));
 	}
-
-	firstStr[j + i] = '\0';
-	return i;
 }
 
+void Create_Text_Runs()
+{
+	uint32_t i;
+	
+	memset(textRuns, 0, sizeof(textRuns));
+	textRunClock = 0;
+	/* Any banner text fits, runs are shared by both fonts */
+	for (i = 0; i < GRAPHIC_TEXT_RUNS; i++)
+	{
+		textRuns[i].surface = backend->Create_Surface(screenWidth/2 - 40, atlases[GRAPHIC_FONT_LARGE].height,
+													  OSD_SURFACE_ARGB);
+	}
+}
 
+void Release_Resources()
+{
+	uint32_t i;
+	
+	for (i = 0; i < GRAPHIC_TEXT_RUNS; i++)
+	{
+		if (textRuns[i].surface != NULL)
+		{
+			backend->Release_Surface(textRuns[i].surface);
+			textRuns[i].surface = NULL;
+		}
+	}
+	for (i = 0; i < GRAPHIC_NUM_LAYERS; i++)
+	{
+		if (layers[i].cache != NULL)
+		{
+			backend->Release_Surface(layers[i].cache);
+			layers[i].cache = NULL;
+		}
+	}
+	for (i = 0; i < GRAPHIC_NUM_FONTS; i++)
+	{
+		if (atlases[i].surface != NULL)
+		{
+			backend->Release_Surface(atlases[i].surface);
+			atlases[i].surface = NULL;
+		}
+		if (atlases[i].font != NULL)
+		{
+			backend->Release_Font(atlases[i].font);
+			atlases[i].font = NULL;
+		}
+	}
+	if (spriteAtlas != NULL)
+	{
+		backend->Release_Surface(spriteAtlas);
+		spriteAtlas = NULL;
+	}
+}
 
+TextRun* Get_Text_Run(uint8_t font, const char* text)
+{
+	GlyphAtlas* atlas = &atlases[font];
+	TextRun* run = &textRuns[0];
+	GlyphCell* cell;
+	OsdRectangle runArea;
+	uint8_t ascii = 1;
+	int32_t pen = 0;
+	int32_t inkEnd = 0;
+	uint32_t i;
+	
+	textRunClock++;
+	for (i = 0; i < GRAPHIC_TEXT_RUNS; i++)
+	{
+		if (textRuns[i].used && textRuns[i].font == font
+			&& strncmp(textRuns[i].text, text, GRAPHIC_TEXT_RUN_SIZE - 1) == 0)
+		{
+			textRuns[i].lastUse = textRunClock;
+			pthread_mutex_lock(&mutex);
+			statistics.textRunHits++;
+			pthread_mutex_unlock(&mutex);
+			return &textRuns[i];
+		}
+		
+		/* Free run or the one unused for the longest time */
+		if (!textRuns[i].used || (run->used && textRuns[i].lastUse < run->lastUse))
+		{
+			run = &textRuns[i];
+		}
+	}
+	
+	run->used = 1;
+	run->font = font;
+	run->lastUse = textRunClock;
+	strncpy(run->text, text, GRAPHIC_TEXT_RUN_SIZE - 1);
+	run->text[GRAPHIC_TEXT_RUN_SIZE - 1] = '\0';
+	for (i = 0; run->text[i] != '\0'; i++)
+	{
+		if ((uint8_t)run->text[i] < GLYPH_ATLAS_FIRST || (uint8_t)run->text[i] > GLYPH_ATLAS_LAST)
+		{
+			ascii = 0;
+		}
+	}
+	
+	runArea.x = 0;
+	runArea.y = 0;
+	runArea.w = screenWidth/2 - 40;
+	runArea.h = atlases[GRAPHIC_FONT_LARGE].height;
+	backend->Fill_Rectangle(run->surface, &runArea, OSD_COLOR(0x00, 0x00, 0x00, 0x00));
+	if (ascii)
+	{
+		/* Cells are premultiplied and the run is cleared, so a cell is copied
+		   unless it overlaps the previous one, which is blended into */
+		for (i = 0; run->text[i] != '\0'; i++)
+		{
+			cell = &atlas->glyphs[(uint8_t)run->text[i] - GLYPH_ATLAS_FIRST];
+			backend->Blit(run->surface, atlas->surface, &cell->rectangle, pen + cell->bearing, 0,
+						  (pen + cell->bearing < inkEnd) ? OSD_BLIT_BLEND : OSD_BLIT_COPY);
+			if (pen + cell->bearing + cell->rectangle.w > inkEnd)
+			{
+				inkEnd = pen + cell->bearing + cell->rectangle.w;
+			}
+			pen += cell->advance;
+		}
+		run->width = pen;
+	}
+	else
+	{
+		/* Service names may have characters which are not in the atlas */
+		backend->Draw_String(run->surface, atlas->font, run->text, 0, 0, OSD_COLOR(0xff, 0xff, 0xff, 0xff));
+		run->width = backend->Get_String_Width(atlas->font, run->text);
+	}
+	
+	pthread_mutex_lock(&mutex);
+	statistics.textRunMisses++;
+	pthread_mutex_unlock(&mutex);
+	return run;
+}
 
+void Draw_Text(OsdSurface* surface, uint8_t font, const char* text, int32_t x, int32_t y, uint8_t align)
+{
+	TextRun* run = Get_Text_Run(font, text);
+	OsdRectangle source;
+	
+	source.x = 0;
+	source.y = 0;
+	source.w = run->width;
+	source.h = atlases[font].height;
+	if (align == GRAPHIC_ALIGN_CENTER)
+	{
+		x -= run->width / 2;
+	}
+	else if (align == GRAPHIC_ALIGN_RIGHT)
+	{
+		x -= run->width;
+	}
+	
+	backend->Blit(surface, run->surface, &source, x, y, OSD_BLIT_BLEND);
+}
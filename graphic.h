@@ -4,46 +4,252 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <time.h>
-#include <signal.h>
-#include <directfb.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sched.h>
 #include <pthread.h>
-
-/* Helper macro for error checking */
-#define DFBCHECK(x...)										\
-{															\
-DFBResult err = x;											\
-															\
-if (err != DFB_OK)											\
-  {															\
-    fprintf( stderr, "%s <%d>:\n\t", __FILE__, __LINE__ );	\
-    DirectFBErrorFatal( #x, err );							\
-  }															\
-}
+#include <sys/eventfd.h>
+#include "osd_backend.h"
+#include "timer_service.h"
+#include "latency.h"
+#include "trace.h"
 
 #define SHOW 1
 #define HIDE 0
 
 #define ERROR -1
-#define NON_STOP 1
+
+/* Milliseconds the info banner and the volume stay on the screen */
+#define GRAPHIC_HIDE_TIME 3000
+
+/* OSD layers, drawn in this order */
+#define GRAPHIC_LAYER_SUBTITLE 0
+#define GRAPHIC_LAYER_TELETEXT 1
+#define GRAPHIC_LAYER_INFO_BANNER 2
+#define GRAPHIC_LAYER_VOLUME 3
+#define GRAPHIC_NUM_LAYERS 4
+
+/* Damaged rectangles kept per frame, more are merged together */
+#define GRAPHIC_MAX_DAMAGE 8
+
+/* Published states whose change times are kept for the latency
+   measurement, power of two */
+#define GRAPHIC_CHANGE_HISTORY 64
+
+/* Microseconds a layer takes to fade in or out */
+#define GRAPHIC_FADE_TIME 250000
+/* Step of the first frame of a fade, one refresh at 60 Hz */
+#define GRAPHIC_FADE_FIRST_STEP 16667
+
+/* Fonts are loaded once, with a glyph atlas per size */
+#define GRAPHIC_FONT_LARGE 0
+#define GRAPHIC_FONT_SMALL 1
+#define GRAPHIC_NUM_FONTS 2
+/* Printable ASCII is pre-rasterized, other characters are drawn by the font */
+#define GLYPH_ATLAS_FIRST 0x20
+#define GLYPH_ATLAS_LAST 0x7E
+#define GLYPH_ATLAS_SIZE (GLYPH_ATLAS_LAST - GLYPH_ATLAS_FIRST + 1)
+
+/* Text alignment to the anchor x coordinate */
+#define GRAPHIC_ALIGN_LEFT 0
+#define GRAPHIC_ALIGN_CENTER 1
+#define GRAPHIC_ALIGN_RIGHT 2
+
+/* Rendered strings kept for reuse, with the terminating zero */
+#define GRAPHIC_TEXT_RUNS 16
+#define GRAPHIC_TEXT_RUN_SIZE 32
+
+/* OSD images, decoded once into the sprite atlas */
+#define GRAPHIC_SPRITE_VOLUME_0 0
+#define GRAPHIC_SPRITE_VOLUME_10 10
+#define GRAPHIC_NUM_SPRITES 11
+
+/* UTF-8 service name with the terminating zero */
+#define INFO_NAME_SIZE 32
+
+/* Teletext page of a header row and 24 rows */
+#define GRAPHIC_TELETEXT_ROWS 25
+#define GRAPHIC_TELETEXT_COLUMNS 40
 
 typedef struct infoElements {
 	uint8_t channel;
 	uint8_t teletext;
 	uint16_t audioPID;
 	uint16_t videoPID;
-	/* TODO: Add infomation for personal exercise */
+	char serviceName[INFO_NAME_SIZE];
 } infoElements;
 
+typedef struct teletextElements {
+	/*
+	 * 7 bit teletext characters, codes below 0x20 are the spacing
+	 * attributes which select the colours and the mosaic characters
+	 */
+	uint8_t rows[GRAPHIC_TELETEXT_ROWS][GRAPHIC_TELETEXT_COLUMNS];
+} teletextElements;
+
+typedef struct subtitleElements {
+	/* Display the subtitles are composed for, scaled to the screen */
+	int32_t displayWidth;
+	int32_t displayHeight;
+	/* Area of the overlay on the display */
+	int32_t x;
+	int32_t y;
+	int32_t width;
+	int32_t height;
+	/* ARGB pixels, width pixels per row */
+	const uint32_t* pixels;
+	/* Gives the pixels back to the producer once they are drawn or not needed any more */
+	void (*Release)(void* argument);
+	void* releaseArgument;
+} subtitleElements;
+
 typedef struct graphicElements {
 	uint8_t infoBanner;
 	infoElements infoBannerValue;
-	timer_t timerInfoBanner;
 	uint8_t volume;
 	uint8_t volumeValue;
-	timer_t timerVolume;
+	uint8_t teletext;
+	teletextElements teletextValue;
+	uint8_t subtitle;
+	/* Number of the display set, the overlay is rendered again when it changes */
+	uint32_t subtitleValue;
 } graphicElements;
 
+/* Microseconds of the monotonic clock */
+typedef struct GraphicChange {
+	/* Key which caused the change, 0 if it was not caused by a key */
+	uint64_t inputTime;
+	uint64_t publishTime;
+} GraphicChange;
+
+typedef struct GlyphCell {
+	/* Cell in the atlas, drawn at the pen position plus bearing */
+	OsdRectangle rectangle;
+	int32_t bearing;
+	int32_t advance;
+} GlyphCell;
+
+typedef struct GlyphAtlas {
+	OsdFont* font;
+	OsdSurface* surface;
+	int32_t height;
+	GlyphCell glyphs[GLYPH_ATLAS_SIZE];
+} GlyphAtlas;
+
+typedef struct TextRun {
+	uint8_t used;
+	uint8_t font;
+	char text[GRAPHIC_TEXT_RUN_SIZE];
+	int32_t width;
+	/* Frame counter of the last use, the oldest run is replaced */
+	uint32_t lastUse;
+	OsdSurface* surface;
+} TextRun;
+
+typedef struct OsdSprite {
+	const char* fileName;
+	/* Area in the atlas, empty if the image could not be decoded */
+	OsdRectangle rectangle;
+} OsdSprite;
+
+typedef struct OsdLayer {
+	/* Layer is shown or fading in */
+	uint8_t visible;
+	/* Shown and hidden at once, without a fade */
+	uint8_t instant;
+	/* Area of the fully shown layer */
+	OsdRectangle bounds;
+	/* Pixels the hidden layer is moved down, it slides up while fading in */
+	int32_t slide;
+	/* Microseconds of fading in, GRAPHIC_FADE_TIME when fully shown */
+	uint32_t progress;
+	/* Where the cache is blended in this frame and in the one on the screen */
+	OsdRectangle area;
+	uint8_t alpha;
+	OsdRectangle shownArea;
+	uint8_t shownAlpha;
+	/* Premultiplied layer contents, rendered only when they change */
+	OsdSurface* cache;
+	uint8_t cacheValid;
+	/* Draws the layer into the cache, bounds start at 0, 0 */
+	void (*Render)(OsdSurface* surface);
+} OsdLayer;
+
+/* Times are in microseconds */
+typedef struct GraphicStatistics {
+	uint32_t frames;
+	/* States published by the Show and Hide calls */
+	uint32_t redrawRequests;
+	/* States which were replaced by a newer one before they were drawn */
+	uint32_t mergedRequests;
+	/* States included in the drawn frames, equal to redrawRequests when
+	   nothing is pending */
+	uint32_t renderedRequests;
+	/* Copies of the state retried because a producer changed it */
+	uint32_t stateRetries;
+	/* Times the render thread woke up */
+	uint32_t wakeups;
+	/* Frames redrawn completely, after a background change */
+	uint32_t fullFrames;
+	/* Redraw requests which did not change anything on the screen */
+	uint32_t skippedFrames;
+	/* Pixels cleared and redrawn in the last frame and in all of them */
+	uint32_t lastDamageArea;
+	uint64_t totalDamageArea;
+	/* Text drawn from the run cache and text rendered into it */
+	uint32_t textRunHits;
+	uint32_t textRunMisses;
+	/* Microseconds spent loading the fonts and building the atlases */
+	uint32_t fontLoadTime;
+	/* Layer caches rendered because their contents changed, and the
+	   microseconds it took */
+	uint32_t cacheRenders;
+	uint64_t cacheRenderTime;
+	/* Frames drawn while a layer was fading, they only blend the caches */
+	uint32_t animationFrames;
+	uint64_t lastAnimationDrawTime;
+	uint64_t maxAnimationDrawTime;
+	uint64_t averageAnimationDrawTime;
+	uint64_t totalAnimationDrawTime;
+	/* Longest time between two frames of a fade, 20000 holds 50 fps */
+	uint64_t maxAnimationInterval;
+	/* Microseconds spent decoding the images into the sprite atlas */
+	uint32_t spriteLoadTime;
+	uint32_t spriteAtlasSize;
+	/* Time spent drawing, without waiting for the vertical sync */
+	uint64_t lastDrawTime;
+	uint64_t maxDrawTime;
+	/* Time from the start of drawing until the frame was flipped */
+	uint64_t lastFrameTime;
+	uint64_t maxFrameTime;
+	uint64_t averageFrameTime;
+	uint64_t totalFrameTime;
+	/* Time since Graphic_Init */
+	uint64_t runTime;
+	/* CPU time of the render thread, in frames and outside of them */
+	uint64_t cpuTime;
+	uint64_t frameCpuTime;
+	uint64_t idleCpuTime;
+	/* Idle CPU time per 1000 of the run time, 1000 is one busy core */
+	uint32_t idleCpuLoad;
+} GraphicStatistics;
+
+/***********************************************************************
+* @brief    Selects the drawing backend, has to be called before
+* 			Graphic_Init
+*
+* @param	[in] osdBackend - backend functions, e.g. DirectFB on the box
+* 							  or the software rasterizer on a host
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Graphic_Set_Backend(const OsdBackend* osdBackend);
+
 /***********************************************************************
 * @brief    Graphic module initialization function
 * 
@@ -74,12 +280,12 @@ int32_t Graphic_Deinit();
 int32_t Show_Info_Banner(infoElements inputInfoBanner);
 
 /***********************************************************************
-* @brief    Signal the graphic module to hide the info banner
+* @brief    Signal the graphic module to fade out the info banner
 * 
-* @param	[in] value - required argument by timer callback
+* @param	[in] argument - argument of the timer callback, unused
 *
 ***********************************************************************/
-void Hide_Info_Banner(union sigval value);
+void Hide_Info_Banner(void* argument);
 
 /***********************************************************************
 * @brief    Signal the graphic module to show volume icon
@@ -93,11 +299,58 @@ void Hide_Info_Banner(union sigval value);
 int32_t Show_Volume(uint8_t volume);
 
 /***********************************************************************
-* @brief    Signal the graphic module to hide the volume icon
+* @brief    Signal the graphic module to fade out the volume icon
 * 
-* @param	[in] value - required argument by timer callback
+* @param	[in] argument - argument of the timer callback, unused
+*
+***********************************************************************/
+void Hide_Volume(void* argument);
+
+/***********************************************************************
+* @brief    Signal the graphic module to show a teletext page, it stays
+* 			until it is hidden
+*
+* @param	[in] page - characters of the page
+*
+* @return   EXIT_SUCCESS - no error
+*
+***********************************************************************/
+int32_t Show_Teletext(const teletextElements* page);
+
+/***********************************************************************
+* @brief    Signal the graphic module to fade out the teletext page
+*
+***********************************************************************/
+void Hide_Teletext();
+
+/***********************************************************************
+* @brief    Signal the graphic module to show a subtitle display set.
+* 			The pixels are not copied, they are drawn once and given
+* 			back with the Release function of the overlay after the
+* 			blit, or when the overlay is replaced or hidden before it
+* 			was drawn. The drawing stays until the next display set or
+* 			until it is hidden
+*
+* @param	[in] overlay - composed regions of the display set
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - invalid overlay, it is given back at once
+*
+***********************************************************************/
+int32_t Show_Subtitle(const subtitleElements* overlay);
+
+/***********************************************************************
+* @brief    Signal the graphic module to remove the subtitles at once
+*
+***********************************************************************/
+void Hide_Subtitle();
+
+/***********************************************************************
+* @brief    Copies the render statistics
+*
+* @param	[out] outStatistics - structure where the statistics are saved
 *
 ***********************************************************************/
-void Hide_Volume(union sigval value);
+void Graphic_Get_Statistics(GraphicStatistics* outStatistics);
 
 #endif
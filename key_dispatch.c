@@ -0,0 +1,442 @@
+#include "key_dispatch.h"
+
+typedef struct KeySubscriber {
+	uint32_t classMask;
+	/* NULL when it was removed while the keys were dispatched */
+	Key_Handler handler;
+	void* argument;
+} KeySubscriber;
+
+/***********************************************************************
+* @brief    Merges the repeats of the batch, rate limits them and
+* 			passes the actions to the subscribers
+*
+* @param	[in] batch - key events taken from the queue
+* @param	[in] numOfEvents - number of key events
+*
+* @return   number of actions passed to the subscribers
+*
+***********************************************************************/
+static uint32_t Dispatch_Batch(KeyEvent* batch, uint32_t numOfEvents);
+
+/***********************************************************************
+* @brief    Calls the subscribers of the key class
+*
+***********************************************************************/
+static void Deliver(const KeyEvent* event);
+
+/***********************************************************************
+* @brief    Timer callback at the end of the repeat interval, wakes the
+* 			application thread to pass on the held repeats
+*
+***********************************************************************/
+static void Repeat_Timeout(void* argument);
+
+/***********************************************************************
+* @brief    Passes the repeats held back during the interval on as one
+* 			action, if the key was not released in the meantime
+*
+* @return   number of actions passed to the subscribers
+*
+***********************************************************************/
+static uint32_t Dispatch_Held_Repeats();
+
+static KeyEvent queue[KEY_QUEUE_SIZE];
+/* Written only by the input thread */
+static uint32_t queueTail = 0;
+/* Written only by the application thread */
+static uint32_t queueHead = 0;
+/* Written by the input thread when the queue was empty */
+static int32_t wakeFileDesc = -1;
+static KeySubscriber subscribers[KEY_MAX_SUBSCRIBERS];
+static uint32_t numOfSubscribers = 0;
+static uint8_t dispatching = 0;
+static uint8_t subscribersRemoved = 0;
+/* Time of the last action of every key and the repeats held back since */
+static uint64_t lastActionTime[KEY_CNT];
+static uint32_t heldRepeats[KEY_CNT];
+/* Last repeat held back, the timer passes it on when no other repeat comes first */
+static KeyEvent heldEvent;
+static TimerEntry repeatTimer;
+/* Set by the timer thread */
+static uint8_t repeatDue = 0;
+/* Updated by both threads without a lock */
+static KeyStatistics statistics;
+
+int32_t Key_Dispatch_Init()
+{
+	queueHead = 0;
+	queueTail = 0;
+	numOfSubscribers = 0;
+	subscribersRemoved = 0;
+	memset(lastActionTime, 0, sizeof(lastActionTime));
+	memset(heldRepeats, 0, sizeof(heldRepeats));
+	memset(&heldEvent, 0, sizeof(heldEvent));
+	memset(&statistics, 0, sizeof(statistics));
+	repeatDue = 0;
+
+	if (Timer_Service_Init())
+	{
+		printf("%s(%d): Error initializing timer service!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+	Timer_Init(&repeatTimer, Repeat_Timeout, NULL);
+
+	wakeFileDesc = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (wakeFileDesc == ERROR)
+	{
+		printf("%s(%d): Error creating eventfd (%s)!\n", __FUNCTION__, __LINE__, strerror(errno));
+		Timer_Service_Deinit();
+		return EXIT_FAILURE;
+	}
+	if (Remote_Register_Events_Callback(Key_Dispatch_Push))
+	{
+		close(wakeFileDesc);
+		wakeFileDesc = ERROR;
+		Timer_Service_Deinit();
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+int32_t Key_Dispatch_Deinit()
+{
+	Remote_Unregister_Events_Callback(Key_Dispatch_Push);
+	/* Timer writes the descriptor */
+	Timer_Stop(&repeatTimer);
+	if (wakeFileDesc != ERROR)
+	{
+		close(wakeFileDesc);
+		wakeFileDesc = ERROR;
+		Timer_Service_Deinit();
+	}
+	return EXIT_SUCCESS;
+}
+
+int32_t Key_Dispatch_Subscribe(uint32_t classMask, Key_Handler handler, void* argument)
+{
+	if (numOfSubscribers == KEY_MAX_SUBSCRIBERS)
+	{
+		printf("%s(%d): Too many key subscribers!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+	subscribers[numOfSubscribers].classMask = classMask;
+	subscribers[numOfSubscribers].handler = handler;
+	subscribers[numOfSubscribers].argument = argument;
+	numOfSubscribers++;
+	return EXIT_SUCCESS;
+}
+
+int32_t Key_Dispatch_Unsubscribe(Key_Handler handler, void* argument)
+{
+	uint32_t i;
+
+	for (i = 0; i < numOfSubscribers; i++)
+	{
+		if (subscribers[i].handler == handler && subscribers[i].argument == argument)
+		{
+			break;
+		}
+	}
+	if (i == numOfSubscribers)
+	{
+		printf("%s(%d): Key subscriber was not found!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+
+	/* Slots are kept in place until the current key is delivered */
+	if (dispatching)
+	{
+		subscribers[i].handler = NULL;
+		subscribersRemoved = 1;
+		return EXIT_SUCCESS;
+	}
+	memmove(&subscribers[i], &subscribers[i + 1], (numOfSubscribers - i - 1) * sizeof(KeySubscriber));
+	numOfSubscribers--;
+	return EXIT_SUCCESS;
+}
+
+int32_t Key_Dispatch_Push(struct input_event* buffer, uint32_t eventCnt)
+{
+	KeyEvent* event;
+	uint32_t tail = queueTail;
+	uint32_t head;
+	uint32_t dropped = 0;
+	uint8_t wasEmpty = 0;
+	uint64_t wake = 1;
+	uint32_t i;
+
+	for (i = 0; i < eventCnt; i++)
+	{
+		if (buffer[i].type != EV_KEY || buffer[i].code >= KEY_CNT || buffer[i].value > KEY_ACTION_REPEAT)
+		{
+			continue;
+		}
+		head = __atomic_load_n(&queueHead, __ATOMIC_ACQUIRE);
+		if (tail - head == KEY_QUEUE_SIZE)
+		{
+			dropped++;
+			continue;
+		}
+
+		event = &queue[tail & (KEY_QUEUE_SIZE - 1)];
+		event->code = buffer[i].code;
+		event->keyClass = Key_Get_Class(buffer[i].code);
+		event->action = buffer[i].value;
+		event->repeats = (buffer[i].value == KEY_ACTION_REPEAT) ? 1 : 0;
+		event->time = (uint64_t)buffer[i].time.tv_sec * 1000000 + buffer[i].time.tv_usec;
+
+		/* Either the application sees the new tail, or the input thread sees
+		   the application caught up and wakes it */
+		__atomic_store_n(&queueTail, tail + 1, __ATOMIC_SEQ_CST);
+		head = __atomic_load_n(&queueHead, __ATOMIC_SEQ_CST);
+		if (head == tail)
+		{
+			wasEmpty = 1;
+		}
+		tail++;
+
+		__atomic_add_fetch(&statistics.queued, 1, __ATOMIC_RELAXED);
+		if (tail - head > __atomic_load_n(&statistics.maxQueueDepth, __ATOMIC_RELAXED))
+		{
+			__atomic_store_n(&statistics.maxQueueDepth, tail - head, __ATOMIC_RELAXED);
+		}
+	}
+
+	if (wasEmpty && write(wakeFileDesc, &wake, sizeof(wake)) != sizeof(wake))
+	{
+		printf("%s(%d): Error waking key dispatch!\n", __FUNCTION__, __LINE__);
+	}
+	if (dropped > 0)
+	{
+		__atomic_add_fetch(&statistics.dropped, dropped, __ATOMIC_RELAXED);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+uint32_t Key_Dispatch_Process(int32_t timeout)
+{
+	KeyEvent batch[KEY_QUEUE_SIZE];
+	struct pollfd wakeDesc;
+	uint64_t wake;
+	uint32_t head = queueHead;
+	uint32_t tail;
+	uint32_t numOfEvents;
+	uint32_t dispatched = 0;
+
+	tail = __atomic_load_n(&queueTail, __ATOMIC_SEQ_CST);
+	if (head == tail && timeout != 0 && !__atomic_load_n(&repeatDue, __ATOMIC_RELAXED))
+	{
+		wakeDesc.fd = wakeFileDesc;
+		wakeDesc.events = POLLIN;
+		if (poll(&wakeDesc, 1, timeout) > 0)
+		{
+			__atomic_add_fetch(&statistics.wakeups, 1, __ATOMIC_RELAXED);
+		}
+	}
+	/* Cleared before the queue is read, a key pushed afterwards wakes again */
+	if (read(wakeFileDesc, &wake, sizeof(wake)) < 0)
+	{
+		wake = 0;
+	}
+
+	/* Queue is emptied, so the descriptor is readable again only for new keys */
+	while ((tail = __atomic_load_n(&queueTail, __ATOMIC_SEQ_CST)) != head)
+	{
+		for (numOfEvents = 0; head != tail; numOfEvents++, head++)
+		{
+			batch[numOfEvents] = queue[head & (KEY_QUEUE_SIZE - 1)];
+		}
+		/* Slots are given back before the subscribers run */
+		__atomic_store_n(&queueHead, head, __ATOMIC_SEQ_CST);
+		dispatched += Dispatch_Batch(batch, numOfEvents);
+	}
+	if (__atomic_exchange_n(&repeatDue, 0, __ATOMIC_RELAXED))
+	{
+		dispatched += Dispatch_Held_Repeats();
+	}
+	return dispatched;
+}
+
+int32_t Key_Dispatch_Get_File_Desc()
+{
+	return wakeFileDesc;
+}
+
+uint8_t Key_Get_Class(uint16_t code)
+{
+	switch (code)
+	{
+		case KEY_0:
+		case KEY_1:
+		case KEY_2:
+		case KEY_3:
+		case KEY_4:
+		case KEY_5:
+		case KEY_6:
+		case KEY_7:
+		case KEY_8:
+		case KEY_9:
+		case KEY_NUMERIC_0:
+		case KEY_NUMERIC_1:
+		case KEY_NUMERIC_2:
+		case KEY_NUMERIC_3:
+		case KEY_NUMERIC_4:
+		case KEY_NUMERIC_5:
+		case KEY_NUMERIC_6:
+		case KEY_NUMERIC_7:
+		case KEY_NUMERIC_8:
+		case KEY_NUMERIC_9:
+			return KEY_CLASS_DIGIT;
+		case KEY_CHANNELUP:
+		case KEY_CHANNELDOWN:
+		case KEY_PAGEUP:
+		case KEY_PAGEDOWN:
+		case KEY_LAST:
+			return KEY_CLASS_CHANNEL;
+		case KEY_VOLUMEUP:
+		case KEY_VOLUMEDOWN:
+		case KEY_MUTE:
+			return KEY_CLASS_VOLUME;
+		case KEY_UP:
+		case KEY_DOWN:
+		case KEY_LEFT:
+		case KEY_RIGHT:
+		case KEY_OK:
+		case KEY_ENTER:
+		case KEY_BACK:
+		case KEY_EXIT:
+		case KEY_MENU:
+		case KEY_INFO:
+		case KEY_EPG:
+		case KEY_TEXT:
+		case KEY_SUBTITLE:
+			return KEY_CLASS_NAVIGATION;
+		case KEY_POWER:
+		case KEY_POWER2:
+		case KEY_SLEEP:
+			return KEY_CLASS_POWER;
+		default:
+			return KEY_CLASS_OTHER;
+	}
+}
+
+void Key_Dispatch_Get_Statistics(KeyStatistics* outStatistics)
+{
+	outStatistics->queued = __atomic_load_n(&statistics.queued, __ATOMIC_RELAXED);
+	outStatistics->dropped = __atomic_load_n(&statistics.dropped, __ATOMIC_RELAXED);
+	outStatistics->maxQueueDepth = __atomic_load_n(&statistics.maxQueueDepth, __ATOMIC_RELAXED);
+	outStatistics->dispatched = __atomic_load_n(&statistics.dispatched, __ATOMIC_RELAXED);
+	outStatistics->coalescedRepeats = __atomic_load_n(&statistics.coalescedRepeats, __ATOMIC_RELAXED);
+	outStatistics->wakeups = __atomic_load_n(&statistics.wakeups, __ATOMIC_RELAXED);
+}
+
+uint32_t Dispatch_Batch(KeyEvent* batch, uint32_t numOfEvents)
+{
+	KeyEvent* event;
+	uint32_t coalesced = 0;
+	uint32_t dispatched = 0;
+	uint32_t i;
+
+	for (i = 0; i < numOfEvents; i++)
+	{
+		event = &batch[i];
+		if (event->action == KEY_ACTION_REPEAT)
+		{
+			/* Repeats which waited in the queue together are one action */
+			while (i + 1 < numOfEvents && batch[i + 1].action == KEY_ACTION_REPEAT && batch[i + 1].code == event->code)
+			{
+				i++;
+				event->time = batch[i].time;
+				event->repeats++;
+				coalesced++;
+			}
+			/* Held key acts at most once per interval, the timer passes the last repeats on */
+			if (event->time - lastActionTime[event->code] < KEY_REPEAT_INTERVAL)
+			{
+				heldRepeats[event->code] += event->repeats;
+				heldEvent = *event;
+				coalesced++;
+				Timer_Start(&repeatTimer,
+							(KEY_REPEAT_INTERVAL - (event->time - lastActionTime[event->code]) + 999) / 1000);
+				continue;
+			}
+			event->repeats += heldRepeats[event->code];
+		}
+		/* Repeats held back when the key is released are dropped */
+		lastActionTime[event->code] = event->time;
+		heldRepeats[event->code] = 0;
+
+		Deliver(event);
+		dispatched++;
+	}
+
+	__atomic_add_fetch(&statistics.coalescedRepeats, coalesced, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&statistics.dispatched, dispatched, __ATOMIC_RELAXED);
+	return dispatched;
+}
+
+void Repeat_Timeout(void* argument)
+{
+	uint64_t wake = 1;
+
+	__atomic_store_n(&repeatDue, 1, __ATOMIC_RELAXED);
+	if (write(wakeFileDesc, &wake, sizeof(wake)) != sizeof(wake))
+	{
+		printf("%s(%d): Error waking key dispatch!\n", __FUNCTION__, __LINE__);
+	}
+}
+
+uint32_t Dispatch_Held_Repeats()
+{
+	KeyEvent event = heldEvent;
+
+	/* Key was released or acted again since */
+	if (heldRepeats[event.code] == 0)
+	{
+		return 0;
+	}
+	event.repeats = heldRepeats[event.code];
+	lastActionTime[event.code] = Latency_Now();
+	heldRepeats[event.code] = 0;
+
+	Deliver(&event);
+	__atomic_add_fetch(&statistics.dispatched, 1, __ATOMIC_RELAXED);
+	return 1;
+}
+
+void Deliver(const KeyEvent* event)
+{
+	uint32_t count = numOfSubscribers;
+	uint32_t i;
+	uint32_t j;
+
+	/* OSD changes made by the handlers are measured from the key */
+	Latency_Record_Since(LATENCY_KEY_TO_DISPATCH, event->time);
+	Latency_Set_Input_Time(event->time);
+	dispatching = 1;
+	for (i = 0; i < count; i++)
+	{
+		if (subscribers[i].handler != NULL && (subscribers[i].classMask & event->keyClass))
+		{
+			subscribers[i].handler(event, subscribers[i].argument);
+		}
+	}
+	dispatching = 0;
+	Latency_Set_Input_Time(0);
+
+	/* Subscribers removed by the handlers */
+	if (subscribersRemoved)
+	{
+		for (i = 0, j = 0; i < numOfSubscribers; i++)
+		{
+			if (subscribers[i].handler != NULL)
+			{
+				subscribers[j++] = subscribers[i];
+			}
+		}
+		numOfSubscribers = j;
+		subscribersRemoved = 0;
+	}
+}
@@ -0,0 +1,160 @@
+#ifndef _KEY_DISPATCH_H_
+#define _KEY_DISPATCH_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <linux/input.h>
+#include <sys/eventfd.h>
+#include "remote.h"
+#include "latency.h"
+#include "timer_service.h"
+
+/* Key events between the input thread and the application, power of two */
+#define KEY_QUEUE_SIZE 256
+#define KEY_MAX_SUBSCRIBERS 8
+/* Microseconds between two actions of a held key, repeats in between are merged
+   and passed on by a timer at the end of the interval */
+#define KEY_REPEAT_INTERVAL 100000
+
+/* Key classes, subscribers ask for a mask of them */
+#define KEY_CLASS_DIGIT 0x01
+#define KEY_CLASS_CHANNEL 0x02
+#define KEY_CLASS_VOLUME 0x04
+#define KEY_CLASS_NAVIGATION 0x08
+#define KEY_CLASS_POWER 0x10
+#define KEY_CLASS_OTHER 0x20
+#define KEY_CLASS_ALL 0x3F
+
+/* Same values as in the EV_KEY events */
+#define KEY_ACTION_RELEASE 0
+#define KEY_ACTION_PRESS 1
+#define KEY_ACTION_REPEAT 2
+
+typedef struct KeyEvent {
+	uint16_t code;
+	uint8_t keyClass;
+	uint8_t action;
+	/* Repeat events this action stands for, 0 for a press or a release */
+	uint32_t repeats;
+	/* Microseconds of the input event, on the monotonic clock */
+	uint64_t time;
+} KeyEvent;
+
+typedef void(*Key_Handler)(const KeyEvent* event, void* argument);
+
+typedef struct KeyStatistics {
+	/* Key events pushed by the input thread and the ones lost to a full queue */
+	uint32_t queued;
+	uint32_t dropped;
+	uint32_t maxQueueDepth;
+	/* Actions passed to the subscribers */
+	uint32_t dispatched;
+	/* Repeats merged into another action */
+	uint32_t coalescedRepeats;
+	uint32_t wakeups;
+} KeyStatistics;
+
+/***********************************************************************
+* @brief    Key dispatch initialization function, takes the events of
+* 			the remote module. Remote has to be initialized before
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Key_Dispatch_Init();
+
+/***********************************************************************
+* @brief    Key dispatch deinitialization function, stops taking the
+* 			events of the remote module
+*
+* @return   EXIT_SUCCESS - no error
+*
+***********************************************************************/
+int32_t Key_Dispatch_Deinit();
+
+/***********************************************************************
+* @brief    Adds a subscriber. Subscribers are called on the thread
+* 			which calls Key_Dispatch_Process, and have to be added and
+* 			removed on that thread too, handlers included
+*
+* @param	[in] classMask - KEY_CLASS_ bits of the keys
+* @param	[in] handler - called for every key action of the classes
+* @param	[in] argument - passed to the handler
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - too many subscribers
+*
+***********************************************************************/
+int32_t Key_Dispatch_Subscribe(uint32_t classMask, Key_Handler handler, void* argument);
+
+/***********************************************************************
+* @brief    Removes a subscriber
+*
+* @param	[in] handler - handler of the subscriber
+* @param	[in] argument - argument of the subscriber
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - subscriber was not found
+*
+***********************************************************************/
+int32_t Key_Dispatch_Unsubscribe(Key_Handler handler, void* argument);
+
+/***********************************************************************
+* @brief    Queues the EV_KEY events of a batch without blocking.
+* 			Called by one input thread only, it is the remote callback
+*
+* @param	[in] buffer - input events
+* @param	[in] eventCnt - number of input events
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - queue was full, events were dropped
+*
+***********************************************************************/
+int32_t Key_Dispatch_Push(struct input_event* buffer, uint32_t eventCnt);
+
+/***********************************************************************
+* @brief    Waits for queued keys and passes them to the subscribers
+*
+* @param	[in] timeout - milliseconds to wait for a key, -1 waits
+* 						   forever, 0 does not wait
+*
+* @return   number of actions passed to the subscribers
+*
+***********************************************************************/
+uint32_t Key_Dispatch_Process(int32_t timeout);
+
+/***********************************************************************
+* @brief    Returns a descriptor which is readable while keys are
+* 			queued or merged repeats are due, for applications which
+* 			wait on more than keys
+*
+* @return   file descriptor
+*
+***********************************************************************/
+int32_t Key_Dispatch_Get_File_Desc();
+
+/***********************************************************************
+* @brief    Returns the class of a key
+*
+* @param	[in] code - KEY_ code of the input event
+*
+* @return   one of the KEY_CLASS_ bits
+*
+***********************************************************************/
+uint8_t Key_Get_Class(uint16_t code);
+
+/***********************************************************************
+* @brief    Copies the key dispatch statistics
+*
+* @param	[out] outStatistics - structure where the statistics are saved
+*
+***********************************************************************/
+void Key_Dispatch_Get_Statistics(KeyStatistics* outStatistics);
+
+#endif
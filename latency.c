@@ -0,0 +1,219 @@
+#include "latency.h"
+
+typedef struct LatencyHistogram {
+	uint32_t counts[LATENCY_NUM_BUCKETS];
+	uint32_t count;
+	uint64_t total;
+	uint32_t min;
+	uint32_t max;
+} LatencyHistogram;
+
+/***********************************************************************
+* @brief    Returns the bucket of a value
+*
+***********************************************************************/
+static uint32_t Bucket_Index(uint32_t value);
+
+/***********************************************************************
+* @brief    Returns the largest value which falls into the bucket
+*
+***********************************************************************/
+static uint32_t Bucket_Value(uint32_t index);
+
+/***********************************************************************
+* @brief    Timer callback, prints the summaries and restarts the timer
+*
+***********************************************************************/
+static void Periodic_Dump(void* argument);
+
+static const char* stageNames[LATENCY_NUM_STAGES] = {
+	"key to dispatch",
+	"key to OSD state",
+	"key to photon",
+	"OSD state to photon",
+	"channel change"
+};
+
+static LatencyHistogram histograms[LATENCY_NUM_STAGES];
+/* Key handled by the thread, read when it changes the OSD */
+static __thread uint64_t inputTime = 0;
+static TimerEntry dumpTimer;
+static uint32_t dumpPeriod = 0;
+
+uint64_t Latency_Now()
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+void Latency_Record(uint32_t stage, uint64_t microseconds)
+{
+	LatencyHistogram* histogram = &histograms[stage];
+	uint32_t value = (microseconds > UINT32_MAX) ? UINT32_MAX : (uint32_t)microseconds;
+	uint32_t current;
+
+	/* Relaxed atomics, samples of a dump may be a few counts apart */
+	__atomic_add_fetch(&histogram->counts[Bucket_Index(value)], 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&histogram->total, value, __ATOMIC_RELAXED);
+	current = __atomic_load_n(&histogram->max, __ATOMIC_RELAXED);
+	while (value > current && !__atomic_compare_exchange_n(&histogram->max, &current, value, 1,
+														   __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+	/* Count of 0 means the minimum was not set yet */
+	current = __atomic_load_n(&histogram->min, __ATOMIC_RELAXED);
+	while ((value < current || __atomic_load_n(&histogram->count, __ATOMIC_RELAXED) == 0)
+		   && !__atomic_compare_exchange_n(&histogram->min, &current, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+	__atomic_add_fetch(&histogram->count, 1, __ATOMIC_RELEASE);
+}
+
+void Latency_Record_Since(uint32_t stage, uint64_t startTime)
+{
+	uint64_t now = Latency_Now();
+
+	if (startTime != 0 && startTime <= now)
+	{
+		Latency_Record(stage, now - startTime);
+	}
+}
+
+void Latency_Set_Input_Time(uint64_t time)
+{
+	inputTime = time;
+}
+
+uint64_t Latency_Get_Input_Time()
+{
+	return inputTime;
+}
+
+void Latency_Get_Summary(uint32_t stage, LatencySummary* outSummary)
+{
+	LatencyHistogram* histogram = &histograms[stage];
+	uint32_t counts[LATENCY_NUM_BUCKETS];
+	uint32_t percentiles[4] = { 500, 900, 990, 999 };
+	uint32_t* results[4];
+	uint64_t total = 0;
+	uint64_t seen = 0;
+	uint32_t next = 0;
+	uint32_t i;
+
+	memset(outSummary, 0, sizeof(LatencySummary));
+	results[0] = &outSummary->p50;
+	results[1] = &outSummary->p90;
+	results[2] = &outSummary->p99;
+	results[3] = &outSummary->p999;
+
+	/* Copy first, percentiles are taken from one set of counts */
+	for (i = 0; i < LATENCY_NUM_BUCKETS; i++)
+	{
+		counts[i] = __atomic_load_n(&histogram->counts[i], __ATOMIC_RELAXED);
+		total += counts[i];
+	}
+	if (total == 0)
+	{
+		return;
+	}
+
+	for (i = 0; i < LATENCY_NUM_BUCKETS && next < 4; i++)
+	{
+		seen += counts[i];
+		/* Smallest value which has the percentile of the samples at or below it */
+		while (next < 4 && seen * 1000 >= total * percentiles[next])
+		{
+			*results[next++] = Bucket_Value(i);
+		}
+	}
+
+	outSummary->count = (uint32_t)total;
+	outSummary->min = __atomic_load_n(&histogram->min, __ATOMIC_RELAXED);
+	outSummary->max = __atomic_load_n(&histogram->max, __ATOMIC_RELAXED);
+	outSummary->mean = (uint32_t)(__atomic_load_n(&histogram->total, __ATOMIC_RELAXED) / total);
+	/* Top of the last bucket may be above the largest sample */
+	for (i = 0; i < 4; i++)
+	{
+		if (*results[i] > outSummary->max)
+		{
+			*results[i] = outSummary->max;
+		}
+	}
+}
+
+void Latency_Reset()
+{
+	memset(histograms, 0, sizeof(histograms));
+}
+
+void Latency_Dump()
+{
+	LatencySummary summary;
+	uint32_t stage;
+
+	for (stage = 0; stage < LATENCY_NUM_STAGES; stage++)
+	{
+		Latency_Get_Summary(stage, &summary);
+		if (summary.count == 0)
+		{
+			continue;
+		}
+		printf("Latency %s: %u samples, p50 %u us, p90 %u us, p99 %u us, p99.9 %u us, min %u us, max %u us\n",
+			   stageNames[stage], summary.count, summary.p50, summary.p90, summary.p99, summary.p999,
+			   summary.min, summary.max);
+	}
+}
+
+int32_t Latency_Start_Periodic_Dump(uint32_t seconds)
+{
+	if (seconds == 0 || Timer_Service_Init())
+	{
+		printf("%s(%d): Error starting latency dumps!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+	dumpPeriod = seconds;
+	Timer_Init(&dumpTimer, Periodic_Dump, NULL);
+	return Timer_Start(&dumpTimer, seconds * 1000);
+}
+
+void Latency_Stop_Periodic_Dump()
+{
+	if (dumpPeriod == 0)
+	{
+		return;
+	}
+	Timer_Stop(&dumpTimer);
+	Timer_Service_Deinit();
+	dumpPeriod = 0;
+}
+
+uint32_t Bucket_Index(uint32_t value)
+{
+	uint32_t shift;
+
+	if (value < LATENCY_LINEAR_LIMIT)
+	{
+		return value;
+	}
+	/* Keeps the five bits below the highest one */
+	shift = 31 - __builtin_clz(value) - 5;
+	return LATENCY_LINEAR_LIMIT + (shift - 1) * LATENCY_SUB_BUCKETS + (value >> shift) - LATENCY_SUB_BUCKETS;
+}
+
+uint32_t Bucket_Value(uint32_t index)
+{
+	uint32_t shift;
+	uint32_t subBucket;
+
+	if (index < LATENCY_LINEAR_LIMIT)
+	{
+		return index;
+	}
+	shift = (index - LATENCY_LINEAR_LIMIT) / LATENCY_SUB_BUCKETS + 1;
+	subBucket = (index - LATENCY_LINEAR_LIMIT) % LATENCY_SUB_BUCKETS + LATENCY_SUB_BUCKETS;
+	return (uint32_t)((((uint64_t)subBucket + 1) << shift) - 1);
+}
+
+void Periodic_Dump(void* argument)
+{
+	Latency_Dump();
+	Timer_Start(&dumpTimer, dumpPeriod * 1000);
+}
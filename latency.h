@@ -0,0 +1,123 @@
+#ifndef _LATENCY_H_
+#define _LATENCY_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "timer_service.h"
+
+/* Values below the limit have their own bucket, larger ones share
+   buckets of 32 per power of two, so a bucket is at most 3% wide */
+#define LATENCY_LINEAR_LIMIT 64
+#define LATENCY_SUB_BUCKETS 32
+/* Buckets up to 2^32 microseconds */
+#define LATENCY_NUM_BUCKETS (LATENCY_LINEAR_LIMIT + 26 * LATENCY_SUB_BUCKETS)
+
+/* Measured stages, the first three start at the kernel time of the key */
+#define LATENCY_KEY_TO_DISPATCH 0
+#define LATENCY_KEY_TO_STATE 1
+#define LATENCY_KEY_TO_PHOTON 2
+/* From the OSD state change until the frame with it was presented */
+#define LATENCY_STATE_TO_PHOTON 3
+/* From the channel change request, the key if there was one, until the new streams were started */
+#define LATENCY_ZAP 4
+#define LATENCY_NUM_STAGES 5
+
+/* Microseconds */
+typedef struct LatencySummary {
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint32_t mean;
+	uint32_t p50;
+	uint32_t p90;
+	uint32_t p99;
+	uint32_t p999;
+} LatencySummary;
+
+/***********************************************************************
+* @brief    Returns microseconds of the monotonic clock, the clock of
+* 			the input event times
+*
+***********************************************************************/
+uint64_t Latency_Now();
+
+/***********************************************************************
+* @brief    Adds a sample to the histogram of a stage. Can be called
+* 			from any thread, it does not lock
+*
+* @param    [in] stage - LATENCY_ stage
+* @param    [in] microseconds - measured latency
+*
+***********************************************************************/
+void Latency_Record(uint32_t stage, uint64_t microseconds);
+
+/***********************************************************************
+* @brief    Adds the time from start until now to the histogram of a
+* 			stage. Start times of 0 and in the future are ignored
+*
+* @param    [in] stage - LATENCY_ stage
+* @param    [in] startTime - microseconds of the monotonic clock
+*
+***********************************************************************/
+void Latency_Record_Since(uint32_t stage, uint64_t startTime);
+
+/***********************************************************************
+* @brief    Sets the time of the key which the calling thread handles,
+* 			OSD changes made by the thread are measured from it
+*
+* @param    [in] time - microseconds of the monotonic clock, 0 when
+* 						the thread does not handle a key
+*
+***********************************************************************/
+void Latency_Set_Input_Time(uint64_t time);
+
+/***********************************************************************
+* @brief    Returns the time of the key which the calling thread
+* 			handles, 0 if it does not handle one
+*
+***********************************************************************/
+uint64_t Latency_Get_Input_Time();
+
+/***********************************************************************
+* @brief    Calculates the percentiles of a stage
+*
+* @param    [in] stage - LATENCY_ stage
+* @param    [out] outSummary - structure where the summary is saved
+*
+***********************************************************************/
+void Latency_Get_Summary(uint32_t stage, LatencySummary* outSummary);
+
+/***********************************************************************
+* @brief    Empties the histograms
+*
+***********************************************************************/
+void Latency_Reset();
+
+/***********************************************************************
+* @brief    Prints the summaries of the stages which have samples
+*
+***********************************************************************/
+void Latency_Dump();
+
+/***********************************************************************
+* @brief    Prints the summaries periodically on the timer service
+* 			thread
+*
+* @param    [in] seconds - period of the dumps
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Latency_Start_Periodic_Dump(uint32_t seconds);
+
+/***********************************************************************
+* @brief    Stops the periodic dumps
+*
+***********************************************************************/
+void Latency_Stop_Periodic_Dump();
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef _OSD_BACKEND_H_
+#define _OSD_BACKEND_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+/* Surface flags */
+#define OSD_SURFACE_ARGB 0
+/* Pixel format of the screen, for images which are only copied to it */
+#define OSD_SURFACE_SCREEN_FORMAT 1
+
+/* Blit flags */
+#define OSD_BLIT_COPY 0
+/* Source over, blended with the alpha channel of the source */
+#define OSD_BLIT_BLEND 1
+
+/* Flip flags */
+#define OSD_FLIP_NONE 0
+/* Presents on the next vertical sync and waits for it */
+#define OSD_FLIP_WAIT_VSYNC 1
+
+/* Colors are 0xAARRGGBB, not premultiplied. Surfaces created with
+   OSD_SURFACE_ARGB keep their pixels premultiplied by alpha */
+#define OSD_COLOR(a, r, g, b) (((uint32_t)(a) << 24) | ((uint32_t)(r) << 16) | ((uint32_t)(g) << 8) | (uint32_t)(b))
+
+typedef struct OsdRectangle {
+	int32_t x;
+	int32_t y;
+	int32_t w;
+	int32_t h;
+} OsdRectangle;
+
+/* Defined by each backend */
+typedef struct OsdSurface OsdSurface;
+typedef struct OsdFont OsdFont;
+
+/*
+ * Drawing operations used by the graphic module. Surfaces and fonts are
+ * created at initialization, drawing functions do not allocate. Errors
+ * of drawing functions are handled by the backend.
+ */
+typedef struct OsdBackend {
+	const char* name;
+	/* Creates the double buffered screen surface and returns its size */
+	int32_t (*Init)(int32_t* width, int32_t* height);
+	void (*Deinit)();
+	OsdSurface* (*Get_Screen)();
+	OsdSurface* (*Create_Surface)(int32_t width, int32_t height, uint32_t flags);
+	void (*Release_Surface)(OsdSurface* surface);
+	/* Bytes of memory held by the pixels, rows times the pitch */
+	uint32_t (*Get_Surface_Bytes)(OsdSurface* surface);
+	/* NULL clip is the whole surface */
+	void (*Set_Clip)(OsdSurface* surface, const OsdRectangle* clip);
+	/* Pixels are replaced with the color, not blended */
+	void (*Fill_Rectangle)(OsdSurface* surface, const OsdRectangle* rectangle, uint32_t color);
+	void (*Blit)(OsdSurface* destination, OsdSurface* source, const OsdRectangle* sourceRectangle,
+				 int32_t x, int32_t y, uint32_t flags);
+	/* Source over of a premultiplied surface with all of its channels scaled by alpha / 255 */
+	void (*Blit_Alpha)(OsdSurface* destination, OsdSurface* source, const OsdRectangle* sourceRectangle,
+					   int32_t x, int32_t y, uint8_t alpha);
+	/* Replaces the rectangle with width x height ARGB pixels scaled to it, nearest neighbour */
+	void (*Write_Pixels)(OsdSurface* surface, const OsdRectangle* rectangle, const uint32_t* pixels,
+						 int32_t width, int32_t height, int32_t pitch);
+	/* NULL region swaps the buffers, otherwise the region is copied to the front buffer */
+	void (*Flip)(const OsdRectangle* region, uint32_t flags);
+	OsdFont* (*Load_Font)(int32_t height);
+	void (*Release_Font)(OsdFont* font);
+	int32_t (*Get_Font_Height)(OsdFont* font);
+	void (*Get_Glyph_Extents)(OsdFont* font, uint32_t character, OsdRectangle* ink, int32_t* advance);
+	int32_t (*Get_String_Width)(OsdFont* font, const char* text);
+	/* UTF-8 text, blended with its top left corner at x, y */
+	void (*Draw_String)(OsdSurface* surface, OsdFont* font, const char* text, int32_t x, int32_t y, uint32_t color);
+	int32_t (*Get_Image_Size)(const char* fileName, int32_t* width, int32_t* height);
+	/* Decodes the image into the rectangle of the surface */
+	int32_t (*Render_Image)(const char* fileName, OsdSurface* surface, const OsdRectangle* rectangle);
+} OsdBackend;
+
+#endif
@@ -0,0 +1,639 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include "graphic.h"
+#include "osd_software.h"
+#include "crc32.h"
+
+/* Host benchmark of the OSD drawn by the software backend */
+
+/* Minimal time spent on one measurement */
+#define BENCH_MIN_SECONDS 0.2
+/* Rows drawn between two clock reads */
+#define BENCH_CHECK_INTERVAL 64
+/* Banner size on a 1920x1080 screen */
+#define BENCH_BLEND_WIDTH 960
+#define BENCH_BLEND_HEIGHT 180
+#define BENCH_DEFAULT_FRAMES 300
+/* Longest wait for one frame of the render thread */
+#define BENCH_FRAME_TIMEOUT_MS 1000
+/* Time given to the render thread to draw the final frame, after the fade */
+#define BENCH_SETTLE_MS (GRAPHIC_FADE_TIME / 1000 + 100)
+#define BENCH_FADES 4
+/* Global alpha of the measured fade blend */
+#define BENCH_FADE_ALPHA 100
+#define BENCH_DEFAULT_REFRESH 60
+/* Timers restarted by the timer benchmark, spread over the wheel */
+#define BENCH_TIMERS 1024
+#define BENCH_TIMER_RESTARTS 64
+/* Delay of the timer whose lateness is measured */
+#define BENCH_TIMER_DELAY_MS 50
+/* Most threads publishing the OSD state at the same time */
+#define BENCH_PRODUCERS 4
+#define BENCH_PRODUCER_MS 200
+/* Events recorded by the trace benchmark, more than a ring holds */
+#define BENCH_TRACE_EVENTS (4 * TRACE_RING_SIZE)
+
+/***********************************************************************
+* @brief    Measures the fill, blend and fade kernels of every kind the
+* 			CPU supports and checks that they blend the same pixels
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - kernels blend differently
+*
+***********************************************************************/
+static int32_t Run_Kernel_Benchmarks();
+
+/***********************************************************************
+* @brief    Draws banner and volume changes through the graphic module
+* 			as fast as the render thread takes them and prints the
+* 			frame rate and draw times
+*
+* @param    [in] numOfFrames - number of changes
+*
+***********************************************************************/
+static void Run_Pipeline_Benchmark(uint32_t numOfFrames);
+
+/***********************************************************************
+* @brief    Fades the banner and the volume in and out at the refresh
+* 			rate and prints the cost of the fade frames
+*
+* @param    [in] refreshRate - emulated refreshes per second
+*
+***********************************************************************/
+static void Run_Fade_Benchmark(uint32_t refreshRate);
+
+/***********************************************************************
+* @brief    Publishes volume changes from 1 to BENCH_PRODUCERS threads
+* 			while the render thread draws them, prints how long the
+* 			producers took and checks that the last state was drawn
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - a published state was not drawn
+*
+***********************************************************************/
+static int32_t Run_State_Benchmark();
+
+/***********************************************************************
+* @brief    Producer thread of the state benchmark
+*
+* @param    [in, out] argument - BenchProducer of the thread
+*
+***********************************************************************/
+static void* Produce_States(void* argument);
+
+/***********************************************************************
+* @brief    Measures restarting and stopping many timers of the timer
+* 			service and how late a timer expires
+*
+***********************************************************************/
+static void Run_Timer_Benchmark();
+
+/***********************************************************************
+* @brief    Measures the cost of a tracepoint
+*
+***********************************************************************/
+static void Run_Trace_Benchmark();
+
+/***********************************************************************
+* @brief    Timer callback of the timer benchmark, saves the time
+*
+* @param    [out] argument - timespec where the time is saved
+*
+***********************************************************************/
+static void Timer_Expired(void* argument);
+
+/***********************************************************************
+* @brief    Sleeps for some milliseconds
+*
+***********************************************************************/
+static void Sleep_Milliseconds(uint32_t milliseconds);
+
+/***********************************************************************
+* @brief    Waits until the render thread finished more frames than
+* 			the given count
+*
+* @param    [in] frames - frames already counted
+*
+* @return   frames - new frame count, unchanged after a timeout
+*
+***********************************************************************/
+static uint32_t Wait_For_Frame(uint32_t frames);
+
+/***********************************************************************
+* @brief    Returns seconds between two times
+*
+***********************************************************************/
+static double Seconds(const struct timespec* start, const struct timespec* end);
+
+typedef struct BenchProducer {
+	pthread_t thread;
+	uint32_t index;
+	uint32_t calls;
+	/* Nanoseconds of the calls */
+	uint64_t totalTime;
+	uint64_t maxTime;
+} BenchProducer;
+
+static uint32_t fillRow[OSD_SOFTWARE_WIDTH];
+static uint32_t blendSource[BENCH_BLEND_WIDTH * BENCH_BLEND_HEIGHT];
+static uint32_t blendDestination[BENCH_BLEND_WIDTH * BENCH_BLEND_HEIGHT];
+static TimerEntry timers[BENCH_TIMERS];
+static uint8_t producersRunning = 0;
+
+int32_t main(int32_t argc, char** argv)
+{
+	int32_t option;
+	uint32_t numOfFrames = BENCH_DEFAULT_FRAMES;
+	uint32_t refreshRate = BENCH_DEFAULT_REFRESH;
+	const char* kernelName = NULL;
+	const char* dumpFile = NULL;
+	const char* traceFile = NULL;
+	const OsdPixelKernels* selected;
+	const uint32_t* frame;
+	int32_t width;
+	int32_t height;
+	uint32_t kind;
+	infoElements input;
+
+	while ((option = getopt(argc, argv, "n:k:o:r:t:")) != -1)
+	{
+		switch (option)
+		{
+			case 'n':
+				numOfFrames = strtoul(optarg, NULL, 10);
+				break;
+			case 'k':
+				kernelName = optarg;
+				break;
+			case 'o':
+				dumpFile = optarg;
+				break;
+			case 'r':
+				refreshRate = strtoul(optarg, NULL, 10);
+				break;
+			case 't':
+				traceFile = optarg;
+				break;
+			default:
+				printf("Usage: %s [-n frames] [-k scalar|sse2|avx2|neon] [-r fade refresh rate] [-o frame.ppm]"
+					   " [-t trace.json]\n", argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (Run_Kernel_Benchmarks())
+	{
+		return EXIT_FAILURE;
+	}
+	Run_Trace_Benchmark();
+	if (traceFile != NULL && Trace_Init(traceFile, 0, 1))
+	{
+		return EXIT_FAILURE;
+	}
+
+	if (kernelName != NULL)
+	{
+		for (kind = 0; kind < OSD_NUM_KERNELS; kind++)
+		{
+			selected = Osd_Software_Get_Kernels(kind);
+			if (selected != NULL && strcmp(selected->name, kernelName) == 0)
+			{
+				break;
+			}
+		}
+		if (kind == OSD_NUM_KERNELS || Osd_Software_Set_Kernels(kind))
+		{
+			printf("Kernels %s are not supported!\n", kernelName);
+			return EXIT_FAILURE;
+		}
+	}
+
+	/* Frames are presented as soon as they are drawn */
+	Osd_Software_Set_Refresh_Rate(0);
+	Graphic_Set_Backend(Osd_Software_Get_Backend());
+	if (Graphic_Init())
+	{
+		return EXIT_FAILURE;
+	}
+
+	/* Fades first, so the longest times are theirs */
+	Run_Fade_Benchmark(refreshRate);
+	Osd_Software_Set_Refresh_Rate(0);
+	/* Only the pipeline changes are measured from a key */
+	Latency_Reset();
+	Run_Pipeline_Benchmark(numOfFrames);
+	Run_Timer_Benchmark();
+	if (Run_State_Benchmark())
+	{
+		Graphic_Deinit();
+		return EXIT_FAILURE;
+	}
+
+	/* Same picture on every run, its checksum shows drawing changes */
+	memset(&input, 0, sizeof(input));
+	input.channel = 1;
+	input.teletext = 1;
+	input.audioPID = 101;
+	input.videoPID = 102;
+	strncpy(input.serviceName, "OSD bench", INFO_NAME_SIZE - 1);
+	Show_Info_Banner(input);
+	Show_Volume(5);
+	Sleep_Milliseconds(BENCH_SETTLE_MS);
+
+	frame = Osd_Software_Get_Frame(&width, &height);
+	printf("Final frame %dx%d checksum %08x\n", width, height,
+		   Crc32_Calculate((const uint8_t*)frame, width * height * sizeof(uint32_t)));
+	if (dumpFile != NULL && Osd_Software_Dump_PPM(dumpFile) == EXIT_SUCCESS)
+	{
+		printf("Final frame written to %s\n", dumpFile);
+	}
+
+	Graphic_Deinit();
+	return EXIT_SUCCESS;
+}
+
+int32_t Run_Kernel_Benchmarks()
+{
+	const OsdPixelKernels* scalar = Osd_Software_Get_Kernels(OSD_KERNELS_SCALAR);
+	const OsdPixelKernels* current;
+	struct timespec start;
+	struct timespec now;
+	double seconds;
+	uint64_t rows;
+	uint32_t reference = 0;
+	uint32_t fadeReference = 0;
+	uint32_t checksum;
+	uint32_t fadeChecksum;
+	uint32_t alpha;
+	uint32_t kind;
+	uint32_t i;
+	int32_t y;
+
+	/* Every alpha value over an opaque background, premultiplied */
+	for (i = 0; i < BENCH_BLEND_WIDTH * BENCH_BLEND_HEIGHT; i++)
+	{
+		alpha = (i * 7) & 0xFF;
+		blendSource[i] = (alpha << 24) | ((alpha * ((i >> 3) & 0xFF) / 255) << 16) | ((alpha / 2) << 8) | (alpha / 3);
+	}
+
+	printf("Pixel kernels\n");
+	for (kind = 0; kind < OSD_NUM_KERNELS; kind++)
+	{
+		current = Osd_Software_Get_Kernels(kind);
+		if (current == NULL)
+		{
+			continue;
+		}
+
+		/* Blending of all kinds has to match the scalar one */
+		scalar->Fill_Row(blendDestination, 0xFF204060, BENCH_BLEND_WIDTH * BENCH_BLEND_HEIGHT);
+		current->Blend_Row(blendDestination, blendSource, BENCH_BLEND_WIDTH * BENCH_BLEND_HEIGHT);
+		checksum = Crc32_Calculate((const uint8_t*)blendDestination, sizeof(blendDestination));
+		scalar->Fill_Row(blendDestination, 0xFF204060, BENCH_BLEND_WIDTH * BENCH_BLEND_HEIGHT);
+		current->Blend_Row_Alpha(blendDestination, blendSource, BENCH_BLEND_WIDTH * BENCH_BLEND_HEIGHT,
+								 BENCH_FADE_ALPHA);
+		fadeChecksum = Crc32_Calculate((const uint8_t*)blendDestination, sizeof(blendDestination));
+		if (kind == OSD_KERNELS_SCALAR)
+		{
+			reference = checksum;
+			fadeReference = fadeChecksum;
+		}
+		else if (checksum != reference || fadeChecksum != fadeReference)
+		{
+			printf("%s blending differs from scalar (%08x %08x, %08x %08x)!\n", current->name,
+				   checksum, fadeChecksum, reference, fadeReference);
+			return EXIT_FAILURE;
+		}
+
+		rows = 0;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		do
+		{
+			for (i = 0; i < BENCH_CHECK_INTERVAL; i++)
+			{
+				current->Fill_Row(fillRow, 0xFF000000 | i, OSD_SOFTWARE_WIDTH);
+			}
+			rows += BENCH_CHECK_INTERVAL;
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			seconds = Seconds(&start, &now);
+		} while (seconds < BENCH_MIN_SECONDS);
+		printf("    %-8s fill %8.1f Mpixel/s", current->name, rows * OSD_SOFTWARE_WIDTH / seconds / 1e6);
+
+		rows = 0;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		do
+		{
+			for (y = 0; y < BENCH_BLEND_HEIGHT; y++)
+			{
+				current->Blend_Row(blendDestination + y * BENCH_BLEND_WIDTH, blendSource + y * BENCH_BLEND_WIDTH,
+								   BENCH_BLEND_WIDTH);
+			}
+			rows += BENCH_BLEND_HEIGHT;
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			seconds = Seconds(&start, &now);
+		} while (seconds < BENCH_MIN_SECONDS);
+		printf("  blend %8.1f Mpixel/s", rows * BENCH_BLEND_WIDTH / seconds / 1e6);
+
+		rows = 0;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		do
+		{
+			for (y = 0; y < BENCH_BLEND_HEIGHT; y++)
+			{
+				current->Blend_Row_Alpha(blendDestination + y * BENCH_BLEND_WIDTH, blendSource + y * BENCH_BLEND_WIDTH,
+										 BENCH_BLEND_WIDTH, BENCH_FADE_ALPHA);
+			}
+			rows += BENCH_BLEND_HEIGHT;
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			seconds = Seconds(&start, &now);
+		} while (seconds < BENCH_MIN_SECONDS);
+		printf("  fade %8.1f Mpixel/s\n", rows * BENCH_BLEND_WIDTH / seconds / 1e6);
+	}
+	return EXIT_SUCCESS;
+}
+
+void Run_Pipeline_Benchmark(uint32_t numOfFrames)
+{
+	GraphicStatistics statistics;
+	infoElements input;
+	struct timespec start;
+	struct timespec end;
+	uint32_t frames;
+	uint32_t firstFrame;
+	uint32_t i;
+
+	Graphic_Get_Statistics(&statistics);
+	frames = statistics.frames;
+	firstFrame = frames;
+
+	memset(&input, 0, sizeof(input));
+	input.audioPID = 101;
+	input.videoPID = 102;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < numOfFrames; i++)
+	{
+		/* Banner and volume change every frame */
+		input.channel = 1 + i % 99;
+		input.teletext = i & 1;
+		snprintf(input.serviceName, INFO_NAME_SIZE, "Service %u", i % 7);
+		/* As if a key pressed now caused the changes */
+		Latency_Set_Input_Time(Latency_Now());
+		Show_Info_Banner(input);
+		Show_Volume(i % 11);
+		Latency_Set_Input_Time(0);
+		frames = Wait_For_Frame(frames);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	Graphic_Get_Statistics(&statistics);
+	printf("Pipeline: %u frames in %.3f s, %.1f frames/s\n", frames - firstFrame, Seconds(&start, &end),
+		   (frames - firstFrame) / Seconds(&start, &end));
+	printf("    draw last %llu us, longest %llu us, average frame %llu us, damage %u pixels\n",
+		   (unsigned long long)statistics.lastDrawTime, (unsigned long long)statistics.maxDrawTime,
+		   (unsigned long long)statistics.averageFrameTime, statistics.lastDamageArea);
+	printf("    text runs %u hits %u misses, merged requests %u\n",
+		   statistics.textRunHits, statistics.textRunMisses, statistics.mergedRequests);
+	Latency_Dump();
+}
+
+void Run_Fade_Benchmark(uint32_t refreshRate)
+{
+	GraphicStatistics before;
+	GraphicStatistics after;
+	infoElements input;
+	uint32_t i;
+
+	memset(&input, 0, sizeof(input));
+	input.channel = 7;
+	input.audioPID = 101;
+	input.videoPID = 102;
+	strncpy(input.serviceName, "Fade", INFO_NAME_SIZE - 1);
+
+	/* First frame clears the whole screen, it is not a part of a fade */
+	Wait_For_Frame(0);
+	/* Start from a fully shown banner and volume */
+	Show_Info_Banner(input);
+	Show_Volume(7);
+	Sleep_Milliseconds(BENCH_SETTLE_MS);
+	Osd_Software_Set_Refresh_Rate(refreshRate);
+	Graphic_Get_Statistics(&before);
+
+	for (i = 0; i < BENCH_FADES; i++)
+	{
+		Hide_Info_Banner(NULL);
+		Hide_Volume(NULL);
+		Sleep_Milliseconds(BENCH_SETTLE_MS);
+		Show_Info_Banner(input);
+		Show_Volume(7);
+		Sleep_Milliseconds(BENCH_SETTLE_MS);
+	}
+	Graphic_Get_Statistics(&after);
+
+	printf("Fades at %u Hz: %u frames, %.1f frames per fade, cache renders %u\n", refreshRate,
+		   after.animationFrames - before.animationFrames,
+		   (after.animationFrames - before.animationFrames) / (2.0 * BENCH_FADES),
+		   after.cacheRenders - before.cacheRenders);
+	/* Longest times include the fade in which rendered the caches */
+	printf("    draw average %llu us, longest %llu us, longest interval %llu us\n",
+		   (unsigned long long)((after.totalAnimationDrawTime - before.totalAnimationDrawTime)
+								/ (after.animationFrames - before.animationFrames + 1)),
+		   (unsigned long long)after.maxAnimationDrawTime, (unsigned long long)after.maxAnimationInterval);
+}
+
+uint32_t Wait_For_Frame(uint32_t frames)
+{
+	GraphicStatistics statistics;
+	struct timespec start;
+	struct timespec now;
+	struct timespec pause;
+
+	pause.tv_sec = 0;
+	pause.tv_nsec = 20000;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	do
+	{
+		Graphic_Get_Statistics(&statistics);
+		if (statistics.frames > frames)
+		{
+			return statistics.frames;
+		}
+		nanosleep(&pause, NULL);
+		clock_gettime(CLOCK_MONOTONIC, &now);
+	} while (Seconds(&start, &now) * 1000 < BENCH_FRAME_TIMEOUT_MS);
+
+	printf("%s(%d): Render thread did not draw a frame!\n", __FUNCTION__, __LINE__);
+	return frames;
+}
+
+void Sleep_Milliseconds(uint32_t milliseconds)
+{
+	struct timespec pause;
+
+	pause.tv_sec = milliseconds / 1000;
+	pause.tv_nsec = (milliseconds % 1000) * 1000000L;
+	nanosleep(&pause, NULL);
+}
+
+double Seconds(const struct timespec* start, const struct timespec* end)
+{
+	return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+void Run_Timer_Benchmark()
+{
+	TimerStatistics before;
+	TimerStatistics after;
+	struct timespec start;
+	struct timespec end;
+	struct timespec expiredTime;
+	uint32_t restart;
+	uint32_t i;
+
+	for (i = 0; i < BENCH_TIMERS; i++)
+	{
+		Timer_Init(&timers[i], Timer_Expired, &expiredTime);
+	}
+
+	/* Restarts move the timers between slots, none of them expires */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (restart = 0; restart < BENCH_TIMER_RESTARTS; restart++)
+	{
+		for (i = 0; i < BENCH_TIMERS; i++)
+		{
+			Timer_Start(&timers[i], 60000 + (i * 37 + restart * 101) % 10000);
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("Timer restart: %.0f ns with %u timers\n",
+		   Seconds(&start, &end) * 1e9 / (BENCH_TIMERS * BENCH_TIMER_RESTARTS), BENCH_TIMERS);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < BENCH_TIMERS; i++)
+	{
+		Timer_Stop(&timers[i]);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("Timer stop: %.0f ns\n", Seconds(&start, &end) * 1e9 / BENCH_TIMERS);
+
+	/* Stopped timer is a sign that the callback did not run */
+	memset(&expiredTime, 0, sizeof(expiredTime));
+	Timer_Service_Get_Statistics(&before);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	Timer_Start(&timers[0], BENCH_TIMER_DELAY_MS);
+	Sleep_Milliseconds(BENCH_TIMER_DELAY_MS + 5 * TIMER_SERVICE_TICK_MS);
+	Timer_Stop(&timers[0]);
+	Timer_Service_Get_Statistics(&after);
+	if (expiredTime.tv_sec == 0 && expiredTime.tv_nsec == 0)
+	{
+		printf("Timer did not expire!\n");
+		return;
+	}
+	printf("Timer of %u ms expired after %.2f ms, %u wakeups, longest callback %llu us\n",
+		   BENCH_TIMER_DELAY_MS, Seconds(&start, &expiredTime) * 1000,
+		   after.wakeups - before.wakeups, (unsigned long long)after.maxCallbackTime);
+}
+
+void Run_Trace_Benchmark()
+{
+	struct timespec start;
+	struct timespec end;
+	uint32_t i;
+
+	/* First event allocates the ring of the thread */
+	Trace_Record("bench", TRACE_PHASE_INSTANT, 0);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < BENCH_TRACE_EVENTS; i++)
+	{
+		Trace_Record("bench", TRACE_PHASE_COUNTER, i);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("Tracepoint: %.1f ns\n", Seconds(&start, &end) * 1e9 / BENCH_TRACE_EVENTS);
+}
+
+void Timer_Expired(void* argument)
+{
+	clock_gettime(CLOCK_MONOTONIC, (struct timespec*)argument);
+}
+
+int32_t Run_State_Benchmark()
+{
+	BenchProducer producers[BENCH_PRODUCERS];
+	GraphicStatistics before;
+	GraphicStatistics after;
+	uint32_t numOfProducers;
+	uint32_t calls;
+	uint64_t totalTime;
+	uint64_t maxTime;
+	uint32_t i;
+
+	for (numOfProducers = 1; numOfProducers <= BENCH_PRODUCERS; numOfProducers *= 2)
+	{
+		Graphic_Get_Statistics(&before);
+		__atomic_store_n(&producersRunning, 1, __ATOMIC_RELEASE);
+		for (i = 0; i < numOfProducers; i++)
+		{
+			memset(&producers[i], 0, sizeof(BenchProducer));
+			producers[i].index = i;
+			pthread_create(&producers[i].thread, NULL, Produce_States, &producers[i]);
+		}
+		Sleep_Milliseconds(BENCH_PRODUCER_MS);
+		__atomic_store_n(&producersRunning, 0, __ATOMIC_RELEASE);
+
+		calls = 0;
+		totalTime = 0;
+		maxTime = 0;
+		for (i = 0; i < numOfProducers; i++)
+		{
+			pthread_join(producers[i].thread, NULL);
+			calls += producers[i].calls;
+			totalTime += producers[i].totalTime;
+			if (producers[i].maxTime > maxTime)
+			{
+				maxTime = producers[i].maxTime;
+			}
+		}
+		/* Last published state has to reach the screen */
+		Sleep_Milliseconds(BENCH_SETTLE_MS);
+		Graphic_Get_Statistics(&after);
+
+		printf("State with %u producers: %.2f M updates/s, average %.0f ns, longest %llu ns\n",
+			   numOfProducers, calls / (BENCH_PRODUCER_MS * 1000.0), calls ? (double)totalTime / calls : 0.0,
+			   (unsigned long long)maxTime);
+		printf("    %u frames, %u merged, %u retried copies\n", after.frames - before.frames,
+			   after.mergedRequests - before.mergedRequests, after.stateRetries - before.stateRetries);
+		if (after.renderedRequests != after.redrawRequests)
+		{
+			printf("%s(%d): State %u was published, %u was drawn!\n", __FUNCTION__, __LINE__,
+				   after.redrawRequests, after.renderedRequests);
+			return EXIT_FAILURE;
+		}
+	}
+	return EXIT_SUCCESS;
+}
+
+void* Produce_States(void* argument)
+{
+	BenchProducer* producer = (BenchProducer*)argument;
+	struct timespec start;
+	struct timespec end;
+	uint64_t callTime;
+
+	while (__atomic_load_n(&producersRunning, __ATOMIC_ACQUIRE))
+	{
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		Show_Volume((producer->index + producer->calls) % 10);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		callTime = (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000 + (end.tv_nsec - start.tv_nsec);
+		producer->totalTime += callTime;
+		if (callTime > producer->maxTime)
+		{
+			producer->maxTime = callTime;
+		}
+		producer->calls++;
+	}
+	return NULL;
+}
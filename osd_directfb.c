@@ -0,0 +1,500 @@
+#include "osd_directfb.h"
+
+struct OsdSurface {
+	IDirectFBSurface* surface;
+	/* Last flags set on the surface, to skip redundant state changes */
+	DFBSurfaceBlittingFlags blittingFlags;
+	/* ARGB surfaces are premultiplied, the screen and images are not */
+	uint8_t premultiplied;
+};
+
+struct OsdFont {
+	IDirectFBFont* font;
+};
+
+/***********************************************************************
+* @brief    Initializes DirectFB and creates the primary surface
+*
+***********************************************************************/
+static int32_t DirectFB_Init(int32_t* width, int32_t* height);
+
+/***********************************************************************
+* @brief    Releases the primary surface and DirectFB
+*
+***********************************************************************/
+static void DirectFB_Deinit();
+
+/***********************************************************************
+* @brief    Returns the primary surface
+*
+***********************************************************************/
+static OsdSurface* DirectFB_Get_Screen();
+
+/***********************************************************************
+* @brief    Creates an offscreen surface
+*
+***********************************************************************/
+static OsdSurface* DirectFB_Create_Surface(int32_t width, int32_t height, uint32_t flags);
+
+/***********************************************************************
+* @brief    Releases an offscreen surface
+*
+***********************************************************************/
+static void DirectFB_Release_Surface(OsdSurface* surface);
+
+/***********************************************************************
+* @brief    Returns the bytes held by the surface, from its pitch
+*
+***********************************************************************/
+static uint32_t DirectFB_Get_Surface_Bytes(OsdSurface* surface);
+
+/***********************************************************************
+* @brief    Sets the clip of the surface
+*
+***********************************************************************/
+static void DirectFB_Set_Clip(OsdSurface* surface, const OsdRectangle* clip);
+
+/***********************************************************************
+* @brief    Fills a rectangle without blending
+*
+***********************************************************************/
+static void DirectFB_Fill_Rectangle(OsdSurface* surface, const OsdRectangle* rectangle, uint32_t color);
+
+/***********************************************************************
+* @brief    Blits a part of the source surface
+*
+***********************************************************************/
+static void DirectFB_Blit(OsdSurface* destination, OsdSurface* source, const OsdRectangle* sourceRectangle,
+						  int32_t x, int32_t y, uint32_t flags);
+
+/***********************************************************************
+* @brief    Blends a part of the source surface scaled by a global alpha
+*
+***********************************************************************/
+static void DirectFB_Blit_Alpha(OsdSurface* destination, OsdSurface* source, const OsdRectangle* sourceRectangle,
+								int32_t x, int32_t y, uint8_t alpha);
+
+/***********************************************************************
+* @brief    Scales pixels into the locked surface, premultiplied for
+* 			premultiplied surfaces
+*
+***********************************************************************/
+static void DirectFB_Write_Pixels(OsdSurface* surface, const OsdRectangle* rectangle, const uint32_t* pixels,
+								  int32_t width, int32_t height, int32_t pitch);
+
+/***********************************************************************
+* @brief    Blits with the flags, sources which are not premultiplied
+* 			are premultiplied on the way
+*
+***********************************************************************/
+static void Blit_Surface(OsdSurface* destination, OsdSurface* source, const OsdRectangle* sourceRectangle,
+						 int32_t x, int32_t y, DFBSurfaceBlittingFlags blittingFlags);
+
+/***********************************************************************
+* @brief    Flips the primary surface
+*
+***********************************************************************/
+static void DirectFB_Flip(const OsdRectangle* region, uint32_t flags);
+
+/***********************************************************************
+* @brief    Loads OSD_DIRECTFB_FONT_FILE in the given height
+*
+***********************************************************************/
+static OsdFont* DirectFB_Load_Font(int32_t height);
+
+/***********************************************************************
+* @brief    Releases a font
+*
+***********************************************************************/
+static void DirectFB_Release_Font(OsdFont* font);
+
+/***********************************************************************
+* @brief    Returns the height of a line of text
+*
+***********************************************************************/
+static int32_t DirectFB_Get_Font_Height(OsdFont* font);
+
+/***********************************************************************
+* @brief    Returns the ink rectangle and advance of a character
+*
+***********************************************************************/
+static void DirectFB_Get_Glyph_Extents(OsdFont* font, uint32_t character, OsdRectangle* ink, int32_t* advance);
+
+/***********************************************************************
+* @brief    Returns the width of a text
+*
+***********************************************************************/
+static int32_t DirectFB_Get_String_Width(OsdFont* font, const char* text);
+
+/***********************************************************************
+* @brief    Draws a text
+*
+***********************************************************************/
+static void DirectFB_Draw_String(OsdSurface* surface, OsdFont* font, const char* text, int32_t x, int32_t y, uint32_t color);
+
+/***********************************************************************
+* @brief    Reads the size of an image from its header
+*
+***********************************************************************/
+static int32_t DirectFB_Get_Image_Size(const char* fileName, int32_t* width, int32_t* height);
+
+/***********************************************************************
+* @brief    Decodes an image into a rectangle of the surface
+*
+***********************************************************************/
+static int32_t DirectFB_Render_Image(const char* fileName, OsdSurface* surface, const OsdRectangle* rectangle);
+
+static IDirectFB *dfbInterface = NULL;
+static OsdSurface primary;
+static DFBSurfacePixelFormat screenFormat = DSPF_ARGB;
+
+static const OsdBackend directFBBackend = {
+	"directfb",
+	DirectFB_Init,
+	DirectFB_Deinit,
+	DirectFB_Get_Screen,
+	DirectFB_Create_Surface,
+	DirectFB_Release_Surface,
+	DirectFB_Get_Surface_Bytes,
+	DirectFB_Set_Clip,
+	DirectFB_Fill_Rectangle,
+	DirectFB_Blit,
+	DirectFB_Blit_Alpha,
+	DirectFB_Write_Pixels,
+	DirectFB_Flip,
+	DirectFB_Load_Font,
+	DirectFB_Release_Font,
+	DirectFB_Get_Font_Height,
+	DirectFB_Get_Glyph_Extents,
+	DirectFB_Get_String_Width,
+	DirectFB_Draw_String,
+	DirectFB_Get_Image_Size,
+	DirectFB_Render_Image
+};
+
+const OsdBackend* Osd_DirectFB_Get_Backend()
+{
+	return &directFBBackend;
+}
+
+int32_t DirectFB_Init(int32_t* width, int32_t* height)
+{
+	DFBSurfaceDescription surfaceDesc;
+	int screenWidth;
+	int screenHeight;
+
+	/* Initialize DirectFB */
+	DFBCHECK(DirectFBInit(NULL, NULL));
+	/* Fetch the DirectFB interface */
+	DFBCHECK(DirectFBCreate(&dfbInterface));
+	/* Tell the DirectFB to take the full screen for this application */
+	DFBCHECK(dfbInterface->SetCooperativeLevel(dfbInterface, DFSCL_FULLSCREEN));
+
+	/* Create primary surface with double buffering enabled */
+	surfaceDesc.flags = DSDESC_CAPS;
+	surfaceDesc.caps = DSCAPS_PRIMARY | DSCAPS_FLIPPING;
+	DFBCHECK(dfbInterface->CreateSurface(dfbInterface, &surfaceDesc, &primary.surface));
+	primary.blittingFlags = DSBLIT_NOFX;
+	primary.premultiplied = 0;
+	/* Every blended source is premultiplied when it reaches the blender */
+	DFBCHECK(primary.surface->SetSrcBlendFunction(primary.surface, DSBF_ONE));
+
+	/* Fetch the screen size */
+	DFBCHECK(primary.surface->GetSize(primary.surface, &screenWidth, &screenHeight));
+	DFBCHECK(primary.surface->GetPixelFormat(primary.surface, &screenFormat));
+	*width = screenWidth;
+	*height = screenHeight;
+	return EXIT_SUCCESS;
+}
+
+void DirectFB_Deinit()
+{
+	primary.surface->Release(primary.surface);
+	dfbInterface->Release(dfbInterface);
+	primary.surface = NULL;
+	dfbInterface = NULL;
+}
+
+OsdSurface* DirectFB_Get_Screen()
+{
+	return &primary;
+}
+
+OsdSurface* DirectFB_Create_Surface(int32_t width, int32_t height, uint32_t flags)
+{
+	DFBSurfaceDescription surfaceDesc;
+	OsdSurface* surface;
+
+	surface = (OsdSurface*)malloc(sizeof(OsdSurface));
+	if (surface == NULL)
+	{
+		printf("%s(%d): Error allocating surface!\n", __FUNCTION__, __LINE__);
+		return NULL;
+	}
+
+	surface->premultiplied = !(flags & OSD_SURFACE_SCREEN_FORMAT);
+	surfaceDesc.flags = DSDESC_WIDTH | DSDESC_HEIGHT | DSDESC_PIXELFORMAT | DSDESC_CAPS;
+	surfaceDesc.width = width;
+	surfaceDesc.height = height;
+	surfaceDesc.pixelformat = surface->premultiplied ? DSPF_ARGB : screenFormat;
+	surfaceDesc.caps = surface->premultiplied ? DSCAPS_PREMULTIPLIED : DSCAPS_NONE;
+	DFBCHECK(dfbInterface->CreateSurface(dfbInterface, &surfaceDesc, &surface->surface));
+	DFBCHECK(surface->surface->Clear(surface->surface, 0x00, 0x00, 0x00, 0x00));
+	DFBCHECK(surface->surface->SetSrcBlendFunction(surface->surface, DSBF_ONE));
+	surface->blittingFlags = DSBLIT_NOFX;
+	return surface;
+}
+
+void DirectFB_Release_Surface(OsdSurface* surface)
+{
+	surface->surface->Release(surface->surface);
+	free(surface);
+}
+
+uint32_t DirectFB_Get_Surface_Bytes(OsdSurface* surface)
+{
+	void* data;
+	int surfacePitch;
+	int surfaceWidth;
+	int surfaceHeight;
+
+	/* Rows may be padded and the screen format may have less than 4 bytes per pixel */
+	DFBCHECK(surface->surface->GetSize(surface->surface, &surfaceWidth, &surfaceHeight));
+	DFBCHECK(surface->surface->Lock(surface->surface, DSLF_READ, &data, &surfacePitch));
+	DFBCHECK(surface->surface->Unlock(surface->surface));
+	return (uint32_t)surfacePitch * surfaceHeight;
+}
+
+void DirectFB_Set_Clip(OsdSurface* surface, const OsdRectangle* clip)
+{
+	DFBRegion region;
+
+	if (clip == NULL)
+	{
+		DFBCHECK(surface->surface->SetClip(surface->surface, NULL));
+		return;
+	}
+
+	region.x1 = clip->x;
+	region.y1 = clip->y;
+	region.x2 = clip->x + clip->w - 1;
+	region.y2 = clip->y + clip->h - 1;
+	DFBCHECK(surface->surface->SetClip(surface->surface, &region));
+}
+
+void DirectFB_Fill_Rectangle(OsdSurface* surface, const OsdRectangle* rectangle, uint32_t color)
+{
+	uint32_t alpha = surface->premultiplied ? color >> 24 : 255;
+
+	/* Filling does not blend, the color is stored as it is set */
+	DFBCHECK(surface->surface->SetColor(surface->surface, ((color >> 16) & 0xFF) * alpha / 255,
+										((color >> 8) & 0xFF) * alpha / 255, (color & 0xFF) * alpha / 255,
+										color >> 24));
+	DFBCHECK(surface->surface->FillRectangle(surface->surface, rectangle->x, rectangle->y,
+											 rectangle->w, rectangle->h));
+}
+
+void DirectFB_Blit(OsdSurface* destination, OsdSurface* source, const OsdRectangle* sourceRectangle,
+				   int32_t x, int32_t y, uint32_t flags)
+{
+	Blit_Surface(destination, source, sourceRectangle, x, y,
+				 (flags & OSD_BLIT_BLEND) ? DSBLIT_BLEND_ALPHACHANNEL : DSBLIT_NOFX);
+}
+
+void DirectFB_Blit_Alpha(OsdSurface* destination, OsdSurface* source, const OsdRectangle* sourceRectangle,
+						 int32_t x, int32_t y, uint8_t alpha)
+{
+	if (alpha == 0)
+	{
+		return;
+	}
+
+	/* Color alpha scales the source alpha and, premultiplied, its color */
+	DFBCHECK(destination->surface->SetColor(destination->surface, 0xFF, 0xFF, 0xFF, alpha));
+	Blit_Surface(destination, source, sourceRectangle, x, y,
+				 (alpha == 0xFF) ? DSBLIT_BLEND_ALPHACHANNEL
+				 : DSBLIT_BLEND_ALPHACHANNEL | DSBLIT_BLEND_COLORALPHA | DSBLIT_SRC_PREMULTCOLOR);
+}
+
+void DirectFB_Write_Pixels(OsdSurface* surface, const OsdRectangle* rectangle, const uint32_t* pixels,
+						   int32_t width, int32_t height, int32_t pitch)
+{
+	void* data;
+	int surfacePitch;
+	int surfaceWidth;
+	int surfaceHeight;
+	uint32_t* row;
+	uint32_t pixel;
+	uint32_t alpha;
+	int32_t x;
+	int32_t y;
+
+	DFBCHECK(surface->surface->GetSize(surface->surface, &surfaceWidth, &surfaceHeight));
+	if (rectangle->w <= 0 || rectangle->h <= 0 || rectangle->x < 0 || rectangle->y < 0 ||
+		rectangle->x + rectangle->w > surfaceWidth || rectangle->y + rectangle->h > surfaceHeight)
+	{
+		printf("%s(%d): Rectangle is outside of the surface!\n", __FUNCTION__, __LINE__);
+		return;
+	}
+
+	/* CPU writes, the surface is locked only while they last */
+	DFBCHECK(surface->surface->Lock(surface->surface, DSLF_WRITE, &data, &surfacePitch));
+	for (y = 0; y < rectangle->h; y++)
+	{
+		row = (uint32_t*)((uint8_t*)data + (rectangle->y + y) * surfacePitch) + rectangle->x;
+		for (x = 0; x < rectangle->w; x++)
+		{
+			pixel = pixels[(int64_t)y * height / rectangle->h * pitch + (int64_t)x * width / rectangle->w];
+			if (surface->premultiplied)
+			{
+				alpha = pixel >> 24;
+				pixel = (alpha << 24) | (((pixel >> 16) & 0xFF) * alpha / 255) << 16 |
+						(((pixel >> 8) & 0xFF) * alpha / 255) << 8 | (pixel & 0xFF) * alpha / 255;
+			}
+			row[x] = pixel;
+		}
+	}
+	DFBCHECK(surface->surface->Unlock(surface->surface));
+}
+
+void Blit_Surface(OsdSurface* destination, OsdSurface* source, const OsdRectangle* sourceRectangle,
+				  int32_t x, int32_t y, DFBSurfaceBlittingFlags blittingFlags)
+{
+	DFBRectangle rectangle;
+
+	if (!source->premultiplied && (blittingFlags != DSBLIT_NOFX || destination->premultiplied))
+	{
+		blittingFlags |= DSBLIT_SRC_PREMULTIPLY;
+	}
+	if (blittingFlags != destination->blittingFlags)
+	{
+		DFBCHECK(destination->surface->SetBlittingFlags(destination->surface, blittingFlags));
+		destination->blittingFlags = blittingFlags;
+	}
+
+	rectangle.x = sourceRectangle->x;
+	rectangle.y = sourceRectangle->y;
+	rectangle.w = sourceRectangle->w;
+	rectangle.h = sourceRectangle->h;
+	DFBCHECK(destination->surface->Blit(destination->surface, source->surface, &rectangle, x, y));
+}
+
+void DirectFB_Flip(const OsdRectangle* region, uint32_t flags)
+{
+	DFBSurfaceFlipFlags flipFlags = (flags & OSD_FLIP_WAIT_VSYNC) ? DSFLIP_WAITFORSYNC : DSFLIP_NONE;
+	DFBRegion flipRegion;
+
+	if (region == NULL)
+	{
+		DFBCHECK(primary.surface->Flip(primary.surface, NULL, flipFlags));
+		return;
+	}
+
+	/* Region is copied, the back buffer keeps the whole frame */
+	flipRegion.x1 = region->x;
+	flipRegion.y1 = region->y;
+	flipRegion.x2 = region->x + region->w - 1;
+	flipRegion.y2 = region->y + region->h - 1;
+	DFBCHECK(primary.surface->Flip(primary.surface, &flipRegion, flipFlags | DSFLIP_BLIT));
+}
+
+OsdFont* DirectFB_Load_Font(int32_t height)
+{
+	DFBFontDescription fontDesc;
+	OsdFont* font;
+
+	font = (OsdFont*)malloc(sizeof(OsdFont));
+	if (font == NULL)
+	{
+		printf("%s(%d): Error allocating font!\n", __FUNCTION__, __LINE__);
+		return NULL;
+	}
+
+	/* Specify the height of the font by raising the appropriate flag and setting the height value */
+	fontDesc.flags = DFDESC_HEIGHT;
+	fontDesc.height = height;
+	DFBCHECK(dfbInterface->CreateFont(dfbInterface, OSD_DIRECTFB_FONT_FILE, &fontDesc, &font->font));
+	return font;
+}
+
+void DirectFB_Release_Font(OsdFont* font)
+{
+	font->font->Release(font->font);
+	free(font);
+}
+
+int32_t DirectFB_Get_Font_Height(OsdFont* font)
+{
+	int height;
+
+	DFBCHECK(font->font->GetHeight(font->font, &height));
+	return height;
+}
+
+void DirectFB_Get_Glyph_Extents(OsdFont* font, uint32_t character, OsdRectangle* ink, int32_t* advance)
+{
+	DFBRectangle rectangle;
+	int glyphAdvance;
+
+	DFBCHECK(font->font->GetGlyphExtents(font->font, character, &rectangle, &glyphAdvance));
+	ink->x = rectangle.x;
+	ink->y = rectangle.y;
+	ink->w = rectangle.w;
+	ink->h = rectangle.h;
+	*advance = glyphAdvance;
+}
+
+int32_t DirectFB_Get_String_Width(OsdFont* font, const char* text)
+{
+	int width;
+
+	DFBCHECK(font->font->GetStringWidth(font->font, text, -1, &width));
+	return width;
+}
+
+void DirectFB_Draw_String(OsdSurface* surface, OsdFont* font, const char* text, int32_t x, int32_t y, uint32_t color)
+{
+	DFBCHECK(surface->surface->SetFont(surface->surface, font->font));
+	DFBCHECK(surface->surface->SetColor(surface->surface, (color >> 16) & 0xFF, (color >> 8) & 0xFF,
+										color & 0xFF, color >> 24));
+	/* Glyph coverage is multiplied into the color before the blend */
+	DFBCHECK(surface->surface->SetDrawingFlags(surface->surface, DSDRAW_BLEND | DSDRAW_SRC_PREMULTIPLY));
+	DFBCHECK(surface->surface->DrawString(surface->surface, text, -1, x, y, DSTF_TOPLEFT));
+	DFBCHECK(surface->surface->SetDrawingFlags(surface->surface, DSDRAW_NOFX));
+}
+
+int32_t DirectFB_Get_Image_Size(const char* fileName, int32_t* width, int32_t* height)
+{
+	IDirectFBImageProvider *provider;
+	DFBSurfaceDescription imageDesc;
+
+	if (dfbInterface->CreateImageProvider(dfbInterface, fileName, &provider) != DFB_OK)
+	{
+		return EXIT_FAILURE;
+	}
+	DFBCHECK(provider->GetSurfaceDescription(provider, &imageDesc));
+	provider->Release(provider);
+
+	*width = imageDesc.width;
+	*height = imageDesc.height;
+	return EXIT_SUCCESS;
+}
+
+int32_t DirectFB_Render_Image(const char* fileName, OsdSurface* surface, const OsdRectangle* rectangle)
+{
+	IDirectFBImageProvider *provider;
+	DFBRectangle destination;
+
+	if (dfbInterface->CreateImageProvider(dfbInterface, fileName, &provider) != DFB_OK)
+	{
+		return EXIT_FAILURE;
+	}
+
+	destination.x = rectangle->x;
+	destination.y = rectangle->y;
+	destination.w = rectangle->w;
+	destination.h = rectangle->h;
+	DFBCHECK(provider->RenderTo(provider, surface->surface, &destination));
+	provider->Release(provider);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,34 @@
+#ifndef _OSD_DIRECTFB_H_
+#define _OSD_DIRECTFB_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <directfb.h>
+#include "osd_backend.h"
+
+/* Helper macro for error checking */
+#define DFBCHECK(x...)										\
+{															\
+DFBResult err = x;											\
+															\
+if (err != DFB_OK)											\
+  {															\
+    fprintf( stderr, "%s <%d>:\n\t", __FILE__, __LINE__ );	\
+    DirectFBErrorFatal( #x, err );							\
+  }															\
+}
+
+#define OSD_DIRECTFB_FONT_FILE "/home/galois/fonts/DejaVuSans.ttf"
+
+/***********************************************************************
+* @brief    Returns the backend which draws with DirectFB on the
+* 			primary layer of the box
+*
+* @return   backend - pointer to the backend functions
+*
+***********************************************************************/
+const OsdBackend* Osd_DirectFB_Get_Backend();
+
+#endif
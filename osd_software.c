@@ -0,0 +1,1324 @@
+#include "osd_software.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define OSD_HAVE_AVX2
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define FONT_FIRST 0x20
+#define FONT_LAST 0x7E
+#define FONT_SIZE 8
+/* Drawn for characters which are not in the font */
+#define FONT_REPLACEMENT '?'
+
+struct OsdSurface {
+	uint32_t* pixels;
+	int32_t width;
+	int32_t height;
+	/* Pixels from one row to the next */
+	int32_t pitch;
+	OsdRectangle clip;
+};
+
+struct OsdFont {
+	/* Each font pixel is a square of scale x scale pixels */
+	int32_t scale;
+};
+
+/*
+ * 8x8 font for printable ASCII, public domain (font8x8_basic).
+ * One byte per row, the lowest bit is the leftmost pixel.
+ */
+static const uint8_t fontData[FONT_LAST - FONT_FIRST + 1][FONT_SIZE] = {
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, {0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00},
+	{0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, {0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36, 0x00},
+	{0x0C, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x0C, 0x00}, {0x00, 0x63, 0x33, 0x18, 0x0C, 0x66, 0x63, 0x00},
+	{0x1C, 0x36, 0x1C, 0x6E, 0x3B, 0x33, 0x6E, 0x00}, {0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00},
+	{0x18, 0x0C, 0x06, 0x06, 0x06, 0x0C, 0x18, 0x00}, {0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06, 0x00},
+	{0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00}, {0x00, 0x0C, 0x0C, 0x3F, 0x0C, 0x0C, 0x00, 0x00},
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x06}, {0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00},
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00}, {0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00},
+	{0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00}, {0x0C, 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x3F, 0x00},
+	{0x1E, 0x33, 0x30, 0x1C, 0x06, 0x33, 0x3F, 0x00}, {0x1E, 0x33, 0x30, 0x1C, 0x30, 0x33, 0x1E, 0x00},
+	{0x38, 0x3C, 0x36, 0x33, 0x7F, 0x30, 0x78, 0x00}, {0x3F, 0x03, 0x1F, 0x30, 0x30, 0x33, 0x1E, 0x00},
+	{0x1C, 0x06, 0x03, 0x1F, 0x33, 0x33, 0x1E, 0x00}, {0x3F, 0x33, 0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x00},
+	{0x1E, 0x33, 0x33, 0x1E, 0x33, 0x33, 0x1E, 0x00}, {0x1E, 0x33, 0x33, 0x3E, 0x30, 0x18, 0x0E, 0x00},
+	{0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00}, {0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x06},
+	{0x18, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x18, 0x00}, {0x00, 0x00, 0x3F, 0x00, 0x00, 0x3F, 0x00, 0x00},
+	{0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06, 0x00}, {0x1E, 0x33, 0x30, 0x18, 0x0C, 0x00, 0x0C, 0x00},
+	{0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00}, {0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00},
+	{0x3F, 0x66, 0x66, 0x3E, 0x66, 0x66, 0x3F, 0x00}, {0x3C, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3C, 0x00},
+	{0x1F, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1F, 0x00}, {0x7F, 0x46, 0x16, 0x1E, 0x16, 0x46, 0x7F, 0x00},
+	{0x7F, 0x46, 0x16, 0x1E, 0x16, 0x06, 0x0F, 0x00}, {0x3C, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7C, 0x00},
+	{0x33, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x33, 0x00}, {0x1E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00},
+	{0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E, 0x00}, {0x67, 0x66, 0x36, 0x1E, 0x36, 0x66, 0x67, 0x00},
+	{0x0F, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7F, 0x00}, {0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63, 0x00},
+	{0x63, 0x67, 0x6F, 0x7B, 0x73, 0x63, 0x63, 0x00}, {0x1C, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1C, 0x00},
+	{0x3F, 0x66, 0x66, 0x3E, 0x06, 0x06, 0x0F, 0x00}, {0x1E, 0x33, 0x33, 0x33, 0x3B, 0x1E, 0x38, 0x00},
+	{0x3F, 0x66, 0x66, 0x3E, 0x36, 0x66, 0x67, 0x00}, {0x1E, 0x33, 0x07, 0x0E, 0x38, 0x33, 0x1E, 0x00},
+	{0x3F, 0x2D, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00}, {0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x00},
+	{0x33, 0x33, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00}, {0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00},
+	{0x63, 0x63, 0x36, 0x1C, 0x1C, 0x36, 0x63, 0x00}, {0x33, 0x33, 0x33, 0x1E, 0x0C, 0x0C, 0x1E, 0x00},
+	{0x7F, 0x63, 0x31, 0x18, 0x4C, 0x66, 0x7F, 0x00}, {0x1E, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1E, 0x00},
+	{0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40, 0x00}, {0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E, 0x00},
+	{0x08, 0x1C, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF},
+	{0x0C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x1E, 0x30, 0x3E, 0x33, 0x6E, 0x00},
+	{0x07, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3B, 0x00}, {0x00, 0x00, 0x1E, 0x33, 0x03, 0x33, 0x1E, 0x00},
+	{0x38, 0x30, 0x30, 0x3E, 0x33, 0x33, 0x6E, 0x00}, {0x00, 0x00, 0x1E, 0x33, 0x3F, 0x03, 0x1E, 0x00},
+	{0x1C, 0x36, 0x06, 0x0F, 0x06, 0x06, 0x0F, 0x00}, {0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F},
+	{0x07, 0x06, 0x36, 0x6E, 0x66, 0x66, 0x67, 0x00}, {0x0C, 0x00, 0x0E, 0x0C, 0x0C, 0x0C, 0x1E, 0x00},
+	{0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E}, {0x07, 0x06, 0x66, 0x36, 0x1E, 0x36, 0x67, 0x00},
+	{0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00}, {0x00, 0x00, 0x33, 0x7F, 0x7F, 0x6B, 0x63, 0x00},
+	{0x00, 0x00, 0x1F, 0x33, 0x33, 0x33, 0x33, 0x00}, {0x00, 0x00, 0x1E, 0x33, 0x33, 0x33, 0x1E, 0x00},
+	{0x00, 0x00, 0x3B, 0x66, 0x66, 0x3E, 0x06, 0x0F}, {0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x78},
+	{0x00, 0x00, 0x3B, 0x6E, 0x66, 0x06, 0x0F, 0x00}, {0x00, 0x00, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x00},
+	{0x08, 0x0C, 0x3E, 0x0C, 0x0C, 0x2C, 0x18, 0x00}, {0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6E, 0x00},
+	{0x00, 0x00, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00}, {0x00, 0x00, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x00},
+	{0x00, 0x00, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x00}, {0x00, 0x00, 0x33, 0x33, 0x33, 0x3E, 0x30, 0x1F},
+	{0x00, 0x00, 0x3F, 0x19, 0x0C, 0x26, 0x3F, 0x00}, {0x38, 0x0C, 0x0C, 0x07, 0x0C, 0x0C, 0x38, 0x00},
+	{0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00}, {0x07, 0x0C, 0x0C, 0x38, 0x0C, 0x0C, 0x07, 0x00},
+	{0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+};
+
+/***********************************************************************
+* @brief    Allocates the screen buffers and selects the kernels
+*
+***********************************************************************/
+static int32_t Software_Init(int32_t* width, int32_t* height);
+
+/***********************************************************************
+* @brief    Frees the screen buffers
+*
+***********************************************************************/
+static void Software_Deinit();
+
+/***********************************************************************
+* @brief    Returns the back buffer of the screen
+*
+***********************************************************************/
+static OsdSurface* Software_Get_Screen();
+
+/***********************************************************************
+* @brief    Allocates a transparent surface
+*
+***********************************************************************/
+static OsdSurface* Software_Create_Surface(int32_t width, int32_t height, uint32_t flags);
+
+/***********************************************************************
+* @brief    Frees a surface
+*
+***********************************************************************/
+static void Software_Release_Surface(OsdSurface* surface);
+
+/***********************************************************************
+* @brief    Returns the bytes held by the surface pixels
+*
+***********************************************************************/
+static uint32_t Software_Get_Surface_Bytes(OsdSurface* surface);
+
+/***********************************************************************
+* @brief    Sets the clip of the surface, limited to its size
+*
+***********************************************************************/
+static void Software_Set_Clip(OsdSurface* surface, const OsdRectangle* clip);
+
+/***********************************************************************
+* @brief    Fills the clipped rectangle with the premultiplied color
+*
+***********************************************************************/
+static void Software_Fill_Rectangle(OsdSurface* surface, const OsdRectangle* rectangle, uint32_t color);
+
+/***********************************************************************
+* @brief    Copies or blends the clipped part of the source
+*
+***********************************************************************/
+static void Software_Blit(OsdSurface* destination, OsdSurface* source, const OsdRectangle* sourceRectangle,
+						  int32_t x, int32_t y, uint32_t flags);
+
+/***********************************************************************
+* @brief    Blends a part of the source surface scaled by a global alpha
+*
+***********************************************************************/
+static void Software_Blit_Alpha(OsdSurface* destination, OsdSurface* source, const OsdRectangle* sourceRectangle,
+								int32_t x, int32_t y, uint8_t alpha);
+
+/***********************************************************************
+* @brief    Scales pixels into the clipped part of the rectangle,
+* 			premultiplied on the way
+*
+***********************************************************************/
+static void Software_Write_Pixels(OsdSurface* surface, const OsdRectangle* rectangle, const uint32_t* pixels,
+								  int32_t width, int32_t height, int32_t pitch);
+
+/***********************************************************************
+* @brief    Swaps the screen buffers or copies a region to the front
+*
+***********************************************************************/
+static void Software_Flip(const OsdRectangle* region, uint32_t flags);
+
+/***********************************************************************
+* @brief    Returns the embedded font scaled to at most the height
+*
+***********************************************************************/
+static OsdFont* Software_Load_Font(int32_t height);
+
+/***********************************************************************
+* @brief    Frees a font
+*
+***********************************************************************/
+static void Software_Release_Font(OsdFont* font);
+
+/***********************************************************************
+* @brief    Returns the height of a line of text
+*
+***********************************************************************/
+static int32_t Software_Get_Font_Height(OsdFont* font);
+
+/***********************************************************************
+* @brief    Returns the cell of a character, the font is monospaced
+*
+***********************************************************************/
+static void Software_Get_Glyph_Extents(OsdFont* font, uint32_t character, OsdRectangle* ink, int32_t* advance);
+
+/***********************************************************************
+* @brief    Returns the width of a UTF-8 text
+*
+***********************************************************************/
+static int32_t Software_Get_String_Width(OsdFont* font, const char* text);
+
+/***********************************************************************
+* @brief    Draws a UTF-8 text, characters which are not in the font
+* 			are drawn as FONT_REPLACEMENT
+*
+***********************************************************************/
+static void Software_Draw_String(OsdSurface* surface, OsdFont* font, const char* text, int32_t x, int32_t y, uint32_t color);
+
+/***********************************************************************
+* @brief    Returns the size of a binary PPM or of the generated picture
+*
+***********************************************************************/
+static int32_t Software_Get_Image_Size(const char* fileName, int32_t* width, int32_t* height);
+
+/***********************************************************************
+* @brief    Reads a binary PPM or generates a picture for other files
+*
+***********************************************************************/
+static int32_t Software_Render_Image(const char* fileName, OsdSurface* surface, const OsdRectangle* rectangle);
+
+/***********************************************************************
+* @brief    Opens a binary PPM and reads its header
+*
+* @param    [in] fileName - path to the picture
+* @param    [out] width - width in pixels
+* @param    [out] height - height in pixels
+*
+* @return   file - positioned at the first pixel, NULL if it is not
+* 				   a binary PPM with 8 bit samples
+*
+***********************************************************************/
+static FILE* Open_PPM(const char* fileName, int32_t* width, int32_t* height);
+
+/***********************************************************************
+* @brief    Intersects a rectangle with a clip
+*
+* @param    [in, out] rectangle - rectangle to clip
+* @param    [in] clip - clip rectangle
+*
+* @return   1 - something is left
+* @return   0 - rectangle is outside of the clip
+*
+***********************************************************************/
+static uint8_t Clip_Rectangle(OsdRectangle* rectangle, const OsdRectangle* clip);
+
+/***********************************************************************
+* @brief    Clips a blit and copies or blends its rows
+*
+* @param    [in] destination - surface drawn to, clipped to its clip
+* @param    [in] source - surface read from
+* @param    [in] sourceRectangle - area of the source
+* @param    [in] x - destination x coordinate of the area
+* @param    [in] y - destination y coordinate of the area
+* @param    [in] flags - OSD_BLIT_COPY or OSD_BLIT_BLEND
+* @param    [in] alpha - global alpha of a blend, 255 is none
+*
+***********************************************************************/
+static void Blit_Area(OsdSurface* destination, OsdSurface* source, const OsdRectangle* sourceRectangle,
+					  int32_t x, int32_t y, uint32_t flags, uint32_t alpha);
+
+/***********************************************************************
+* @brief    Premultiplies a color by its alpha
+*
+***********************************************************************/
+static uint32_t Premultiply(uint32_t color);
+
+/***********************************************************************
+* @brief    Multiplies all four channels of a pixel by a factor / 255
+*
+***********************************************************************/
+static uint32_t Scale_Pixel(uint32_t pixel, uint32_t factor);
+
+/***********************************************************************
+* @brief    Returns the next character of a UTF-8 text and advances
+* 			the text, invalid sequences are FONT_REPLACEMENT
+*
+***********************************************************************/
+static uint32_t Next_Character(const char** text);
+
+/***********************************************************************
+* @brief    Pixel kernels, one pixel per step in the scalar ones and a
+* 			register of pixels per step in the vector ones. Blending
+* 			rounds like x * a / 255 in all of them, so every kind gives
+* 			the same picture
+*
+***********************************************************************/
+static void Fill_Row_Scalar(uint32_t* destination, uint32_t color, int32_t length);
+static void Blend_Row_Scalar(uint32_t* destination, const uint32_t* source, int32_t length);
+static void Blend_Row_Alpha_Scalar(uint32_t* destination, const uint32_t* source, int32_t length, uint32_t alpha);
+#if defined(__SSE2__)
+static void Fill_Row_Sse2(uint32_t* destination, uint32_t color, int32_t length);
+static void Blend_Row_Sse2(uint32_t* destination, const uint32_t* source, int32_t length);
+static void Blend_Row_Alpha_Sse2(uint32_t* destination, const uint32_t* source, int32_t length, uint32_t alpha);
+#endif
+#ifdef OSD_HAVE_AVX2
+static void Fill_Row_Avx2(uint32_t* destination, uint32_t color, int32_t length);
+static void Blend_Row_Avx2(uint32_t* destination, const uint32_t* source, int32_t length);
+static void Blend_Row_Alpha_Avx2(uint32_t* destination, const uint32_t* source, int32_t length, uint32_t alpha);
+#endif
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+static void Fill_Row_Neon(uint32_t* destination, uint32_t color, int32_t length);
+static void Blend_Row_Neon(uint32_t* destination, const uint32_t* source, int32_t length);
+static void Blend_Row_Alpha_Neon(uint32_t* destination, const uint32_t* source, int32_t length, uint32_t alpha);
+#endif
+
+static const OsdBackend softwareBackend = {
+	"software",
+	Software_Init,
+	Software_Deinit,
+	Software_Get_Screen,
+	Software_Create_Surface,
+	Software_Release_Surface,
+	Software_Get_Surface_Bytes,
+	Software_Set_Clip,
+	Software_Fill_Rectangle,
+	Software_Blit,
+	Software_Blit_Alpha,
+	Software_Write_Pixels,
+	Software_Flip,
+	Software_Load_Font,
+	Software_Release_Font,
+	Software_Get_Font_Height,
+	Software_Get_Glyph_Extents,
+	Software_Get_String_Width,
+	Software_Draw_String,
+	Software_Get_Image_Size,
+	Software_Render_Image
+};
+
+static const OsdPixelKernels allKernels[OSD_NUM_KERNELS] = {
+	{"scalar", Fill_Row_Scalar, Blend_Row_Scalar, Blend_Row_Alpha_Scalar},
+#if defined(__SSE2__)
+	{"sse2", Fill_Row_Sse2, Blend_Row_Sse2, Blend_Row_Alpha_Sse2},
+#else
+	{"sse2", NULL, NULL, NULL},
+#endif
+#ifdef OSD_HAVE_AVX2
+	{"avx2", Fill_Row_Avx2, Blend_Row_Avx2, Blend_Row_Alpha_Avx2},
+#else
+	{"avx2", NULL, NULL, NULL},
+#endif
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+	{"neon", Fill_Row_Neon, Blend_Row_Neon, Blend_Row_Alpha_Neon}
+#else
+	{"neon", NULL, NULL, NULL}
+#endif
+};
+
+/* Back buffer is drawn to, the front buffer is what is shown */
+static OsdSurface screen;
+static uint32_t* frontBuffer = NULL;
+static const OsdPixelKernels* kernels = NULL;
+static uint32_t refreshPeriod = 0;
+static struct timespec refreshStart;
+
+const OsdBackend* Osd_Software_Get_Backend()
+{
+	return &softwareBackend;
+}
+
+const OsdPixelKernels* Osd_Software_Get_Kernels(uint32_t kind)
+{
+	if (kind >= OSD_NUM_KERNELS || allKernels[kind].Fill_Row == NULL)
+	{
+		return NULL;
+	}
+
+#ifdef OSD_HAVE_AVX2
+	if (kind == OSD_KERNELS_AVX2)
+	{
+		__builtin_cpu_init();
+		if (!__builtin_cpu_supports("avx2"))
+		{
+			return NULL;
+		}
+	}
+#endif
+	return &allKernels[kind];
+}
+
+int32_t Osd_Software_Set_Kernels(uint32_t kind)
+{
+	const OsdPixelKernels* selected = Osd_Software_Get_Kernels(kind);
+
+	if (selected == NULL)
+	{
+		return EXIT_FAILURE;
+	}
+	kernels = selected;
+	return EXIT_SUCCESS;
+}
+
+void Osd_Software_Set_Refresh_Rate(uint32_t refreshRate)
+{
+	refreshPeriod = refreshRate ? 1000000000 / refreshRate : 0;
+	clock_gettime(CLOCK_MONOTONIC, &refreshStart);
+}
+
+const uint32_t* Osd_Software_Get_Frame(int32_t* width, int32_t* height)
+{
+	*width = screen.width;
+	*height = screen.height;
+	return frontBuffer;
+}
+
+int32_t Osd_Software_Dump_PPM(const char* fileName)
+{
+	FILE* file;
+	uint8_t* row;
+	uint32_t pixel;
+	int32_t x;
+	int32_t y;
+
+	if (frontBuffer == NULL)
+	{
+		return EXIT_FAILURE;
+	}
+
+	file = fopen(fileName, "wb");
+	if (file == NULL)
+	{
+		printf("%s(%d): Error opening %s: %s!\n", __FUNCTION__, __LINE__, fileName, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	row = (uint8_t*)malloc(screen.width * 3);
+	if (row == NULL)
+	{
+		fclose(file);
+		return EXIT_FAILURE;
+	}
+
+	/* Premultiplied colors are the frame over black */
+	fprintf(file, "P6\n%d %d\n255\n", screen.width, screen.height);
+	for (y = 0; y < screen.height; y++)
+	{
+		for (x = 0; x < screen.width; x++)
+		{
+			pixel = frontBuffer[y * screen.pitch + x];
+			row[3 * x] = (pixel >> 16) & 0xFF;
+			row[3 * x + 1] = (pixel >> 8) & 0xFF;
+			row[3 * x + 2] = pixel & 0xFF;
+		}
+		fwrite(row, 1, screen.width * 3, file);
+	}
+
+	free(row);
+	if (fclose(file))
+	{
+		printf("%s(%d): Error writing %s!\n", __FUNCTION__, __LINE__, fileName);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+int32_t Software_Init(int32_t* width, int32_t* height)
+{
+	uint32_t kind;
+
+	screen.width = OSD_SOFTWARE_WIDTH;
+	screen.height = OSD_SOFTWARE_HEIGHT;
+	screen.pitch = OSD_SOFTWARE_WIDTH;
+	screen.pixels = (uint32_t*)calloc(screen.pitch * screen.height, sizeof(uint32_t));
+	frontBuffer = (uint32_t*)calloc(screen.pitch * screen.height, sizeof(uint32_t));
+	if (screen.pixels == NULL || frontBuffer == NULL)
+	{
+		printf("%s(%d): Error allocating screen buffers!\n", __FUNCTION__, __LINE__);
+		free(screen.pixels);
+		free(frontBuffer);
+		screen.pixels = NULL;
+		frontBuffer = NULL;
+		return EXIT_FAILURE;
+	}
+	Software_Set_Clip(&screen, NULL);
+
+	/* Fastest kernels, unless they were selected */
+	for (kind = OSD_NUM_KERNELS; kernels == NULL && kind > 0; kind--)
+	{
+		kernels = Osd_Software_Get_Kernels(kind - 1);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &refreshStart);
+
+	*width = screen.width;
+	*height = screen.height;
+	return EXIT_SUCCESS;
+}
+
+void Software_Deinit()
+{
+	free(screen.pixels);
+	free(frontBuffer);
+	screen.pixels = NULL;
+	frontBuffer = NULL;
+}
+
+OsdSurface* Software_Get_Screen()
+{
+	return &screen;
+}
+
+OsdSurface* Software_Create_Surface(int32_t width, int32_t height, uint32_t flags)
+{
+	OsdSurface* surface;
+
+	/* Screen format is premultiplied ARGB as well */
+	surface = (OsdSurface*)malloc(sizeof(OsdSurface));
+	if (surface == NULL)
+	{
+		printf("%s(%d): Error allocating surface!\n", __FUNCTION__, __LINE__);
+		return NULL;
+	}
+	surface->pixels = (uint32_t*)calloc(width * height, sizeof(uint32_t));
+	if (surface->pixels == NULL)
+	{
+		printf("%s(%d): Error allocating %dx%d pixels!\n", __FUNCTION__, __LINE__, width, height);
+		free(surface);
+		return NULL;
+	}
+	surface->width = width;
+	surface->height = height;
+	surface->pitch = width;
+	Software_Set_Clip(surface, NULL);
+	return surface;
+}
+
+void Software_Release_Surface(OsdSurface* surface)
+{
+	free(surface->pixels);
+	free(surface);
+}
+
+uint32_t Software_Get_Surface_Bytes(OsdSurface* surface)
+{
+	return (uint32_t)surface->pitch * surface->height * sizeof(uint32_t);
+}
+
+void Software_Set_Clip(OsdSurface* surface, const OsdRectangle* clip)
+{
+	OsdRectangle bounds;
+
+	bounds.x = 0;
+	bounds.y = 0;
+	bounds.w = surface->width;
+	bounds.h = surface->height;
+	surface->clip = bounds;
+	if (clip != NULL)
+	{
+		surface->clip = *clip;
+		if (!Clip_Rectangle(&surface->clip, &bounds))
+		{
+			surface->clip.w = 0;
+			surface->clip.h = 0;
+		}
+	}
+}
+
+void Software_Fill_Rectangle(OsdSurface* surface, const OsdRectangle* rectangle, uint32_t color)
+{
+	OsdRectangle area = *rectangle;
+	uint32_t* row;
+	int32_t y;
+
+	if (!Clip_Rectangle(&area, &surface->clip))
+	{
+		return;
+	}
+
+	color = Premultiply(color);
+	row = surface->pixels + area.y * surface->pitch + area.x;
+	for (y = 0; y < area.h; y++)
+	{
+		kernels->Fill_Row(row, color, area.w);
+		row += surface->pitch;
+	}
+}
+
+void Software_Blit(OsdSurface* destination, OsdSurface* source, const OsdRectangle* sourceRectangle,
+				   int32_t x, int32_t y, uint32_t flags)
+{
+	Blit_Area(destination, source, sourceRectangle, x, y, flags, 255);
+}
+
+void Software_Blit_Alpha(OsdSurface* destination, OsdSurface* source, const OsdRectangle* sourceRectangle,
+						 int32_t x, int32_t y, uint8_t alpha)
+{
+	if (alpha == 0)
+	{
+		return;
+	}
+	Blit_Area(destination, source, sourceRectangle, x, y, OSD_BLIT_BLEND, alpha);
+}
+
+void Software_Write_Pixels(OsdSurface* surface, const OsdRectangle* rectangle, const uint32_t* pixels,
+						   int32_t width, int32_t height, int32_t pitch)
+{
+	OsdRectangle area = *rectangle;
+	const uint32_t* sourceRow;
+	uint32_t* row;
+	int32_t x;
+	int32_t y;
+
+	if (rectangle->w <= 0 || rectangle->h <= 0 || !Clip_Rectangle(&area, &surface->clip))
+	{
+		return;
+	}
+
+	row = surface->pixels + area.y * surface->pitch + area.x;
+	for (y = area.y; y < area.y + area.h; y++)
+	{
+		sourceRow = pixels + (int64_t)(y - rectangle->y) * height / rectangle->h * pitch;
+		for (x = area.x; x < area.x + area.w; x++)
+		{
+			row[x - area.x] = Premultiply(sourceRow[(int64_t)(x - rectangle->x) * width / rectangle->w]);
+		}
+		row += surface->pitch;
+	}
+}
+
+void Software_Flip(const OsdRectangle* region, uint32_t flags)
+{
+	OsdRectangle area;
+	OsdRectangle bounds;
+	struct timespec now;
+	struct timespec refresh;
+	uint64_t elapsed;
+	uint64_t next;
+	uint32_t* buffer;
+	int32_t y;
+
+	if ((flags & OSD_FLIP_WAIT_VSYNC) && refreshPeriod)
+	{
+		/* Sleeps until the next refresh since the start */
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		elapsed = (uint64_t)(now.tv_sec - refreshStart.tv_sec) * 1000000000 + now.tv_nsec - refreshStart.tv_nsec;
+		next = (elapsed / refreshPeriod + 1) * refreshPeriod;
+		refresh.tv_sec = refreshStart.tv_sec + (refreshStart.tv_nsec + next) / 1000000000;
+		refresh.tv_nsec = (refreshStart.tv_nsec + next) % 1000000000;
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &refresh, NULL) == EINTR);
+	}
+
+	if (region == NULL)
+	{
+		buffer = screen.pixels;
+		screen.pixels = frontBuffer;
+		frontBuffer = buffer;
+		return;
+	}
+
+	area = *region;
+	bounds.x = 0;
+	bounds.y = 0;
+	bounds.w = screen.width;
+	bounds.h = screen.height;
+	if (!Clip_Rectangle(&area, &bounds))
+	{
+		return;
+	}
+	for (y = area.y; y < area.y + area.h; y++)
+	{
+		memcpy(frontBuffer + y * screen.pitch + area.x, screen.pixels + y * screen.pitch + area.x,
+			   area.w * sizeof(uint32_t));
+	}
+}
+
+OsdFont* Software_Load_Font(int32_t height)
+{
+	OsdFont* font;
+
+	font = (OsdFont*)malloc(sizeof(OsdFont));
+	if (font == NULL)
+	{
+		printf("%s(%d): Error allocating font!\n", __FUNCTION__, __LINE__);
+		return NULL;
+	}
+	font->scale = height / FONT_SIZE;
+	if (font->scale < 1)
+	{
+		font->scale = 1;
+	}
+	return font;
+}
+
+void Software_Release_Font(OsdFont* font)
+{
+	free(font);
+}
+
+int32_t Software_Get_Font_Height(OsdFont* font)
+{
+	return FONT_SIZE * font->scale;
+}
+
+void Software_Get_Glyph_Extents(OsdFont* font, uint32_t character, OsdRectangle* ink, int32_t* advance)
+{
+	ink->x = 0;
+	ink->y = 0;
+	ink->w = FONT_SIZE * font->scale;
+	ink->h = FONT_SIZE * font->scale;
+	*advance = FONT_SIZE * font->scale;
+}
+
+int32_t Software_Get_String_Width(OsdFont* font, const char* text)
+{
+	int32_t width = 0;
+
+	while (*text != '\0')
+	{
+		Next_Character(&text);
+		width += FONT_SIZE * font->scale;
+	}
+	return width;
+}
+
+void Software_Draw_String(OsdSurface* surface, OsdFont* font, const char* text, int32_t x, int32_t y, uint32_t color)
+{
+	const uint8_t* glyph;
+	OsdRectangle span;
+	uint32_t character;
+	uint32_t pixel;
+	uint32_t* destination;
+	int32_t row;
+	int32_t column;
+	int32_t end;
+	int32_t line;
+	int32_t i;
+
+	color = Premultiply(color);
+	while (*text != '\0')
+	{
+		character = Next_Character(&text);
+		glyph = fontData[character - FONT_FIRST];
+		for (row = 0; row < FONT_SIZE; row++)
+		{
+			/* Runs of set bits are drawn as one span */
+			for (column = 0; column < FONT_SIZE; column = end)
+			{
+				end = column + 1;
+				if (!(glyph[row] & (1 << column)))
+				{
+					continue;
+				}
+				while (end < FONT_SIZE && (glyph[row] & (1 << end)))
+				{
+					end++;
+				}
+
+				span.x = x + column * font->scale;
+				span.y = y + row * font->scale;
+				span.w = (end - column) * font->scale;
+				span.h = font->scale;
+				if (!Clip_Rectangle(&span, &surface->clip))
+				{
+					continue;
+				}
+				for (line = 0; line < span.h; line++)
+				{
+					destination = surface->pixels + (span.y + line) * surface->pitch + span.x;
+					if ((color >> 24) == 0xFF)
+					{
+						kernels->Fill_Row(destination, color, span.w);
+						continue;
+					}
+					for (i = 0; i < span.w; i++)
+					{
+						pixel = color;
+						Blend_Row_Scalar(&destination[i], &pixel, 1);
+					}
+				}
+			}
+		}
+		x += FONT_SIZE * font->scale;
+	}
+}
+
+int32_t Software_Get_Image_Size(const char* fileName, int32_t* width, int32_t* height)
+{
+	FILE* file = Open_PPM(fileName, width, height);
+
+	if (file != NULL)
+	{
+		fclose(file);
+		return EXIT_SUCCESS;
+	}
+
+	/* No decoder for other formats, a picture of the same kind is generated */
+	*width = OSD_SOFTWARE_IMAGE_WIDTH;
+	*height = OSD_SOFTWARE_IMAGE_HEIGHT;
+	return EXIT_SUCCESS;
+}
+
+int32_t Software_Render_Image(const char* fileName, OsdSurface* surface, const OsdRectangle* rectangle)
+{
+	OsdRectangle area = *rectangle;
+	OsdRectangle bounds;
+	FILE* file;
+	uint8_t rgb[3];
+	uint32_t level = 0;
+	uint32_t* row;
+	const char* digit;
+	int32_t width;
+	int32_t height;
+	int32_t x;
+	int32_t y;
+
+	bounds.x = 0;
+	bounds.y = 0;
+	bounds.w = surface->width;
+	bounds.h = surface->height;
+	if (!Clip_Rectangle(&area, &bounds))
+	{
+		return EXIT_FAILURE;
+	}
+
+	file = Open_PPM(fileName, &width, &height);
+	if (file != NULL)
+	{
+		/* Opaque pixels, rows and columns outside of the rectangle are skipped */
+		for (y = 0; y < height; y++)
+		{
+			for (x = 0; x < width; x++)
+			{
+				if (fread(rgb, 1, 3, file) != 3)
+				{
+					fclose(file);
+					return EXIT_FAILURE;
+				}
+				if (x < area.w && y < area.h)
+				{
+					surface->pixels[(area.y + y) * surface->pitch + area.x + x] = OSD_COLOR(0xFF, rgb[0], rgb[1], rgb[2]);
+				}
+			}
+		}
+		fclose(file);
+		return EXIT_SUCCESS;
+	}
+
+	/* Number in the name (volume_7.png) is shown as a bar of that many tenths */
+	for (digit = fileName; *digit != '\0'; digit++)
+	{
+		if (*digit >= '0' && *digit <= '9')
+		{
+			level = level * 10 + *digit - '0';
+		}
+	}
+	if (level > 10)
+	{
+		level = 10;
+	}
+
+	for (y = 0; y < area.h; y++)
+	{
+		row = surface->pixels + (area.y + y) * surface->pitch + area.x;
+		for (x = 0; x < area.w; x++)
+		{
+			if (y < 4 || y >= area.h - 4 || x < 4 || x >= area.w - 4)
+			{
+				row[x] = OSD_COLOR(0xFF, 0xFF, 0xFF, 0xFF);
+			}
+			else if (x - 4 < (int32_t)((area.w - 8) * level / 10))
+			{
+				row[x] = OSD_COLOR(0xFF, 0x00, 0xCE, 0x67);
+			}
+			else
+			{
+				row[x] = Premultiply(OSD_COLOR(0x80, 0x00, 0x00, 0x00));
+			}
+		}
+	}
+	return EXIT_SUCCESS;
+}
+
+FILE* Open_PPM(const char* fileName, int32_t* width, int32_t* height)
+{
+	FILE* file;
+	int maxValue;
+	int imageWidth;
+	int imageHeight;
+
+	file = fopen(fileName, "rb");
+	if (file == NULL)
+	{
+		return NULL;
+	}
+
+	/* Header is "P6 width height 255" followed by one whitespace */
+	if (fgetc(file) != 'P' || fgetc(file) != '6'
+		|| fscanf(file, "%d %d %d", &imageWidth, &imageHeight, &maxValue) != 3
+		|| maxValue != 255 || imageWidth <= 0 || imageHeight <= 0 || fgetc(file) == EOF)
+	{
+		fclose(file);
+		return NULL;
+	}
+
+	*width = imageWidth;
+	*height = imageHeight;
+	return file;
+}
+
+uint8_t Clip_Rectangle(OsdRectangle* rectangle, const OsdRectangle* clip)
+{
+	int32_t x2 = rectangle->x + rectangle->w;
+	int32_t y2 = rectangle->y + rectangle->h;
+
+	if (rectangle->x < clip->x)
+	{
+		rectangle->x = clip->x;
+	}
+	if (rectangle->y < clip->y)
+	{
+		rectangle->y = clip->y;
+	}
+	if (x2 > clip->x + clip->w)
+	{
+		x2 = clip->x + clip->w;
+	}
+	if (y2 > clip->y + clip->h)
+	{
+		y2 = clip->y + clip->h;
+	}
+	rectangle->w = x2 - rectangle->x;
+	rectangle->h = y2 - rectangle->y;
+	return rectangle->w > 0 && rectangle->h > 0;
+}
+
+void Blit_Area(OsdSurface* destination, OsdSurface* source, const OsdRectangle* sourceRectangle,
+			   int32_t x, int32_t y, uint32_t flags, uint32_t alpha)
+{
+	OsdRectangle sourceArea = *sourceRectangle;
+	OsdRectangle sourceBounds;
+	OsdRectangle area;
+	const uint32_t* sourceRow;
+	uint32_t* destinationRow;
+	int32_t row;
+
+	sourceBounds.x = 0;
+	sourceBounds.y = 0;
+	sourceBounds.w = source->width;
+	sourceBounds.h = source->height;
+	if (!Clip_Rectangle(&sourceArea, &sourceBounds))
+	{
+		return;
+	}
+
+	/* Destination moves with the parts of the source cut off, and the
+	   source with the parts of the destination cut off */
+	x += sourceArea.x - sourceRectangle->x;
+	y += sourceArea.y - sourceRectangle->y;
+	area.x = x;
+	area.y = y;
+	area.w = sourceArea.w;
+	area.h = sourceArea.h;
+	if (!Clip_Rectangle(&area, &destination->clip))
+	{
+		return;
+	}
+	sourceArea.x += area.x - x;
+	sourceArea.y += area.y - y;
+
+	sourceRow = source->pixels + sourceArea.y * source->pitch + sourceArea.x;
+	destinationRow = destination->pixels + area.y * destination->pitch + area.x;
+	for (row = 0; row < area.h; row++)
+	{
+		if (flags & OSD_BLIT_BLEND)
+		{
+			if (alpha == 255)
+			{
+				kernels->Blend_Row(destinationRow, sourceRow, area.w);
+			}
+			else
+			{
+				kernels->Blend_Row_Alpha(destinationRow, sourceRow, area.w, alpha);
+			}
+		}
+		else
+		{
+			/* Library copy is already vectorized */
+			memmove(destinationRow, sourceRow, area.w * sizeof(uint32_t));
+		}
+		sourceRow += source->pitch;
+		destinationRow += destination->pitch;
+	}
+}
+
+uint32_t Premultiply(uint32_t color)
+{
+	uint32_t alpha = color >> 24;
+	uint32_t redBlue = (color & 0x00FF00FF) * alpha + 0x00800080;
+	uint32_t green = ((color >> 8) & 0xFF) * alpha + 0x80;
+
+	/* x / 255 as (x + 128 + ((x + 128) >> 8)) >> 8 */
+	redBlue = ((redBlue + ((redBlue >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+	green = ((green + (green >> 8)) >> 8) & 0xFF;
+	return (alpha << 24) | redBlue | (green << 8);
+}
+
+uint32_t Scale_Pixel(uint32_t pixel, uint32_t factor)
+{
+	/* Two channels per multiply, each divided by 255 with rounding */
+	uint32_t redBlue = (pixel & 0x00FF00FF) * factor + 0x00800080;
+	uint32_t alphaGreen = ((pixel >> 8) & 0x00FF00FF) * factor + 0x00800080;
+
+	redBlue = ((redBlue + ((redBlue >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+	alphaGreen = (alphaGreen + ((alphaGreen >> 8) & 0x00FF00FF)) & 0xFF00FF00;
+	return redBlue | alphaGreen;
+}
+
+uint32_t Next_Character(const char** text)
+{
+	const uint8_t* byte = (const uint8_t*)*text;
+	uint32_t character = *byte++;
+
+	if (character >= 0x80)
+	{
+		/* Continuation bytes of the sequence are skipped */
+		while ((*byte & 0xC0) == 0x80)
+		{
+			byte++;
+		}
+		character = FONT_REPLACEMENT;
+	}
+	else if (character < FONT_FIRST || character > FONT_LAST)
+	{
+		character = FONT_REPLACEMENT;
+	}
+	*text = (const char*)byte;
+	return character;
+}
+
+void Fill_Row_Scalar(uint32_t* destination, uint32_t color, int32_t length)
+{
+	int32_t i;
+
+	for (i = 0; i < length; i++)
+	{
+		destination[i] = color;
+	}
+}
+
+void Blend_Row_Scalar(uint32_t* destination, const uint32_t* source, int32_t length)
+{
+	uint32_t pixel;
+	uint32_t inverseAlpha;
+	int32_t i;
+
+	for (i = 0; i < length; i++)
+	{
+		pixel = source[i];
+		inverseAlpha = 255 - (pixel >> 24);
+		if (inverseAlpha == 0)
+		{
+			destination[i] = pixel;
+			continue;
+		}
+		if (inverseAlpha == 255)
+		{
+			continue;
+		}
+		destination[i] = pixel + Scale_Pixel(destination[i], inverseAlpha);
+	}
+}
+
+void Blend_Row_Alpha_Scalar(uint32_t* destination, const uint32_t* source, int32_t length, uint32_t alpha)
+{
+	uint32_t pixel;
+	int32_t i;
+
+	for (i = 0; i < length; i++)
+	{
+		/* Premultiplied source is faded by scaling all of its channels */
+		pixel = Scale_Pixel(source[i], alpha);
+		if (pixel != 0)
+		{
+			destination[i] = pixel + Scale_Pixel(destination[i], 255 - (pixel >> 24));
+		}
+	}
+}
+
+#if defined(__SSE2__)
+void Fill_Row_Sse2(uint32_t* destination, uint32_t color, int32_t length)
+{
+	const __m128i pixels = _mm_set1_epi32(color);
+	int32_t i = 0;
+
+	for (; i + 4 <= length; i += 4)
+	{
+		_mm_storeu_si128((__m128i*)(destination + i), pixels);
+	}
+	Fill_Row_Scalar(destination + i, color, length - i);
+}
+
+void Blend_Row_Sse2(uint32_t* destination, const uint32_t* source, int32_t length)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i maximum = _mm_set1_epi32(255);
+	const __m128i half = _mm_set1_epi16(128);
+	__m128i sourcePixels;
+	__m128i destinationPixels;
+	__m128i inverseAlpha;
+	__m128i low;
+	__m128i high;
+	int32_t i = 0;
+
+	/* Four pixels, channels widened to 16 bits */
+	for (; i + 4 <= length; i += 4)
+	{
+		sourcePixels = _mm_loadu_si128((const __m128i*)(source + i));
+		destinationPixels = _mm_loadu_si128((const __m128i*)(destination + i));
+
+		inverseAlpha = _mm_sub_epi32(maximum, _mm_srli_epi32(sourcePixels, 24));
+		inverseAlpha = _mm_or_si128(inverseAlpha, _mm_slli_epi32(inverseAlpha, 16));
+
+		low = _mm_mullo_epi16(_mm_unpacklo_epi8(destinationPixels, zero), _mm_unpacklo_epi32(inverseAlpha, inverseAlpha));
+		high = _mm_mullo_epi16(_mm_unpackhi_epi8(destinationPixels, zero), _mm_unpackhi_epi32(inverseAlpha, inverseAlpha));
+		low = _mm_add_epi16(low, half);
+		high = _mm_add_epi16(high, half);
+		low = _mm_srli_epi16(_mm_add_epi16(low, _mm_srli_epi16(low, 8)), 8);
+		high = _mm_srli_epi16(_mm_add_epi16(high, _mm_srli_epi16(high, 8)), 8);
+
+		destinationPixels = _mm_adds_epu8(_mm_packus_epi16(low, high), sourcePixels);
+		_mm_storeu_si128((__m128i*)(destination + i), destinationPixels);
+	}
+	Blend_Row_Scalar(destination + i, source + i, length - i);
+}
+
+void Blend_Row_Alpha_Sse2(uint32_t* destination, const uint32_t* source, int32_t length, uint32_t alpha)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i maximum = _mm_set1_epi32(255);
+	const __m128i half = _mm_set1_epi16(128);
+	const __m128i factor = _mm_set1_epi16(alpha);
+	__m128i sourcePixels;
+	__m128i destinationPixels;
+	__m128i inverseAlpha;
+	__m128i low;
+	__m128i high;
+	int32_t i = 0;
+
+	for (; i + 4 <= length; i += 4)
+	{
+		sourcePixels = _mm_loadu_si128((const __m128i*)(source + i));
+		destinationPixels = _mm_loadu_si128((const __m128i*)(destination + i));
+
+		/* Source is scaled by the global alpha first, then blended as usual */
+		low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(sourcePixels, zero), factor), half);
+		high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(sourcePixels, zero), factor), half);
+		low = _mm_srli_epi16(_mm_add_epi16(low, _mm_srli_epi16(low, 8)), 8);
+		high = _mm_srli_epi16(_mm_add_epi16(high, _mm_srli_epi16(high, 8)), 8);
+		sourcePixels = _mm_packus_epi16(low, high);
+
+		inverseAlpha = _mm_sub_epi32(maximum, _mm_srli_epi32(sourcePixels, 24));
+		inverseAlpha = _mm_or_si128(inverseAlpha, _mm_slli_epi32(inverseAlpha, 16));
+
+		low = _mm_mullo_epi16(_mm_unpacklo_epi8(destinationPixels, zero), _mm_unpacklo_epi32(inverseAlpha, inverseAlpha));
+		high = _mm_mullo_epi16(_mm_unpackhi_epi8(destinationPixels, zero), _mm_unpackhi_epi32(inverseAlpha, inverseAlpha));
+		low = _mm_add_epi16(low, half);
+		high = _mm_add_epi16(high, half);
+		low = _mm_srli_epi16(_mm_add_epi16(low, _mm_srli_epi16(low, 8)), 8);
+		high = _mm_srli_epi16(_mm_add_epi16(high, _mm_srli_epi16(high, 8)), 8);
+
+		destinationPixels = _mm_adds_epu8(_mm_packus_epi16(low, high), sourcePixels);
+		_mm_storeu_si128((__m128i*)(destination + i), destinationPixels);
+	}
+	Blend_Row_Alpha_Scalar(destination + i, source + i, length - i, alpha);
+}
+#endif
+
+#ifdef OSD_HAVE_AVX2
+__attribute__((target("avx2")))
+void Fill_Row_Avx2(uint32_t* destination, uint32_t color, int32_t length)
+{
+	const __m256i pixels = _mm256_set1_epi32(color);
+	int32_t i = 0;
+
+	for (; i + 8 <= length; i += 8)
+	{
+		_mm256_storeu_si256((__m256i*)(destination + i), pixels);
+	}
+	Fill_Row_Scalar(destination + i, color, length - i);
+}
+
+__attribute__((target("avx2")))
+void Blend_Row_Avx2(uint32_t* destination, const uint32_t* source, int32_t length)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i maximum = _mm256_set1_epi32(255);
+	const __m256i half = _mm256_set1_epi16(128);
+	__m256i sourcePixels;
+	__m256i destinationPixels;
+	__m256i inverseAlpha;
+	__m256i low;
+	__m256i high;
+	int32_t i = 0;
+
+	/* Same as SSE2, unpack and pack work within each 128 bit half */
+	for (; i + 8 <= length; i += 8)
+	{
+		sourcePixels = _mm256_loadu_si256((const __m256i*)(source + i));
+		destinationPixels = _mm256_loadu_si256((const __m256i*)(destination + i));
+
+		inverseAlpha = _mm256_sub_epi32(maximum, _mm256_srli_epi32(sourcePixels, 24));
+		inverseAlpha = _mm256_or_si256(inverseAlpha, _mm256_slli_epi32(inverseAlpha, 16));
+
+		low = _mm256_mullo_epi16(_mm256_unpacklo_epi8(destinationPixels, zero), _mm256_unpacklo_epi32(inverseAlpha, inverseAlpha));
+		high = _mm256_mullo_epi16(_mm256_unpackhi_epi8(destinationPixels, zero), _mm256_unpackhi_epi32(inverseAlpha, inverseAlpha));
+		low = _mm256_add_epi16(low, half);
+		high = _mm256_add_epi16(high, half);
+		low = _mm256_srli_epi16(_mm256_add_epi16(low, _mm256_srli_epi16(low, 8)), 8);
+		high = _mm256_srli_epi16(_mm256_add_epi16(high, _mm256_srli_epi16(high, 8)), 8);
+
+		destinationPixels = _mm256_adds_epu8(_mm256_packus_epi16(low, high), sourcePixels);
+		_mm256_storeu_si256((__m256i*)(destination + i), destinationPixels);
+	}
+	Blend_Row_Scalar(destination + i, source + i, length - i);
+}
+
+__attribute__((target("avx2")))
+void Blend_Row_Alpha_Avx2(uint32_t* destination, const uint32_t* source, int32_t length, uint32_t alpha)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i maximum = _mm256_set1_epi32(255);
+	const __m256i half = _mm256_set1_epi16(128);
+	const __m256i factor = _mm256_set1_epi16(alpha);
+	__m256i sourcePixels;
+	__m256i destinationPixels;
+	__m256i inverseAlpha;
+	__m256i low;
+	__m256i high;
+	int32_t i = 0;
+
+	for (; i + 8 <= length; i += 8)
+	{
+		sourcePixels = _mm256_loadu_si256((const __m256i*)(source + i));
+		destinationPixels = _mm256_loadu_si256((const __m256i*)(destination + i));
+
+		low = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(sourcePixels, zero), factor), half);
+		high = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(sourcePixels, zero), factor), half);
+		low = _mm256_srli_epi16(_mm256_add_epi16(low, _mm256_srli_epi16(low, 8)), 8);
+		high = _mm256_srli_epi16(_mm256_add_epi16(high, _mm256_srli_epi16(high, 8)), 8);
+		sourcePixels = _mm256_packus_epi16(low, high);
+
+		inverseAlpha = _mm256_sub_epi32(maximum, _mm256_srli_epi32(sourcePixels, 24));
+		inverseAlpha = _mm256_or_si256(inverseAlpha, _mm256_slli_epi32(inverseAlpha, 16));
+
+		low = _mm256_mullo_epi16(_mm256_unpacklo_epi8(destinationPixels, zero), _mm256_unpacklo_epi32(inverseAlpha, inverseAlpha));
+		high = _mm256_mullo_epi16(_mm256_unpackhi_epi8(destinationPixels, zero), _mm256_unpackhi_epi32(inverseAlpha, inverseAlpha));
+		low = _mm256_add_epi16(low, half);
+		high = _mm256_add_epi16(high, half);
+		low = _mm256_srli_epi16(_mm256_add_epi16(low, _mm256_srli_epi16(low, 8)), 8);
+		high = _mm256_srli_epi16(_mm256_add_epi16(high, _mm256_srli_epi16(high, 8)), 8);
+
+		destinationPixels = _mm256_adds_epu8(_mm256_packus_epi16(low, high), sourcePixels);
+		_mm256_storeu_si256((__m256i*)(destination + i), destinationPixels);
+	}
+	Blend_Row_Alpha_Scalar(destination + i, source + i, length - i, alpha);
+}
+#endif
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+void Fill_Row_Neon(uint32_t* destination, uint32_t color, int32_t length)
+{
+	const uint32x4_t pixels = vdupq_n_u32(color);
+	int32_t i = 0;
+
+	for (; i + 4 <= length; i += 4)
+	{
+		vst1q_u32(destination + i, pixels);
+	}
+	Fill_Row_Scalar(destination + i, color, length - i);
+}
+
+void Blend_Row_Neon(uint32_t* destination, const uint32_t* source, int32_t length)
+{
+	uint8x8x4_t sourcePixels;
+	uint8x8x4_t destinationPixels;
+	uint8x8_t inverseAlpha;
+	uint16x8_t product;
+	int32_t channel;
+	int32_t i = 0;
+
+	/* Eight pixels split into planes, the last plane is alpha */
+	for (; i + 8 <= length; i += 8)
+	{
+		sourcePixels = vld4_u8((const uint8_t*)(source + i));
+		destinationPixels = vld4_u8((const uint8_t*)(destination + i));
+		inverseAlpha = vmvn_u8(sourcePixels.val[3]);
+
+		for (channel = 0; channel < 4; channel++)
+		{
+			product = vmull_u8(destinationPixels.val[channel], inverseAlpha);
+			/* (x + 128 + ((x + 128) >> 8)) >> 8 */
+			destinationPixels.val[channel] = vqadd_u8(sourcePixels.val[channel],
+													  vrshrn_n_u16(vrsraq_n_u16(product, product, 8), 8));
+		}
+		vst4_u8((uint8_t*)(destination + i), destinationPixels);
+	}
+	Blend_Row_Scalar(destination + i, source + i, length - i);
+}
+
+void Blend_Row_Alpha_Neon(uint32_t* destination, const uint32_t* source, int32_t length, uint32_t alpha)
+{
+	const uint8x8_t factor = vdup_n_u8(alpha);
+	uint8x8x4_t sourcePixels;
+	uint8x8x4_t destinationPixels;
+	uint8x8_t inverseAlpha;
+	uint16x8_t product;
+	int32_t channel;
+	int32_t i = 0;
+
+	for (; i + 8 <= length; i += 8)
+	{
+		sourcePixels = vld4_u8((const uint8_t*)(source + i));
+		destinationPixels = vld4_u8((const uint8_t*)(destination + i));
+
+		/* Source is scaled by the global alpha first, then blended as usual */
+		for (channel = 0; channel < 4; channel++)
+		{
+			product = vmull_u8(sourcePixels.val[channel], factor);
+			sourcePixels.val[channel] = vrshrn_n_u16(vrsraq_n_u16(product, product, 8), 8);
+		}
+		inverseAlpha = vmvn_u8(sourcePixels.val[3]);
+
+		for (channel = 0; channel < 4; channel++)
+		{
+			product = vmull_u8(destinationPixels.val[channel], inverseAlpha);
+			destinationPixels.val[channel] = vqadd_u8(sourcePixels.val[channel],
+													  vrshrn_n_u16(vrsraq_n_u16(product, product, 8), 8));
+		}
+		vst4_u8((uint8_t*)(destination + i), destinationPixels);
+	}
+	Blend_Row_Alpha_Scalar(destination + i, source + i, length - i, alpha);
+}
+#endif
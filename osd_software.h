@@ -0,0 +1,109 @@
+#ifndef _OSD_SOFTWARE_H_
+#define _OSD_SOFTWARE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include "osd_backend.h"
+
+/* Size of the screen surface */
+#define OSD_SOFTWARE_WIDTH 1920
+#define OSD_SOFTWARE_HEIGHT 1080
+
+/* Images which are not binary PPM are replaced by a generated picture */
+#define OSD_SOFTWARE_IMAGE_WIDTH 256
+#define OSD_SOFTWARE_IMAGE_HEIGHT 64
+
+/* Pixel kernels */
+#define OSD_KERNELS_SCALAR 0
+#define OSD_KERNELS_SSE2 1
+#define OSD_KERNELS_AVX2 2
+#define OSD_KERNELS_NEON 3
+#define OSD_NUM_KERNELS 4
+
+/* Fills length pixels with a premultiplied color */
+typedef void(*Osd_Fill_Row)(uint32_t* destination, uint32_t color, int32_t length);
+/* Source over of premultiplied pixels */
+typedef void(*Osd_Blend_Row)(uint32_t* destination, const uint32_t* source, int32_t length);
+/* Source over of premultiplied pixels scaled by a global alpha */
+typedef void(*Osd_Blend_Row_Alpha)(uint32_t* destination, const uint32_t* source, int32_t length, uint32_t alpha);
+
+typedef struct OsdPixelKernels {
+	const char* name;
+	Osd_Fill_Row Fill_Row;
+	Osd_Blend_Row Blend_Row;
+	Osd_Blend_Row_Alpha Blend_Row_Alpha;
+} OsdPixelKernels;
+
+/***********************************************************************
+* @brief    Returns the backend which draws into memory. Pixels are
+* 			premultiplied ARGB, text uses an embedded 8x8 bitmap font
+* 			scaled to the requested height
+*
+* @return   backend - pointer to the backend functions
+*
+***********************************************************************/
+const OsdBackend* Osd_Software_Get_Backend();
+
+/***********************************************************************
+* @brief    Returns the pixel kernels of a kind
+*
+* @param    [in] kind - OSD_KERNELS_SCALAR, OSD_KERNELS_SSE2,
+* 						OSD_KERNELS_AVX2 or OSD_KERNELS_NEON
+*
+* @return   kernels - pointer to the kernels, NULL if the CPU or the
+* 					  compiler does not support them
+*
+***********************************************************************/
+const OsdPixelKernels* Osd_Software_Get_Kernels(uint32_t kind);
+
+/***********************************************************************
+* @brief    Selects the pixel kernels used for drawing, the fastest
+* 			supported ones are selected by default
+*
+* @param    [in] kind - OSD_KERNELS_SCALAR, OSD_KERNELS_SSE2,
+* 						OSD_KERNELS_AVX2 or OSD_KERNELS_NEON
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - kernels are not supported
+*
+***********************************************************************/
+int32_t Osd_Software_Set_Kernels(uint32_t kind);
+
+/***********************************************************************
+* @brief    Sets the emulated refresh rate. Flips which wait for the
+* 			vertical sync sleep until the next refresh
+*
+* @param    [in] refreshRate - refreshes per second, 0 does not wait
+*
+***********************************************************************/
+void Osd_Software_Set_Refresh_Rate(uint32_t refreshRate);
+
+/***********************************************************************
+* @brief    Returns the front buffer, which is what would be on the
+* 			screen
+*
+* @param    [out] width - width in pixels
+* @param    [out] height - height in pixels
+*
+* @return   pixels - premultiplied ARGB rows without padding, NULL if
+* 					 the backend is not initialized
+*
+***********************************************************************/
+const uint32_t* Osd_Software_Get_Frame(int32_t* width, int32_t* height);
+
+/***********************************************************************
+* @brief    Writes the front buffer as a binary PPM
+*
+* @param    [in] fileName - path of the picture
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Osd_Software_Dump_PPM(const char* fileName);
+
+#endif
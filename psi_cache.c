@@ -0,0 +1,233 @@
+#include "psi_cache.h"
+
+#define ENTRY_SECTION 0
+#define ENTRY_TABLE 1
+
+typedef struct PsiCacheEntry {
+	uint8_t used;
+	uint8_t kind;
+	/* version_number and current_next_indicator byte */
+	uint8_t version;
+	uint16_t sectionLength;
+	uint32_t key;
+	uint32_t crc;
+} PsiCacheEntry;
+
+/***********************************************************************
+* @brief    Finds the entry with the key or the empty slot where it
+* 			belongs, linear probing
+*
+* @param    [in] key - table_id, table_id_extension and section_number
+* @param    [in] kind - ENTRY_SECTION or ENTRY_TABLE
+*
+* @return   pointer to the entry, NULL if the cache is full
+*
+***********************************************************************/
+static PsiCacheEntry* Find_Entry(uint32_t key, uint8_t kind);
+
+static PsiCacheEntry cache[PSI_CACHE_SIZE];
+static uint32_t numOfEntries = 0;
+static PsiCacheStatistics statistics;
+static Psi_Change_Callback PsiChangeCallback = NULL;
+static void* changeCallbackUserData = NULL;
+static pthread_mutex_t cacheMutex;
+
+int32_t Psi_Cache_Init()
+{
+	memset(cache, 0, sizeof(cache));
+	memset(&statistics, 0, sizeof(statistics));
+	numOfEntries = 0;
+
+	if (pthread_mutex_init(&cacheMutex, NULL))
+	{
+		printf("%s(%d): Error initializing cache mutex!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+int32_t Psi_Cache_Deinit()
+{
+	PsiChangeCallback = NULL;
+	pthread_mutex_destroy(&cacheMutex);
+	return EXIT_SUCCESS;
+}
+
+void Psi_Cache_Flush()
+{
+	pthread_mutex_lock(&cacheMutex);
+	memset(cache, 0, sizeof(cache));
+	numOfEntries = 0;
+	pthread_mutex_unlock(&cacheMutex);
+}
+
+int32_t Psi_Cache_Register_Change_Callback(Psi_Change_Callback changeCallback, void* userData)
+{
+	if (PsiChangeCallback != NULL)
+	{
+		printf("%s(%d): Psi_Cache_Register_Change_Callback failed, callback already registered!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+
+	pthread_mutex_lock(&cacheMutex);
+	changeCallbackUserData = userData;
+	PsiChangeCallback = changeCallback;
+	pthread_mutex_unlock(&cacheMutex);
+	return EXIT_SUCCESS;
+}
+
+int32_t Psi_Cache_Unregister_Change_Callback(Psi_Change_Callback changeCallback)
+{
+	if (PsiChangeCallback != changeCallback)
+	{
+		printf("%s(%d): Psi_Cache_Unregister_Change_Callback failed, wrong callback function!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+
+	pthread_mutex_lock(&cacheMutex);
+	PsiChangeCallback = NULL;
+	changeCallbackUserData = NULL;
+	pthread_mutex_unlock(&cacheMutex);
+	return EXIT_SUCCESS;
+}
+
+int32_t Psi_Cache_Filter_Section(const uint8_t* section)
+{
+	uint16_t sectionLength;
+	uint32_t key;
+	uint32_t crc;
+	uint8_t version;
+	uint8_t versionChanged = 0;
+	PsiCacheEntry* sectionEntry;
+	PsiCacheEntry* tableEntry;
+	Psi_Change_Callback changeCallback;
+	void* userData;
+
+	/* Short sections (TDT) carry neither version nor CRC_32 */
+	if (!(section[1] & 0x80))
+	{
+		return PSI_SECTION_NEW;
+	}
+
+	version = section[5] & 0x3F;
+	if (!(version & 0x01))
+	{
+		return PSI_SECTION_NOT_APPLICABLE;
+	}
+
+	sectionLength = ((section[1] & 0x0F) << 8) | section[2];
+	if (sectionLength < 9)
+	{
+		pthread_mutex_lock(&cacheMutex);
+		statistics.corruptedSections++;
+		pthread_mutex_unlock(&cacheMutex);
+		return PSI_SECTION_CORRUPTED;
+	}
+
+	/*
+	 * key is:					bit
+	 * table_id					08
+	 * table_id_extension		16
+	 * section_number			08
+	 */
+	key = ((uint32_t)section[0] << 24) | ((uint32_t)section[3] << 16) | ((uint32_t)section[4] << 8) | section[6];
+	crc = ((uint32_t)section[sectionLength - 1] << 24) | ((uint32_t)section[sectionLength] << 16)
+		  | ((uint32_t)section[sectionLength + 1] << 8) | section[sectionLength + 2];
+
+	pthread_mutex_lock(&cacheMutex);
+
+	/* Cheap compare, repetition has the same header and CRC_32 field */
+	sectionEntry = Find_Entry(key, ENTRY_SECTION);
+	if (sectionEntry != NULL && sectionEntry->used && sectionEntry->version == version
+		&& sectionEntry->sectionLength == sectionLength && sectionEntry->crc == crc)
+	{
+		statistics.repeatedSections++;
+		pthread_mutex_unlock(&cacheMutex);
+		return PSI_SECTION_REPEATED;
+	}
+	pthread_mutex_unlock(&cacheMutex);
+
+	/* Only verified sections may enter the cache */
+	if (Crc32_Check_Section(section))
+	{
+		pthread_mutex_lock(&cacheMutex);
+		statistics.corruptedSections++;
+		pthread_mutex_unlock(&cacheMutex);
+		return PSI_SECTION_CORRUPTED;
+	}
+
+	pthread_mutex_lock(&cacheMutex);
+
+	/* Full cache still works, new sections are just not remembered */
+	sectionEntry = Find_Entry(key, ENTRY_SECTION);
+	if (sectionEntry != NULL)
+	{
+		if (!sectionEntry->used)
+		{
+			sectionEntry->used = 1;
+			sectionEntry->kind = ENTRY_SECTION;
+			sectionEntry->key = key;
+			numOfEntries++;
+		}
+		sectionEntry->version = version;
+		sectionEntry->sectionLength = sectionLength;
+		sectionEntry->crc = crc;
+	}
+
+	/* Whole table is tracked without the section_number */
+	tableEntry = Find_Entry(key & 0xFFFFFF00, ENTRY_TABLE);
+	if (tableEntry != NULL && (!tableEntry->used || tableEntry->version != version))
+	{
+		if (!tableEntry->used)
+		{
+			tableEntry->used = 1;
+			tableEntry->kind = ENTRY_TABLE;
+			tableEntry->key = key & 0xFFFFFF00;
+			numOfEntries++;
+		}
+		tableEntry->version = version;
+		versionChanged = 1;
+		statistics.versionChanges++;
+	}
+	statistics.newSections++;
+
+	changeCallback = PsiChangeCallback;
+	userData = changeCallbackUserData;
+	pthread_mutex_unlock(&cacheMutex);
+
+	if (versionChanged && changeCallback != NULL)
+	{
+		changeCallback(section, userData);
+	}
+	return PSI_SECTION_NEW;
+}
+
+void Psi_Cache_Get_Statistics(PsiCacheStatistics* outStatistics)
+{
+	pthread_mutex_lock(&cacheMutex);
+	*outStatistics = statistics;
+	pthread_mutex_unlock(&cacheMutex);
+}
+
+PsiCacheEntry* Find_Entry(uint32_t key, uint8_t kind)
+{
+	uint32_t index;
+	uint32_t i;
+
+	/* Fibonacci hashing spreads the consecutive program numbers */
+	index = ((key + kind) * 2654435761u) >> (32 - PSI_CACHE_SIZE_BITS);
+	for (i = 0; i < PSI_CACHE_SIZE; i++)
+	{
+		if (!cache[index].used || (cache[index].key == key && cache[index].kind == kind))
+		{
+			/* Keep the last slot free so that lookups always end */
+			if (!cache[index].used && numOfEntries >= PSI_CACHE_SIZE - 1)
+			{
+				return NULL;
+			}
+			return &cache[index];
+		}
+		index = (index + 1) & (PSI_CACHE_SIZE - 1);
+	}
+	return NULL;
+}
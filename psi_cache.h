@@ -0,0 +1,101 @@
+#ifndef _PSI_CACHE_H_
+#define _PSI_CACHE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include "crc32.h"
+
+/* Number of sections remembered, EIT schedule needs thousands */
+#define PSI_CACHE_SIZE_BITS 14
+#define PSI_CACHE_SIZE (1 << PSI_CACHE_SIZE_BITS)
+
+/* Section status returned by Psi_Cache_Filter_Section */
+#define PSI_SECTION_NEW 0
+#define PSI_SECTION_REPEATED 1
+#define PSI_SECTION_CORRUPTED 2
+#define PSI_SECTION_NOT_APPLICABLE 3
+
+typedef void(*Psi_Change_Callback)(const uint8_t* section, void* userData);
+
+typedef struct PsiCacheStatistics {
+	uint64_t newSections;
+	uint64_t repeatedSections;
+	uint32_t corruptedSections;
+	uint32_t versionChanges;
+} PsiCacheStatistics;
+
+/***********************************************************************
+* @brief    PSI cache initialization function
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Psi_Cache_Init();
+
+/***********************************************************************
+* @brief    PSI cache deinitialization function
+*
+* @return   EXIT_SUCCESS - no error
+*
+***********************************************************************/
+int32_t Psi_Cache_Deinit();
+
+/***********************************************************************
+* @brief    Forgets all sections, used after retuning to another
+* 			transport stream
+*
+***********************************************************************/
+void Psi_Cache_Flush();
+
+/***********************************************************************
+* @brief    Registers the callback which is called when a table changes
+* 			its version, it gets the first section of the new version
+*
+* @param    [in] changeCallback - callback function
+* @param    [in] userData - passed to the callback unchanged
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Psi_Cache_Register_Change_Callback(Psi_Change_Callback changeCallback, void* userData);
+
+/***********************************************************************
+* @brief    Unregisters the change callback
+*
+* @param    [in] changeCallback - callback function
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Psi_Cache_Unregister_Change_Callback(Psi_Change_Callback changeCallback);
+
+/***********************************************************************
+* @brief    Decides if a section has to be parsed. Repetitions of a
+* 			known section are dropped after comparing the header and
+* 			CRC_32 field, new sections are CRC checked and remembered
+*
+* @param    [in] section - pointer to the section, starting at table_id
+*
+* @return   PSI_SECTION_NEW - section has to be parsed
+* @return   PSI_SECTION_REPEATED - same section was already parsed
+* @return   PSI_SECTION_CORRUPTED - CRC_32 error
+* @return   PSI_SECTION_NOT_APPLICABLE - current_next_indicator is 0
+*
+***********************************************************************/
+int32_t Psi_Cache_Filter_Section(const uint8_t* section);
+
+/***********************************************************************
+* @brief    Copies the cache counters
+*
+* @param    [out] statistics - structure where the counters are saved
+*
+***********************************************************************/
+void Psi_Cache_Get_Statistics(PsiCacheStatistics* statistics);
+
+#endif
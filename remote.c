@@ -1,156 +1,526 @@
 #include "remote.h"
 
+/* epoll data of the descriptors which are not devices */
+#define REMOTE_WAKE_ID REMOTE_MAX_DEVICES
+#define REMOTE_INOTIFY_ID (REMOTE_MAX_DEVICES + 1)
+#define REMOTE_INOTIFY_BUFFER_SIZE 4096
+
+typedef struct RemoteDevice {
+	/* -1 when the slot is free */
+	int32_t fileDesc;
+	char path[REMOTE_PATH_SIZE];
+	/* epoll does not watch regular files, they are read until their end */
+	uint8_t isFile;
+	/* Start of a record which was split by a FIFO write */
+	uint8_t pending[sizeof(struct input_event)];
+	uint32_t pendingBytes;
+} RemoteDevice;
+
 /***********************************************************************
-* @brief    Reads the events on the remote and call callback function
+* @brief    Waits on epoll for the devices, inotify and the wake eventfd
+* 			and passes the events to the callback
 *
 ***********************************************************************/
 static void* Read_Input_Events();
 
 /***********************************************************************
-* @brief    Gets the keys that were pressed
-* 
-* @param	[in] count - maximum number of events to read
-* @param	[out] buf - array where the events will be
-* @param	[out] eventsRead - number of read events
-* 
-* @return   EXIT_SUCCESS - no error
-* @return   EXIT_FAILURE - error
+* @brief    Reads the events of a device in batches of NUM_EVENTS until
+* 			it has no more, removes the device when it is gone
+*
+* @param	[in] index - slot of the device
 *
 ***********************************************************************/
-static int32_t Get_Keys(int32_t count, uint8_t* buf, int32_t* eventsRead);
+static void Drain_Device(uint32_t index);
+
+/***********************************************************************
+* @brief    Opens the devices which appeared in the input directory and
+* 			removes the deleted ones
+*
+***********************************************************************/
+static void Handle_Hotplug();
+
+/***********************************************************************
+* @brief    Closes the device and frees its slot
+*
+* @param	[in] index - slot of the device
+*
+***********************************************************************/
+static void Remove_Device(uint32_t index);
+
+/***********************************************************************
+* @brief    Returns 1 if the directory entry is an evdev device
+*
+***********************************************************************/
+static uint8_t Is_Event_Device(const char* name);
 
 Remote_Events_Callback RemoteEventsCallback = NULL;
 
-static int32_t inputFileDesc;
-static struct input_event* eventBuf;
-static int32_t remoteInit = 0;  
+static RemoteDevice devices[REMOTE_MAX_DEVICES] = { [0 ... REMOTE_MAX_DEVICES - 1] = { .fileDesc = -1 } };
+static struct input_event eventBuf[NUM_EVENTS];
+static char inputDirectory[REMOTE_PATH_SIZE];
+static int32_t epollFileDesc = -1;
+static int32_t wakeFileDesc = -1;
+static int32_t inotifyFileDesc = -1;
+static int32_t remoteInit = 0;
 static pthread_t readInputEventsThread;
-static pthread_mutex_t mutex;
+/* Protects the device slots, the callback and the statistics */
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static RemoteStatistics statistics;
 
-int32_t Remote_Init()
+int32_t Remote_Init(const char* directory)
 {
-	const char* dev = "/dev/input/event0";
-	char deviceName[20];
+	struct epoll_event event;
+	DIR* directoryStream;
+	struct dirent* entry;
+	char path[REMOTE_PATH_SIZE];
+	uint32_t i;
 
-	inputFileDesc = open(dev, O_RDWR);
-    if (inputFileDesc == ERROR)
-    {
-        printf("Error while opening device (%s)!\n", dev);
-	    return EXIT_FAILURE;
-    }
-    
-    ioctl(inputFileDesc, EVIOCGNAME(sizeof(deviceName)), deviceName);
-	printf("RC device opened succesfully [%s]\n", deviceName);
-	
-	eventBuf = malloc(NUM_EVENTS * sizeof(struct input_event));
-    if (!eventBuf)
-    {
-        printf("Error allocating memory!\n");
-        return EXIT_FAILURE;
-    }
-    
-    remoteInit = 1;
-	
-	pthread_mutex_init(&mutex, NULL);
-	pthread_create(&readInputEventsThread, NULL, Read_Input_Events, NULL);
+	for (i = 0; i < REMOTE_MAX_DEVICES; i++)
+	{
+		devices[i].fileDesc = ERROR;
+	}
+	memset(&statistics, 0, sizeof(statistics));
+
+	epollFileDesc = epoll_create1(EPOLL_CLOEXEC);
+	wakeFileDesc = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (epollFileDesc == ERROR || wakeFileDesc == ERROR)
+	{
+		printf("%s(%d): Error creating epoll (%s)!\n", __FUNCTION__, __LINE__, strerror(errno));
+		Remote_Deinit();
+		return EXIT_FAILURE;
+	}
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.u32 = REMOTE_WAKE_ID;
+	epoll_ctl(epollFileDesc, EPOLL_CTL_ADD, wakeFileDesc, &event);
+
+	inputDirectory[0] = '\0';
+	if (directory != NULL)
+	{
+		snprintf(inputDirectory, sizeof(inputDirectory), "%s", directory);
+		/* Devices are created by the kernel and made readable by udev afterwards */
+		inotifyFileDesc = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+		if (inotifyFileDesc == ERROR
+			|| inotify_add_watch(inotifyFileDesc, directory, IN_CREATE | IN_ATTRIB | IN_MOVED_TO | IN_DELETE) == ERROR)
+		{
+			printf("%s(%d): Hot plugged devices are not watched in %s (%s)!\n", __FUNCTION__, __LINE__,
+				   directory, strerror(errno));
+		}
+		else
+		{
+			event.data.u32 = REMOTE_INOTIFY_ID;
+			epoll_ctl(epollFileDesc, EPOLL_CTL_ADD, inotifyFileDesc, &event);
+		}
+
+		directoryStream = opendir(directory);
+		if (directoryStream == NULL)
+		{
+			printf("%s(%d): Error opening %s (%s)!\n", __FUNCTION__, __LINE__, directory, strerror(errno));
+		}
+		else
+		{
+			while ((entry = readdir(directoryStream)) != NULL)
+			{
+				if (Is_Event_Device(entry->d_name)
+					&& snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name) < (int32_t)sizeof(path))
+				{
+					Remote_Add_Device(path);
+				}
+			}
+			closedir(directoryStream);
+		}
+	}
+
+	remoteInit = 1;
+	if (pthread_create(&readInputEventsThread, NULL, Read_Input_Events, NULL))
+	{
+		printf("%s(%d): Error creating input thread!\n", __FUNCTION__, __LINE__);
+		remoteInit = 0;
+		Remote_Deinit();
+		return EXIT_FAILURE;
+	}
 	return EXIT_SUCCESS;
 }
 
 int32_t Remote_Deinit()
 {
+	uint64_t wake = 1;
+	uint32_t i;
+
+	/* Reactor wakes up right away, it does not wait for the next key */
+	if (__atomic_exchange_n(&remoteInit, 0, __ATOMIC_SEQ_CST))
+	{
+		if (write(wakeFileDesc, &wake, sizeof(wake)) != sizeof(wake))
+		{
+			printf("%s(%d): Error waking input thread!\n", __FUNCTION__, __LINE__);
+		}
+		pthread_join(readInputEventsThread, NULL);
+	}
+
 	pthread_mutex_lock(&mutex);
-	remoteInit = 0;
+	for (i = 0; i < REMOTE_MAX_DEVICES; i++)
+	{
+		if (devices[i].fileDesc != ERROR)
+		{
+			Remove_Device(i);
+		}
+	}
+	pthread_mutex_unlock(&mutex);
+
+	if (inotifyFileDesc != ERROR)
+	{
+		close(inotifyFileDesc);
+		inotifyFileDesc = ERROR;
+	}
+	if (wakeFileDesc != ERROR)
+	{
+		close(wakeFileDesc);
+		wakeFileDesc = ERROR;
+	}
+	if (epollFileDesc != ERROR)
+	{
+		close(epollFileDesc);
+		epollFileDesc = ERROR;
+	}
+	return EXIT_SUCCESS;
+}
+
+int32_t Remote_Add_Device(const char* path)
+{
+	struct epoll_event event;
+	struct stat status;
+	char deviceName[32];
+	int32_t clockId = CLOCK_MONOTONIC;
+	int32_t fileDesc;
+	int32_t flags = O_RDONLY;
+	uint32_t index = REMOTE_MAX_DEVICES;
+	uint64_t wake = 1;
+	uint32_t i;
+
+	if (stat(path, &status) == ERROR)
+	{
+		printf("%s(%d): Error opening device %s (%s)!\n", __FUNCTION__, __LINE__, path, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	/* Keeps a writer on the FIFO, so it does not end when a writer closes it */
+	if (S_ISFIFO(status.st_mode))
+	{
+		flags = O_RDWR;
+	}
+
+	pthread_mutex_lock(&mutex);
+	for (i = 0; i < REMOTE_MAX_DEVICES; i++)
+	{
+		if (devices[i].fileDesc != ERROR && strcmp(devices[i].path, path) == 0)
+		{
+			/* Hot plug reports a device more than once */
+			pthread_mutex_unlock(&mutex);
+			return EXIT_SUCCESS;
+		}
+		if (devices[i].fileDesc == ERROR && index == REMOTE_MAX_DEVICES)
+		{
+			index = i;
+		}
+	}
+	if (index == REMOTE_MAX_DEVICES)
+	{
+		pthread_mutex_unlock(&mutex);
+		printf("%s(%d): Too many input devices, %s is not opened!\n", __FUNCTION__, __LINE__, path);
+		return EXIT_FAILURE;
+	}
+
+	fileDesc = open(path, flags | O_NONBLOCK | O_CLOEXEC);
+	if (fileDesc == ERROR)
+	{
+		pthread_mutex_unlock(&mutex);
+		printf("%s(%d): Error opening device %s (%s)!\n", __FUNCTION__, __LINE__, path, strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	/* Event times are compared with the monotonic clock of the rest of the box */
+	ioctl(fileDesc, EVIOCSCLOCKID, &clockId);
+	if (ioctl(fileDesc, EVIOCGNAME(sizeof(deviceName)), deviceName) < 0)
+	{
+		snprintf(deviceName, sizeof(deviceName), "%s", S_ISREG(status.st_mode) ? "file" : "fifo");
+	}
+
+	devices[index].fileDesc = fileDesc;
+	snprintf(devices[index].path, REMOTE_PATH_SIZE, "%s", path);
+	devices[index].isFile = 0;
+	devices[index].pendingBytes = 0;
+
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.u32 = index;
+	if (epoll_ctl(epollFileDesc, EPOLL_CTL_ADD, fileDesc, &event) == ERROR)
+	{
+		if (errno != EPERM)
+		{
+			printf("%s(%d): Error watching device %s (%s)!\n", __FUNCTION__, __LINE__, path, strerror(errno));
+			close(fileDesc);
+			devices[index].fileDesc = ERROR;
+			pthread_mutex_unlock(&mutex);
+			return EXIT_FAILURE;
+		}
+		/* Regular file, the reactor reads it when it wakes up */
+		devices[index].isFile = 1;
+		if (write(wakeFileDesc, &wake, sizeof(wake)) != sizeof(wake))
+		{
+			printf("%s(%d): Error waking input thread!\n", __FUNCTION__, __LINE__);
+		}
+	}
+	statistics.devicesAdded++;
 	pthread_mutex_unlock(&mutex);
-	
-	pthread_join(readInputEventsThread, NULL);
-	
-	free(eventBuf);
-	
-	if(close(inputFileDesc) == ERROR)
-	{
-		printf("Error while closing device (%d)!\n", strerror(errno));
-	    return EXIT_FAILURE;
-	}
-	
-	pthread_mutex_destroy(&mutex);
+
+	printf("RC device opened succesfully [%s] %s\n", deviceName, path);
 	return EXIT_SUCCESS;
 }
 
 int32_t Remote_Register_Events_Callback(Remote_Events_Callback remoteEventsCallback)
 {
+	pthread_mutex_lock(&mutex);
 	if(RemoteEventsCallback != NULL)
 	{
+		pthread_mutex_unlock(&mutex);
 		printf("%s(%d): Remote_Register_Events_Callback failed, callback already registered!\n", __FUNCTION__, __LINE__);
 		return EXIT_FAILURE;
 	}
-	
+
 	RemoteEventsCallback = remoteEventsCallback;
-	
+	pthread_mutex_unlock(&mutex);
+
 	return EXIT_SUCCESS;
 }
 
 int32_t Remote_Unregister_Events_Callback(Remote_Events_Callback remoteEventsCallback)
 {
+	pthread_mutex_lock(&mutex);
 	if(RemoteEventsCallback == NULL)
 	{
+		pthread_mutex_unlock(&mutex);
 		printf("%s(%d): Remote_Unregister_Events_Callback failed, callback already unregistered!\n", __FUNCTION__, __LINE__);
 		return EXIT_FAILURE;
 	}
-	
+
 	if(RemoteEventsCallback != remoteEventsCallback)
 	{
+		pthread_mutex_unlock(&mutex);
 		printf("%s(%d): Remote_Unregister_Events_Callback failed, wrong callback function!\n", __FUNCTION__, __LINE__);
 		return EXIT_FAILURE;
 	}
-	
+
 	RemoteEventsCallback = NULL;
-	
+	pthread_mutex_unlock(&mutex);
+
 	return EXIT_SUCCESS;
 }
 
+void Remote_Get_Statistics(RemoteStatistics* outStatistics)
+{
+	pthread_mutex_lock(&mutex);
+	*outStatistics = statistics;
+	pthread_mutex_unlock(&mutex);
+}
+
 void* Read_Input_Events()
 {
-	uint32_t eventCnt;
-	
+	struct epoll_event events[REMOTE_MAX_DEVICES + 2];
+	int32_t numOfEvents;
+	int32_t timeout;
+	uint64_t wake;
+	uint32_t index;
+	int32_t i;
+
+	TRACE_THREAD_NAME("remote");
 	while (NON_STOP)
     {
+		/* Files are always readable, they are drained without sleeping */
+		timeout = -1;
 		pthread_mutex_lock(&mutex);
-		if (remoteInit == 0)
+		for (index = 0; index < REMOTE_MAX_DEVICES; index++)
+		{
+			if (devices[index].fileDesc != ERROR && devices[index].isFile)
+			{
+				timeout = 0;
+			}
+		}
+		pthread_mutex_unlock(&mutex);
+
+		numOfEvents = epoll_wait(epollFileDesc, events, REMOTE_MAX_DEVICES + 2, timeout);
+		if (numOfEvents == ERROR)
 		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			printf("%s(%d): Error waiting for input events (%s)!\n", __FUNCTION__, __LINE__, strerror(errno));
+			return NULL;
+		}
+		if (__atomic_load_n(&remoteInit, __ATOMIC_SEQ_CST) == 0)
+		{
+			return NULL;
+		}
+
+		pthread_mutex_lock(&mutex);
+		statistics.wakeups++;
+		pthread_mutex_unlock(&mutex);
+
+		TRACE_BEGIN("input events");
+		for (i = 0; i < numOfEvents; i++)
+		{
+			index = events[i].data.u32;
+			if (index == REMOTE_WAKE_ID)
+			{
+				/* A file was added, it is read below */
+				if (read(wakeFileDesc, &wake, sizeof(wake)) < 0)
+				{
+					wake = 0;
+				}
+			}
+			else if (index == REMOTE_INOTIFY_ID)
+			{
+				Handle_Hotplug();
+			}
+			else if (devices[index].fileDesc != ERROR)
+			{
+				Drain_Device(index);
+			}
+		}
+
+		/* Only the reactor removes devices, the slots stay valid without the lock */
+		for (index = 0; index < REMOTE_MAX_DEVICES; index++)
+		{
+			if (devices[index].fileDesc != ERROR && devices[index].isFile)
+			{
+				Drain_Device(index);
+			}
+		}
+		TRACE_END_VALUE("input events", numOfEvents);
+	}
+}
+
+void Drain_Device(uint32_t index)
+{
+	RemoteDevice* device = &devices[index];
+	Remote_Events_Callback callback;
+	uint8_t* buffer = (uint8_t*)eventBuf;
+	uint32_t requested;
+	uint32_t bytes;
+	uint32_t eventCnt;
+	ssize_t ret;
+
+	while (NON_STOP)
+	{
+		memcpy(buffer, device->pending, device->pendingBytes);
+		requested = sizeof(eventBuf) - device->pendingBytes;
+		ret = read(device->fileDesc, buffer + device->pendingBytes, requested);
+		if (ret == ERROR)
+		{
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				return;
+			}
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			/* ENODEV when the device was unplugged */
+			printf("%s(%d): Device %s is gone (%s)!\n", __FUNCTION__, __LINE__, device->path, strerror(errno));
+			pthread_mutex_lock(&mutex);
+			Remove_Device(index);
 			pthread_mutex_unlock(&mutex);
 			return;
 		}
-		pthread_mutex_unlock(&mutex);
-		
-        /* Read input events */
-        if (Get_Keys(NUM_EVENTS, (uint8_t*)eventBuf, &eventCnt))
-        {
-			printf("Error while reading input events!");
+		if (ret == 0)
+		{
+			/* End of a file */
+			pthread_mutex_lock(&mutex);
+			Remove_Device(index);
+			pthread_mutex_unlock(&mutex);
 			return;
 		}
-		
-		if (RemoteEventsCallback != NULL)
+
+		bytes = device->pendingBytes + ret;
+		eventCnt = bytes / sizeof(struct input_event);
+		device->pendingBytes = bytes % sizeof(struct input_event);
+		memcpy(device->pending, buffer + eventCnt * sizeof(struct input_event), device->pendingBytes);
+
+		if (eventCnt > 0)
+		{
+			pthread_mutex_lock(&mutex);
+			callback = RemoteEventsCallback;
+			statistics.events += eventCnt;
+			statistics.batches++;
+			pthread_mutex_unlock(&mutex);
+			if (callback != NULL)
+			{
+				TRACE_BEGIN("events callback");
+				callback(eventBuf, eventCnt);
+				TRACE_END_VALUE("events callback", eventCnt);
+			}
+		}
+
+		/* Short read of a device or a FIFO means it is drained */
+		if ((uint32_t)ret < requested && !device->isFile)
 		{
-			RemoteEventsCallback(eventBuf, eventCnt);
+			return;
 		}
 	}
-	
 }
 
-int32_t Get_Keys(int32_t count, uint8_t* buf, int32_t* eventsRead)
+void Handle_Hotplug()
 {
-    int32_t ret = 0;
-    
-    /* Read input events and put them in buffer */
-    ret = read(inputFileDesc, buf, (size_t)(count * (int)sizeof(struct input_event)));
-    if (ret <= 0)
-    {
-        printf("Error code %d\n", ret);
-        return EXIT_FAILURE;
-    }
-    
-    /* Calculate number of read events */
-    *eventsRead = ret / (int)sizeof(struct input_event);
-    
-    return EXIT_SUCCESS;
+	/* Aligned for the inotify_event structures */
+	uint8_t buffer[REMOTE_INOTIFY_BUFFER_SIZE] __attribute__((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event* event;
+	char path[REMOTE_PATH_SIZE];
+	ssize_t length;
+	ssize_t offset;
+	uint32_t i;
+
+	while ((length = read(inotifyFileDesc, buffer, sizeof(buffer))) > 0)
+	{
+		for (offset = 0; offset < length; offset += sizeof(struct inotify_event) + event->len)
+		{
+			event = (const struct inotify_event*)(buffer + offset);
+			if (event->len == 0 || !Is_Event_Device(event->name)
+				|| snprintf(path, sizeof(path), "%s/%s", inputDirectory, event->name) >= (int32_t)sizeof(path))
+			{
+				continue;
+			}
+
+			if (event->mask & IN_DELETE)
+			{
+				pthread_mutex_lock(&mutex);
+				for (i = 0; i < REMOTE_MAX_DEVICES; i++)
+				{
+					if (devices[i].fileDesc != ERROR && strcmp(devices[i].path, path) == 0)
+					{
+						Remove_Device(i);
+					}
+				}
+				pthread_mutex_unlock(&mutex);
+			}
+			else if (access(path, R_OK) == 0)
+			{
+				/* Not readable yet when it is created, IN_ATTRIB follows */
+				Remote_Add_Device(path);
+			}
+		}
+	}
+}
+
+void Remove_Device(uint32_t index)
+{
+	epoll_ctl(epollFileDesc, EPOLL_CTL_DEL, devices[index].fileDesc, NULL);
+	close(devices[index].fileDesc);
+	devices[index].fileDesc = ERROR;
+	devices[index].isFile = 0;
+	devices[index].pendingBytes = 0;
+	statistics.devicesRemoved++;
+}
+
+uint8_t Is_Event_Device(const char* name)
+{
+	return strncmp(name, "event", 5) == 0;
 }
@@ -6,28 +6,60 @@
 #include <fcntl.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
 #include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include "trace.h"
+#include "common.h"
 
-#define NUM_EVENTS 5
+/* Events read from a device at once and passed to the callback */
+#define NUM_EVENTS 64
+/* Devices watched at the same time */
+#define REMOTE_MAX_DEVICES 16
+#define REMOTE_PATH_SIZE 64
+/* Where the evdev devices of the box are, hot plugged ones appear there too */
+#define REMOTE_INPUT_DIRECTORY "/dev/input"
 
 #define ERROR -1
-#define NON_STOP 1
 
 typedef int32_t(*Remote_Events_Callback)(struct input_event* buffer, uint32_t eventCnt);
 
+typedef struct RemoteStatistics {
+	uint32_t events;
+	/* Callback calls, each with up to NUM_EVENTS events */
+	uint32_t batches;
+	/* Times the reactor thread woke up */
+	uint32_t wakeups;
+	uint32_t devicesAdded;
+	uint32_t devicesRemoved;
+} RemoteStatistics;
+
 /***********************************************************************
-* @brief    Remote initialization function
-* 
+* @brief    Remote initialization function, starts the reactor thread
+* 			and opens the evdev devices in the directory. Devices added
+* 			to the directory later are opened when they appear
+*
+* @param	[in] inputDirectory - REMOTE_INPUT_DIRECTORY on the box, NULL
+* 								  opens only the devices which are added
+*
 * @return   EXIT_SUCCESS - no error
 * @return   EXIT_FAILURE - error
 *
 ***********************************************************************/
-int32_t Remote_Init();
+int32_t Remote_Init(const char* inputDirectory);
 
 /***********************************************************************
-* @brief    Remote deinitialization function
-* 
+* @brief    Remote deinitialization function, stops the reactor thread
+* 			right away and closes the devices
+*
 * @return   EXIT_SUCCESS - no error
 * @return   EXIT_FAILURE - error
 *
@@ -35,10 +67,24 @@ int32_t Remote_Init();
 int32_t Remote_Deinit();
 
 /***********************************************************************
-* @brief    Registers the remote callback
-* 
+* @brief    Adds an input device. Besides evdev devices, a FIFO or a
+* 			file of struct input_event records can be added, the file
+* 			is read once until its end
+*
+* @param	[in] path - path of the device
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Remote_Add_Device(const char* path);
+
+/***********************************************************************
+* @brief    Registers the remote callback, it is called on the reactor
+* 			thread
+*
 * @param	[in] remoteEventsCallback - callback function
-* 
+*
 * @return   EXIT_SUCCESS - no error
 * @return   EXIT_FAILURE - error
 *
@@ -47,13 +93,21 @@ int32_t Remote_Register_Events_Callback(Remote_Events_Callback remoteEventsCallb
 
 /***********************************************************************
 * @brief    Unregisters the remote callback
-* 
+*
 * @param	[in] remoteEventsCallback - callback function
-* 
+*
 * @return   EXIT_SUCCESS - no error
 * @return   EXIT_FAILURE - error
 *
 ***********************************************************************/
 int32_t Remote_Unregister_Events_Callback(Remote_Events_Callback remoteEventsCallback);
 
+/***********************************************************************
+* @brief    Copies the reactor statistics
+*
+* @param	[out] outStatistics - structure where the statistics are saved
+*
+***********************************************************************/
+void Remote_Get_Statistics(RemoteStatistics* outStatistics);
+
 #endif
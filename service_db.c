@@ -0,0 +1,210 @@
+#include "service_db.h"
+
+/***********************************************************************
+* @brief    Returns the index of the service with the program number,
+* 			appends a new service if there is none. Called with the
+* 			database mutex locked
+*
+* @param    [in] programNumber - program_number / service_id
+*
+* @return   index of the service, SERVICE_DB_NO_INDEX if it is full
+*
+***********************************************************************/
+static uint16_t Get_Or_Add_Service(uint16_t programNumber);
+
+/* Services are kept contiguous so that the list is walked linearly */
+static ServiceEntry services[SERVICE_DB_MAX_SERVICES];
+static uint32_t numOfServices = 0;
+/* Direct indexes, lookups never search */
+static uint16_t programIndex[65536];
+static uint16_t lcnIndex[SERVICE_DB_MAX_LCN];
+static pthread_mutex_t serviceDbMutex;
+
+int32_t Service_Db_Init()
+{
+	if (pthread_mutex_init(&serviceDbMutex, NULL))
+	{
+		printf("%s(%d): Error initializing service database mutex!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+	Service_Db_Clear();
+	return EXIT_SUCCESS;
+}
+
+int32_t Service_Db_Deinit()
+{
+	pthread_mutex_destroy(&serviceDbMutex);
+	return EXIT_SUCCESS;
+}
+
+void Service_Db_Clear()
+{
+	pthread_mutex_lock(&serviceDbMutex);
+	/* 0xFF bytes give SERVICE_DB_NO_INDEX */
+	memset(programIndex, 0xFF, sizeof(programIndex));
+	memset(lcnIndex, 0xFF, sizeof(lcnIndex));
+	numOfServices = 0;
+	pthread_mutex_unlock(&serviceDbMutex);
+}
+
+int32_t Service_Db_Update_PAT(const PATTable* programTable, uint32_t numOfPrograms)
+{
+	uint32_t i;
+	uint16_t index;
+	int32_t ret = EXIT_SUCCESS;
+
+	pthread_mutex_lock(&serviceDbMutex);
+	for (i = 0; i < numOfPrograms; i++)
+	{
+		index = Get_Or_Add_Service(programTable[i].programNumber);
+		if (index == SERVICE_DB_NO_INDEX)
+		{
+			ret = EXIT_FAILURE;
+			break;
+		}
+		services[index].programMapPID = programTable[i].programMapPID;
+	}
+	pthread_mutex_unlock(&serviceDbMutex);
+	return ret;
+}
+
+int32_t Service_Db_Update_SDT(const SDTService* serviceTable, uint32_t numOfServicesInTable)
+{
+	uint32_t i;
+	uint16_t index;
+	int32_t ret = EXIT_SUCCESS;
+
+	pthread_mutex_lock(&serviceDbMutex);
+	for (i = 0; i < numOfServicesInTable; i++)
+	{
+		index = Get_Or_Add_Service(serviceTable[i].serviceId);
+		if (index == SERVICE_DB_NO_INDEX)
+		{
+			ret = EXIT_FAILURE;
+			break;
+		}
+		services[index].serviceType = serviceTable[i].serviceType;
+		memcpy(services[index].serviceName, serviceTable[i].serviceName, SERVICE_NAME_SIZE);
+	}
+	pthread_mutex_unlock(&serviceDbMutex);
+	return ret;
+}
+
+int32_t Service_Db_Update_NIT(const NITService* serviceTable, uint32_t numOfServicesInTable)
+{
+	uint32_t i;
+	uint16_t index;
+	uint16_t oldLCN;
+	int32_t ret = EXIT_SUCCESS;
+
+	pthread_mutex_lock(&serviceDbMutex);
+	for (i = 0; i < numOfServicesInTable; i++)
+	{
+		index = Get_Or_Add_Service(serviceTable[i].serviceId);
+		if (index == SERVICE_DB_NO_INDEX)
+		{
+			ret = EXIT_FAILURE;
+			break;
+		}
+
+		/* NIT may carry the service type when the SDT does not */
+		if (services[index].serviceType == 0)
+		{
+			services[index].serviceType = serviceTable[i].serviceType;
+		}
+		services[index].visible = serviceTable[i].visible;
+
+		oldLCN = services[index].logicalChannelNumber;
+		if (oldLCN != 0 && lcnIndex[oldLCN] == index)
+		{
+			lcnIndex[oldLCN] = SERVICE_DB_NO_INDEX;
+		}
+		services[index].logicalChannelNumber = serviceTable[i].logicalChannelNumber;
+		/* LCN 0 means the service has no channel number */
+		if (serviceTable[i].logicalChannelNumber != 0)
+		{
+			lcnIndex[serviceTable[i].logicalChannelNumber] = index;
+		}
+	}
+	pthread_mutex_unlock(&serviceDbMutex);
+	return ret;
+}
+
+int32_t Service_Db_Find_By_Program(uint16_t programNumber, ServiceEntry* service)
+{
+	int32_t ret = EXIT_FAILURE;
+
+	pthread_mutex_lock(&serviceDbMutex);
+	if (programIndex[programNumber] != SERVICE_DB_NO_INDEX)
+	{
+		*service = services[programIndex[programNumber]];
+		ret = EXIT_SUCCESS;
+	}
+	pthread_mutex_unlock(&serviceDbMutex);
+	return ret;
+}
+
+int32_t Service_Db_Find_By_LCN(uint16_t logicalChannelNumber, ServiceEntry* service)
+{
+	int32_t ret = EXIT_FAILURE;
+
+	if (logicalChannelNumber >= SERVICE_DB_MAX_LCN)
+	{
+		return EXIT_FAILURE;
+	}
+
+	pthread_mutex_lock(&serviceDbMutex);
+	if (lcnIndex[logicalChannelNumber] != SERVICE_DB_NO_INDEX)
+	{
+		*service = services[lcnIndex[logicalChannelNumber]];
+		ret = EXIT_SUCCESS;
+	}
+	pthread_mutex_unlock(&serviceDbMutex);
+	return ret;
+}
+
+int32_t Service_Db_Get_Service(uint32_t index, ServiceEntry* service)
+{
+	int32_t ret = EXIT_FAILURE;
+
+	pthread_mutex_lock(&serviceDbMutex);
+	if (index < numOfServices)
+	{
+		*service = services[index];
+		ret = EXIT_SUCCESS;
+	}
+	pthread_mutex_unlock(&serviceDbMutex);
+	return ret;
+}
+
+uint32_t Service_Db_Get_Count()
+{
+	uint32_t count;
+
+	pthread_mutex_lock(&serviceDbMutex);
+	count = numOfServices;
+	pthread_mutex_unlock(&serviceDbMutex);
+	return count;
+}
+
+uint16_t Get_Or_Add_Service(uint16_t programNumber)
+{
+	uint16_t index = programIndex[programNumber];
+
+	if (index != SERVICE_DB_NO_INDEX)
+	{
+		return index;
+	}
+	if (numOfServices == SERVICE_DB_MAX_SERVICES)
+	{
+		printf("%s(%d): Service database is full!\n", __FUNCTION__, __LINE__);
+		return SERVICE_DB_NO_INDEX;
+	}
+
+	index = numOfServices++;
+	memset(&services[index], 0, sizeof(ServiceEntry));
+	services[index].programNumber = programNumber;
+	services[index].visible = 1;
+	programIndex[programNumber] = index;
+	return index;
+}
@@ -0,0 +1,129 @@
+#ifndef _SERVICE_DB_H_
+#define _SERVICE_DB_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include "table_parse.h"
+
+#define SERVICE_DB_MAX_SERVICES 512
+/* logical_channel_number is a 10 bit field */
+#define SERVICE_DB_MAX_LCN 1024
+#define SERVICE_DB_NO_INDEX 0xFFFF
+
+typedef struct ServiceEntry {
+	uint16_t programNumber;
+	uint16_t programMapPID;
+	uint16_t logicalChannelNumber;
+	uint8_t serviceType;
+	uint8_t visible;
+	char serviceName[SERVICE_NAME_SIZE];
+} ServiceEntry;
+
+/***********************************************************************
+* @brief    Service database initialization function
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Service_Db_Init();
+
+/***********************************************************************
+* @brief    Service database deinitialization function
+*
+* @return   EXIT_SUCCESS - no error
+*
+***********************************************************************/
+int32_t Service_Db_Deinit();
+
+/***********************************************************************
+* @brief    Removes all services
+*
+***********************************************************************/
+void Service_Db_Clear();
+
+/***********************************************************************
+* @brief    Adds the programs from the PAT, or updates their PMT PID
+*
+* @param    [in] programTable - PAT_Parse results
+* @param    [in] numOfPrograms - number of programs
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - database is full
+*
+***********************************************************************/
+int32_t Service_Db_Update_PAT(const PATTable* programTable, uint32_t numOfPrograms);
+
+/***********************************************************************
+* @brief    Saves the service names and types from the SDT
+*
+* @param    [in] serviceTable - SDT_Parse results
+* @param    [in] numOfServices - number of services
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - database is full
+*
+***********************************************************************/
+int32_t Service_Db_Update_SDT(const SDTService* serviceTable, uint32_t numOfServices);
+
+/***********************************************************************
+* @brief    Saves the logical channel numbers from the NIT
+*
+* @param    [in] serviceTable - NIT_Parse results
+* @param    [in] numOfServices - number of services
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - database is full
+*
+***********************************************************************/
+int32_t Service_Db_Update_NIT(const NITService* serviceTable, uint32_t numOfServices);
+
+/***********************************************************************
+* @brief    Copies the service with the program number, O(1)
+*
+* @param    [in] programNumber - program_number / service_id
+* @param    [out] service - where the service is copied
+*
+* @return   EXIT_SUCCESS - service found
+* @return   EXIT_FAILURE - no such service
+*
+***********************************************************************/
+int32_t Service_Db_Find_By_Program(uint16_t programNumber, ServiceEntry* service);
+
+/***********************************************************************
+* @brief    Copies the service with the logical channel number, O(1)
+*
+* @param    [in] logicalChannelNumber - LCN from the NIT
+* @param    [out] service - where the service is copied
+*
+* @return   EXIT_SUCCESS - service found
+* @return   EXIT_FAILURE - no such service
+*
+***********************************************************************/
+int32_t Service_Db_Find_By_LCN(uint16_t logicalChannelNumber, ServiceEntry* service);
+
+/***********************************************************************
+* @brief    Copies the service at a position of the table, services are
+* 			kept in the order they were found
+*
+* @param    [in] index - position in the table
+* @param    [out] service - where the service is copied
+*
+* @return   EXIT_SUCCESS - service found
+* @return   EXIT_FAILURE - index out of range
+*
+***********************************************************************/
+int32_t Service_Db_Get_Service(uint32_t index, ServiceEntry* service);
+
+/***********************************************************************
+* @brief    Returns the number of services in the table
+*
+* @return   numOfServices - number of services
+*
+***********************************************************************/
+uint32_t Service_Db_Get_Count();
+
+#endif
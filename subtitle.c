@@ -0,0 +1,1790 @@
+#include "subtitle.h"
+
+/* PES of DVB subtitles, EN 300 743 */
+#define SUBTITLE_STREAM_ID 0xBD
+#define SUBTITLE_DATA_IDENTIFIER 0x20
+#define SUBTITLE_STREAM_IDENTIFIER 0x00
+#define SUBTITLE_SYNC_BYTE 0x0F
+/* sync_byte, segment_type, page_id and segment_length */
+#define SEGMENT_HEADER_SIZE 6
+
+/* Segment types */
+#define SEGMENT_PAGE_COMPOSITION 0x10
+#define SEGMENT_REGION_COMPOSITION 0x11
+#define SEGMENT_CLUT_DEFINITION 0x12
+#define SEGMENT_OBJECT_DATA 0x13
+#define SEGMENT_DISPLAY_DEFINITION 0x14
+#define SEGMENT_END_OF_DISPLAY_SET 0x80
+
+/* page_state */
+#define PAGE_STATE_NORMAL_CASE 0
+#define PAGE_STATE_ACQUISITION_POINT 1
+#define PAGE_STATE_MODE_CHANGE 2
+
+/* Data types of the pixel-data sub-blocks */
+#define PIXELS_2_BIT 0x10
+#define PIXELS_4_BIT 0x11
+#define PIXELS_8_BIT 0x12
+#define MAP_TABLE_2_TO_4 0x20
+#define MAP_TABLE_2_TO_8 0x21
+#define MAP_TABLE_4_TO_8 0x22
+#define END_OF_OBJECT_LINE 0xF0
+
+/* region_depth and the bits of the pixel codes */
+#define REGION_DEPTH_2_BIT 1
+#define REGION_DEPTH_4_BIT 2
+#define REGION_DEPTH_8_BIT 3
+
+/* Flags of a CLUT entry */
+#define CLUT_ENTRY_2_BIT 0x80
+#define CLUT_ENTRY_4_BIT 0x40
+#define CLUT_ENTRY_8_BIT 0x20
+#define CLUT_ENTRY_FULL_RANGE 0x01
+
+#define OBJECT_TYPE_BITMAP 0
+#define OBJECT_CODING_PIXELS 0
+/* Pixel code which is not written with the non_modifying_colour_flag */
+#define NON_MODIFYING_PIXEL_CODE 1
+
+#define CC_UNKNOWN 0xFF
+#define NO_VERSION 0xFF
+#define PTS_MASK 0x1FFFFFFFFULL
+#define COLOR_TRANSPARENT 0x00000000
+
+typedef struct PesBuffer {
+	/* Bytes received, of the whole PES packet with its header */
+	uint32_t size;
+	/* 6 bytes and PES_packet_length, 0 if the length is not given */
+	uint32_t length;
+	uint8_t data[SUBTITLE_MAX_PES_SIZE];
+} PesBuffer;
+
+typedef struct SubtitleClut {
+	uint8_t id;
+	uint8_t version;
+	/* ARGB of the 2, 4 and 8 bit pixel codes */
+	uint32_t entries2[4];
+	uint32_t entries4[16];
+	uint32_t entries8[256];
+} SubtitleClut;
+
+typedef struct RegionObject {
+	uint16_t objectId;
+	uint8_t objectType;
+	int32_t x;
+	int32_t y;
+} RegionObject;
+
+typedef struct SubtitleRegion {
+	uint8_t id;
+	uint8_t version;
+	int32_t width;
+	int32_t height;
+	uint8_t depth;
+	uint8_t clutId;
+	/* One pixel code per byte, from the region pool */
+	uint8_t* pixels;
+	uint32_t numOfObjects;
+	RegionObject objects[SUBTITLE_MAX_REGION_OBJECTS];
+} SubtitleRegion;
+
+typedef struct PageRegion {
+	uint8_t regionId;
+	int32_t x;
+	int32_t y;
+} PageRegion;
+
+/* Display set from its page composition until it is composed */
+typedef struct DisplaySet {
+	uint8_t started;
+	uint64_t pts;
+	uint8_t timeout;
+	uint32_t numOfRegions;
+	PageRegion regions[SUBTITLE_MAX_REGIONS];
+} DisplaySet;
+
+/* Bits of a pixel code string, reading past the end returns zeros */
+typedef struct BitReader {
+	const uint8_t* data;
+	uint32_t size;
+	uint32_t position;
+} BitReader;
+
+/***********************************************************************
+* @brief    Decoding thread, decodes the queued PES packets and calls
+* 			the callback when a display set is due
+*
+***********************************************************************/
+static void* Subtitle_Task();
+
+/***********************************************************************
+* @brief    Takes a free PES buffer, NULL if all are used
+*
+***********************************************************************/
+static PesBuffer* Take_Pes();
+
+/***********************************************************************
+* @brief    Queues a complete PES packet for the decoding thread
+*
+***********************************************************************/
+static void Queue_Pes(PesBuffer* pes);
+
+/***********************************************************************
+* @brief    Returns a PES buffer to the free ones
+*
+***********************************************************************/
+static void Release_Pes(PesBuffer* pes);
+
+/***********************************************************************
+* @brief    Splits the PES packet into segments of the selected pages
+*
+* @param    [in] pes - complete PES packet
+* @param    [in] compositionPageId - page of the subtitles
+* @param    [in] ancillaryPageId - shared page
+*
+***********************************************************************/
+static void Decode_Pes(const PesBuffer* pes, uint16_t compositionPageId, uint16_t ancillaryPageId);
+
+/***********************************************************************
+* @brief    Decodes one segment, after its header
+*
+* @param    [in] type - segment_type
+* @param    [in] data - segment data
+* @param    [in] length - segment_length
+* @param    [in] pts - PTS of the PES packet
+*
+***********************************************************************/
+static void Decode_Segment(uint8_t type, const uint8_t* data, uint32_t length, uint64_t pts);
+
+/***********************************************************************
+* @brief    Starts a display set, and a new epoch on a mode change
+*
+***********************************************************************/
+static void Decode_Page_Composition(const uint8_t* data, uint32_t length, uint64_t pts);
+
+/***********************************************************************
+* @brief    Creates or updates a region and its object list
+*
+***********************************************************************/
+static void Decode_Region_Composition(const uint8_t* data, uint32_t length);
+
+/***********************************************************************
+* @brief    Updates the entries of a CLUT
+*
+***********************************************************************/
+static void Decode_Clut_Definition(const uint8_t* data, uint32_t length);
+
+/***********************************************************************
+* @brief    Draws an object into every region which places it
+*
+***********************************************************************/
+static void Decode_Object_Data(const uint8_t* data, uint32_t length);
+
+/***********************************************************************
+* @brief    Sets the size of the display and of its window
+*
+***********************************************************************/
+static void Decode_Display_Definition(const uint8_t* data, uint32_t length);
+
+/***********************************************************************
+* @brief    Decodes the pixel-data sub-blocks of one field of an object
+*
+* @param    [in] region - region the object is drawn into
+* @param    [in] x - object position in the region
+* @param    [in] y - first line of the field in the region
+* @param    [in] data - pixel-data sub-blocks
+* @param    [in] length - bytes of the sub-blocks
+* @param    [in] nonModifying - pixel code 1 leaves the region as it is
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - unknown data type
+*
+***********************************************************************/
+static int32_t Decode_Pixel_Data(SubtitleRegion* region, int32_t x, int32_t y, const uint8_t* data,
+								 uint32_t length, uint8_t nonModifying);
+
+/***********************************************************************
+* @brief    Decodes a 2, 4 or 8 bit pixel code string up to its end code
+*
+* @param    [in] reader - bits after the data_type
+* @param    [in] bits - bits of the pixel codes
+* @param    [in] map - pixel codes of the region depth, NULL if the codes
+* 					   are of the region depth
+* @param    [in/out] x - column of the next pixel in the region
+*
+***********************************************************************/
+static void Decode_Pixel_String(SubtitleRegion* region, BitReader* reader, uint8_t bits, const uint8_t* map,
+								int32_t* x, int32_t y, uint8_t nonModifying);
+
+/***********************************************************************
+* @brief    Composes the regions of the display set into a free overlay
+* 			and queues it for its PTS
+*
+***********************************************************************/
+static void Compose_Display_Set();
+
+/***********************************************************************
+* @brief    Forgets the regions, CLUTs and objects of the epoch. The
+* 			display definition is kept, it may precede the page
+* 			composition which starts the epoch
+*
+***********************************************************************/
+static void Reset_Epoch();
+
+/***********************************************************************
+* @brief    Returns to the display of a page without a display definition
+*
+***********************************************************************/
+static void Reset_Display_Definition();
+
+/***********************************************************************
+* @brief    Returns microseconds until the PTS is due, negative when it
+* 			is late, 0 without a clock or when the PTS is too far ahead
+*
+***********************************************************************/
+static int64_t Time_Until(uint64_t pts);
+
+/***********************************************************************
+* @brief    Sets the CLUT to the default entries
+*
+***********************************************************************/
+static void Default_Clut(SubtitleClut* clut);
+
+/***********************************************************************
+* @brief    Converts a CLUT entry to ARGB, Y of 0 is transparent
+*
+***********************************************************************/
+static uint32_t Ycrcbt_To_Argb(uint8_t y, uint8_t cr, uint8_t cb, uint8_t t);
+
+static SubtitleRegion* Find_Region(uint8_t id);
+static SubtitleClut* Find_Clut(uint8_t id);
+static uint32_t Read_Bits(BitReader* reader, uint32_t count);
+
+/***********************************************************************
+* @brief    Returns microseconds of the monotonic clock
+*
+***********************************************************************/
+static uint64_t Now();
+
+/* Shared by the demux thread and the decoding thread */
+static pthread_mutex_t subtitleMutex;
+static pthread_cond_t subtitleCondition;
+/* Signalled when a PES buffer or an overlay is freed, for the blocking demux thread and the deinitialization */
+static pthread_cond_t freeCondition;
+static uint8_t blocking = 0;
+static PesBuffer* pesBuffers = NULL;
+static PesBuffer* freePes[SUBTITLE_PES_BUFFERS];
+static uint32_t numOfFreePes = 0;
+static PesBuffer* readyPes[SUBTITLE_PES_BUFFERS];
+static uint32_t readyHead = 0;
+static uint32_t numOfReadyPes = 0;
+static uint16_t selectedCompositionPage = 0;
+static uint16_t selectedAncillaryPage = 0;
+/* 0 when the selection only removes the subtitles of the previous channel */
+static uint8_t selectedDecoding = 0;
+static uint8_t pageSelected = 0;
+static uint8_t running = 0;
+static pthread_t subtitleThread;
+static Subtitle_Clock systemClock = NULL;
+static Subtitle_Display_Callback displayCallback = NULL;
+static void* displayArgument = NULL;
+static SubtitleStatistics statistics;
+
+/* PES state, only the demux thread changes it */
+static uint16_t subtitlePID = 0;
+static uint8_t lastCC = CC_UNKNOWN;
+static PesBuffer* filling = NULL;
+
+/* Epoch and overlays, only the decoding thread uses them */
+static uint8_t* regionPool = NULL;
+static uint32_t regionPoolUsed = 0;
+static SubtitleRegion regions[SUBTITLE_MAX_REGIONS];
+static uint32_t numOfRegions = 0;
+static SubtitleClut cluts[SUBTITLE_MAX_CLUTS];
+static uint32_t numOfCluts = 0;
+static SubtitleClut defaultClut;
+static int32_t displayWidth = SUBTITLE_DEFAULT_DISPLAY_WIDTH;
+static int32_t displayHeight = SUBTITLE_DEFAULT_DISPLAY_HEIGHT;
+static int32_t windowX = 0;
+static int32_t windowY = 0;
+/* Decoding starts at an acquisition point or a mode change */
+static uint8_t acquired = 0;
+static uint8_t pageVersion = NO_VERSION;
+/* Segments of a repeated display set are skipped */
+static uint8_t repeated = 0;
+static DisplaySet displaySet;
+static SubtitleOverlay overlays[SUBTITLE_OVERLAYS];
+/* Receiver releases overlays from its own thread, the free ones are guarded by the mutex */
+static SubtitleOverlay* freeOverlays[SUBTITLE_OVERLAYS];
+static uint32_t numOfFreeOverlays = 0;
+/* Overlays passed to the display callback and not released yet */
+static uint32_t numOfHeldOverlays = 0;
+/* Waiting for their PTS, in the order they were composed */
+static SubtitleOverlay* pendingOverlays[SUBTITLE_OVERLAYS];
+static uint32_t pendingHead = 0;
+static uint32_t numOfPendingOverlays = 0;
+/* Monotonic time the shown display set times out at, 0 if none */
+static uint64_t shownDeadline = 0;
+static uint8_t shown = 0;
+
+/* Map tables used when an object does not send its own */
+static const uint8_t defaultMap2To4[4] = {0x0, 0x7, 0x8, 0xF};
+static const uint8_t defaultMap2To8[4] = {0x00, 0x77, 0x88, 0xFF};
+static const uint8_t defaultMap4To8[16] = {
+	0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF
+};
+
+int32_t Subtitle_Init(Subtitle_Clock clock, Subtitle_Display_Callback callback, void* argument)
+{
+	pthread_condattr_t conditionAttributes;
+	uint32_t i;
+
+	if (callback == NULL)
+	{
+		printf("%s(%d): Invalid arguments!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+
+	/* Everything the decoder needs is allocated here, decoding does not allocate */
+	pesBuffers = (PesBuffer*)malloc(sizeof(PesBuffer) * SUBTITLE_PES_BUFFERS);
+	regionPool = (uint8_t*)malloc(SUBTITLE_REGION_POOL_SIZE);
+	for (i = 0; i < SUBTITLE_OVERLAYS; i++)
+	{
+		overlays[i].pixels = (uint32_t*)malloc(SUBTITLE_OVERLAY_PIXELS * sizeof(uint32_t));
+		if (overlays[i].pixels == NULL)
+		{
+			break;
+		}
+	}
+	if (pesBuffers == NULL || regionPool == NULL || i < SUBTITLE_OVERLAYS)
+	{
+		printf("%s(%d): Error allocating subtitle buffers!\n", __FUNCTION__, __LINE__);
+		Subtitle_Deinit();
+		return EXIT_FAILURE;
+	}
+
+	if (pthread_mutex_init(&subtitleMutex, NULL))
+	{
+		printf("%s(%d): Error initializing subtitle mutex!\n", __FUNCTION__, __LINE__);
+		Subtitle_Deinit();
+		return EXIT_FAILURE;
+	}
+	pthread_condattr_init(&conditionAttributes);
+	pthread_condattr_setclock(&conditionAttributes, CLOCK_MONOTONIC);
+	if (pthread_cond_init(&subtitleCondition, &conditionAttributes))
+	{
+		printf("%s(%d): Error initializing subtitle condition!\n", __FUNCTION__, __LINE__);
+		pthread_condattr_destroy(&conditionAttributes);
+		pthread_mutex_destroy(&subtitleMutex);
+		Subtitle_Deinit();
+		return EXIT_FAILURE;
+	}
+	pthread_condattr_destroy(&conditionAttributes);
+	if (pthread_cond_init(&freeCondition, NULL))
+	{
+		printf("%s(%d): Error initializing subtitle condition!\n", __FUNCTION__, __LINE__);
+		pthread_cond_destroy(&subtitleCondition);
+		pthread_mutex_destroy(&subtitleMutex);
+		Subtitle_Deinit();
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < SUBTITLE_PES_BUFFERS; i++)
+	{
+		freePes[i] = &pesBuffers[i];
+	}
+	numOfFreePes = SUBTITLE_PES_BUFFERS;
+	readyHead = 0;
+	numOfReadyPes = 0;
+	for (i = 0; i < SUBTITLE_OVERLAYS; i++)
+	{
+		freeOverlays[i] = &overlays[i];
+	}
+	numOfFreeOverlays = SUBTITLE_OVERLAYS;
+	numOfHeldOverlays = 0;
+	pendingHead = 0;
+	numOfPendingOverlays = 0;
+	shownDeadline = 0;
+	shown = 0;
+
+	Default_Clut(&defaultClut);
+	Reset_Epoch();
+	Reset_Display_Definition();
+	memset(&statistics, 0, sizeof(statistics));
+	subtitlePID = 0;
+	lastCC = CC_UNKNOWN;
+	filling = NULL;
+	selectedDecoding = 0;
+	pageSelected = 0;
+	blocking = 0;
+	systemClock = clock;
+	displayCallback = callback;
+	displayArgument = argument;
+
+	running = 1;
+	if (pthread_create(&subtitleThread, NULL, Subtitle_Task, NULL))
+	{
+		printf("%s(%d): Error creating subtitle thread!\n", __FUNCTION__, __LINE__);
+		running = 0;
+		pthread_cond_destroy(&freeCondition);
+		pthread_cond_destroy(&subtitleCondition);
+		pthread_mutex_destroy(&subtitleMutex);
+		Subtitle_Deinit();
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+int32_t Subtitle_Deinit()
+{
+	uint32_t i;
+
+	if (running)
+	{
+		pthread_mutex_lock(&subtitleMutex);
+		running = 0;
+		pthread_cond_signal(&subtitleCondition);
+		pthread_cond_broadcast(&freeCondition);
+		pthread_mutex_unlock(&subtitleMutex);
+		pthread_join(subtitleThread, NULL);
+		/* Receiver may still draw the last overlays */
+		pthread_mutex_lock(&subtitleMutex);
+		while (numOfHeldOverlays > 0)
+		{
+			pthread_cond_wait(&freeCondition, &subtitleMutex);
+		}
+		pthread_mutex_unlock(&subtitleMutex);
+		pthread_cond_destroy(&freeCondition);
+		pthread_cond_destroy(&subtitleCondition);
+		pthread_mutex_destroy(&subtitleMutex);
+	}
+
+	free(pesBuffers);
+	pesBuffers = NULL;
+	free(regionPool);
+	regionPool = NULL;
+	for (i = 0; i < SUBTITLE_OVERLAYS; i++)
+	{
+		free(overlays[i].pixels);
+		overlays[i].pixels = NULL;
+	}
+	filling = NULL;
+	return EXIT_SUCCESS;
+}
+
+void Subtitle_Release_Overlay(const SubtitleOverlay* overlay)
+{
+	pthread_mutex_lock(&subtitleMutex);
+	freeOverlays[numOfFreeOverlays++] = &overlays[overlay - overlays];
+	numOfHeldOverlays--;
+	pthread_cond_broadcast(&freeCondition);
+	pthread_mutex_unlock(&subtitleMutex);
+}
+
+void Subtitle_Set_Blocking(uint8_t enable)
+{
+	if (pesBuffers == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&subtitleMutex);
+	blocking = enable;
+	pthread_cond_broadcast(&freeCondition);
+	pthread_mutex_unlock(&subtitleMutex);
+}
+
+void Subtitle_Select_Page(uint16_t compositionPageId, uint16_t ancillaryPageId)
+{
+	if (pesBuffers == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&subtitleMutex);
+	selectedCompositionPage = compositionPageId;
+	selectedAncillaryPage = ancillaryPageId;
+	selectedDecoding = 1;
+	pageSelected = 1;
+	pthread_cond_signal(&subtitleCondition);
+	pthread_mutex_unlock(&subtitleMutex);
+}
+
+void Subtitle_Deselect_Page()
+{
+	if (pesBuffers == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&subtitleMutex);
+	selectedDecoding = 0;
+	pageSelected = 1;
+	pthread_cond_signal(&subtitleCondition);
+	pthread_mutex_unlock(&subtitleMutex);
+}
+
+int32_t Subtitle_Packet_Received(const uint8_t* packet, uint16_t pid, void* userData)
+{
+	uint8_t adaptationFieldControl;
+	uint8_t continuityCounter;
+	uint32_t offset = 4;
+	uint32_t size;
+
+	if (pesBuffers == NULL)
+	{
+		return EXIT_SUCCESS;
+	}
+
+	/* Subtitles of another service, the PES being collected is not complete */
+	if (pid != subtitlePID)
+	{
+		if (filling != NULL)
+		{
+			Release_Pes(filling);
+			filling = NULL;
+		}
+		lastCC = CC_UNKNOWN;
+		subtitlePID = pid;
+	}
+
+	/* transport_error_indicator, the PES is lost */
+	if (packet[1] & 0x80)
+	{
+		if (filling != NULL)
+		{
+			Release_Pes(filling);
+			filling = NULL;
+		}
+		lastCC = CC_UNKNOWN;
+		return EXIT_SUCCESS;
+	}
+
+	adaptationFieldControl = (packet[3] >> 4) & 0x03;
+	continuityCounter = packet[3] & 0x0F;
+	if (!(adaptationFieldControl & 0x01))
+	{
+		return EXIT_SUCCESS;
+	}
+	if (lastCC != CC_UNKNOWN)
+	{
+		if (continuityCounter == lastCC)
+		{
+			return EXIT_SUCCESS;
+		}
+		if (continuityCounter != ((lastCC + 1) & 0x0F))
+		{
+			__atomic_add_fetch(&statistics.continuityErrors, 1, __ATOMIC_RELAXED);
+			if (filling != NULL)
+			{
+				Release_Pes(filling);
+				filling = NULL;
+			}
+		}
+	}
+	lastCC = continuityCounter;
+
+	if (adaptationFieldControl & 0x02)
+	{
+		offset += 1 + packet[4];
+		if (offset >= TS_PACKET_SIZE)
+		{
+			return EXIT_SUCCESS;
+		}
+	}
+	size = TS_PACKET_SIZE - offset;
+
+	if (packet[1] & 0x40)
+	{
+		/* PES without a length ends where the next one starts */
+		if (filling != NULL)
+		{
+			if (filling->length == 0)
+			{
+				Queue_Pes(filling);
+			}
+			else
+			{
+				Release_Pes(filling);
+			}
+		}
+		filling = Take_Pes();
+		if (filling == NULL)
+		{
+			__atomic_add_fetch(&statistics.droppedPes, 1, __ATOMIC_RELAXED);
+			return EXIT_SUCCESS;
+		}
+		/* Start code, stream_id and PES_packet_length */
+		if (size < 6)
+		{
+			Release_Pes(filling);
+			filling = NULL;
+			return EXIT_SUCCESS;
+		}
+		filling->size = 0;
+		filling->length = (uint32_t)packet[offset + 4] << 8 | packet[offset + 5];
+		if (filling->length != 0)
+		{
+			filling->length += 6;
+		}
+	}
+	else if (filling == NULL)
+	{
+		return EXIT_SUCCESS;
+	}
+
+	if (filling->size + size > SUBTITLE_MAX_PES_SIZE)
+	{
+		Release_Pes(filling);
+		filling = NULL;
+		return EXIT_SUCCESS;
+	}
+	memcpy(filling->data + filling->size, packet + offset, size);
+	filling->size += size;
+
+	if (filling->length != 0 && filling->size >= filling->length)
+	{
+		Queue_Pes(filling);
+		filling = NULL;
+	}
+	return EXIT_SUCCESS;
+}
+
+void Subtitle_Get_Statistics(SubtitleStatistics* outStatistics)
+{
+	outStatistics->pesPackets = __atomic_load_n(&statistics.pesPackets, __ATOMIC_RELAXED);
+	outStatistics->droppedPes = __atomic_load_n(&statistics.droppedPes, __ATOMIC_RELAXED);
+	outStatistics->continuityErrors = __atomic_load_n(&statistics.continuityErrors, __ATOMIC_RELAXED);
+	outStatistics->segments = __atomic_load_n(&statistics.segments, __ATOMIC_RELAXED);
+	outStatistics->segmentErrors = __atomic_load_n(&statistics.segmentErrors, __ATOMIC_RELAXED);
+	outStatistics->epochs = __atomic_load_n(&statistics.epochs, __ATOMIC_RELAXED);
+	outStatistics->displaySets = __atomic_load_n(&statistics.displaySets, __ATOMIC_RELAXED);
+	outStatistics->droppedDisplaySets = __atomic_load_n(&statistics.droppedDisplaySets, __ATOMIC_RELAXED);
+	outStatistics->maxDecodeTime = __atomic_load_n(&statistics.maxDecodeTime, __ATOMIC_RELAXED);
+	outStatistics->maxLateness = __atomic_load_n(&statistics.maxLateness, __ATOMIC_RELAXED);
+}
+
+void* Subtitle_Task()
+{
+	PesBuffer* pes;
+	SubtitleOverlay* overlay;
+	uint16_t compositionPageId = 0;
+	uint16_t ancillaryPageId = 0;
+	uint8_t decoding = 0;
+	uint8_t clear;
+	uint64_t start;
+	int64_t wait;
+	uint64_t now;
+	uint64_t deadline;
+	uint64_t lateness;
+	struct timespec timeout;
+
+	TRACE_THREAD_NAME("subtitle");
+	pthread_mutex_lock(&subtitleMutex);
+	while (1)
+	{
+		clear = 0;
+		if (pageSelected)
+		{
+			/* Display sets of the previous page are not shown any more */
+			pageSelected = 0;
+			compositionPageId = selectedCompositionPage;
+			ancillaryPageId = selectedAncillaryPage;
+			decoding = selectedDecoding;
+			Reset_Epoch();
+			Reset_Display_Definition();
+			while (numOfPendingOverlays > 0)
+			{
+				freeOverlays[numOfFreeOverlays++] = pendingOverlays[pendingHead];
+				pendingHead = (pendingHead + 1) % SUBTITLE_OVERLAYS;
+				numOfPendingOverlays--;
+			}
+			clear = shown;
+			/* PES packets queued before the selection are still decoded */
+			if (!clear)
+			{
+				continue;
+			}
+		}
+		/* A due display set is shown before more PES packets are decoded, which could replace it */
+		else if (numOfReadyPes > 0
+				 && (numOfPendingOverlays == 0 || Time_Until(pendingOverlays[pendingHead]->pts) > 0))
+		{
+			pes = readyPes[readyHead];
+			readyHead = (readyHead + 1) % SUBTITLE_PES_BUFFERS;
+			numOfReadyPes--;
+			pthread_mutex_unlock(&subtitleMutex);
+
+			if (decoding)
+			{
+				start = Now();
+				TRACE_BEGIN("subtitle PES");
+				Decode_Pes(pes, compositionPageId, ancillaryPageId);
+				TRACE_END_VALUE("subtitle PES", pes->size);
+				start = Now() - start;
+				if (start > statistics.maxDecodeTime)
+				{
+					__atomic_store_n(&statistics.maxDecodeTime, (uint32_t)start, __ATOMIC_RELAXED);
+				}
+			}
+			Release_Pes(pes);
+			pthread_mutex_lock(&subtitleMutex);
+			continue;
+		}
+
+		/* Oldest display set first, a later one can not be due before it */
+		overlay = NULL;
+		wait = 0;
+		if (!clear && numOfPendingOverlays > 0)
+		{
+			wait = Time_Until(pendingOverlays[pendingHead]->pts);
+			if (wait <= 0)
+			{
+				overlay = pendingOverlays[pendingHead];
+				pendingHead = (pendingHead + 1) % SUBTITLE_OVERLAYS;
+				numOfPendingOverlays--;
+			}
+		}
+		now = Now();
+		if (!clear && overlay == NULL && shownDeadline != 0 && now >= shownDeadline)
+		{
+			clear = 1;
+		}
+
+		if (overlay != NULL || clear)
+		{
+			/* Receiver gives the overlay back when it does not need the pixels any more */
+			if (overlay != NULL && overlay->width > 0)
+			{
+				numOfHeldOverlays++;
+			}
+			pthread_mutex_unlock(&subtitleMutex);
+			if (overlay != NULL)
+			{
+				lateness = (wait < 0) ? -wait : 0;
+				TRACE_INSTANT("subtitle display set", overlay->width * overlay->height);
+				/* Empty display set removes the subtitles */
+				displayCallback(overlay->width > 0 ? overlay : NULL, displayArgument);
+				shown = (overlay->width > 0);
+				shownDeadline = (shown && overlay->timeout > 0) ? Now() + overlay->timeout * 1000000ULL : 0;
+				lateness += Now() - now;
+				if (lateness > statistics.maxLateness)
+				{
+					__atomic_store_n(&statistics.maxLateness, (uint32_t)lateness, __ATOMIC_RELAXED);
+				}
+			}
+			else
+			{
+				displayCallback(NULL, displayArgument);
+				shown = 0;
+				shownDeadline = 0;
+			}
+			pthread_mutex_lock(&subtitleMutex);
+			if (overlay != NULL && overlay->width == 0)
+			{
+				freeOverlays[numOfFreeOverlays++] = overlay;
+			}
+			continue;
+		}
+
+		/* Queued PES packets and the display sets which are due are finished before it stops */
+		if (!running)
+		{
+			break;
+		}
+
+		/* Sleeps until the next PTS or timeout, new PES packets wake it up */
+		deadline = 0;
+		if (numOfPendingOverlays > 0)
+		{
+			deadline = now + wait;
+		}
+		if (shownDeadline != 0 && (deadline == 0 || shownDeadline < deadline))
+		{
+			deadline = shownDeadline;
+		}
+		if (deadline == 0)
+		{
+			pthread_cond_wait(&subtitleCondition, &subtitleMutex);
+		}
+		else
+		{
+			timeout.tv_sec = deadline / 1000000;
+			timeout.tv_nsec = (deadline % 1000000) * 1000;
+			pthread_cond_timedwait(&subtitleCondition, &subtitleMutex, &timeout);
+		}
+	}
+	pthread_mutex_unlock(&subtitleMutex);
+	return NULL;
+}
+
+PesBuffer* Take_Pes()
+{
+	PesBuffer* pes = NULL;
+
+	pthread_mutex_lock(&subtitleMutex);
+	/* File input waits for the decoder instead of losing the PES */
+	while (blocking && running && numOfFreePes == 0)
+	{
+		pthread_cond_wait(&freeCondition, &subtitleMutex);
+	}
+	if (numOfFreePes > 0)
+	{
+		pes = freePes[--numOfFreePes];
+	}
+	pthread_mutex_unlock(&subtitleMutex);
+	return pes;
+}
+
+void Queue_Pes(PesBuffer* pes)
+{
+	__atomic_add_fetch(&statistics.pesPackets, 1, __ATOMIC_RELAXED);
+	pthread_mutex_lock(&subtitleMutex);
+	readyPes[(readyHead + numOfReadyPes) % SUBTITLE_PES_BUFFERS] = pes;
+	numOfReadyPes++;
+	pthread_cond_signal(&subtitleCondition);
+	pthread_mutex_unlock(&subtitleMutex);
+}
+
+void Release_Pes(PesBuffer* pes)
+{
+	pthread_mutex_lock(&subtitleMutex);
+	freePes[numOfFreePes++] = pes;
+	pthread_cond_signal(&freeCondition);
+	pthread_mutex_unlock(&subtitleMutex);
+}
+
+void Decode_Pes(const PesBuffer* pes, uint16_t compositionPageId, uint16_t ancillaryPageId)
+{
+	const uint8_t* data = pes->data;
+	uint32_t size = (pes->length != 0 && pes->length < pes->size) ? pes->length : pes->size;
+	uint64_t pts = 0;
+	uint32_t offset;
+	uint16_t pageId;
+	uint32_t segmentLength;
+
+	/*
+	 * PES header:					bit
+	 * packet_start_code_prefix		24
+	 * stream_id					08
+	 * PES_packet_length			16
+	 * flags						16, PTS_DTS_flags are the top bits of the second byte
+	 * PES_header_data_length		08
+	 */
+	if (size < 9 || data[0] != 0x00 || data[1] != 0x00 || data[2] != 0x01 || data[3] != SUBTITLE_STREAM_ID)
+	{
+		return;
+	}
+	if ((data[7] & 0x80) && size >= 14)
+	{
+		pts = (uint64_t)((data[9] >> 1) & 0x07) << 30 | (uint64_t)data[10] << 22 | (uint64_t)(data[11] >> 1) << 15
+			  | (uint64_t)data[12] << 7 | data[13] >> 1;
+	}
+	offset = 9 + data[8];
+
+	/* data_identifier and subtitle_stream_id */
+	if (offset + 2 > size || data[offset] != SUBTITLE_DATA_IDENTIFIER || data[offset + 1] != SUBTITLE_STREAM_IDENTIFIER)
+	{
+		return;
+	}
+	offset += 2;
+
+	/* Segments until the end_of_PES_data_field_marker */
+	while (offset + SEGMENT_HEADER_SIZE <= size && data[offset] == SUBTITLE_SYNC_BYTE)
+	{
+		pageId = (uint16_t)data[offset + 2] << 8 | data[offset + 3];
+		segmentLength = (uint32_t)data[offset + 4] << 8 | data[offset + 5];
+		if (offset + SEGMENT_HEADER_SIZE + segmentLength > size)
+		{
+			__atomic_add_fetch(&statistics.segmentErrors, 1, __ATOMIC_RELAXED);
+			break;
+		}
+		if (pageId == compositionPageId || pageId == ancillaryPageId)
+		{
+			__atomic_add_fetch(&statistics.segments, 1, __ATOMIC_RELAXED);
+			Decode_Segment(data[offset + 1], data + offset + SEGMENT_HEADER_SIZE, segmentLength, pts);
+		}
+		offset += SEGMENT_HEADER_SIZE + segmentLength;
+	}
+
+	/* Display set without an end segment ends with its PES packet */
+	if (displaySet.started)
+	{
+		Compose_Display_Set();
+	}
+}
+
+void Decode_Segment(uint8_t type, const uint8_t* data, uint32_t length, uint64_t pts)
+{
+	if (type == SEGMENT_PAGE_COMPOSITION)
+	{
+		Decode_Page_Composition(data, length, pts);
+		return;
+	}
+	/* Display definition comes before the page composition, it is needed by the epoch it starts */
+	if (type == SEGMENT_DISPLAY_DEFINITION)
+	{
+		Decode_Display_Definition(data, length);
+		return;
+	}
+	/* Until the first epoch starts, and while a display set is repeated, there is nothing to update */
+	if (!acquired || repeated)
+	{
+		return;
+	}
+
+	switch (type)
+	{
+		case SEGMENT_REGION_COMPOSITION:
+			Decode_Region_Composition(data, length);
+			break;
+		case SEGMENT_CLUT_DEFINITION:
+			Decode_Clut_Definition(data, length);
+			break;
+		case SEGMENT_OBJECT_DATA:
+			Decode_Object_Data(data, length);
+			break;
+		case SEGMENT_END_OF_DISPLAY_SET:
+			if (displaySet.started)
+			{
+				Compose_Display_Set();
+			}
+			break;
+	}
+}
+
+void Decode_Page_Composition(const uint8_t* data, uint32_t length, uint64_t pts)
+{
+	uint8_t version;
+	uint8_t state;
+	uint32_t offset;
+	PageRegion* pageRegion;
+
+	/*
+	 * page_time_out			08
+	 * page_version_number		04
+	 * page_state				02
+	 * reserved					02
+	 * regions of 6 bytes:		region_id 8, reserved 8, horizontal and vertical address 16
+	 */
+	if (length < 2)
+	{
+		__atomic_add_fetch(&statistics.segmentErrors, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	version = data[1] >> 4;
+	state = (data[1] >> 2) & 0x03;
+
+	/* Previous display set sent no end segment */
+	if (displaySet.started)
+	{
+		Compose_Display_Set();
+	}
+
+	/* Acquisition points repeat the page for receivers which start there */
+	repeated = 0;
+	if (state == PAGE_STATE_MODE_CHANGE || (state == PAGE_STATE_ACQUISITION_POINT && !acquired))
+	{
+		Reset_Epoch();
+		acquired = 1;
+		__atomic_add_fetch(&statistics.epochs, 1, __ATOMIC_RELAXED);
+	}
+	else if (!acquired)
+	{
+		return;
+	}
+	else if (version == pageVersion)
+	{
+		repeated = 1;
+		return;
+	}
+	pageVersion = version;
+
+	displaySet.started = 1;
+	displaySet.pts = pts;
+	displaySet.timeout = data[0];
+	displaySet.numOfRegions = 0;
+	for (offset = 2; offset + 6 <= length && displaySet.numOfRegions < SUBTITLE_MAX_REGIONS; offset += 6)
+	{
+		pageRegion = &displaySet.regions[displaySet.numOfRegions++];
+		pageRegion->regionId = data[offset];
+		pageRegion->x = (int32_t)data[offset + 2] << 8 | data[offset + 3];
+		pageRegion->y = (int32_t)data[offset + 4] << 8 | data[offset + 5];
+	}
+}
+
+void Decode_Region_Composition(const uint8_t* data, uint32_t length)
+{
+	SubtitleRegion* region;
+	RegionObject* object;
+	uint8_t version;
+	uint8_t fill;
+	int32_t width;
+	int32_t height;
+	uint8_t depth;
+	uint8_t fillCode;
+	uint32_t offset;
+
+	/*
+	 * region_id								08
+	 * region_version_number					04
+	 * region_fill_flag							01
+	 * reserved									03
+	 * region_width								16
+	 * region_height							16
+	 * region_level_of_compatibility			03
+	 * region_depth								03
+	 * reserved									02
+	 * CLUT_id									08
+	 * region_8-bit_pixel_code					08
+	 * region_4-bit_pixel-code					04
+	 * region_2-bit_pixel-code					02
+	 * reserved									02
+	 */
+	if (length < 10)
+	{
+		__atomic_add_fetch(&statistics.segmentErrors, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	version = data[1] >> 4;
+	fill = (data[1] >> 3) & 0x01;
+	width = (int32_t)data[2] << 8 | data[3];
+	height = (int32_t)data[4] << 8 | data[5];
+	depth = (data[6] >> 2) & 0x07;
+	if (width == 0 || height == 0 || depth < REGION_DEPTH_2_BIT || depth > REGION_DEPTH_8_BIT)
+	{
+		__atomic_add_fetch(&statistics.segmentErrors, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	region = Find_Region(data[0]);
+	if (region == NULL)
+	{
+		/* Region lives until the end of the epoch, its pixels are taken from the pool */
+		if (numOfRegions == SUBTITLE_MAX_REGIONS || regionPoolUsed + width * height > SUBTITLE_REGION_POOL_SIZE)
+		{
+			__atomic_add_fetch(&statistics.segmentErrors, 1, __ATOMIC_RELAXED);
+			return;
+		}
+		region = &regions[numOfRegions++];
+		region->id = data[0];
+		region->version = NO_VERSION;
+		region->width = width;
+		region->height = height;
+		region->pixels = regionPool + regionPoolUsed;
+		regionPoolUsed += width * height;
+		fill = 1;
+	}
+	else if (region->width != width || region->height != height)
+	{
+		/* Size is fixed for the epoch */
+		__atomic_add_fetch(&statistics.segmentErrors, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	if (region->version == version)
+	{
+		return;
+	}
+	region->version = version;
+	region->depth = depth;
+	region->clutId = data[7];
+
+	if (fill)
+	{
+		fillCode = (depth == REGION_DEPTH_8_BIT) ? data[8]
+				   : (depth == REGION_DEPTH_4_BIT) ? data[9] >> 4 : (data[9] >> 2) & 0x03;
+		memset(region->pixels, fillCode, width * height);
+	}
+
+	/*
+	 * Objects of 6 bytes, 8 for character objects:
+	 * object_id 16, object_type 2, object_provider_flag 2,
+	 * object_horizontal_position 12, reserved 4, object_vertical_position 12
+	 */
+	region->numOfObjects = 0;
+	for (offset = 10; offset + 6 <= length && region->numOfObjects < SUBTITLE_MAX_REGION_OBJECTS; )
+	{
+		object = &region->objects[region->numOfObjects++];
+		object->objectId = (uint16_t)data[offset] << 8 | data[offset + 1];
+		object->objectType = data[offset + 2] >> 6;
+		object->x = (int32_t)(data[offset + 2] & 0x0F) << 8 | data[offset + 3];
+		object->y = (int32_t)(data[offset + 4] & 0x0F) << 8 | data[offset + 5];
+		offset += (object->objectType == 1 || object->objectType == 2) ? 8 : 6;
+	}
+}
+
+void Decode_Clut_Definition(const uint8_t* data, uint32_t length)
+{
+	SubtitleClut* clut;
+	uint8_t version;
+	uint8_t entryId;
+	uint8_t flags;
+	uint32_t color;
+	uint32_t offset;
+
+	if (length < 2)
+	{
+		__atomic_add_fetch(&statistics.segmentErrors, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	version = data[1] >> 4;
+
+	clut = Find_Clut(data[0]);
+	if (clut == NULL)
+	{
+		if (numOfCluts == SUBTITLE_MAX_CLUTS)
+		{
+			__atomic_add_fetch(&statistics.segmentErrors, 1, __ATOMIC_RELAXED);
+			return;
+		}
+		/* Entries which are not sent keep their default colours */
+		clut = &cluts[numOfCluts++];
+		*clut = defaultClut;
+		clut->id = data[0];
+	}
+	if (clut->version == version)
+	{
+		return;
+	}
+	clut->version = version;
+
+	/*
+	 * CLUT_entry_id 8, 2-bit, 4-bit and 8-bit entry flags 3, reserved 4,
+	 * full_range_flag 1, then Y, Cr, Cb and T of 8 bits, or of 6, 4, 4
+	 * and 2 bits without the full range
+	 */
+	for (offset = 2; offset + 4 <= length; )
+	{
+		entryId = data[offset];
+		flags = data[offset + 1];
+		if (flags & CLUT_ENTRY_FULL_RANGE)
+		{
+			if (offset + 6 > length)
+			{
+				break;
+			}
+			color = Ycrcbt_To_Argb(data[offset + 2], data[offset + 3], data[offset + 4], data[offset + 5]);
+			offset += 6;
+		}
+		else
+		{
+			color = Ycrcbt_To_Argb(data[offset + 2] & 0xFC, ((data[offset + 2] << 6) | (data[offset + 3] >> 2)) & 0xF0,
+								   (data[offset + 3] << 2) & 0xF0, (data[offset + 3] & 0x03) * 0x55);
+			offset += 4;
+		}
+		if ((flags & CLUT_ENTRY_2_BIT) && entryId < 4)
+		{
+			clut->entries2[entryId] = color;
+		}
+		if ((flags & CLUT_ENTRY_4_BIT) && entryId < 16)
+		{
+			clut->entries4[entryId] = color;
+		}
+		if (flags & CLUT_ENTRY_8_BIT)
+		{
+			clut->entries8[entryId] = color;
+		}
+	}
+}
+
+void Decode_Object_Data(const uint8_t* data, uint32_t length)
+{
+	uint16_t objectId;
+	uint8_t codingMethod;
+	uint8_t nonModifying;
+	uint32_t topLength;
+	uint32_t bottomLength;
+	const uint8_t* top;
+	const uint8_t* bottom;
+	SubtitleRegion* region;
+	uint32_t i;
+	uint32_t j;
+
+	/*
+	 * object_id						16
+	 * object_version_number			04
+	 * object_coding_method				02
+	 * non_modifying_colour_flag		01
+	 * reserved							01
+	 * top_field_data_block_length		16
+	 * bottom_field_data_block_length	16
+	 */
+	if (length < 3)
+	{
+		__atomic_add_fetch(&statistics.segmentErrors, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	objectId = (uint16_t)data[0] << 8 | data[1];
+	codingMethod = (data[2] >> 2) & 0x03;
+	nonModifying = (data[2] >> 1) & 0x01;
+	/* Character objects need the fonts of the receiver, they are not drawn */
+	if (codingMethod != OBJECT_CODING_PIXELS)
+	{
+		return;
+	}
+	if (length < 7)
+	{
+		__atomic_add_fetch(&statistics.segmentErrors, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	topLength = (uint32_t)data[3] << 8 | data[4];
+	bottomLength = (uint32_t)data[5] << 8 | data[6];
+	if (7 + topLength + bottomLength > length)
+	{
+		__atomic_add_fetch(&statistics.segmentErrors, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	top = data + 7;
+	/* Without a bottom field the top field is repeated */
+	bottom = bottomLength ? top + topLength : top;
+	if (bottomLength == 0)
+	{
+		bottomLength = topLength;
+	}
+
+	/* Objects are drawn where the regions of the epoch place them */
+	for (i = 0; i < numOfRegions; i++)
+	{
+		region = &regions[i];
+		for (j = 0; j < region->numOfObjects; j++)
+		{
+			if (region->objects[j].objectId != objectId || region->objects[j].objectType != OBJECT_TYPE_BITMAP)
+			{
+				continue;
+			}
+			if (Decode_Pixel_Data(region, region->objects[j].x, region->objects[j].y, top, topLength, nonModifying)
+				|| Decode_Pixel_Data(region, region->objects[j].x, region->objects[j].y + 1, bottom, bottomLength,
+									 nonModifying))
+			{
+				__atomic_add_fetch(&statistics.segmentErrors, 1, __ATOMIC_RELAXED);
+			}
+		}
+	}
+}
+
+void Decode_Display_Definition(const uint8_t* data, uint32_t length)
+{
+	/*
+	 * dds_version_number				04
+	 * display_window_flag				01
+	 * reserved							03
+	 * display_width, display_height	16, one less than the size
+	 * window minimum and maximum horizontal and vertical positions of 16 bits
+	 */
+	if (length < 5)
+	{
+		__atomic_add_fetch(&statistics.segmentErrors, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	displayWidth = ((int32_t)data[1] << 8 | data[2]) + 1;
+	displayHeight = ((int32_t)data[3] << 8 | data[4]) + 1;
+	windowX = 0;
+	windowY = 0;
+	if ((data[0] & 0x08) && length >= 13)
+	{
+		windowX = (int32_t)data[5] << 8 | data[6];
+		windowY = (int32_t)data[9] << 8 | data[10];
+	}
+}
+
+int32_t Decode_Pixel_Data(SubtitleRegion* region, int32_t x, int32_t y, const uint8_t* data,
+						  uint32_t length, uint8_t nonModifying)
+{
+	uint8_t map2To4[4];
+	uint8_t map2To8[4];
+	uint8_t map4To8[16];
+	BitReader reader;
+	int32_t column = x;
+	uint32_t offset = 0;
+	uint8_t type;
+	uint32_t i;
+
+	memcpy(map2To4, defaultMap2To4, sizeof(map2To4));
+	memcpy(map2To8, defaultMap2To8, sizeof(map2To8));
+	memcpy(map4To8, defaultMap4To8, sizeof(map4To8));
+
+	while (offset < length)
+	{
+		type = data[offset++];
+		reader.data = data + offset;
+		reader.size = length - offset;
+		reader.position = 0;
+		switch (type)
+		{
+			case PIXELS_2_BIT:
+				Decode_Pixel_String(region, &reader, 2, (region->depth == REGION_DEPTH_4_BIT) ? map2To4
+									: (region->depth == REGION_DEPTH_8_BIT) ? map2To8 : NULL, &column, y, nonModifying);
+				break;
+			case PIXELS_4_BIT:
+				Decode_Pixel_String(region, &reader, 4, (region->depth == REGION_DEPTH_8_BIT) ? map4To8 : NULL,
+									&column, y, nonModifying);
+				break;
+			case PIXELS_8_BIT:
+				Decode_Pixel_String(region, &reader, 8, NULL, &column, y, nonModifying);
+				break;
+			case MAP_TABLE_2_TO_4:
+				for (i = 0; i < 4; i++)
+				{
+					map2To4[i] = Read_Bits(&reader, 4);
+				}
+				break;
+			case MAP_TABLE_2_TO_8:
+				for (i = 0; i < 4; i++)
+				{
+					map2To8[i] = Read_Bits(&reader, 8);
+				}
+				break;
+			case MAP_TABLE_4_TO_8:
+				for (i = 0; i < 16; i++)
+				{
+					map4To8[i] = Read_Bits(&reader, 8);
+				}
+				break;
+			case END_OF_OBJECT_LINE:
+				/* Fields are interlaced, the next line of the field is two lines down */
+				column = x;
+				y += 2;
+				break;
+			default:
+				return EXIT_FAILURE;
+		}
+		/* Pixel code strings end on a byte boundary */
+		offset += (reader.position + 7) / 8;
+	}
+	return EXIT_SUCCESS;
+}
+
+void Decode_Pixel_String(SubtitleRegion* region, BitReader* reader, uint8_t bits, const uint8_t* map,
+						 int32_t* x, int32_t y, uint8_t nonModifying)
+{
+	uint32_t code;
+	uint32_t run;
+	uint32_t value;
+	uint8_t* row;
+	int32_t end;
+	int32_t i;
+
+	while (reader->position < reader->size * 8)
+	{
+		/* Codes which are not 0 are single pixels, 0 starts a run or the end of the string */
+		code = Read_Bits(reader, bits);
+		run = 1;
+		if (code == 0)
+		{
+			if (bits == 2)
+			{
+				if (Read_Bits(reader, 1))
+				{
+					run = 3 + Read_Bits(reader, 3);
+					code = Read_Bits(reader, 2);
+				}
+				else if (!Read_Bits(reader, 1))
+				{
+					switch (Read_Bits(reader, 2))
+					{
+						case 0:
+							return;
+						case 1:
+							run = 2;
+							break;
+						case 2:
+							run = 12 + Read_Bits(reader, 4);
+							code = Read_Bits(reader, 2);
+							break;
+						default:
+							run = 29 + Read_Bits(reader, 8);
+							code = Read_Bits(reader, 2);
+							break;
+					}
+				}
+			}
+			else if (bits == 4)
+			{
+				if (!Read_Bits(reader, 1))
+				{
+					value = Read_Bits(reader, 3);
+					if (value == 0)
+					{
+						return;
+					}
+					run = value + 2;
+				}
+				else if (!Read_Bits(reader, 1))
+				{
+					run = 4 + Read_Bits(reader, 2);
+					code = Read_Bits(reader, 4);
+				}
+				else
+				{
+					switch (Read_Bits(reader, 2))
+					{
+						case 0:
+							run = 1;
+							break;
+						case 1:
+							run = 2;
+							break;
+						case 2:
+							run = 9 + Read_Bits(reader, 4);
+							code = Read_Bits(reader, 4);
+							break;
+						default:
+							run = 25 + Read_Bits(reader, 8);
+							code = Read_Bits(reader, 4);
+							break;
+					}
+				}
+			}
+			else
+			{
+				if (!Read_Bits(reader, 1))
+				{
+					run = Read_Bits(reader, 7);
+					if (run == 0)
+					{
+						return;
+					}
+				}
+				else
+				{
+					run = Read_Bits(reader, 7);
+					code = Read_Bits(reader, 8);
+				}
+			}
+		}
+
+		/* Pixels outside of the region are dropped */
+		end = *x + (int32_t)run;
+		if (y >= 0 && y < region->height && !(nonModifying && code == NON_MODIFYING_PIXEL_CODE))
+		{
+			/* Codes of fewer bits are mapped, codes of more bits keep their upper bits */
+			if (map != NULL)
+			{
+				code = map[code];
+			}
+			else if (bits == 8 && region->depth != REGION_DEPTH_8_BIT)
+			{
+				code >>= (region->depth == REGION_DEPTH_4_BIT) ? 4 : 6;
+			}
+			else if (bits == 4 && region->depth == REGION_DEPTH_2_BIT)
+			{
+				code >>= 2;
+			}
+			row = region->pixels + y * region->width;
+			for (i = (*x > 0) ? *x : 0; i < end && i < region->width; i++)
+			{
+				row[i] = code;
+			}
+		}
+		*x = end;
+	}
+}
+
+void Compose_Display_Set()
+{
+	SubtitleOverlay* overlay;
+	SubtitleRegion* region;
+	SubtitleClut* clut;
+	const uint32_t* palette;
+	const uint8_t* source;
+	uint32_t* destination;
+	int32_t left = INT32_MAX;
+	int32_t top = INT32_MAX;
+	int32_t right = 0;
+	int32_t bottom = 0;
+	int32_t regionX;
+	int32_t regionY;
+	int32_t row;
+	int32_t column;
+	int32_t firstColumn;
+	int32_t lastColumn;
+	uint32_t i;
+
+	displaySet.started = 0;
+
+	/* All overlays wait for their PTS, the newest one is replaced */
+	overlay = NULL;
+	pthread_mutex_lock(&subtitleMutex);
+	if (numOfFreeOverlays > 0)
+	{
+		overlay = freeOverlays[--numOfFreeOverlays];
+	}
+	pthread_mutex_unlock(&subtitleMutex);
+	if (overlay == NULL && numOfPendingOverlays == 0)
+	{
+		/* Receiver holds all overlays */
+		__atomic_add_fetch(&statistics.droppedDisplaySets, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	else if (overlay == NULL)
+	{
+		overlay = pendingOverlays[(pendingHead + numOfPendingOverlays - 1) % SUBTITLE_OVERLAYS];
+		numOfPendingOverlays--;
+		__atomic_add_fetch(&statistics.droppedDisplaySets, 1, __ATOMIC_RELAXED);
+	}
+
+	/* Overlay is the bounding box of the regions on the display */
+	for (i = 0; i < displaySet.numOfRegions; i++)
+	{
+		region = Find_Region(displaySet.regions[i].regionId);
+		if (region == NULL)
+		{
+			continue;
+		}
+		regionX = windowX + displaySet.regions[i].x;
+		regionY = windowY + displaySet.regions[i].y;
+		left = (regionX < left) ? regionX : left;
+		top = (regionY < top) ? regionY : top;
+		right = (regionX + region->width > right) ? regionX + region->width : right;
+		bottom = (regionY + region->height > bottom) ? regionY + region->height : bottom;
+	}
+	right = (right > displayWidth) ? displayWidth : right;
+	bottom = (bottom > displayHeight) ? displayHeight : bottom;
+	overlay->pts = displaySet.pts;
+	overlay->timeout = displaySet.timeout;
+	overlay->displayWidth = displayWidth;
+	overlay->displayHeight = displayHeight;
+	overlay->x = 0;
+	overlay->y = 0;
+	overlay->width = 0;
+	overlay->height = 0;
+	if (left < right && top < bottom)
+	{
+		overlay->x = left;
+		overlay->y = top;
+		overlay->width = right - left;
+		/* Regions below the overlay buffer are cut off */
+		overlay->height = (bottom - top < SUBTITLE_OVERLAY_PIXELS / overlay->width) ? bottom - top
+						  : SUBTITLE_OVERLAY_PIXELS / overlay->width;
+		memset(overlay->pixels, 0, overlay->width * overlay->height * sizeof(uint32_t));
+	}
+
+	/* Pixel codes go through the CLUT of the region, with the entries of its depth */
+	for (i = 0; i < displaySet.numOfRegions && overlay->width > 0; i++)
+	{
+		region = Find_Region(displaySet.regions[i].regionId);
+		if (region == NULL)
+		{
+			continue;
+		}
+		clut = Find_Clut(region->clutId);
+		if (clut == NULL)
+		{
+			clut = &defaultClut;
+		}
+		palette = (region->depth == REGION_DEPTH_8_BIT) ? clut->entries8
+				  : (region->depth == REGION_DEPTH_4_BIT) ? clut->entries4 : clut->entries2;
+		regionX = windowX + displaySet.regions[i].x - overlay->x;
+		regionY = windowY + displaySet.regions[i].y - overlay->y;
+		firstColumn = (regionX < 0) ? -regionX : 0;
+		lastColumn = (regionX + region->width > overlay->width) ? overlay->width - regionX : region->width;
+		for (row = (regionY < 0) ? -regionY : 0; row < region->height && regionY + row < overlay->height; row++)
+		{
+			source = region->pixels + row * region->width;
+			destination = overlay->pixels + (regionY + row) * overlay->width + regionX;
+			for (column = firstColumn; column < lastColumn; column++)
+			{
+				destination[column] = palette[source[column]];
+			}
+		}
+	}
+
+	pendingOverlays[(pendingHead + numOfPendingOverlays) % SUBTITLE_OVERLAYS] = overlay;
+	numOfPendingOverlays++;
+	__atomic_add_fetch(&statistics.displaySets, 1, __ATOMIC_RELAXED);
+}
+
+void Reset_Epoch()
+{
+	numOfRegions = 0;
+	regionPoolUsed = 0;
+	numOfCluts = 0;
+	acquired = 0;
+	pageVersion = NO_VERSION;
+	repeated = 0;
+	displaySet.started = 0;
+}
+
+void Reset_Display_Definition()
+{
+	displayWidth = SUBTITLE_DEFAULT_DISPLAY_WIDTH;
+	displayHeight = SUBTITLE_DEFAULT_DISPLAY_HEIGHT;
+	windowX = 0;
+	windowY = 0;
+}
+
+int64_t Time_Until(uint64_t pts)
+{
+	uint64_t stc;
+	int64_t difference;
+
+	if (systemClock == NULL || systemClock(&stc))
+	{
+		return 0;
+	}
+
+	/* PTS and clock wrap at 33 bits */
+	difference = (int64_t)((pts - stc) & PTS_MASK);
+	if (difference > (int64_t)(PTS_MASK >> 1))
+	{
+		difference -= PTS_MASK + 1;
+	}
+	/* So far ahead that the clock jumped */
+	if (difference > (int64_t)SUBTITLE_MAX_DELAY * 90)
+	{
+		return 0;
+	}
+	return difference * 100 / 9;
+}
+
+void Default_Clut(SubtitleClut* clut)
+{
+	uint32_t i;
+	uint8_t red;
+	uint8_t green;
+	uint8_t blue;
+	uint8_t alpha;
+
+	clut->id = 0;
+	clut->version = NO_VERSION;
+
+	/* Transparent, white, black and grey */
+	clut->entries2[0] = COLOR_TRANSPARENT;
+	clut->entries2[1] = 0xFFFFFFFF;
+	clut->entries2[2] = 0xFF000000;
+	clut->entries2[3] = 0xFF808080;
+
+	/* Full colours, then the same at half intensity */
+	for (i = 0; i < 16; i++)
+	{
+		if (i == 0)
+		{
+			clut->entries4[i] = COLOR_TRANSPARENT;
+			continue;
+		}
+		red = (i & 0x01) ? ((i & 0x08) ? 0x7F : 0xFF) : 0;
+		green = (i & 0x02) ? ((i & 0x08) ? 0x7F : 0xFF) : 0;
+		blue = (i & 0x04) ? ((i & 0x08) ? 0x7F : 0xFF) : 0;
+		clut->entries4[i] = 0xFF000000 | (uint32_t)red << 16 | (uint32_t)green << 8 | blue;
+	}
+
+	/* Colours of the 8 bit CLUT in EN 300 743, the bits 0x88 select the group */
+	for (i = 0; i < 256; i++)
+	{
+		if (i < 8)
+		{
+			red = (i & 0x01) ? 0xFF : 0;
+			green = (i & 0x02) ? 0xFF : 0;
+			blue = (i & 0x04) ? 0xFF : 0;
+			alpha = (i == 0) ? 0 : 0x3F;
+		}
+		else
+		{
+			switch (i & 0x88)
+			{
+				case 0x00:
+					red = ((i & 0x01) ? 0x55 : 0) + ((i & 0x10) ? 0xAA : 0);
+					green = ((i & 0x02) ? 0x55 : 0) + ((i & 0x20) ? 0xAA : 0);
+					blue = ((i & 0x04) ? 0x55 : 0) + ((i & 0x40) ? 0xAA : 0);
+					alpha = 0xFF;
+					break;
+				case 0x08:
+					red = ((i & 0x01) ? 0x55 : 0) + ((i & 0x10) ? 0xAA : 0);
+					green = ((i & 0x02) ? 0x55 : 0) + ((i & 0x20) ? 0xAA : 0);
+					blue = ((i & 0x04) ? 0x55 : 0) + ((i & 0x40) ? 0xAA : 0);
+					alpha = 0x7F;
+					break;
+				case 0x80:
+					red = 0x7F + ((i & 0x01) ? 0x2B : 0) + ((i & 0x10) ? 0x55 : 0);
+					green = 0x7F + ((i & 0x02) ? 0x2B : 0) + ((i & 0x20) ? 0x55 : 0);
+					blue = 0x7F + ((i & 0x04) ? 0x2B : 0) + ((i & 0x40) ? 0x55 : 0);
+					alpha = 0xFF;
+					break;
+				default:
+					red = ((i & 0x01) ? 0x2B : 0) + ((i & 0x10) ? 0x55 : 0);
+					green = ((i & 0x02) ? 0x2B : 0) + ((i & 0x20) ? 0x55 : 0);
+					blue = ((i & 0x04) ? 0x2B : 0) + ((i & 0x40) ? 0x55 : 0);
+					alpha = 0xFF;
+					break;
+			}
+		}
+		clut->entries8[i] = (uint32_t)alpha << 24 | (uint32_t)red << 16 | (uint32_t)green << 8 | blue;
+	}
+}
+
+uint32_t Ycrcbt_To_Argb(uint8_t y, uint8_t cr, uint8_t cb, uint8_t t)
+{
+	int32_t luma = ((int32_t)y - 16) * 298;
+	int32_t red;
+	int32_t green;
+	int32_t blue;
+
+	if (y == 0)
+	{
+		return COLOR_TRANSPARENT;
+	}
+
+	/* ITU-R BT.601 */
+	red = (luma + 409 * ((int32_t)cr - 128) + 128) >> 8;
+	green = (luma - 100 * ((int32_t)cb - 128) - 208 * ((int32_t)cr - 128) + 128) >> 8;
+	blue = (luma + 516 * ((int32_t)cb - 128) + 128) >> 8;
+	red = (red < 0) ? 0 : (red > 255) ? 255 : red;
+	green = (green < 0) ? 0 : (green > 255) ? 255 : green;
+	blue = (blue < 0) ? 0 : (blue > 255) ? 255 : blue;
+	return (uint32_t)(255 - t) << 24 | (uint32_t)red << 16 | (uint32_t)green << 8 | (uint32_t)blue;
+}
+
+SubtitleRegion* Find_Region(uint8_t id)
+{
+	uint32_t i;
+
+	for (i = 0; i < numOfRegions; i++)
+	{
+		if (regions[i].id == id)
+		{
+			return &regions[i];
+		}
+	}
+	return NULL;
+}
+
+SubtitleClut* Find_Clut(uint8_t id)
+{
+	uint32_t i;
+
+	for (i = 0; i < numOfCluts; i++)
+	{
+		if (cluts[i].id == id)
+		{
+			return &cluts[i];
+		}
+	}
+	return NULL;
+}
+
+uint32_t Read_Bits(BitReader* reader, uint32_t count)
+{
+	uint32_t value = 0;
+	uint32_t bit;
+
+	/* Most significant bit first */
+	while (count--)
+	{
+		bit = 0;
+		if (reader->position < reader->size * 8)
+		{
+			bit = (reader->data[reader->position >> 3] >> (7 - (reader->position & 7))) & 1;
+		}
+		value = (value << 1) | bit;
+		reader->position++;
+	}
+	return value;
+}
+
+uint64_t Now()
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
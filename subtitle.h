@@ -0,0 +1,167 @@
+#ifndef _SUBTITLE_H_
+#define _SUBTITLE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include "ts_demux.h"
+#include "trace.h"
+
+/* Display the subtitles are composed for when there is no display definition */
+#define SUBTITLE_DEFAULT_DISPLAY_WIDTH 720
+#define SUBTITLE_DEFAULT_DISPLAY_HEIGHT 576
+/* PES packets on their way from the demux to the decoding thread, of the largest size each */
+#define SUBTITLE_PES_BUFFERS 4
+#define SUBTITLE_MAX_PES_SIZE (6 + 0xFFFF)
+/* Regions and CLUTs of an epoch */
+#define SUBTITLE_MAX_REGIONS 16
+#define SUBTITLE_MAX_CLUTS 16
+#define SUBTITLE_MAX_REGION_OBJECTS 16
+/* Largest display of a display definition, high definition services */
+#define SUBTITLE_MAX_DISPLAY_WIDTH 1920
+#define SUBTITLE_MAX_DISPLAY_HEIGHT 1080
+/* Pixel codes of all regions of an epoch come from one pool */
+#define SUBTITLE_REGION_POOL_SIZE (SUBTITLE_MAX_DISPLAY_WIDTH * SUBTITLE_MAX_DISPLAY_HEIGHT)
+/* Composed display sets waiting for their PTS or held by the receiver, allocated once */
+#define SUBTITLE_OVERLAYS 3
+#define SUBTITLE_OVERLAY_PIXELS (SUBTITLE_MAX_DISPLAY_WIDTH * SUBTITLE_MAX_DISPLAY_HEIGHT)
+/* Milliseconds a PTS may be ahead of the clock, later ones are taken as a discontinuity */
+#define SUBTITLE_MAX_DELAY 10000
+
+typedef struct SubtitleOverlay {
+	/* Presentation time of the display set in 90 kHz ticks */
+	uint64_t pts;
+	/* Seconds until the display set is removed, if no other one comes first */
+	uint8_t timeout;
+	int32_t displayWidth;
+	int32_t displayHeight;
+	/* Area of the regions on the display */
+	int32_t x;
+	int32_t y;
+	int32_t width;
+	int32_t height;
+	/* ARGB pixels, width pixels per row, not premultiplied */
+	uint32_t* pixels;
+} SubtitleOverlay;
+
+/*
+ * Called on the subtitle thread when a display set is due, NULL when the
+ * subtitles have to be removed. The overlay belongs to the receiver until
+ * it is given back with Subtitle_Release_Overlay, so it is drawn without
+ * a copy
+ */
+typedef void(*Subtitle_Display_Callback)(const SubtitleOverlay* overlay, void* argument);
+
+/* Returns the 33 bit system time clock in 90 kHz ticks the PTS are compared to */
+typedef int32_t(*Subtitle_Clock)(uint64_t* stc);
+
+typedef struct SubtitleStatistics {
+	uint32_t pesPackets;
+	/* PES packets lost while all buffers waited for the decoding thread */
+	uint32_t droppedPes;
+	uint32_t continuityErrors;
+	uint32_t segments;
+	/* Segments which are too short, pool overruns and unknown pixel data */
+	uint32_t segmentErrors;
+	uint32_t epochs;
+	uint32_t displaySets;
+	/* Display sets replaced before they were due, all overlays were waiting */
+	uint32_t droppedDisplaySets;
+	/* Microseconds */
+	uint32_t maxDecodeTime;
+	/* Microseconds the display sets were shown after their PTS */
+	uint32_t maxLateness;
+} SubtitleStatistics;
+
+/***********************************************************************
+* @brief    Subtitle initialization function, allocates the buffers and
+* 			starts the decoding thread
+*
+* @param    [in] clock - system time clock, NULL shows display sets as
+* 						 soon as they are decoded
+* @param    [in] callback - called when a display set is due
+* @param    [in] argument - passed to the callback
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Subtitle_Init(Subtitle_Clock clock, Subtitle_Display_Callback callback, void* argument);
+
+/***********************************************************************
+* @brief    Subtitle deinitialization function, stops the decoding
+* 			thread after the queued PES packets and the display sets
+* 			which are due, and waits until the receiver gave back the
+* 			overlays. Packets must not be passed to the decoder any
+* 			more
+*
+* @return   EXIT_SUCCESS - no error
+*
+***********************************************************************/
+int32_t Subtitle_Deinit();
+
+/***********************************************************************
+* @brief    Gives an overlay of the display callback back to the
+* 			decoder, from any thread
+*
+* @param    [in] overlay - overlay passed to the display callback
+*
+***********************************************************************/
+void Subtitle_Release_Overlay(const SubtitleOverlay* overlay);
+
+/***********************************************************************
+* @brief    Makes the demux thread wait for a free PES buffer instead of
+* 			dropping the PES, for file input which is read faster than
+* 			the subtitles are decoded
+*
+* @param    [in] enable - 1 to wait, 0 to drop
+*
+***********************************************************************/
+void Subtitle_Set_Blocking(uint8_t enable);
+
+/***********************************************************************
+* @brief    Selects the subtitles of the stream, from the subtitling
+* 			descriptor. The shown subtitles are removed and decoding
+* 			waits for the next epoch
+*
+* @param    [in] compositionPageId - page of the subtitles
+* @param    [in] ancillaryPageId - page shared by several subtitles,
+* 								   same as compositionPageId if none
+*
+***********************************************************************/
+void Subtitle_Select_Page(uint16_t compositionPageId, uint16_t ancillaryPageId);
+
+/***********************************************************************
+* @brief    Removes the shown and pending subtitles and stops decoding
+* 			until a page is selected, for channels without subtitles
+*
+***********************************************************************/
+void Subtitle_Deselect_Page();
+
+/***********************************************************************
+* @brief    Collects a transport packet of the subtitle PID, a packet
+* 			consumer of the demux. Complete PES packets are decoded on
+* 			the subtitle thread
+*
+* @param    [in] packet - transport packet
+* @param    [in] pid - subtitle PID
+* @param    [in] userData - unused
+*
+* @return   EXIT_SUCCESS - no error
+*
+***********************************************************************/
+int32_t Subtitle_Packet_Received(const uint8_t* packet, uint16_t pid, void* userData);
+
+/***********************************************************************
+* @brief    Copies the decoder counters
+*
+* @param    [out] outStatistics - structure where the counters are saved
+*
+***********************************************************************/
+void Subtitle_Get_Statistics(SubtitleStatistics* outStatistics);
+
+#endif
@@ -0,0 +1,386 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "table_parse.h"
+#include "crc32.h"
+
+/* Host benchmark of the PAT and PMT parsers on synthetic sections */
+
+/* Minimal time spent on one measurement */
+#define BENCH_MIN_SECONDS 0.2
+/* Iterations between two clock reads */
+#define BENCH_CHECK_INTERVAL 256
+#define MAX_PAT_SECTIONS 4
+#define BENCH_PID_BASE 0x100
+
+typedef struct BenchSection {
+	uint8_t data[3 + PSI_MAX_SECTION_LENGTH];
+	uint32_t numOfEntries;
+} BenchSection;
+
+/* Decoder measured by Run_Benchmark, returns a value so that the work is kept */
+typedef uint32_t(*Bench_Function)(const BenchSection* sections, uint32_t numOfSections);
+
+/***********************************************************************
+* @brief    Builds the PAT sections of a transport stream with the
+* 			number of programs, PAT_MAX_PROGRAMS per section
+*
+* @param    [out] sections - array of MAX_PAT_SECTIONS sections
+* @param    [in] numOfPrograms - number of programs
+*
+* @return   numOfSections - number of sections built
+*
+***********************************************************************/
+static uint32_t Build_PAT(BenchSection* sections, uint32_t numOfPrograms);
+
+/***********************************************************************
+* @brief    Builds a PMT section with the number of elementary streams,
+* 			every stream has a language descriptor and every fourth a
+* 			teletext descriptor
+*
+* @param    [out] section - section to build
+* @param    [in] numOfStreams - number of elementary streams
+*
+***********************************************************************/
+static void Build_PMT(BenchSection* section, uint32_t numOfStreams);
+
+/***********************************************************************
+* @brief    Fills section_length and CRC_32 of a section
+*
+* @param    [in,out] section - section with the payload already written
+* @param    [in] end - offset where the CRC_32 goes
+*
+***********************************************************************/
+static void Finish_Section(uint8_t* section, uint16_t end);
+
+/***********************************************************************
+* @brief    Runs the function until BENCH_MIN_SECONDS pass and prints
+* 			sections per second and nanoseconds per entry
+*
+* @param    [in] name - name printed in the report
+* @param    [in] function - decoder to measure
+* @param    [in] sections - sections passed to the decoder
+* @param    [in] numOfSections - number of sections
+* @param    [in] numOfEntries - programs or streams in all sections
+*
+***********************************************************************/
+static void Run_Benchmark(const char* name, Bench_Function function, const BenchSection* sections,
+						  uint32_t numOfSections, uint32_t numOfEntries);
+
+/***********************************************************************
+* @brief    Decoding as PAT_Parse and PMT_Parse used to do it, one
+* 			Make_16bit_Number call per field, kept as the reference
+*
+***********************************************************************/
+static uint16_t Make_16bit_Number(const uint8_t* buffer, uint16_t firstIndex, uint16_t secondIndex, uint16_t mask);
+static uint32_t Reference_PAT_Decode(const uint8_t* buffer, PATTable* programTable);
+static uint32_t Reference_PMT_Decode(const uint8_t* buffer, PMTStream* streamTable);
+
+static uint32_t Bench_PAT_Parse(const BenchSection* sections, uint32_t numOfSections);
+static uint32_t Bench_PAT_Decode(const BenchSection* sections, uint32_t numOfSections);
+static uint32_t Bench_PAT_Reference(const BenchSection* sections, uint32_t numOfSections);
+static uint32_t Bench_PMT_Parse(const BenchSection* sections, uint32_t numOfSections);
+static uint32_t Bench_PMT_Decode(const BenchSection* sections, uint32_t numOfSections);
+static uint32_t Bench_PMT_Reference(const BenchSection* sections, uint32_t numOfSections);
+
+static const uint32_t patSizes[] = {1, 10, 50, 100, 253, 500};
+static const uint32_t pmtSizes[] = {1, 4, 16, 32, 64};
+
+static BenchSection sections[MAX_PAT_SECTIONS];
+static PATTable programTable[PAT_MAX_PROGRAMS];
+static PMTStream streamTable[PMT_MAX_STREAMS];
+/* Parsers print their progress, it goes here while they are measured */
+static int32_t nullOutput;
+static int32_t standardOutput;
+
+int32_t main(int32_t argc, char** argv)
+{
+	uint32_t i;
+	uint32_t j;
+	uint32_t numOfSections;
+	uint32_t numOfPrograms;
+
+	nullOutput = open("/dev/null", O_WRONLY);
+	standardOutput = dup(STDOUT_FILENO);
+	if (nullOutput < 0 || standardOutput < 0)
+	{
+		printf("%s(%d): Error opening /dev/null!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < sizeof(patSizes) / sizeof(patSizes[0]); i++)
+	{
+		numOfSections = Build_PAT(sections, patSizes[i]);
+
+		/* Both decoders have to give the same programs */
+		for (j = 0; j < numOfSections; j++)
+		{
+			numOfPrograms = PAT_Decode_Programs(sections[j].data, programTable, PAT_MAX_PROGRAMS);
+			if (numOfPrograms != sections[j].numOfEntries
+				|| Reference_PAT_Decode(sections[j].data, programTable) != numOfPrograms)
+			{
+				printf("PAT decoding mismatch at %u programs!\n", patSizes[i]);
+				return EXIT_FAILURE;
+			}
+		}
+
+		printf("PAT %3u programs, %u section(s)\n", patSizes[i], numOfSections);
+		Run_Benchmark("PAT_Parse", Bench_PAT_Parse, sections, numOfSections, patSizes[i]);
+		Run_Benchmark("PAT_Decode_Programs", Bench_PAT_Decode, sections, numOfSections, patSizes[i]);
+		Run_Benchmark("Make_16bit_Number", Bench_PAT_Reference, sections, numOfSections, patSizes[i]);
+	}
+
+	for (i = 0; i < sizeof(pmtSizes) / sizeof(pmtSizes[0]); i++)
+	{
+		Build_PMT(&sections[0], pmtSizes[i]);
+		if (PMT_Decode_Streams(sections[0].data, streamTable, PMT_MAX_STREAMS) != pmtSizes[i]
+			|| Reference_PMT_Decode(sections[0].data, streamTable) != pmtSizes[i])
+		{
+			printf("PMT decoding mismatch at %u streams!\n", pmtSizes[i]);
+			return EXIT_FAILURE;
+		}
+
+		printf("PMT %3u streams\n", pmtSizes[i]);
+		Run_Benchmark("PMT_Parse", Bench_PMT_Parse, sections, 1, pmtSizes[i]);
+		Run_Benchmark("PMT_Decode_Streams", Bench_PMT_Decode, sections, 1, pmtSizes[i]);
+		Run_Benchmark("Make_16bit_Number", Bench_PMT_Reference, sections, 1, pmtSizes[i]);
+	}
+
+	close(standardOutput);
+	close(nullOutput);
+	return EXIT_SUCCESS;
+}
+
+uint32_t Build_PAT(BenchSection* patSections, uint32_t numOfPrograms)
+{
+	uint32_t numOfSections = 0;
+	uint32_t program = 0;
+	uint32_t count;
+	uint16_t offset;
+	uint8_t* data;
+
+	while (program < numOfPrograms && numOfSections < MAX_PAT_SECTIONS)
+	{
+		data = patSections[numOfSections].data;
+		data[0] = PAT_TABLE_ID;
+		data[3] = 0x12;
+		data[4] = 0x34;
+		data[5] = 0xC1;
+		data[6] = numOfSections;
+		data[7] = (numOfPrograms - 1) / PAT_MAX_PROGRAMS;
+		offset = 8;
+
+		for (count = 0; count < PAT_MAX_PROGRAMS && program < numOfPrograms; count++, program++)
+		{
+			data[offset] = (program + 1) >> 8;
+			data[offset + 1] = program + 1;
+			data[offset + 2] = 0xE0 | ((BENCH_PID_BASE + program) >> 8);
+			data[offset + 3] = BENCH_PID_BASE + program;
+			offset += 4;
+		}
+		Finish_Section(data, offset);
+		patSections[numOfSections].numOfEntries = count;
+		numOfSections++;
+	}
+	return numOfSections;
+}
+
+void Build_PMT(BenchSection* section, uint32_t numOfStreams)
+{
+	uint8_t* data = section->data;
+	uint16_t offset;
+	uint16_t esInfoLength;
+	uint32_t i;
+
+	data[0] = PMT_TABLE_ID;
+	data[3] = 0x00;
+	data[4] = 0x01;
+	data[5] = 0xC1;
+	data[6] = 0;
+	data[7] = 0;
+	data[8] = 0xE0 | (BENCH_PID_BASE >> 8);
+	data[9] = BENCH_PID_BASE & 0xFF;
+	/* Program info carries a CA descriptor */
+	data[10] = 0xF0;
+	data[11] = 6;
+	memcpy(data + 12, "\x09\x04\x0B\x00\xE1\x00", 6);
+	offset = 18;
+
+	for (i = 0; i < numOfStreams; i++)
+	{
+		esInfoLength = (i % 4 == 3) ? 13 : 6;
+		data[offset] = (i == 0) ? 0x02 : ((i == 1) ? 0x03 : 0x06);
+		data[offset + 1] = 0xE0 | ((BENCH_PID_BASE + 1 + i) >> 8);
+		data[offset + 2] = BENCH_PID_BASE + 1 + i;
+		data[offset + 3] = 0xF0;
+		data[offset + 4] = esInfoLength;
+		/* ISO 639 language descriptor */
+		memcpy(data + offset + 5, "\x0A\x04" "eng\x00", 6);
+		if (esInfoLength > 6)
+		{
+			memcpy(data + offset + 11, "\x56\x05" "deu\x09\x00", 7);
+		}
+		offset += 5 + esInfoLength;
+	}
+	Finish_Section(data, offset);
+	section->numOfEntries = numOfStreams;
+}
+
+void Finish_Section(uint8_t* section, uint16_t end)
+{
+	uint16_t sectionLength = end + 4 - 3;
+	uint32_t crc;
+
+	section[1] = 0xB0 | (sectionLength >> 8);
+	section[2] = sectionLength & 0xFF;
+	crc = Crc32_Calculate(section, end);
+	section[end] = crc >> 24;
+	section[end + 1] = crc >> 16;
+	section[end + 2] = crc >> 8;
+	section[end + 3] = crc;
+}
+
+void Run_Benchmark(const char* name, Bench_Function function, const BenchSection* benchSections,
+				   uint32_t numOfSections, uint32_t numOfEntries)
+{
+	struct timespec start;
+	struct timespec now;
+	double seconds;
+	uint64_t iterations = 0;
+	uint32_t i;
+	volatile uint32_t result = 0;
+
+	fflush(stdout);
+	dup2(nullOutput, STDOUT_FILENO);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	do
+	{
+		for (i = 0; i < BENCH_CHECK_INTERVAL; i++)
+		{
+			result += function(benchSections, numOfSections);
+		}
+		iterations += BENCH_CHECK_INTERVAL;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		seconds = (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+	} while (seconds < BENCH_MIN_SECONDS);
+
+	fflush(stdout);
+	dup2(standardOutput, STDOUT_FILENO);
+
+	printf("    %-20s %12.0f sections/s %8.2f ns/entry\n", name, iterations * numOfSections / seconds,
+		   seconds * 1e9 / (iterations * numOfEntries));
+}
+
+uint32_t Bench_PAT_Parse(const BenchSection* benchSections, uint32_t numOfSections)
+{
+	uint32_t count = 0;
+	uint32_t i;
+
+	for (i = 0; i < numOfSections; i++)
+	{
+		count += PAT_Parse(benchSections[i].data, programTable);
+	}
+	return count;
+}
+
+uint32_t Bench_PAT_Decode(const BenchSection* benchSections, uint32_t numOfSections)
+{
+	uint32_t count = 0;
+	uint32_t i;
+
+	for (i = 0; i < numOfSections; i++)
+	{
+		count += PAT_Decode_Programs(benchSections[i].data, programTable, PAT_MAX_PROGRAMS);
+	}
+	return count;
+}
+
+uint32_t Bench_PAT_Reference(const BenchSection* benchSections, uint32_t numOfSections)
+{
+	uint32_t count = 0;
+	uint32_t i;
+
+	for (i = 0; i < numOfSections; i++)
+	{
+		count += Reference_PAT_Decode(benchSections[i].data, programTable);
+	}
+	return count;
+}
+
+uint32_t Bench_PMT_Parse(const BenchSection* benchSections, uint32_t numOfSections)
+{
+	PMTTable pmt;
+
+	PMT_Parse(benchSections[0].data, &pmt);
+	return pmt.videoPID + pmt.audioPID + pmt.teletext;
+}
+
+uint32_t Bench_PMT_Decode(const BenchSection* benchSections, uint32_t numOfSections)
+{
+	return PMT_Decode_Streams(benchSections[0].data, streamTable, PMT_MAX_STREAMS);
+}
+
+uint32_t Bench_PMT_Reference(const BenchSection* benchSections, uint32_t numOfSections)
+{
+	return Reference_PMT_Decode(benchSections[0].data, streamTable);
+}
+
+uint16_t Make_16bit_Number(const uint8_t* buffer, uint16_t firstIndex, uint16_t secondIndex, uint16_t mask)
+{
+	uint16_t number;
+	number = *(buffer + firstIndex);
+	number = number<<8;
+	number = number + *(buffer + secondIndex);
+	number = number & mask;
+	return number;
+}
+
+uint32_t Reference_PAT_Decode(const uint8_t* buffer, PATTable* referenceTable)
+{
+	uint16_t sectionLength;
+	uint16_t programNumber;
+	uint16_t offset = 0;
+	uint32_t numOfPrograms = 0;
+
+	sectionLength = Make_16bit_Number(buffer, 1, 2, 0x0FFF) - 9;
+	while (sectionLength >= 4)
+	{
+		programNumber = Make_16bit_Number(buffer, 8 + offset, 9 + offset, 0xFFFF);
+		if (programNumber != 0)
+		{
+			referenceTable[numOfPrograms].programNumber = programNumber;
+			referenceTable[numOfPrograms].programMapPID = Make_16bit_Number(buffer, 10 + offset, 11 + offset, 0x1FFF);
+			numOfPrograms++;
+		}
+		offset += 4;
+		sectionLength -= 4;
+	}
+	return numOfPrograms;
+}
+
+uint32_t Reference_PMT_Decode(const uint8_t* buffer, PMTStream* referenceTable)
+{
+	uint16_t sectionEnd;
+	uint16_t offset;
+	uint16_t esInfoLength;
+	uint32_t numOfStreams = 0;
+
+	sectionEnd = 3 + Make_16bit_Number(buffer, 1, 2, 0x0FFF) - 4;
+	offset = 12 + Make_16bit_Number(buffer, 10, 11, 0x0FFF);
+	while (offset + 5 <= sectionEnd)
+	{
+		esInfoLength = Make_16bit_Number(buffer, offset + 3, offset + 4, 0x0FFF);
+		referenceTable[numOfStreams].streamType = buffer[offset];
+		referenceTable[numOfStreams].elementaryPID = Make_16bit_Number(buffer, offset + 1, offset + 2, 0x1FFF);
+		referenceTable[numOfStreams].descriptorsOffset = offset + 5;
+		referenceTable[numOfStreams].descriptorsLength = esInfoLength;
+		numOfStreams++;
+		offset += 5 + esInfoLength;
+	}
+	return numOfStreams;
+}
@@ -13,82 +13,251 @@
 * @return   number - 16 bit number
 *
 ***********************************************************************/
-static uint16_t Make_16bit_Number(uint8_t* buffer, uint16_t firstIndex, uint16_t secondIndex, uint16_t mask);
+static uint16_t Make_16bit_Number(const uint8_t* buffer, uint16_t firstIndex, uint16_t secondIndex, uint16_t mask);
 
-uint32_t PAT_Parse(uint8_t* buffer, PATTable* programTable)
+/***********************************************************************
+* @brief    Takes four bytes from buffer and combines them into a big
+* 			endian 32 bit number, compilers turn it into one load and
+* 			a byte swap
+* 
+* @param    [in] buffer - pointer to the most significant byte
+*
+* @return   number - 32 bit number
+*
+***********************************************************************/
+static uint32_t Make_32bit_Number(const uint8_t* buffer);
+
+/***********************************************************************
+* @brief    Finds the service in the NIT results, adds it if it is not
+* 			there yet
+* 
+* @param    [in] serviceTable - pointer to array with NIT results
+* @param    [in,out] numOfServices - number of services in the array
+* @param    [in] maxServices - number of elements in serviceTable
+* @param    [in] serviceId - service to find
+*
+* @return   pointer to the service, NULL if the array is full
+*
+***********************************************************************/
+static NITService* Get_NIT_Service(NITService* serviceTable, uint32_t* numOfServices, uint32_t maxServices, uint16_t serviceId);
+
+/***********************************************************************
+* @brief    Converts the 40 bit start_time field, 16 bit MJD followed
+* 			by hours, minutes and seconds in BCD, to UTC seconds
+* 
+* @param    [in] field - pointer to the start_time field
+*
+* @return   seconds since 1970, 0 if the time is undefined
+*
+***********************************************************************/
+static uint32_t Make_Utc_Time(const uint8_t* field);
+
+/***********************************************************************
+* @brief    Converts a 24 bit duration, hours, minutes and seconds in
+* 			BCD, to seconds
+* 
+* @param    [in] field - pointer to the duration field
+*
+* @return   number of seconds
+*
+***********************************************************************/
+static uint32_t Make_Bcd_Duration(const uint8_t* field);
+
+uint32_t PAT_Parse(const uint8_t* buffer, PATTable* programTable)
 {
-	uint16_t sectionLength = 0;
-	uint16_t numOfPrograms = 0;
-	uint16_t programNumber = 0;
-	uint16_t programMapPID = 0;
-	uint16_t offset = 0;
+	uint32_t numOfPrograms;
 	
-	printf("PAT receiving started\n");
+	TRACE_BEGIN("PAT parse");
+	/* Corrupted section would give bogus PIDs */
+	if (Crc32_Check_Section(buffer))
+	{
+		printf("PAT CRC_32 error, section rejected\n");
+		TRACE_END("PAT parse");
+		return 0;
+	}
+	
+	numOfPrograms = PAT_Decode_Programs(buffer, programTable, PAT_MAX_PROGRAMS);
+	TRACE_END_VALUE("PAT parse", numOfPrograms);
+	return numOfPrograms;
+}
+
+int32_t PMT_Parse(const uint8_t* buffer, PMTTable* returnValues)
+{
+	PMTStream streamTable[PMT_MAX_STREAMS];
+	uint32_t numOfStreams;
+	uint32_t i;
+	uint16_t descriptorOffset;
+	uint16_t descriptorsEnd;
+	uint16_t entryOffset;
+	uint16_t descriptorEnd;
+	PMTSubtitle* subtitle;
+	
+	/* Unused subtitle entries are zero too, the zapper compares tables with memcmp */
+	memset(returnValues, 0, sizeof(PMTTable));
+	
+	TRACE_BEGIN("PMT parse");
+	if (Crc32_Check_Section(buffer))
+	{
+		printf("PMT CRC_32 error, section rejected\n");
+		TRACE_END("PMT parse");
+		return EXIT_FAILURE;
+	}
+	
+	returnValues->pcrPID = Make_16bit_Number(buffer, 8, 9, 0x1FFF);
+	numOfStreams = PMT_Decode_Streams(buffer, streamTable, PMT_MAX_STREAMS);
+	for (i = 0; i < numOfStreams; i++)
+	{
+		/* Video streams are either stream type 1 or 2 */
+		if (streamTable[i].streamType == 0x01 || streamTable[i].streamType == 0x02)
+		{
+			returnValues->videoPID = streamTable[i].elementaryPID;
+		}
+		
+		/* Audio streams are either stream type 3 or 4 */
+		if (streamTable[i].streamType == 0x03 || streamTable[i].streamType == 0x04)
+		{
+			returnValues->audioPID = streamTable[i].elementaryPID;
+		}
+		
+		descriptorsEnd = streamTable[i].descriptorsOffset + streamTable[i].descriptorsLength;
+		for (descriptorOffset = streamTable[i].descriptorsOffset; descriptorOffset + 2 <= descriptorsEnd;
+			 descriptorOffset += 2 + buffer[descriptorOffset + 1])
+		{
+			/*
+			 * 2 bytes are:			bit
+			 * descriptor_tag		08
+			 * descriptor_length	08
+			 */
+			if (buffer[descriptorOffset] == TELETEXT)
+			{
+				returnValues->teletext = 1;
+				returnValues->teletextPID = streamTable[i].elementaryPID;
+			}
+			
+			/*
+			 * Subtitling descriptor has entries of 8 bytes:	bit
+			 * ISO_639_language_code							24
+			 * subtitling_type									08
+			 * composition_page_id								16
+			 * ancillary_page_id								16
+			 */
+			if (buffer[descriptorOffset] == SUBTITLING_DESCRIPTOR)
+			{
+				descriptorEnd = descriptorOffset + 2 + buffer[descriptorOffset + 1];
+				if (descriptorEnd > descriptorsEnd)
+				{
+					descriptorEnd = descriptorsEnd;
+				}
+				for (entryOffset = descriptorOffset + 2; entryOffset + 8 <= descriptorEnd &&
+					 returnValues->numOfSubtitles < PMT_MAX_SUBTITLES; entryOffset += 8)
+				{
+					subtitle = &returnValues->subtitles[returnValues->numOfSubtitles++];
+					subtitle->elementaryPID = streamTable[i].elementaryPID;
+					memcpy(subtitle->language, buffer + entryOffset, 3);
+					subtitle->language[3] = '\0';
+					subtitle->subtitlingType = buffer[entryOffset + 3];
+					subtitle->compositionPageId = (uint16_t)buffer[entryOffset + 4] << 8 | buffer[entryOffset + 5];
+					subtitle->ancillaryPageId = (uint16_t)buffer[entryOffset + 6] << 8 | buffer[entryOffset + 7];
+				}
+			}
+		}
+	}
+	TRACE_END_VALUE("PMT parse", numOfStreams);
+	return EXIT_SUCCESS;
+}
+
+uint32_t PAT_Decode_Programs(const uint8_t* buffer, PATTable* programTable, uint32_t maxPrograms)
+{
+	uint16_t sectionLength;
+	uint16_t sectionEnd;
+	uint16_t offset;
+	uint32_t first;
+	uint32_t second;
+	uint32_t numOfPrograms = 0;
 	
 	sectionLength = Make_16bit_Number(buffer, 1, 2, 0x0FFF);
-	sectionLength = sectionLength - 9;
+	if (sectionLength < 9 || sectionLength > PSI_MAX_SECTION_LENGTH)
+	{
+		return 0;
+	}
 	/* 
-	 * 9 bytes are:				bit
+	 * 8 bytes are:				bit
+	 * table_id					08
+	 * section_syntax_indicator	01
+	 * '0'						01
+	 * reserved					02
+	 * section_length			12
 	 * transport_stream_id		16
 	 * reserved					02
 	 * version_number			05
 	 * current_next_indicator	01
 	 * section_number			08
 	 * last_section number		08
-	 * CRC_32					32
+	 * 
+	 * program loop ends where the CRC_32 starts
 	 */
-
-	while (sectionLength > 0)
+	sectionEnd = 3 + sectionLength - 4;
+	offset = 8;
+	
+	/* 
+	 * 4 bytes are:		bit
+	 * program_number	16
+	 * reserved			03
+	 * network_PID		13
+	 * 
+	 * Two entries per iteration, each is one 32 bit load. Entry is
+	 * always written, the network PID entry (program 0) is overwritten
+	 * by the next one
+	 */
+	while (offset + 8 <= sectionEnd && numOfPrograms + 2 <= maxPrograms)
 	{
-		programNumber = Make_16bit_Number(buffer, 8 + offset, 9 + offset, 0xFFFF);
+		first = Make_32bit_Number(buffer + offset);
+		second = Make_32bit_Number(buffer + offset + 4);
 		
-		if (programNumber != 0)
-		{
-			programTable[numOfPrograms].programNumber = programNumber;
-			
-			programMapPID = Make_16bit_Number(buffer, 10 + offset, 11 + offset, 0x1FFF);
-			
-			programTable[numOfPrograms].programMapPID = programMapPID;
-			numOfPrograms++;
-		}
+		programTable[numOfPrograms].programNumber = first >> 16;
+		programTable[numOfPrograms].programMapPID = first & 0x1FFF;
+		numOfPrograms += (first >> 16) != 0;
+		
+		programTable[numOfPrograms].programNumber = second >> 16;
+		programTable[numOfPrograms].programMapPID = second & 0x1FFF;
+		numOfPrograms += (second >> 16) != 0;
 		
+		offset += 8;
+	}
+	
+	while (offset + 4 <= sectionEnd && numOfPrograms < maxPrograms)
+	{
+		first = Make_32bit_Number(buffer + offset);
+		programTable[numOfPrograms].programNumber = first >> 16;
+		programTable[numOfPrograms].programMapPID = first & 0x1FFF;
+		numOfPrograms += (first >> 16) != 0;
 		offset += 4;
-		sectionLength -= 4;
-		/* 
-		 * 4 bytes are:		bit
-		 * program_number	16
-		 * reserved			03
-		 * network_PID		13
-		 */
 	}
-	printf("PAT receiving completed\n");
 	return numOfPrograms;
 }
 
-int32_t PMT_Parse(uint8_t* buffer, PMTTable* returnValues)
+uint32_t PMT_Decode_Streams(const uint8_t* buffer, PMTStream* streamTable, uint32_t maxStreams)
 {
 	uint16_t sectionLength;
-	uint16_t programInfoLength;
+	uint16_t sectionEnd;
+	uint16_t offset;
 	uint16_t esInfoLength;
-	uint8_t streamType;
-	uint16_t offset = 0;
-	uint16_t offsetSecond = 0;
-	uint8_t descriptorTag;
-	uint8_t descriptorLength;
-	
-	returnValues->videoPID = 0;
-	returnValues->audioPID = 0;
-	returnValues->teletext = 0;
-	
-	printf("PMT receiving started\n");
+	uint32_t fields;
+	uint32_t numOfStreams = 0;
 	
 	sectionLength = Make_16bit_Number(buffer, 1, 2, 0x0FFF);
-	
-	programInfoLength = Make_16bit_Number(buffer, 10, 11, 0x0FFF);
-	
-	sectionLength = sectionLength - 13 - programInfoLength;
+	if (sectionLength < 13 || sectionLength > PSI_MAX_SECTION_LENGTH)
+	{
+		return 0;
+	}
+	sectionEnd = 3 + sectionLength - 4;
 	/* 
-	 * 13 bytes are:			bit
+	 * 12 bytes are:			bit
+	 * table_id					08
+	 * section_syntax_indicator	01
+	 * '0'						01
+	 * reserved					02
+	 * section_length			12
 	 * program_number			16
 	 * reserved					02
 	 * version_number			05
@@ -99,70 +268,404 @@ int32_t PMT_Parse(uint8_t* buffer, PMTTable* returnValues)
 	 * PCR_PID					13
 	 * reserved					04
 	 * program_info_legth		12
-	 * CRC_32					32
 	 */
+	offset = 12 + Make_16bit_Number(buffer, 10, 11, 0x0FFF);
 	
-	offset = programInfoLength;
-	while (sectionLength)
-	{	
-		if (sectionLength < 0)
+	while (offset + 5 <= sectionEnd && numOfStreams < maxStreams)
+	{
+		/* 
+		 * 5 bytes are:		bit
+		 * stream_type		08
+		 * reserved			03
+		 * elementary_PID	13
+		 * reserved			04
+		 * ES_info_legth	12
+		 * 
+		 * PID and ES_info_length come with one 32 bit load
+		 */
+		fields = Make_32bit_Number(buffer + offset + 1);
+		esInfoLength = fields & 0x0FFF;
+		if (offset + 5 + esInfoLength > sectionEnd)
 		{
-		 return EXIT_FAILURE;
+			break;
 		}
-		streamType = *(buffer + 12 + offset);
 		
-		/* Video streams are either stream type 1 or 2 */
-		if (streamType == 0x01 || streamType == 0x02)
+		streamTable[numOfStreams].streamType = buffer[offset];
+		streamTable[numOfStreams].elementaryPID = (fields >> 16) & 0x1FFF;
+		streamTable[numOfStreams].descriptorsOffset = offset + 5;
+		streamTable[numOfStreams].descriptorsLength = esInfoLength;
+		numOfStreams++;
+		
+		offset += 5 + esInfoLength;
+	}
+	return numOfStreams;
+}
+
+uint32_t SDT_Parse(const uint8_t* buffer, SDTService* serviceTable, uint32_t maxServices)
+{
+	uint16_t sectionEnd;
+	uint16_t offset;
+	uint16_t descriptorsEnd;
+	uint16_t descriptorOffset;
+	uint8_t descriptorTag;
+	uint8_t descriptorLength;
+	uint8_t providerNameLength;
+	uint8_t serviceNameLength;
+	const uint8_t* descriptor;
+	uint32_t numOfServices = 0;
+	
+	if (Crc32_Check_Section(buffer))
+	{
+		printf("SDT CRC_32 error, section rejected\n");
+		return 0;
+	}
+	
+	/* Service loop ends where the CRC_32 starts */
+	sectionEnd = 3 + Make_16bit_Number(buffer, 1, 2, 0x0FFF) - 4;
+	/* 
+	 * 11 bytes are:			bit
+	 * table_id					08
+	 * section_syntax_indicator	01
+	 * reserved_future_use		01
+	 * reserved					02
+	 * section_length			12
+	 * transport_stream_id		16
+	 * reserved					02
+	 * version_number			05
+	 * current_next_indicator	01
+	 * section_number			08
+	 * last_section number		08
+	 * original_network_id		16
+	 * reserved_future_use		08
+	 */
+	offset = 11;
+	
+	while (offset + 5 <= sectionEnd && numOfServices < maxServices)
+	{
+		serviceTable[numOfServices].serviceId = Make_16bit_Number(buffer, offset, offset + 1, 0xFFFF);
+		serviceTable[numOfServices].serviceType = 0;
+		serviceTable[numOfServices].serviceName[0] = '\0';
+		
+		descriptorsEnd = offset + 5 + Make_16bit_Number(buffer, offset + 3, offset + 4, 0x0FFF);
+		/* 
+		 * 5 bytes are:				bit
+		 * service_id				16
+		 * reserved_future_use		06
+		 * EIT_schedule_flag		01
+		 * EIT_present_following	01
+		 * running_status			03
+		 * free_CA_mode				01
+		 * descriptors_loop_length	12
+		 */
+		if (descriptorsEnd > sectionEnd)
 		{
-			returnValues->videoPID  = Make_16bit_Number(buffer, 13 + offset, 14 + programInfoLength + offset, 0x1FFF);
+			break;
 		}
 		
-		/* Audio streams are either stream type 3 or 4 */
-		if (streamType == 0x03 || streamType == 0x04)
+		for (descriptorOffset = offset + 5; descriptorOffset + 2 <= descriptorsEnd;
+			 descriptorOffset += 2 + descriptorLength)
 		{
-			returnValues->audioPID = Make_16bit_Number(buffer, 13 + offset, 14 + programInfoLength + offset, 0x1FFF);
+			descriptorTag = buffer[descriptorOffset];
+			descriptorLength = buffer[descriptorOffset + 1];
+			if (descriptorOffset + 2 + descriptorLength > descriptorsEnd)
+			{
+				break;
+			}
+			if (descriptorTag != SERVICE_DESCRIPTOR || descriptorLength < 3)
+			{
+				continue;
+			}
+			
+			/* 
+			 * descriptor is:			bit
+			 * service_type				08
+			 * provider_name_length		08
+			 * provider_name			8*N
+			 * service_name_length		08
+			 * service_name				8*N
+			 */
+			descriptor = buffer + descriptorOffset + 2;
+			providerNameLength = descriptor[1];
+			if (3 + providerNameLength > descriptorLength)
+			{
+				continue;
+			}
+			serviceNameLength = descriptor[2 + providerNameLength];
+			if (3 + providerNameLength + serviceNameLength > descriptorLength)
+			{
+				continue;
+			}
+			serviceTable[numOfServices].serviceType = descriptor[0];
+			Dvb_Text_To_Utf8(descriptor + 3 + providerNameLength, serviceNameLength,
+							 serviceTable[numOfServices].serviceName, SERVICE_NAME_SIZE);
 		}
 		
-		esInfoLength = Make_16bit_Number(buffer, 15 + offset, 16 + programInfoLength + offset, 0x0FFF);
+		numOfServices++;
+		offset = descriptorsEnd;
+	}
+	return numOfServices;
+}
+
+uint32_t NIT_Parse(const uint8_t* buffer, NITService* serviceTable, uint32_t maxServices)
+{
+	uint16_t sectionEnd;
+	uint16_t offset;
+	uint16_t loopEnd;
+	uint16_t descriptorsEnd;
+	uint16_t descriptorOffset;
+	uint16_t entryOffset;
+	uint8_t descriptorTag;
+	uint8_t descriptorLength;
+	uint32_t numOfServices = 0;
+	NITService* service;
+	
+	if (Crc32_Check_Section(buffer))
+	{
+		printf("NIT CRC_32 error, section rejected\n");
+		return 0;
+	}
+	
+	sectionEnd = 3 + Make_16bit_Number(buffer, 1, 2, 0x0FFF) - 4;
+	/* 
+	 * 10 bytes are:				bit
+	 * table_id						08
+	 * section_syntax_indicator		01
+	 * reserved_future_use			01
+	 * reserved						02
+	 * section_length				12
+	 * network_id					16
+	 * reserved						02
+	 * version_number				05
+	 * current_next_indicator		01
+	 * section_number				08
+	 * last_section number			08
+	 * reserved_future_use			04
+	 * network_descriptors_length	12
+	 */
+	offset = 10 + Make_16bit_Number(buffer, 8, 9, 0x0FFF);
+	if (offset + 2 > sectionEnd)
+	{
+		return 0;
+	}
+	
+	loopEnd = offset + 2 + Make_16bit_Number(buffer, offset, offset + 1, 0x0FFF);
+	if (loopEnd > sectionEnd)
+	{
+		loopEnd = sectionEnd;
+	}
+	offset += 2;
+	
+	while (offset + 6 <= loopEnd)
+	{
+		descriptorsEnd = offset + 6 + Make_16bit_Number(buffer, offset + 4, offset + 5, 0x0FFF);
+		/* 
+		 * 6 bytes are:					bit
+		 * transport_stream_id			16
+		 * original_network_id			16
+		 * reserved_future_use			04
+		 * transport_descriptors_length	12
+		 */
+		if (descriptorsEnd > loopEnd)
+		{
+			break;
+		}
 		
-		/* offsetSecond is used for goig through descriptors */
-		offsetSecond = 0;
-		while (esInfoLength - offsetSecond)
+		for (descriptorOffset = offset + 6; descriptorOffset + 2 <= descriptorsEnd;
+			 descriptorOffset += 2 + descriptorLength)
 		{
-			if (esInfoLength - offsetSecond < 0)
+			descriptorTag = buffer[descriptorOffset];
+			descriptorLength = buffer[descriptorOffset + 1];
+			if (descriptorOffset + 2 + descriptorLength > descriptorsEnd)
 			{
-				return EXIT_FAILURE;
+				break;
 			}
-			descriptorTag = buffer[17 + offset + offsetSecond];
-			descriptorLength = buffer[17 + offset + offsetSecond + 1];
-			offsetSecond += descriptorLength + 2;
-			/*
-			 * 2 bytes are:			bit
-			 * descriptor_tag		08
-			 * descriptor_length	08
-			 */
-			if (descriptorTag == TELETEXT)
+			
+			if (descriptorTag == SERVICE_LIST_DESCRIPTOR)
 			{
-				returnValues->teletext = 1;
+				/* 
+				 * 3 bytes per service:	bit
+				 * service_id			16
+				 * service_type			08
+				 */
+				for (entryOffset = 0; entryOffset + 3 <= descriptorLength; entryOffset += 3)
+				{
+					service = Get_NIT_Service(serviceTable, &numOfServices, maxServices,
+						Make_16bit_Number(buffer, descriptorOffset + 2 + entryOffset, descriptorOffset + 3 + entryOffset, 0xFFFF));
+					if (service != NULL)
+					{
+						service->serviceType = buffer[descriptorOffset + 4 + entryOffset];
+					}
+				}
+			}
+			else if (descriptorTag == LOGICAL_CHANNEL_DESCRIPTOR)
+			{
+				/* 
+				 * 4 bytes per service:		bit
+				 * service_id				16
+				 * visible_service_flag		01
+				 * reserved					05
+				 * logical_channel_number	10
+				 */
+				for (entryOffset = 0; entryOffset + 4 <= descriptorLength; entryOffset += 4)
+				{
+					service = Get_NIT_Service(serviceTable, &numOfServices, maxServices,
+						Make_16bit_Number(buffer, descriptorOffset + 2 + entryOffset, descriptorOffset + 3 + entryOffset, 0xFFFF));
+					if (service != NULL)
+					{
+						service->visible = buffer[descriptorOffset + 4 + entryOffset] >> 7;
+						service->logicalChannelNumber = Make_16bit_Number(buffer, descriptorOffset + 4 + entryOffset,
+																		  descriptorOffset + 5 + entryOffset, 0x03FF);
+					}
+				}
 			}
 		}
 		
-		offset += (5 + esInfoLength);
-		sectionLength -= (5 + esInfoLength);
+		offset = descriptorsEnd;
+	}
+	return numOfServices;
+}
+
+uint32_t EIT_Parse(const uint8_t* buffer, EITEvent* eventTable, uint32_t maxEvents)
+{
+	uint16_t sectionEnd;
+	uint16_t offset;
+	uint16_t descriptorsEnd;
+	uint16_t descriptorOffset;
+	uint8_t descriptorTag;
+	uint8_t descriptorLength;
+	uint8_t eventNameLength;
+	uint8_t textLength;
+	uint8_t shortEventFound;
+	const uint8_t* descriptor;
+	uint32_t numOfEvents = 0;
+	EITEvent* event;
+	
+	/* EIT comes at a high rate, only errors are printed */
+	if (Crc32_Check_Section(buffer))
+	{
+		printf("EIT CRC_32 error, section rejected\n");
+		return 0;
+	}
+	
+	sectionEnd = 3 + Make_16bit_Number(buffer, 1, 2, 0x0FFF) - 4;
+	/* 
+	 * 14 bytes are:				bit
+	 * table_id						08
+	 * section_syntax_indicator		01
+	 * reserved_future_use			01
+	 * reserved						02
+	 * section_length				12
+	 * service_id					16
+	 * reserved						02
+	 * version_number				05
+	 * current_next_indicator		01
+	 * section_number				08
+	 * last_section number			08
+	 * transport_stream_id			16
+	 * original_network_id			16
+	 * segment_last_section_number	08
+	 * last_table_id				08
+	 */
+	offset = 14;
+	
+	while (offset + 12 <= sectionEnd && numOfEvents < maxEvents)
+	{
+		descriptorsEnd = offset + 12 + Make_16bit_Number(buffer, offset + 10, offset + 11, 0x0FFF);
 		/* 
-		 * 5 bytes are:		bit
-		 * stream_type		08
-		 * reserved			03
-		 * elementary_PID	13
-		 * reserved			04
-		 * ES_info_legth	12
+		 * 12 bytes are:			bit
+		 * event_id					16
+		 * start_time				40
+		 * duration					24
+		 * running_status			03
+		 * free_CA_mode				01
+		 * descriptors_loop_length	12
 		 */
+		if (descriptorsEnd > sectionEnd)
+		{
+			break;
+		}
+		
+		event = &eventTable[numOfEvents];
+		event->serviceId = Make_16bit_Number(buffer, 3, 4, 0xFFFF);
+		event->eventId = Make_16bit_Number(buffer, offset, offset + 1, 0xFFFF);
+		event->startTime = Make_Utc_Time(buffer + offset + 2);
+		event->duration = Make_Bcd_Duration(buffer + offset + 7);
+		event->runningStatus = buffer[offset + 10] >> 5;
+		event->eventName[0] = '\0';
+		event->eventText[0] = '\0';
+		
+		shortEventFound = 0;
+		for (descriptorOffset = offset + 12; descriptorOffset + 2 <= descriptorsEnd && !shortEventFound;
+			 descriptorOffset += 2 + descriptorLength)
+		{
+			descriptorTag = buffer[descriptorOffset];
+			descriptorLength = buffer[descriptorOffset + 1];
+			if (descriptorOffset + 2 + descriptorLength > descriptorsEnd)
+			{
+				break;
+			}
+			if (descriptorTag != SHORT_EVENT_DESCRIPTOR || descriptorLength < 5)
+			{
+				continue;
+			}
+			
+			/* 
+			 * descriptor is:			bit
+			 * ISO_639_language_code	24
+			 * event_name_length		08
+			 * event_name				8*N
+			 * text_length				08
+			 * text						8*N
+			 */
+			descriptor = buffer + descriptorOffset + 2;
+			eventNameLength = descriptor[3];
+			if (5 + eventNameLength > descriptorLength)
+			{
+				continue;
+			}
+			textLength = descriptor[4 + eventNameLength];
+			if (5 + eventNameLength + textLength > descriptorLength)
+			{
+				continue;
+			}
+			Dvb_Text_To_Utf8(descriptor + 4, eventNameLength, event->eventName, EVENT_NAME_SIZE);
+			Dvb_Text_To_Utf8(descriptor + 5 + eventNameLength, textLength, event->eventText, EVENT_TEXT_SIZE);
+			shortEventFound = 1;
+		}
+		
+		numOfEvents++;
+		offset = descriptorsEnd;
 	}
-	printf("PMT receiving completed\n");
-	return EXIT_SUCCESS;
+	return numOfEvents;
 }
 
-uint16_t Make_16bit_Number(uint8_t* buffer, uint16_t firstIndex, uint16_t secondIndex, uint16_t mask)
+NITService* Get_NIT_Service(NITService* serviceTable, uint32_t* numOfServices, uint32_t maxServices, uint16_t serviceId)
+{
+	uint32_t i;
+	
+	for (i = 0; i < *numOfServices; i++)
+	{
+		if (serviceTable[i].serviceId == serviceId)
+		{
+			return &serviceTable[i];
+		}
+	}
+	
+	if (*numOfServices == maxServices)
+	{
+		return NULL;
+	}
+	
+	/* Services without LCN descriptor stay visible with LCN 0 */
+	serviceTable[i].serviceId = serviceId;
+	serviceTable[i].logicalChannelNumber = 0;
+	serviceTable[i].serviceType = 0;
+	serviceTable[i].visible = 1;
+	(*numOfServices)++;
+	return &serviceTable[i];
+}
+
+uint16_t Make_16bit_Number(const uint8_t* buffer, uint16_t firstIndex, uint16_t secondIndex, uint16_t mask)
 {
 	uint16_t number;
 	number = *(buffer + firstIndex);
@@ -171,3 +674,27 @@ uint16_t Make_16bit_Number(uint8_t* buffer, uint16_t firstIndex, uint16_t second
 	number = number & mask;
 	return number;
 }
+
+uint32_t Make_32bit_Number(const uint8_t* buffer)
+{
+	return ((uint32_t)buffer[0] << 24) | ((uint32_t)buffer[1] << 16) | ((uint32_t)buffer[2] << 8) | buffer[3];
+}
+
+uint32_t Make_Utc_Time(const uint8_t* field)
+{
+	uint32_t modifiedJulianDate = ((uint32_t)field[0] << 8) | field[1];
+	
+	/* All bits set means undefined, 40587 is 1970-01-01 */
+	if (modifiedJulianDate == 0xFFFF || modifiedJulianDate < 40587)
+	{
+		return 0;
+	}
+	return (modifiedJulianDate - 40587) * 86400 + Make_Bcd_Duration(field + 2);
+}
+
+uint32_t Make_Bcd_Duration(const uint8_t* field)
+{
+	return ((field[0] >> 4) * 10 + (field[0] & 0x0F)) * 3600
+		   + ((field[1] >> 4) * 10 + (field[1] & 0x0F)) * 60
+		   + (field[2] >> 4) * 10 + (field[2] & 0x0F);
+}
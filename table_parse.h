@@ -4,38 +4,138 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include "crc32.h"
+#include "dvb_text.h"
+#include "trace.h"
 
-/* Descriptor code in PMT table */
+/* PIDs and table ids of the tables */
+#define PAT_PID			0x0000
+#define NIT_PID			0x0010
+#define SDT_PID			0x0011
+#define EIT_PID			0x0012
+#define PAT_TABLE_ID	0x00
+#define PMT_TABLE_ID	0x02
+#define NIT_TABLE_ID	0x40
+#define SDT_TABLE_ID	0x42
+/* Present/following actual and other, schedule actual and other */
+#define EIT_PF_ACTUAL_TABLE_ID			0x4E
+#define EIT_PF_OTHER_TABLE_ID			0x4F
+#define EIT_SCHEDULE_ACTUAL_TABLE_ID	0x50
+#define EIT_SCHEDULE_OTHER_TABLE_ID		0x60
+
+/* Descriptor codes in PMT table */
 #define TELETEXT	0x56
+#define SUBTITLING_DESCRIPTOR	0x59
+/* Descriptor codes in SDT and NIT tables */
+#define SERVICE_LIST_DESCRIPTOR		0x41
+#define SERVICE_DESCRIPTOR			0x48
+#define LOGICAL_CHANNEL_DESCRIPTOR	0x83
+/* Descriptor code in EIT table */
+#define SHORT_EVENT_DESCRIPTOR		0x4D
+
+/* PAT and PMT sections are at most 1024 bytes */
+#define PSI_MAX_SECTION_LENGTH 1021
+/* Entries which fit in one section */
+#define PAT_MAX_PROGRAMS ((PSI_MAX_SECTION_LENGTH - 9) / 4)
+#define PMT_MAX_STREAMS ((PSI_MAX_SECTION_LENGTH - 13) / 5)
+/* Subtitle components kept from the subtitling descriptors */
+#define PMT_MAX_SUBTITLES 8
+/* PCR_PID of a program without a PCR */
+#define PMT_NO_PCR_PID 0x1FFF
+/* ISO 639 language code with the terminating zero */
+#define LANGUAGE_CODE_SIZE 4
+
+/* UTF-8 service name with the terminating zero */
+#define SERVICE_NAME_SIZE 32
+/* UTF-8 event name and description with the terminating zero */
+#define EVENT_NAME_SIZE 64
+#define EVENT_TEXT_SIZE 256
+
+/* running_status values */
+#define RUNNING_STATUS_UNDEFINED	0
+#define RUNNING_STATUS_RUNNING		4
 
 typedef struct PATTable {
 	uint16_t programNumber;
 	uint16_t programMapPID;
 } PATTable;
 
+typedef struct PMTStream {
+	uint8_t streamType;
+	uint16_t elementaryPID;
+	/* ES descriptors are left in the section */
+	uint16_t descriptorsOffset;
+	uint16_t descriptorsLength;
+} PMTStream;
+
+typedef struct PMTSubtitle {
+	uint16_t elementaryPID;
+	char language[LANGUAGE_CODE_SIZE];
+	/* 0x10 to 0x15 normal, 0x20 to 0x25 for the hard of hearing */
+	uint8_t subtitlingType;
+	/* Segments of both pages make up the subtitles */
+	uint16_t compositionPageId;
+	uint16_t ancillaryPageId;
+} PMTSubtitle;
+
 typedef struct PMTTable {
 	uint16_t videoPID;
 	uint16_t audioPID;
+	/* PCR_PID of the program, PMT_NO_PCR_PID if it has no PCR */
+	uint16_t pcrPID;
 	uint8_t teletext;
+	/* Stream with the teletext descriptor, 0 if there is none */
+	uint16_t teletextPID;
+	/* Entries of the subtitling descriptors in the order of the PMT */
+	uint8_t numOfSubtitles;
+	PMTSubtitle subtitles[PMT_MAX_SUBTITLES];
 } PMTTable;
 
+typedef struct SDTService {
+	uint16_t serviceId;
+	uint8_t serviceType;
+	char serviceName[SERVICE_NAME_SIZE];
+} SDTService;
+
+typedef struct NITService {
+	uint16_t serviceId;
+	uint16_t logicalChannelNumber;
+	uint8_t serviceType;
+	uint8_t visible;
+} NITService;
+
+typedef struct EITEvent {
+	uint16_t serviceId;
+	uint16_t eventId;
+	/* UTC seconds since 1970, 0 if undefined */
+	uint32_t startTime;
+	/* Seconds */
+	uint32_t duration;
+	uint8_t runningStatus;
+	char eventName[EVENT_NAME_SIZE];
+	char eventText[EVENT_TEXT_SIZE];
+} EITEvent;
+
 /***********************************************************************
 * @brief    Parses the PAT table and saves the program numbers and their
-* 			network PID
+* 			network PID, sections with wrong CRC_32 are rejected
 * 
 * @param    [in] buffer - pointer to array with PAT table
 * @param    [in] programTable - pointer to array of type PATTable where 
-* 								to save program number and network PID
+* 								to save program number and network PID,
+* 								with PAT_MAX_PROGRAMS elements
 *
-* @return   numOfPrograms - number of channels
+* @return   numOfPrograms - number of channels, 0 if the section is
+* 							corrupted
 *
 ***********************************************************************/
-uint32_t PAT_Parse(uint8_t* buffer, PATTable* programTable);
+uint32_t PAT_Parse(const uint8_t* buffer, PATTable* programTable);
 
 /***********************************************************************
 * @brief    Parses the PMT table and saves the audio and video PID of
-* 			the streams, and information if there is teletext,
-* 			if videoPID is 0, then the channel is audio only
+* 			the streams, the teletext PID if there is teletext and the
+* 			subtitle components, if videoPID is 0, then the channel is
+* 			audio only. Sections with wrong CRC_32 are rejected
 * 
 * @param    [in] buffer - pointer to array with PMT table
 * @param    [out] returnValues - pointer to structure which contains the
@@ -43,9 +143,83 @@ uint32_t PAT_Parse(uint8_t* buffer, PATTable* programTable);
 * 								 information if there is teletext 
 *
 * @return   EXIT_SUCCESS - no error
-* @return   EXIT_FAILURE - error
+* @return   EXIT_FAILURE - error or corrupted section
+*
+***********************************************************************/
+int32_t PMT_Parse(const uint8_t* buffer, PMTTable* returnValues);
+
+/***********************************************************************
+* @brief    Decodes the program loop of a PAT section, entries which do
+* 			not fit in section_length are ignored. CRC_32 is not
+* 			checked, the network PID entry is skipped
+* 
+* @param    [in] buffer - pointer to array with PAT table
+* @param    [out] programTable - pointer to array of type PATTable
+* @param    [in] maxPrograms - number of elements in programTable
+*
+* @return   numOfPrograms - number of programs
+*
+***********************************************************************/
+uint32_t PAT_Decode_Programs(const uint8_t* buffer, PATTable* programTable, uint32_t maxPrograms);
+
+/***********************************************************************
+* @brief    Decodes the elementary stream loop of a PMT section, streams
+* 			which do not fit in section_length are ignored. CRC_32 is
+* 			not checked
+* 
+* @param    [in] buffer - pointer to array with PMT table
+* @param    [out] streamTable - pointer to array of type PMTStream
+* @param    [in] maxStreams - number of elements in streamTable
+*
+* @return   numOfStreams - number of elementary streams
+*
+***********************************************************************/
+uint32_t PMT_Decode_Streams(const uint8_t* buffer, PMTStream* streamTable, uint32_t maxStreams);
+
+/***********************************************************************
+* @brief    Parses the SDT table and saves the service names, converted
+* 			to UTF-8, and service types. Sections with wrong CRC_32 are
+* 			rejected
+* 
+* @param    [in] buffer - pointer to array with SDT table
+* @param    [out] serviceTable - pointer to array of type SDTService
+* @param    [in] maxServices - number of elements in serviceTable
+*
+* @return   numOfServices - number of services, 0 if the section is
+* 							corrupted
+*
+***********************************************************************/
+uint32_t SDT_Parse(const uint8_t* buffer, SDTService* serviceTable, uint32_t maxServices);
+
+/***********************************************************************
+* @brief    Parses the NIT table and saves the service types from the
+* 			service list descriptors and the logical channel numbers.
+* 			Sections with wrong CRC_32 are rejected
+* 
+* @param    [in] buffer - pointer to array with NIT table
+* @param    [out] serviceTable - pointer to array of type NITService
+* @param    [in] maxServices - number of elements in serviceTable
+*
+* @return   numOfServices - number of services, 0 if the section is
+* 							corrupted
+*
+***********************************************************************/
+uint32_t NIT_Parse(const uint8_t* buffer, NITService* serviceTable, uint32_t maxServices);
+
+/***********************************************************************
+* @brief    Parses the EIT table, present/following or schedule, and
+* 			saves the events with the name and description from the
+* 			first short event descriptor, converted to UTF-8. Sections
+* 			with wrong CRC_32 are rejected
+* 
+* @param    [in] buffer - pointer to array with EIT table
+* @param    [out] eventTable - pointer to array of type EITEvent
+* @param    [in] maxEvents - number of elements in eventTable
+*
+* @return   numOfEvents - number of events, 0 if the section is
+* 						  corrupted
 *
 ***********************************************************************/
-int32_t PMT_Parse(uint8_t* buffer, PMTTable* returnValues);
+uint32_t EIT_Parse(const uint8_t* buffer, EITEvent* eventTable, uint32_t maxEvents);
 
 #endif
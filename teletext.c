@@ -0,0 +1,927 @@
+#include "teletext.h"
+
+/* PES of EBU teletext, EN 300 472 */
+#define TELETEXT_STREAM_ID 0xBD
+#define TELETEXT_DATA_IDENTIFIER_FIRST 0x10
+#define TELETEXT_DATA_IDENTIFIER_LAST 0x1F
+#define TELETEXT_DATA_UNIT_NON_SUBTITLE 0x02
+#define TELETEXT_DATA_UNIT_SUBTITLE 0x03
+/* Field and line byte, framing code and the 42 bytes of the packet */
+#define TELETEXT_DATA_UNIT_LENGTH 0x2C
+#define TELETEXT_FRAMING_CODE 0xE4
+#define TELETEXT_PACKET_SIZE 42
+/* data_unit_id and data_unit_length before the data */
+#define TELETEXT_DATA_UNIT_HEADER 2
+#define TELETEXT_MAX_DATA_UNIT (TELETEXT_DATA_UNIT_HEADER + 0xFF)
+
+/* Decoded byte which had more errors than the code corrects */
+#define HAMMING_ERROR 0xFF
+/* Character with a parity error, the cached one is kept in its place */
+#define PARITY_ERROR 0xFF
+#define CC_UNKNOWN 0xFF
+#define NO_SLOT 0xFFFF
+#define NO_CHARACTER_SET 0xFF
+
+typedef struct TeletextSlot {
+	TeletextPage page;
+	/* Next subpage of the same page */
+	uint16_t next;
+	/* Value of the update clock when the page was stored */
+	uint32_t lastUpdate;
+} TeletextSlot;
+
+/* Page of a magazine between its header and the next header */
+typedef struct TeletextAssembly {
+	uint8_t receiving;
+	TeletextPage page;
+	uint8_t linksReceived;
+} TeletextAssembly;
+
+/***********************************************************************
+* @brief    Starts a PES packet at the payload of a packet with the
+* 			payload_unit_start_indicator
+*
+* @param    [in] payload - start of the PES packet
+* @param    [in] size - payload bytes in the transport packet
+*
+***********************************************************************/
+static void Start_Pes(const uint8_t* payload, uint32_t size);
+
+/***********************************************************************
+* @brief    Splits the PES data into data units, a data unit may go on
+* 			in the next transport packet
+*
+* @param    [in] data - PES data bytes
+* @param    [in] size - number of bytes
+*
+***********************************************************************/
+static void Feed_Pes_Data(const uint8_t* data, uint32_t size);
+
+/***********************************************************************
+* @brief    Decodes a complete data unit, starting at data_unit_id
+*
+***********************************************************************/
+static void Decode_Data_Unit(const uint8_t* unit);
+
+/***********************************************************************
+* @brief    Decodes one teletext packet in the bit order of the PES
+*
+* @param    [in] data - TELETEXT_PACKET_SIZE bytes
+*
+***********************************************************************/
+static void Decode_Packet(const uint8_t* data);
+
+/***********************************************************************
+* @brief    Starts receiving a page from its header packet
+*
+* @param    [in] magazine - 0 to 7, 0 is magazine 8
+* @param    [in] packet - bits of the packet in teletext order
+*
+***********************************************************************/
+static void Decode_Header(uint8_t magazine, const uint8_t* packet);
+
+/***********************************************************************
+* @brief    Decodes the FLOF links of packet X/27/0
+*
+***********************************************************************/
+static void Decode_Links(uint8_t magazine, const uint8_t* packet);
+
+/***********************************************************************
+* @brief    Copies characters with odd parity, errors are marked
+*
+***********************************************************************/
+static void Decode_Characters(uint8_t* destination, const uint8_t* packet, uint32_t count);
+
+/***********************************************************************
+* @brief    Stores the page received in the magazine to the cache and
+* 			calls the callback
+*
+***********************************************************************/
+static void Commit_Page(uint8_t magazine);
+
+/***********************************************************************
+* @brief    Returns the slot of the subpage, NO_SLOT if it is not cached
+*
+***********************************************************************/
+static uint16_t Find_Slot(uint16_t pageNumber, uint16_t subpage);
+
+/***********************************************************************
+* @brief    Takes a free slot, or the one which was stored the longest
+* 			time ago, and links it to the page
+*
+***********************************************************************/
+static uint16_t Allocate_Slot(uint16_t pageNumber);
+
+/***********************************************************************
+* @brief    Empties the cache, called with the cache mutex held
+*
+***********************************************************************/
+static void Reset_Cache();
+
+/***********************************************************************
+* @brief    Forgets the PES and the pages being received, only on the
+* 			demux thread
+*
+***********************************************************************/
+static void Reset_Reception();
+
+/***********************************************************************
+* @brief    Decodes a Hamming 8/4 byte in teletext bit order
+*
+* @return   4 data bits, HAMMING_ERROR if two bits are wrong
+*
+***********************************************************************/
+static uint8_t Hamming_8_4(uint8_t value);
+
+/***********************************************************************
+* @brief    Decodes a Hamming 24/18 triplet in teletext bit order
+*
+* @return   18 data bits, UINT32_MAX if two bits are wrong
+*
+***********************************************************************/
+static uint32_t Hamming_24_18(const uint8_t* triplet);
+
+static TeletextSlot* slots = NULL;
+/* First subpage of every page number */
+static uint16_t pageSlots[TELETEXT_NUM_PAGES];
+static uint16_t freeSlot;
+static uint32_t updateClock;
+static TeletextAssembly assemblies[TELETEXT_MAGAZINES];
+static uint8_t magazineCharacterSets[TELETEXT_MAGAZINES];
+static pthread_mutex_t cacheMutex;
+static Teletext_Page_Callback pageCallback = NULL;
+static void* pageArgument = NULL;
+static TeletextStatistics statistics;
+
+/* PES state, only the demux thread changes it */
+static uint16_t teletextPID = 0;
+static uint8_t lastCC = CC_UNKNOWN;
+static uint8_t pesStarted = 0;
+static uint32_t pesRemaining = 0;
+static uint8_t unit[TELETEXT_MAX_DATA_UNIT];
+static uint32_t unitBytes = 0;
+
+/* Bytes are sent with the first teletext bit as the least significant one */
+static uint8_t reversedBits[256];
+static uint8_t hamming84[256];
+
+int32_t Teletext_Init(Teletext_Page_Callback callback, void* argument)
+{
+	uint8_t codeWords[16];
+	uint8_t d1;
+	uint8_t d2;
+	uint8_t d3;
+	uint8_t d4;
+	uint32_t value;
+	uint32_t i;
+	uint32_t j;
+
+	slots = (TeletextSlot*)malloc(sizeof(TeletextSlot) * TELETEXT_CACHE_PAGES);
+	if (slots == NULL)
+	{
+		printf("%s(%d): Error allocating the page cache!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+	if (pthread_mutex_init(&cacheMutex, NULL))
+	{
+		printf("%s(%d): Error initializing cache mutex!\n", __FUNCTION__, __LINE__);
+		free(slots);
+		slots = NULL;
+		return EXIT_FAILURE;
+	}
+
+	for (value = 0; value < 256; value++)
+	{
+		reversedBits[value] = 0;
+		for (i = 0; i < 8; i++)
+		{
+			reversedBits[value] |= ((value >> i) & 1) << (7 - i);
+		}
+	}
+
+	/* Data bits D1 to D4 are b2, b4, b6 and b8, the tests have odd parity */
+	for (value = 0; value < 16; value++)
+	{
+		d1 = value & 1;
+		d2 = (value >> 1) & 1;
+		d3 = (value >> 2) & 1;
+		d4 = (value >> 3) & 1;
+		codeWords[value] = ((1 ^ d1 ^ d3 ^ d4) << 0) | (d1 << 1) | ((1 ^ d1 ^ d2 ^ d4) << 2) | (d2 << 3)
+						   | ((1 ^ d1 ^ d2 ^ d3) << 4) | (d3 << 5) | (d4 << 7);
+		codeWords[value] |= (__builtin_parity(codeWords[value]) ^ 1) << 6;
+	}
+	/* Code words are 4 bits apart, one wrong bit is corrected */
+	for (value = 0; value < 256; value++)
+	{
+		hamming84[value] = HAMMING_ERROR;
+		for (j = 0; j < 16; j++)
+		{
+			if (__builtin_popcount(value ^ codeWords[j]) <= 1)
+			{
+				hamming84[value] = j;
+			}
+		}
+	}
+
+	memset(&statistics, 0, sizeof(statistics));
+	pageCallback = callback;
+	pageArgument = argument;
+	teletextPID = 0;
+	Reset_Cache();
+	Reset_Reception();
+	return EXIT_SUCCESS;
+}
+
+int32_t Teletext_Deinit()
+{
+	pthread_mutex_destroy(&cacheMutex);
+	free(slots);
+	slots = NULL;
+	pageCallback = NULL;
+	return EXIT_SUCCESS;
+}
+
+void Teletext_Reset()
+{
+	if (slots == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&cacheMutex);
+	Reset_Cache();
+	pthread_mutex_unlock(&cacheMutex);
+	/* No teletext is sent on PID 0, the demux thread starts the reception over with its next packet */
+	__atomic_store_n(&teletextPID, 0, __ATOMIC_RELAXED);
+}
+
+int32_t Teletext_Packet_Received(const uint8_t* packet, uint16_t pid, void* userData)
+{
+	uint8_t adaptationFieldControl;
+	uint8_t continuityCounter;
+	uint32_t offset = 4;
+
+	if (slots == NULL)
+	{
+		return EXIT_SUCCESS;
+	}
+
+	/* Teletext of another service, or the cache was reset by a channel change */
+	if (pid != __atomic_load_n(&teletextPID, __ATOMIC_RELAXED))
+	{
+		pthread_mutex_lock(&cacheMutex);
+		Reset_Cache();
+		pthread_mutex_unlock(&cacheMutex);
+		Reset_Reception();
+		__atomic_store_n(&teletextPID, pid, __ATOMIC_RELAXED);
+	}
+
+	/* transport_error_indicator, the PES is lost */
+	if (packet[1] & 0x80)
+	{
+		pesStarted = 0;
+		lastCC = CC_UNKNOWN;
+		return EXIT_SUCCESS;
+	}
+
+	adaptationFieldControl = (packet[3] >> 4) & 0x03;
+	continuityCounter = packet[3] & 0x0F;
+	if (!(adaptationFieldControl & 0x01))
+	{
+		return EXIT_SUCCESS;
+	}
+	if (lastCC != CC_UNKNOWN)
+	{
+		if (continuityCounter == lastCC)
+		{
+			return EXIT_SUCCESS;
+		}
+		if (continuityCounter != ((lastCC + 1) & 0x0F))
+		{
+			__atomic_add_fetch(&statistics.continuityErrors, 1, __ATOMIC_RELAXED);
+			pesStarted = 0;
+		}
+	}
+	lastCC = continuityCounter;
+
+	if (adaptationFieldControl & 0x02)
+	{
+		offset += 1 + packet[4];
+		if (offset >= TS_PACKET_SIZE)
+		{
+			return EXIT_SUCCESS;
+		}
+	}
+
+	if (packet[1] & 0x40)
+	{
+		Start_Pes(packet + offset, TS_PACKET_SIZE - offset);
+	}
+	else if (pesStarted)
+	{
+		Feed_Pes_Data(packet + offset, TS_PACKET_SIZE - offset);
+	}
+	return EXIT_SUCCESS;
+}
+
+int32_t Teletext_Get_Page(uint16_t pageNumber, uint16_t subpage, TeletextPage* outPage)
+{
+	uint16_t slot;
+	uint16_t latest = NO_SLOT;
+
+	if (slots == NULL || pageNumber < TELETEXT_FIRST_PAGE || pageNumber > TELETEXT_LAST_PAGE)
+	{
+		return EXIT_FAILURE;
+	}
+
+	pthread_mutex_lock(&cacheMutex);
+	if (subpage == TELETEXT_ANY_SUBPAGE)
+	{
+		for (slot = pageSlots[pageNumber - TELETEXT_FIRST_PAGE]; slot != NO_SLOT; slot = slots[slot].next)
+		{
+			if (latest == NO_SLOT || slots[slot].lastUpdate > slots[latest].lastUpdate)
+			{
+				latest = slot;
+			}
+		}
+	}
+	else
+	{
+		latest = Find_Slot(pageNumber, subpage);
+	}
+	if (latest == NO_SLOT)
+	{
+		pthread_mutex_unlock(&cacheMutex);
+		return EXIT_FAILURE;
+	}
+	memcpy(outPage, &slots[latest].page, sizeof(TeletextPage));
+	pthread_mutex_unlock(&cacheMutex);
+	return EXIT_SUCCESS;
+}
+
+uint16_t Teletext_Next_Page(uint16_t pageNumber, int32_t direction)
+{
+	uint32_t index;
+	uint32_t i;
+
+	if (slots == NULL)
+	{
+		return TELETEXT_NO_PAGE;
+	}
+	if (pageNumber < TELETEXT_FIRST_PAGE || pageNumber > TELETEXT_LAST_PAGE)
+	{
+		pageNumber = TELETEXT_FIRST_PAGE;
+	}
+
+	pthread_mutex_lock(&cacheMutex);
+	index = pageNumber - TELETEXT_FIRST_PAGE;
+	for (i = 0; i < TELETEXT_NUM_PAGES; i++)
+	{
+		index = (direction < 0) ? (index + TELETEXT_NUM_PAGES - 1) % TELETEXT_NUM_PAGES
+								: (index + 1) % TELETEXT_NUM_PAGES;
+		if (pageSlots[index] != NO_SLOT)
+		{
+			pthread_mutex_unlock(&cacheMutex);
+			return index + TELETEXT_FIRST_PAGE;
+		}
+	}
+	pthread_mutex_unlock(&cacheMutex);
+	return TELETEXT_NO_PAGE;
+}
+
+void Teletext_Get_Statistics(TeletextStatistics* outStatistics)
+{
+	if (slots == NULL)
+	{
+		memset(outStatistics, 0, sizeof(TeletextStatistics));
+		return;
+	}
+	/* Counters are bumped on the demux thread without the cache mutex */
+	outStatistics->pesPackets = __atomic_load_n(&statistics.pesPackets, __ATOMIC_RELAXED);
+	outStatistics->packets = __atomic_load_n(&statistics.packets, __ATOMIC_RELAXED);
+	outStatistics->hammingErrors = __atomic_load_n(&statistics.hammingErrors, __ATOMIC_RELAXED);
+	outStatistics->parityErrors = __atomic_load_n(&statistics.parityErrors, __ATOMIC_RELAXED);
+	outStatistics->continuityErrors = __atomic_load_n(&statistics.continuityErrors, __ATOMIC_RELAXED);
+	outStatistics->pages = __atomic_load_n(&statistics.pages, __ATOMIC_RELAXED);
+	outStatistics->cachedPages = __atomic_load_n(&statistics.cachedPages, __ATOMIC_RELAXED);
+	outStatistics->evictions = __atomic_load_n(&statistics.evictions, __ATOMIC_RELAXED);
+}
+
+void Start_Pes(const uint8_t* payload, uint32_t size)
+{
+	uint32_t headerLength;
+	uint16_t pesLength;
+
+	pesStarted = 0;
+	unitBytes = 0;
+	/*
+	 * 9 bytes are:			bit
+	 * packet_start_code_prefix	24
+	 * stream_id				08
+	 * PES_packet_length		16
+	 * flags					16
+	 * PES_header_data_length	08
+	 */
+	if (size < 9 || payload[0] != 0x00 || payload[1] != 0x00 || payload[2] != 0x01
+		|| payload[3] != TELETEXT_STREAM_ID)
+	{
+		return;
+	}
+	pesLength = (payload[4] << 8) | payload[5];
+	headerLength = 9 + payload[8];
+	/* Header is padded so that the data units fill whole packets, it is never split */
+	if (headerLength + 1 > size || pesLength < headerLength - 6 + 1)
+	{
+		return;
+	}
+	if (payload[headerLength] < TELETEXT_DATA_IDENTIFIER_FIRST || payload[headerLength] > TELETEXT_DATA_IDENTIFIER_LAST)
+	{
+		return;
+	}
+
+	__atomic_add_fetch(&statistics.pesPackets, 1, __ATOMIC_RELAXED);
+	pesStarted = 1;
+	/* Bytes after the data_identifier, 0 length is not allowed for teletext */
+	pesRemaining = pesLength + 6 - headerLength - 1;
+	Feed_Pes_Data(payload + headerLength + 1, size - headerLength - 1);
+}
+
+void Feed_Pes_Data(const uint8_t* data, uint32_t size)
+{
+	uint32_t needed;
+	uint32_t copied;
+
+	if (size > pesRemaining)
+	{
+		size = pesRemaining;
+	}
+	pesRemaining -= size;
+
+	while (size > 0)
+	{
+		/* Units which are whole in the packet are decoded in place */
+		if (unitBytes == 0 && size >= TELETEXT_DATA_UNIT_HEADER
+			&& size >= TELETEXT_DATA_UNIT_HEADER + (uint32_t)data[1])
+		{
+			Decode_Data_Unit(data);
+			size -= TELETEXT_DATA_UNIT_HEADER + data[1];
+			data += TELETEXT_DATA_UNIT_HEADER + data[1];
+			continue;
+		}
+
+		needed = (unitBytes < TELETEXT_DATA_UNIT_HEADER) ? TELETEXT_DATA_UNIT_HEADER - unitBytes
+						: TELETEXT_DATA_UNIT_HEADER + unit[1] - unitBytes;
+		copied = (size < needed) ? size : needed;
+		memcpy(unit + unitBytes, data, copied);
+		unitBytes += copied;
+		data += copied;
+		size -= copied;
+		if (unitBytes >= TELETEXT_DATA_UNIT_HEADER && unitBytes == TELETEXT_DATA_UNIT_HEADER + (uint32_t)unit[1])
+		{
+			Decode_Data_Unit(unit);
+			unitBytes = 0;
+		}
+	}
+	if (pesRemaining == 0)
+	{
+		pesStarted = 0;
+	}
+}
+
+void Decode_Data_Unit(const uint8_t* dataUnit)
+{
+	/*
+	 * Data unit is:			bit
+	 * data_unit_id				08
+	 * data_unit_length			08
+	 * field_parity, line_offset	08
+	 * framing_code				08
+	 * teletext packet			42*8
+	 */
+	if ((dataUnit[0] != TELETEXT_DATA_UNIT_NON_SUBTITLE && dataUnit[0] != TELETEXT_DATA_UNIT_SUBTITLE)
+		|| dataUnit[1] != TELETEXT_DATA_UNIT_LENGTH || dataUnit[3] != TELETEXT_FRAMING_CODE)
+	{
+		/* Stuffing units are 0xFF */
+		return;
+	}
+	Decode_Packet(dataUnit + 4);
+}
+
+void Decode_Packet(const uint8_t* data)
+{
+	TeletextAssembly* assembly;
+	uint8_t packet[TELETEXT_PACKET_SIZE];
+	uint8_t address0;
+	uint8_t address1;
+	uint8_t magazine;
+	uint8_t row;
+	uint8_t designation;
+	uint32_t triplet;
+	uint32_t i;
+
+	for (i = 0; i < TELETEXT_PACKET_SIZE; i++)
+	{
+		packet[i] = reversedBits[data[i]];
+	}
+
+	__atomic_add_fetch(&statistics.packets, 1, __ATOMIC_RELAXED);
+
+	/* Magazine and packet address, 3 and 5 bits */
+	address0 = Hamming_8_4(packet[0]);
+	address1 = Hamming_8_4(packet[1]);
+	if (address0 == HAMMING_ERROR || address1 == HAMMING_ERROR)
+	{
+		return;
+	}
+	magazine = address0 & 0x07;
+	row = (address0 >> 3) | (address1 << 1);
+	assembly = &assemblies[magazine];
+
+	if (row == 0)
+	{
+		Decode_Header(magazine, packet);
+	}
+	else if (row < TELETEXT_ROWS)
+	{
+		if (assembly->receiving)
+		{
+			Decode_Characters(assembly->page.rows[row], packet + 2, TELETEXT_COLUMNS);
+			assembly->page.rowMask |= 1 << row;
+		}
+	}
+	else if (row == 27)
+	{
+		if (assembly->receiving && Hamming_8_4(packet[2]) == 0)
+		{
+			Decode_Links(magazine, packet);
+		}
+	}
+	else if (row == 28 || row == 29)
+	{
+		/* Format 1 of X/28/0 and M/29/0, the character set is in triplet 1 */
+		designation = Hamming_8_4(packet[2]);
+		if (designation != 0)
+		{
+			return;
+		}
+		triplet = Hamming_24_18(packet + 3);
+		if (triplet == UINT32_MAX)
+		{
+			return;
+		}
+		if (row == 29)
+		{
+			magazineCharacterSets[magazine] = (triplet >> 7) & 0x7F;
+		}
+		else if (assembly->receiving)
+		{
+			assembly->page.characterSet = (triplet >> 7) & 0x7F;
+		}
+	}
+	/* Enhancements of X/26, row 25 and the service data of packets 30 and 31 are not used */
+}
+
+void Decode_Header(uint8_t magazine, const uint8_t* packet)
+{
+	TeletextAssembly* assembly = &assemblies[magazine];
+	uint8_t nibbles[8];
+	uint16_t controlBits;
+	uint32_t i;
+
+	for (i = 0; i < 8; i++)
+	{
+		nibbles[i] = Hamming_8_4(packet[2 + i]);
+		if (nibbles[i] == HAMMING_ERROR)
+		{
+			/* Rows which follow can not be given to any page */
+			Commit_Page(magazine);
+			return;
+		}
+	}
+
+	/*
+	 * 8 nibbles are:	bit
+	 * page units		4
+	 * page tens		4
+	 * S1				4
+	 * S2, C4			3, 1
+	 * S3				4
+	 * S4, C5, C6		2, 1, 1
+	 * C7 to C10		4
+	 * C11 to C14		4
+	 */
+	controlBits = ((nibbles[3] >> 3) << 4) | (((nibbles[5] >> 2) & 0x03) << 5) | (nibbles[6] << 7)
+				  | (nibbles[7] << 11);
+
+	/* Header ends the page of its magazine, in serial mode of every magazine */
+	if (controlBits & TELETEXT_C11_SERIAL)
+	{
+		for (i = 0; i < TELETEXT_MAGAZINES; i++)
+		{
+			Commit_Page(i);
+		}
+	}
+	else
+	{
+		Commit_Page(magazine);
+	}
+
+	/* Page FF only ends the previous page */
+	if (nibbles[0] == 0x0F && nibbles[1] == 0x0F)
+	{
+		return;
+	}
+
+	memset(assembly->page.rows, ' ', sizeof(assembly->page.rows));
+	assembly->page.pageNumber = ((magazine ? magazine : 8) << 8) | (nibbles[1] << 4) | nibbles[0];
+	assembly->page.subpage = ((nibbles[5] & 0x03) << 12) | (nibbles[4] << 8) | ((nibbles[3] & 0x07) << 4) | nibbles[2];
+	assembly->page.controlBits = controlBits;
+	assembly->page.characterSet = (magazineCharacterSets[magazine] != NO_CHARACTER_SET)
+								  ? magazineCharacterSets[magazine] : (nibbles[7] >> 1);
+	assembly->page.rowMask = 1;
+	assembly->page.receptions = 0;
+	for (i = 0; i < TELETEXT_LINKS; i++)
+	{
+		assembly->page.links[i] = TELETEXT_NO_PAGE;
+	}
+	assembly->linksReceived = 0;
+	Decode_Characters(assembly->page.rows[0] + TELETEXT_HEADER_COLUMN, packet + 10,
+					  TELETEXT_COLUMNS - TELETEXT_HEADER_COLUMN);
+	assembly->receiving = 1;
+}
+
+void Decode_Links(uint8_t magazine, const uint8_t* packet)
+{
+	TeletextAssembly* assembly = &assemblies[magazine];
+	const uint8_t* link;
+	uint8_t nibbles[6];
+	uint8_t linkMagazine;
+	uint32_t i;
+	uint32_t j;
+
+	/* 6 bytes per link, page and subcode like the header with the magazine bits in S2 and S4 */
+	for (i = 0; i < TELETEXT_LINKS; i++)
+	{
+		link = packet + 3 + 6 * i;
+		for (j = 0; j < 6; j++)
+		{
+			nibbles[j] = Hamming_8_4(link[j]);
+			if (nibbles[j] == HAMMING_ERROR)
+			{
+				break;
+			}
+		}
+		if (j < 6 || (nibbles[0] == 0x0F && nibbles[1] == 0x0F))
+		{
+			continue;
+		}
+		/* Magazine is relative to the one of the page */
+		linkMagazine = magazine ^ ((nibbles[3] >> 3) | ((nibbles[5] >> 2) << 1));
+		assembly->page.links[i] = ((linkMagazine ? linkMagazine : 8) << 8) | (nibbles[1] << 4) | nibbles[0];
+	}
+	assembly->linksReceived = 1;
+}
+
+void Decode_Characters(uint8_t* destination, const uint8_t* packet, uint32_t count)
+{
+	uint32_t errors = 0;
+	uint32_t i;
+
+	for (i = 0; i < count; i++)
+	{
+		if (__builtin_parity(packet[i]))
+		{
+			destination[i] = packet[i] & 0x7F;
+		}
+		else
+		{
+			destination[i] = PARITY_ERROR;
+			errors++;
+		}
+	}
+	if (errors > 0)
+	{
+		__atomic_add_fetch(&statistics.parityErrors, errors, __ATOMIC_RELAXED);
+	}
+}
+
+void Commit_Page(uint8_t magazine)
+{
+	TeletextAssembly* assembly = &assemblies[magazine];
+	TeletextPage* page;
+	uint16_t slot;
+	uint8_t fresh;
+	uint8_t character;
+	uint32_t row;
+	uint32_t column;
+
+	if (!assembly->receiving)
+	{
+		return;
+	}
+	assembly->receiving = 0;
+
+	pthread_mutex_lock(&cacheMutex);
+	slot = Find_Slot(assembly->page.pageNumber, assembly->page.subpage);
+	fresh = (slot == NO_SLOT);
+	if (fresh)
+	{
+		slot = Allocate_Slot(assembly->page.pageNumber);
+	}
+	page = &slots[slot].page;
+	if (fresh)
+	{
+		page->receptions = 0;
+	}
+
+	/* Rows which were not sent again stay, unless the page is erased */
+	if (fresh || (assembly->page.controlBits & TELETEXT_C4_ERASE_PAGE))
+	{
+		memset(page->rows, ' ', sizeof(page->rows));
+		page->rowMask = 0;
+		for (column = 0; column < TELETEXT_LINKS; column++)
+		{
+			page->links[column] = TELETEXT_NO_PAGE;
+		}
+	}
+	for (row = 0; row < TELETEXT_ROWS; row++)
+	{
+		if (!(assembly->page.rowMask & (1 << row)))
+		{
+			continue;
+		}
+		for (column = 0; column < TELETEXT_COLUMNS; column++)
+		{
+			character = assembly->page.rows[row][column];
+			if (character != PARITY_ERROR)
+			{
+				page->rows[row][column] = character;
+			}
+			else if (!(page->rowMask & (1 << row)))
+			{
+				page->rows[row][column] = ' ';
+			}
+		}
+	}
+	page->pageNumber = assembly->page.pageNumber;
+	page->subpage = assembly->page.subpage;
+	page->controlBits = assembly->page.controlBits;
+	page->characterSet = assembly->page.characterSet;
+	page->rowMask |= assembly->page.rowMask;
+	if (assembly->linksReceived)
+	{
+		memcpy(page->links, assembly->page.links, sizeof(page->links));
+	}
+	page->receptions++;
+	slots[slot].lastUpdate = ++updateClock;
+	__atomic_add_fetch(&statistics.pages, 1, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&cacheMutex);
+
+	if (pageCallback != NULL)
+	{
+		pageCallback(assembly->page.pageNumber, assembly->page.subpage, pageArgument);
+	}
+}
+
+uint16_t Find_Slot(uint16_t pageNumber, uint16_t subpage)
+{
+	uint16_t slot;
+
+	for (slot = pageSlots[pageNumber - TELETEXT_FIRST_PAGE]; slot != NO_SLOT; slot = slots[slot].next)
+	{
+		if (slots[slot].page.subpage == subpage)
+		{
+			return slot;
+		}
+	}
+	return NO_SLOT;
+}
+
+uint16_t Allocate_Slot(uint16_t pageNumber)
+{
+	uint16_t* link;
+	uint16_t slot;
+	uint32_t i;
+
+	if (freeSlot != NO_SLOT)
+	{
+		slot = freeSlot;
+		freeSlot = slots[slot].next;
+		__atomic_add_fetch(&statistics.cachedPages, 1, __ATOMIC_RELAXED);
+	}
+	else
+	{
+		/* Cache is full only with more subpages than it was sized for, this is rare */
+		slot = 0;
+		for (i = 1; i < TELETEXT_CACHE_PAGES; i++)
+		{
+			if (slots[i].lastUpdate < slots[slot].lastUpdate)
+			{
+				slot = i;
+			}
+		}
+		for (link = &pageSlots[slots[slot].page.pageNumber - TELETEXT_FIRST_PAGE]; *link != slot;
+			 link = &slots[*link].next);
+		*link = slots[slot].next;
+		__atomic_add_fetch(&statistics.evictions, 1, __ATOMIC_RELAXED);
+	}
+
+	slots[slot].next = pageSlots[pageNumber - TELETEXT_FIRST_PAGE];
+	pageSlots[pageNumber - TELETEXT_FIRST_PAGE] = slot;
+	return slot;
+}
+
+void Reset_Cache()
+{
+	uint32_t i;
+
+	for (i = 0; i < TELETEXT_NUM_PAGES; i++)
+	{
+		pageSlots[i] = NO_SLOT;
+	}
+	for (i = 0; i < TELETEXT_CACHE_PAGES; i++)
+	{
+		slots[i].next = (i + 1 < TELETEXT_CACHE_PAGES) ? i + 1 : NO_SLOT;
+		slots[i].lastUpdate = 0;
+	}
+	freeSlot = 0;
+	updateClock = 0;
+	__atomic_store_n(&statistics.cachedPages, 0, __ATOMIC_RELAXED);
+}
+
+void Reset_Reception()
+{
+	uint32_t i;
+
+	for (i = 0; i < TELETEXT_MAGAZINES; i++)
+	{
+		assemblies[i].receiving = 0;
+		magazineCharacterSets[i] = NO_CHARACTER_SET;
+	}
+	lastCC = CC_UNKNOWN;
+	pesStarted = 0;
+	unitBytes = 0;
+}
+
+uint8_t Hamming_8_4(uint8_t value)
+{
+	uint8_t data = hamming84[value];
+
+	if (data == HAMMING_ERROR)
+	{
+		__atomic_add_fetch(&statistics.hammingErrors, 1, __ATOMIC_RELAXED);
+	}
+	return data;
+}
+
+uint32_t Hamming_24_18(const uint8_t* triplet)
+{
+	uint32_t word = triplet[0] | (triplet[1] << 8) | (triplet[2] << 16);
+	uint32_t syndrome = 0;
+	uint32_t check;
+	uint32_t position;
+	uint32_t test;
+
+	/* Bit n of the word is position n + 1, tests A to E cover the positions with their bit set */
+	for (test = 0; test < 5; test++)
+	{
+		check = 0;
+		for (position = 1; position <= 23; position++)
+		{
+			if (position & (1 << test))
+			{
+				check ^= (word >> (position - 1)) & 1;
+			}
+		}
+		if (check == 0)
+		{
+			syndrome |= 1 << test;
+		}
+	}
+
+	/* Test F is the odd parity of all bits, it fails for one wrong bit */
+	if (__builtin_parity(word) == 0)
+	{
+		if (syndrome != 0 && syndrome <= 23)
+		{
+			word ^= 1 << (syndrome - 1);
+		}
+		else if (syndrome != 0)
+		{
+			syndrome = UINT32_MAX;
+		}
+	}
+	else if (syndrome != 0)
+	{
+		/* Two wrong bits */
+		syndrome = UINT32_MAX;
+	}
+	if (syndrome == UINT32_MAX)
+	{
+		__atomic_add_fetch(&statistics.hammingErrors, 1, __ATOMIC_RELAXED);
+		return UINT32_MAX;
+	}
+
+	/* D1 is position 3, D2 to D4 positions 5 to 7, D5 to D11 9 to 15, D12 to D18 17 to 23 */
+	return ((word >> 2) & 0x01) | ((word >> 3) & 0x0E) | ((word >> 4) & 0x7F0) | ((word >> 5) & 0x3F800);
+}
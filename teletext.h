@@ -0,0 +1,151 @@
+#ifndef _TELETEXT_H_
+#define _TELETEXT_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include "ts_demux.h"
+
+/* Rows 1 to 24 are shown under the header row 0 */
+#define TELETEXT_ROWS 25
+#define TELETEXT_COLUMNS 40
+/* Header characters start after the page number */
+#define TELETEXT_HEADER_COLUMN 8
+#define TELETEXT_MAGAZINES 8
+/* Pages 0x100 to 0x8FF, hex coded like on the remote */
+#define TELETEXT_FIRST_PAGE 0x100
+#define TELETEXT_LAST_PAGE 0x8FF
+#define TELETEXT_NUM_PAGES (TELETEXT_LAST_PAGE - TELETEXT_FIRST_PAGE + 1)
+/* Slots shared by all pages and subpages, allocated once, about 1 MB */
+#define TELETEXT_CACHE_PAGES 1024
+/* FLOF red, green, yellow, blue, index and the unused sixth link */
+#define TELETEXT_LINKS 6
+#define TELETEXT_NO_PAGE 0xFFFF
+/* Subpage which selects the last received one of a page */
+#define TELETEXT_ANY_SUBPAGE 0xFFFF
+
+/* Control bits of the page header, bit n is Cn */
+#define TELETEXT_C4_ERASE_PAGE (1 << 4)
+#define TELETEXT_C5_NEWSFLASH (1 << 5)
+#define TELETEXT_C6_SUBTITLE (1 << 6)
+#define TELETEXT_C7_SUPPRESS_HEADER (1 << 7)
+#define TELETEXT_C11_SERIAL (1 << 11)
+
+typedef struct TeletextPage {
+	uint16_t pageNumber;
+	/* Subcode S4 S3 S2 S1 as hex digits, 0x0000 if the page does not rotate */
+	uint16_t subpage;
+	uint16_t controlBits;
+	/* Default G0 set and national option, from X/28/0, M/29/0 or C12 to C14 */
+	uint8_t characterSet;
+	/* Bit n is set when row n was received */
+	uint32_t rowMask;
+	/* From X/27/0, TELETEXT_NO_PAGE when the link was not sent */
+	uint16_t links[TELETEXT_LINKS];
+	/* Times the page was received since it entered the cache */
+	uint32_t receptions;
+	/*
+	 * Characters without the parity bit, control codes below 0x20 are
+	 * kept for the renderer. Columns of row 0 before the header are spaces
+	 */
+	uint8_t rows[TELETEXT_ROWS][TELETEXT_COLUMNS];
+} TeletextPage;
+
+/* Called on the demux thread after a page was stored in the cache */
+typedef void(*Teletext_Page_Callback)(uint16_t pageNumber, uint16_t subpage, void* argument);
+
+typedef struct TeletextStatistics {
+	uint32_t pesPackets;
+	/* Teletext packets, one per line of the vertical blanking */
+	uint32_t packets;
+	/* Hamming coded bytes with more than one wrong bit */
+	uint32_t hammingErrors;
+	uint32_t parityErrors;
+	uint32_t continuityErrors;
+	/* Pages stored in the cache, again on every reception */
+	uint32_t pages;
+	uint32_t cachedPages;
+	/* Pages dropped from a full cache, the oldest first */
+	uint32_t evictions;
+} TeletextStatistics;
+
+/***********************************************************************
+* @brief    Teletext initialization function, allocates the page cache
+*
+* @param    [in] callback - called when a page is received, may be NULL
+* @param    [in] argument - passed to the callback
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Teletext_Init(Teletext_Page_Callback callback, void* argument);
+
+/***********************************************************************
+* @brief    Teletext deinitialization function, frees the page cache.
+* 			Packets must not be passed to the decoder any more
+*
+* @return   EXIT_SUCCESS - no error
+*
+***********************************************************************/
+int32_t Teletext_Deinit();
+
+/***********************************************************************
+* @brief    Empties the cache when the channel changes, also when the
+* 			new channel sends its teletext on the same PID or none.
+* 			May be called from any thread
+*
+***********************************************************************/
+void Teletext_Reset();
+
+/***********************************************************************
+* @brief    Decodes a transport packet of the teletext PID, a packet
+* 			consumer of the demux. Pages go to the cache as soon as
+* 			they are complete, a new PID empties the cache
+*
+* @param    [in] packet - transport packet
+* @param    [in] pid - teletext PID
+* @param    [in] userData - unused
+*
+* @return   EXIT_SUCCESS - no error
+*
+***********************************************************************/
+int32_t Teletext_Packet_Received(const uint8_t* packet, uint16_t pid, void* userData);
+
+/***********************************************************************
+* @brief    Copies a page from the cache
+*
+* @param    [in] pageNumber - page from 0x100 to 0x8FF
+* @param    [in] subpage - subcode, TELETEXT_ANY_SUBPAGE for the last
+* 						   received subpage
+* @param    [out] outPage - structure where the page is saved
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - page is not received yet
+*
+***********************************************************************/
+int32_t Teletext_Get_Page(uint16_t pageNumber, uint16_t subpage, TeletextPage* outPage);
+
+/***********************************************************************
+* @brief    Returns the next received page in the direction, after the
+* 			last page comes the first
+*
+* @param    [in] pageNumber - page to start from
+* @param    [in] direction - 1 for the next page, -1 for the previous one
+*
+* @return   page number, TELETEXT_NO_PAGE if the cache is empty
+*
+***********************************************************************/
+uint16_t Teletext_Next_Page(uint16_t pageNumber, int32_t direction);
+
+/***********************************************************************
+* @brief    Copies the decoder counters
+*
+* @param    [out] outStatistics - structure where the counters are saved
+*
+***********************************************************************/
+void Teletext_Get_Statistics(TeletextStatistics* outStatistics);
+
+#endif
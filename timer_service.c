@@ -0,0 +1,346 @@
+#include "timer_service.h"
+
+/***********************************************************************
+* @brief    Waits for the ticks of the timerfd and calls the callbacks
+* 			of the expired timers
+*
+***********************************************************************/
+static void* Timer_Loop();
+
+/***********************************************************************
+* @brief    Advances the wheel by one tick and moves the expired timers
+* 			to the expired list. Called with the service mutex locked
+*
+***********************************************************************/
+static void Advance_Wheel();
+
+/***********************************************************************
+* @brief    Inserts the timer before the sentinel of a list
+*
+***********************************************************************/
+static void Link_Timer(TimerEntry* list, TimerEntry* timer);
+
+/***********************************************************************
+* @brief    Removes the timer from the list it is on
+*
+***********************************************************************/
+static void Unlink_Timer(TimerEntry* timer);
+
+/***********************************************************************
+* @brief    Arms the timerfd to tick periodically, or disarms it
+*
+* @param    [in] enable - 1 ticks, 0 stops ticking
+*
+***********************************************************************/
+static void Arm_Ticks(uint8_t enable);
+
+/* Sentinels of the circular lists, one per slot */
+static TimerEntry wheel[TIMER_WHEEL_SIZE];
+/* Timers which expired and whose callbacks are not called yet */
+static TimerEntry expired;
+static uint32_t currentSlot = 0;
+/* Timers on the wheel and on the expired list */
+static uint32_t numOfActive = 0;
+static uint8_t ticking = 0;
+/* Timer whose callback is running, Timer_Stop waits for it */
+static TimerEntry* runningTimer = NULL;
+static uint32_t references = 0;
+static uint8_t serviceRunning = 0;
+static int32_t timerFileDesc = -1;
+static int32_t wakeFileDesc = -1;
+static pthread_t timerLoopThread;
+static pthread_mutex_t serviceMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t callbackCondition = PTHREAD_COND_INITIALIZER;
+static TimerStatistics statistics;
+
+int32_t Timer_Service_Init()
+{
+	uint32_t i;
+
+	pthread_mutex_lock(&serviceMutex);
+	if (references++ > 0)
+	{
+		pthread_mutex_unlock(&serviceMutex);
+		return EXIT_SUCCESS;
+	}
+
+	timerFileDesc = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+	if (timerFileDesc < 0)
+	{
+		printf("%s(%d): Error creating timerfd (%s)!\n", __FUNCTION__, __LINE__, strerror(errno));
+		references = 0;
+		pthread_mutex_unlock(&serviceMutex);
+		return EXIT_FAILURE;
+	}
+	wakeFileDesc = eventfd(0, EFD_CLOEXEC);
+	if (wakeFileDesc < 0)
+	{
+		printf("%s(%d): Error creating eventfd (%s)!\n", __FUNCTION__, __LINE__, strerror(errno));
+		close(timerFileDesc);
+		references = 0;
+		pthread_mutex_unlock(&serviceMutex);
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < TIMER_WHEEL_SIZE; i++)
+	{
+		wheel[i].next = &wheel[i];
+		wheel[i].previous = &wheel[i];
+	}
+	expired.next = &expired;
+	expired.previous = &expired;
+	currentSlot = 0;
+	numOfActive = 0;
+	ticking = 0;
+	runningTimer = NULL;
+	memset(&statistics, 0, sizeof(statistics));
+	serviceRunning = 1;
+
+	if (pthread_create(&timerLoopThread, NULL, Timer_Loop, NULL))
+	{
+		printf("%s(%d): Error creating timer thread!\n", __FUNCTION__, __LINE__);
+		close(wakeFileDesc);
+		close(timerFileDesc);
+		serviceRunning = 0;
+		references = 0;
+		pthread_mutex_unlock(&serviceMutex);
+		return EXIT_FAILURE;
+	}
+	pthread_mutex_unlock(&serviceMutex);
+	return EXIT_SUCCESS;
+}
+
+int32_t Timer_Service_Deinit()
+{
+	uint64_t wake = 1;
+
+	pthread_mutex_lock(&serviceMutex);
+	if (references == 0 || --references > 0)
+	{
+		pthread_mutex_unlock(&serviceMutex);
+		return EXIT_SUCCESS;
+	}
+	serviceRunning = 0;
+	pthread_mutex_unlock(&serviceMutex);
+
+	if (write(wakeFileDesc, &wake, sizeof(wake)) != sizeof(wake))
+	{
+		printf("%s(%d): Error waking timer thread!\n", __FUNCTION__, __LINE__);
+	}
+	pthread_join(timerLoopThread, NULL);
+
+	close(wakeFileDesc);
+	close(timerFileDesc);
+	wakeFileDesc = -1;
+	timerFileDesc = -1;
+	return EXIT_SUCCESS;
+}
+
+void Timer_Init(TimerEntry* timer, Timer_Callback callback, void* argument)
+{
+	memset(timer, 0, sizeof(TimerEntry));
+	timer->callback = callback;
+	timer->argument = argument;
+}
+
+int32_t Timer_Start(TimerEntry* timer, uint32_t milliseconds)
+{
+	uint32_t ticks;
+
+	pthread_mutex_lock(&serviceMutex);
+	if (!serviceRunning)
+	{
+		pthread_mutex_unlock(&serviceMutex);
+		printf("%s(%d): Timer service is not initialized!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+
+	if (timer->active)
+	{
+		Unlink_Timer(timer);
+		numOfActive--;
+	}
+
+	ticks = (milliseconds + TIMER_SERVICE_TICK_MS - 1) / TIMER_SERVICE_TICK_MS;
+	/* First tick of a running wheel can be anywhere up to a tick away */
+	if (ticking || ticks == 0)
+	{
+		ticks++;
+	}
+	timer->rounds = (ticks - 1) / TIMER_WHEEL_SIZE;
+	Link_Timer(&wheel[(currentSlot + ticks) & (TIMER_WHEEL_SIZE - 1)], timer);
+	timer->active = 1;
+	numOfActive++;
+	statistics.starts++;
+
+	if (!ticking)
+	{
+		Arm_Ticks(1);
+	}
+	pthread_mutex_unlock(&serviceMutex);
+	return EXIT_SUCCESS;
+}
+
+void Timer_Stop(TimerEntry* timer)
+{
+	pthread_mutex_lock(&serviceMutex);
+	if (timer->active)
+	{
+		Unlink_Timer(timer);
+		timer->active = 0;
+		numOfActive--;
+		statistics.stops++;
+	}
+	/* A callback stopping its own timer would wait for itself */
+	while (runningTimer == timer && !pthread_equal(pthread_self(), timerLoopThread))
+	{
+		pthread_cond_wait(&callbackCondition, &serviceMutex);
+	}
+	pthread_mutex_unlock(&serviceMutex);
+}
+
+void Timer_Service_Get_Statistics(TimerStatistics* outStatistics)
+{
+	pthread_mutex_lock(&serviceMutex);
+	*outStatistics = statistics;
+	pthread_mutex_unlock(&serviceMutex);
+}
+
+void* Timer_Loop()
+{
+	struct pollfd fileDescs[2];
+	uint64_t expirations;
+	uint64_t i;
+	TimerEntry* timer;
+	struct timespec callbackStart;
+	struct timespec callbackEnd;
+	uint64_t callbackTime;
+
+	fileDescs[0].fd = timerFileDesc;
+	fileDescs[0].events = POLLIN;
+	fileDescs[1].fd = wakeFileDesc;
+	fileDescs[1].events = POLLIN;
+
+	while (NON_STOP)
+	{
+		if (poll(fileDescs, 2, -1) < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			printf("%s(%d): Error polling timerfd (%s)!\n", __FUNCTION__, __LINE__, strerror(errno));
+			break;
+		}
+		if (fileDescs[1].revents & POLLIN)
+		{
+			break;
+		}
+		if (!(fileDescs[0].revents & POLLIN))
+		{
+			continue;
+		}
+		/* Number of ticks since the last read, more than one if the thread was late */
+		if (read(timerFileDesc, &expirations, sizeof(expirations)) != sizeof(expirations))
+		{
+			continue;
+		}
+
+		pthread_mutex_lock(&serviceMutex);
+		statistics.wakeups++;
+		for (i = 0; i < expirations && numOfActive > 0; i++)
+		{
+			Advance_Wheel();
+		}
+
+		/* Callbacks run without the lock, so they can start and stop timers */
+		while (expired.next != &expired)
+		{
+			timer = expired.next;
+			Unlink_Timer(timer);
+			timer->active = 0;
+			numOfActive--;
+			statistics.expirations++;
+			runningTimer = timer;
+			pthread_mutex_unlock(&serviceMutex);
+
+			clock_gettime(CLOCK_MONOTONIC, &callbackStart);
+			timer->callback(timer->argument);
+			clock_gettime(CLOCK_MONOTONIC, &callbackEnd);
+
+			pthread_mutex_lock(&serviceMutex);
+			runningTimer = NULL;
+			callbackTime = Time_Difference(&callbackStart, &callbackEnd);
+			if (callbackTime > statistics.maxCallbackTime)
+			{
+				statistics.maxCallbackTime = callbackTime;
+			}
+			pthread_cond_broadcast(&callbackCondition);
+		}
+
+		/* Nothing to wait for, no wakeups until the next start */
+		if (numOfActive == 0 && ticking)
+		{
+			Arm_Ticks(0);
+		}
+		pthread_mutex_unlock(&serviceMutex);
+	}
+	return NULL;
+}
+
+void Advance_Wheel()
+{
+	TimerEntry* slot;
+	TimerEntry* timer;
+	TimerEntry* next;
+
+	currentSlot = (currentSlot + 1) & (TIMER_WHEEL_SIZE - 1);
+	statistics.ticks++;
+
+	slot = &wheel[currentSlot];
+	for (timer = slot->next; timer != slot; timer = next)
+	{
+		next = timer->next;
+		if (timer->rounds > 0)
+		{
+			timer->rounds--;
+			continue;
+		}
+		Unlink_Timer(timer);
+		Link_Timer(&expired, timer);
+	}
+}
+
+void Link_Timer(TimerEntry* list, TimerEntry* timer)
+{
+	timer->next = list;
+	timer->previous = list->previous;
+	list->previous->next = timer;
+	list->previous = timer;
+}
+
+void Unlink_Timer(TimerEntry* timer)
+{
+	timer->previous->next = timer->next;
+	timer->next->previous = timer->previous;
+	timer->next = NULL;
+	timer->previous = NULL;
+}
+
+void Arm_Ticks(uint8_t enable)
+{
+	struct itimerspec timerSpec;
+
+	memset(&timerSpec, 0, sizeof(timerSpec));
+	if (enable)
+	{
+		timerSpec.it_value.tv_nsec = TIMER_SERVICE_TICK_MS * 1000000L;
+		timerSpec.it_interval.tv_nsec = TIMER_SERVICE_TICK_MS * 1000000L;
+	}
+	if (timerfd_settime(timerFileDesc, 0, &timerSpec, NULL) < 0)
+	{
+		printf("%s(%d): Error setting timerfd (%s)!\n", __FUNCTION__, __LINE__, strerror(errno));
+		return;
+	}
+	ticking = enable;
+}
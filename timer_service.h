@@ -0,0 +1,108 @@
+#ifndef _TIMER_SERVICE_H_
+#define _TIMER_SERVICE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include "common.h"
+
+/* Milliseconds per tick of the wheel, timers expire at most a tick late */
+#define TIMER_SERVICE_TICK_MS 10
+/* Slots of the wheel, power of two. Longer delays go around in rounds */
+#define TIMER_WHEEL_SIZE 256
+
+typedef void(*Timer_Callback)(void* argument);
+
+/* Owned by the caller and has to stay valid while the timer is started */
+typedef struct TimerEntry {
+	struct TimerEntry* next;
+	struct TimerEntry* previous;
+	Timer_Callback callback;
+	void* argument;
+	/* Turns of the wheel left before the timer expires */
+	uint32_t rounds;
+	uint8_t active;
+} TimerEntry;
+
+typedef struct TimerStatistics {
+	uint32_t starts;
+	uint32_t stops;
+	uint32_t expirations;
+	/* Ticks the wheel advanced and wakeups of the service thread */
+	uint32_t ticks;
+	uint32_t wakeups;
+	/* Microseconds, longest time a callback ran */
+	uint64_t maxCallbackTime;
+} TimerStatistics;
+
+/***********************************************************************
+* @brief    Starts the timer service thread. Every module which uses
+* 			timers initializes the service, it runs until the last one
+* 			deinitializes it
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Timer_Service_Init();
+
+/***********************************************************************
+* @brief    Stops the timer service thread after the last user. Timers
+* 			have to be stopped before
+*
+* @return   EXIT_SUCCESS - no error
+*
+***********************************************************************/
+int32_t Timer_Service_Deinit();
+
+/***********************************************************************
+* @brief    Prepares a timer, does not start it
+*
+* @param    [out] timer - timer to prepare
+* @param    [in] callback - called on the service thread when the
+* 							timer expires
+* @param    [in] argument - passed to the callback
+*
+***********************************************************************/
+void Timer_Init(TimerEntry* timer, Timer_Callback callback, void* argument);
+
+/***********************************************************************
+* @brief    Starts the timer, or restarts it if it is already running.
+* 			Can be called from a callback to make a periodic timer
+*
+* @param    [in] timer - timer prepared with Timer_Init
+* @param    [in] milliseconds - delay until the callback is called
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - service is not initialized
+*
+***********************************************************************/
+int32_t Timer_Start(TimerEntry* timer, uint32_t milliseconds);
+
+/***********************************************************************
+* @brief    Stops the timer. When its callback is running on the
+* 			service thread, waits until it returns, so the argument
+* 			can be freed afterwards
+*
+* @param    [in] timer - timer prepared with Timer_Init
+*
+***********************************************************************/
+void Timer_Stop(TimerEntry* timer);
+
+/***********************************************************************
+* @brief    Copies the timer service statistics
+*
+* @param    [out] outStatistics - structure where the statistics are saved
+*
+***********************************************************************/
+void Timer_Service_Get_Statistics(TimerStatistics* outStatistics);
+
+#endif
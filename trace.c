@@ -0,0 +1,423 @@
+#include "trace.h"
+#include <sys/prctl.h>
+
+#define TRACE_RING_MASK (TRACE_RING_SIZE - 1)
+
+typedef struct TraceEvent {
+	uint64_t time;
+	const char* name;
+	uint32_t value;
+	uint8_t phase;
+} TraceEvent;
+
+typedef struct TraceRing {
+	TraceEvent events[TRACE_RING_SIZE];
+	/* Written only by the owner thread, the event before it is complete */
+	uint32_t head;
+	uint8_t wrapped;
+	int32_t threadId;
+	char threadName[TRACE_THREAD_NAME_SIZE];
+	struct TraceRing* next;
+} TraceRing;
+
+/* Pair of clock readings the tick counter is converted with */
+typedef struct TraceCalibration {
+	uint64_t ticks;
+	uint64_t nanoseconds;
+} TraceCalibration;
+
+/***********************************************************************
+* @brief    Returns the cheapest monotonic tick counter of the CPU
+*
+***********************************************************************/
+static inline uint64_t Trace_Clock();
+
+/***********************************************************************
+* @brief    Reads the tick counter together with the monotonic clock
+*
+***********************************************************************/
+static void Calibrate(TraceCalibration* calibration);
+
+/***********************************************************************
+* @brief    Allocates the ring of the calling thread and adds it to the
+* 			list of rings
+*
+* @return   ring - NULL if there is no memory
+*
+***********************************************************************/
+static TraceRing* Create_Ring();
+
+/***********************************************************************
+* @brief    Copies the events of a ring which the owner did not overwrite
+* 			while they were copied
+*
+* @param    [in] ring - ring of a thread
+* @param    [out] outEvents - TRACE_RING_SIZE events
+*
+* @return   number of copied events, oldest first
+*
+***********************************************************************/
+static uint32_t Copy_Ring(TraceRing* ring, TraceEvent* outEvents);
+
+/***********************************************************************
+* @brief    Waits for the signals written to the dump pipe
+*
+***********************************************************************/
+static void* Dump_Task();
+
+/***********************************************************************
+* @brief    Signal handler, wakes the dump thread
+*
+***********************************************************************/
+static void Dump_Signal(int32_t signalNumber);
+
+/***********************************************************************
+* @brief    Dumps the rings when the process exits
+*
+***********************************************************************/
+static void Dump_At_Exit();
+
+static __thread TraceRing* threadRing = NULL;
+/* Rings are only added, threads which end leave their events for the dump */
+static TraceRing* rings = NULL;
+static TraceCalibration baseCalibration;
+static char dumpFileName[256];
+static int32_t dumpSignal = 0;
+static struct sigaction previousAction;
+static int32_t dumpPipe[2] = {-1, -1};
+static pthread_t dumpThread;
+static uint8_t exitDump = 0;
+static uint8_t exitHandlerSet = 0;
+static pthread_mutex_t dumpMutex = PTHREAD_MUTEX_INITIALIZER;
+
+int32_t Trace_Init(const char* fileName, int32_t signalNumber, uint8_t dumpAtExit)
+{
+	struct sigaction action;
+
+	pthread_mutex_lock(&dumpMutex);
+	strncpy(dumpFileName, fileName, sizeof(dumpFileName) - 1);
+	Calibrate(&baseCalibration);
+	pthread_mutex_unlock(&dumpMutex);
+
+	if (signalNumber != 0)
+	{
+		if (pipe(dumpPipe) == -1)
+		{
+			printf("%s(%d): Error creating the dump pipe (%s)!\n", __FUNCTION__, __LINE__, strerror(errno));
+			return EXIT_FAILURE;
+		}
+		if (pthread_create(&dumpThread, NULL, Dump_Task, NULL))
+		{
+			printf("%s(%d): Error creating the dump thread!\n", __FUNCTION__, __LINE__);
+			close(dumpPipe[0]);
+			close(dumpPipe[1]);
+			dumpPipe[0] = dumpPipe[1] = -1;
+			return EXIT_FAILURE;
+		}
+
+		memset(&action, 0, sizeof(action));
+		action.sa_handler = Dump_Signal;
+		action.sa_flags = SA_RESTART;
+		sigemptyset(&action.sa_mask);
+		if (sigaction(signalNumber, &action, &previousAction) == -1)
+		{
+			printf("%s(%d): Error setting the signal handler (%s)!\n", __FUNCTION__, __LINE__, strerror(errno));
+			close(dumpPipe[1]);
+			pthread_join(dumpThread, NULL);
+			close(dumpPipe[0]);
+			dumpPipe[0] = dumpPipe[1] = -1;
+			return EXIT_FAILURE;
+		}
+		dumpSignal = signalNumber;
+	}
+
+	__atomic_store_n(&exitDump, dumpAtExit, __ATOMIC_SEQ_CST);
+	if (dumpAtExit && !exitHandlerSet)
+	{
+		atexit(Dump_At_Exit);
+		exitHandlerSet = 1;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+int32_t Trace_Deinit()
+{
+	__atomic_store_n(&exitDump, 0, __ATOMIC_SEQ_CST);
+
+	if (dumpSignal != 0)
+	{
+		sigaction(dumpSignal, &previousAction, NULL);
+		dumpSignal = 0;
+		/* End of the pipe ends the dump thread */
+		close(dumpPipe[1]);
+		pthread_join(dumpThread, NULL);
+		close(dumpPipe[0]);
+		dumpPipe[0] = dumpPipe[1] = -1;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+void Trace_Record(const char* name, uint8_t phase, uint32_t value)
+{
+	TraceRing* ring = threadRing;
+	TraceEvent* event;
+	uint32_t head;
+
+	if (ring == NULL)
+	{
+		ring = Create_Ring();
+		if (ring == NULL)
+		{
+			return;
+		}
+	}
+
+	head = ring->head;
+	event = &ring->events[head & TRACE_RING_MASK];
+	event->time = Trace_Clock();
+	event->name = name;
+	event->value = value;
+	event->phase = phase;
+	if (((head + 1) & TRACE_RING_MASK) == 0)
+	{
+		ring->wrapped = 1;
+	}
+	/* Publishes the event to a dump running on another thread */
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void Trace_Set_Thread_Name(const char* name)
+{
+	TraceRing* ring = threadRing;
+
+	if (ring == NULL)
+	{
+		ring = Create_Ring();
+		if (ring == NULL)
+		{
+			return;
+		}
+	}
+
+	pthread_mutex_lock(&dumpMutex);
+	strncpy(ring->threadName, name, TRACE_THREAD_NAME_SIZE - 1);
+	pthread_mutex_unlock(&dumpMutex);
+}
+
+int32_t Trace_Dump(const char* fileName)
+{
+	TraceCalibration dumpCalibration;
+	TraceEvent* events;
+	TraceRing* ring;
+	FILE* file;
+	uint64_t elapsed;
+	double ticksToMicroseconds;
+	double time;
+	uint32_t numOfEvents;
+	uint32_t totalEvents = 0;
+	uint8_t first = 1;
+	uint32_t i;
+	struct timespec delay;
+
+	events = (TraceEvent*)malloc(sizeof(TraceEvent) * TRACE_RING_SIZE);
+	if (events == NULL)
+	{
+		printf("%s(%d): Error allocating the dump buffer!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+
+	pthread_mutex_lock(&dumpMutex);
+	file = fopen(fileName, "w");
+	if (file == NULL)
+	{
+		printf("%s(%d): Error opening %s (%s)!\n", __FUNCTION__, __LINE__, fileName, strerror(errno));
+		pthread_mutex_unlock(&dumpMutex);
+		free(events);
+		return EXIT_FAILURE;
+	}
+
+	/* Ticks of the counter are converted over an interval long enough to be exact */
+	if (baseCalibration.nanoseconds == 0)
+	{
+		Calibrate(&baseCalibration);
+	}
+	Calibrate(&dumpCalibration);
+	elapsed = dumpCalibration.nanoseconds - baseCalibration.nanoseconds;
+	if (elapsed < (uint64_t)TRACE_CALIBRATION_MS * 1000000)
+	{
+		delay.tv_sec = 0;
+		delay.tv_nsec = (uint64_t)TRACE_CALIBRATION_MS * 1000000 - elapsed;
+		while (nanosleep(&delay, &delay) == -1 && errno == EINTR);
+		Calibrate(&dumpCalibration);
+	}
+	ticksToMicroseconds = (double)(dumpCalibration.nanoseconds - baseCalibration.nanoseconds)
+						  / (double)(dumpCalibration.ticks - baseCalibration.ticks) / 1000.0;
+
+	fprintf(file, "{\"traceEvents\":[");
+	for (ring = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next)
+	{
+		fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+				first ? "" : ",", (int32_t)getpid(), ring->threadId, ring->threadName);
+		first = 0;
+
+		numOfEvents = Copy_Ring(ring, events);
+		for (i = 0; i < numOfEvents; i++)
+		{
+			/* Signed, events recorded before the initialization are negative */
+			time = ((double)baseCalibration.nanoseconds / 1000.0)
+				   + (double)(int64_t)(events[i].time - baseCalibration.ticks) * ticksToMicroseconds;
+			fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d",
+					events[i].name, events[i].phase, time, (int32_t)getpid(), ring->threadId);
+			switch (events[i].phase)
+			{
+				case TRACE_PHASE_INSTANT:
+					fprintf(file, ",\"s\":\"t\",\"args\":{\"value\":%u}}", events[i].value);
+					break;
+				case TRACE_PHASE_COUNTER:
+					fprintf(file, ",\"args\":{\"value\":%u}}", events[i].value);
+					break;
+				default:
+					if (events[i].value != 0)
+					{
+						fprintf(file, ",\"args\":{\"value\":%u}}", events[i].value);
+					}
+					else
+					{
+						fprintf(file, "}");
+					}
+					break;
+			}
+		}
+		totalEvents += numOfEvents;
+	}
+	fprintf(file, "\n],\"displayTimeUnit\":\"ns\"}\n");
+	fclose(file);
+	pthread_mutex_unlock(&dumpMutex);
+	free(events);
+
+	printf("Trace: %u events written to %s\n", totalEvents, fileName);
+	return EXIT_SUCCESS;
+}
+
+inline uint64_t Trace_Clock()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#elif defined(__aarch64__)
+	uint64_t ticks;
+
+	__asm__ __volatile__("mrs %0, cntvct_el0" : "=r" (ticks));
+	return ticks;
+#else
+	/* ARMv7 user space has no counter to read, the vDSO clock is used */
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+#endif
+}
+
+void Calibrate(TraceCalibration* calibration)
+{
+	struct timespec now;
+
+	calibration->ticks = Trace_Clock();
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	calibration->nanoseconds = (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+TraceRing* Create_Ring()
+{
+	TraceRing* ring;
+
+	ring = (TraceRing*)calloc(1, sizeof(TraceRing));
+	if (ring == NULL)
+	{
+		return NULL;
+	}
+	ring->threadId = (int32_t)syscall(SYS_gettid);
+	if (prctl(PR_GET_NAME, ring->threadName, 0, 0, 0) == -1)
+	{
+		snprintf(ring->threadName, TRACE_THREAD_NAME_SIZE, "%d", ring->threadId);
+	}
+	ring->threadName[TRACE_THREAD_NAME_SIZE - 1] = '\0';
+
+	ring->next = __atomic_load_n(&rings, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(&rings, &ring->next, ring, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+	threadRing = ring;
+	return ring;
+}
+
+uint32_t Copy_Ring(TraceRing* ring, TraceEvent* outEvents)
+{
+	uint32_t before;
+	uint32_t after;
+	uint32_t start;
+	uint32_t oldest;
+	uint32_t i;
+
+	before = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	start = __atomic_load_n(&ring->wrapped, __ATOMIC_RELAXED) ? before - TRACE_RING_SIZE : 0;
+	for (i = start; i != before; i++)
+	{
+		outEvents[i - start] = ring->events[i & TRACE_RING_MASK];
+	}
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	after = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+
+	/* Slots the owner wrote again while they were copied are dropped */
+	oldest = start;
+	if (after - start > TRACE_RING_SIZE - 1)
+	{
+		oldest = after - TRACE_RING_SIZE + 1;
+	}
+	if (oldest - start >= before - start)
+	{
+		return 0;
+	}
+	memmove(outEvents, outEvents + (oldest - start), sizeof(TraceEvent) * (before - oldest));
+	return before - oldest;
+}
+
+void* Dump_Task()
+{
+	uint8_t signalByte;
+	ssize_t ret;
+
+	TRACE_THREAD_NAME("trace dump");
+	while (NON_STOP)
+	{
+		ret = read(dumpPipe[0], &signalByte, 1);
+		if (ret == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		if (ret <= 0)
+		{
+			return NULL;
+		}
+		Trace_Dump(dumpFileName);
+	}
+}
+
+void Dump_Signal(int32_t signalNumber)
+{
+	uint8_t signalByte = (uint8_t)signalNumber;
+	int32_t savedErrno = errno;
+
+	/* Only async-signal-safe calls here, the dump thread writes the file */
+	if (write(dumpPipe[1], &signalByte, 1) < 0)
+	{
+	}
+	errno = savedErrno;
+}
+
+void Dump_At_Exit()
+{
+	if (__atomic_load_n(&exitDump, __ATOMIC_SEQ_CST))
+	{
+		Trace_Dump(dumpFileName);
+	}
+}
@@ -0,0 +1,108 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "common.h"
+
+/* Events kept per thread, the oldest ones are overwritten, power of two */
+#define TRACE_RING_SIZE 8192
+#define TRACE_THREAD_NAME_SIZE 16
+/* Shortest time between the clock calibration points of a dump */
+#define TRACE_CALIBRATION_MS 50
+
+/* Chrome trace event phases */
+#define TRACE_PHASE_BEGIN 'B'
+#define TRACE_PHASE_END 'E'
+#define TRACE_PHASE_INSTANT 'i'
+#define TRACE_PHASE_COUNTER 'C'
+
+/*
+ * Tracepoints are compiled in unless TRACE_DISABLE is defined. Names
+ * have to be string literals, only their pointers are recorded. Every
+ * thread records into its own ring without locking.
+ */
+#ifndef TRACE_DISABLE
+#define TRACE_BEGIN(name) Trace_Record(name, TRACE_PHASE_BEGIN, 0)
+#define TRACE_END(name) Trace_Record(name, TRACE_PHASE_END, 0)
+/* End with a value shown in the arguments of the slice */
+#define TRACE_END_VALUE(name, value) Trace_Record(name, TRACE_PHASE_END, value)
+#define TRACE_INSTANT(name, value) Trace_Record(name, TRACE_PHASE_INSTANT, value)
+#define TRACE_COUNTER(name, value) Trace_Record(name, TRACE_PHASE_COUNTER, value)
+#define TRACE_THREAD_NAME(name) Trace_Set_Thread_Name(name)
+#else
+#define TRACE_BEGIN(name) do { } while (0)
+#define TRACE_END(name) do { } while (0)
+#define TRACE_END_VALUE(name, value) do { } while (0)
+#define TRACE_INSTANT(name, value) do { } while (0)
+#define TRACE_COUNTER(name, value) do { } while (0)
+#define TRACE_THREAD_NAME(name) do { } while (0)
+#endif
+
+/***********************************************************************
+* @brief    Trace initialization function, sets where the rings are
+* 			dumped. Tracepoints record before it too
+*
+* @param    [in] fileName - Chrome trace JSON file the dumps are written to
+* @param    [in] signalNumber - signal which dumps the rings, 0 for none
+* @param    [in] dumpAtExit - dumps the rings when the process exits
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Trace_Init(const char* fileName, int32_t signalNumber, uint8_t dumpAtExit);
+
+/***********************************************************************
+* @brief    Trace deinitialization function, stops the dumps on the
+* 			signal and at exit. Rings stay, threads may still record
+*
+* @return   EXIT_SUCCESS - no error
+*
+***********************************************************************/
+int32_t Trace_Deinit();
+
+/***********************************************************************
+* @brief    Records an event into the ring of the calling thread,
+* 			called through the TRACE_ macros
+*
+* @param    [in] name - string literal
+* @param    [in] phase - TRACE_PHASE_ of the event
+* @param    [in] value - counter value or argument of the event
+*
+***********************************************************************/
+void Trace_Record(const char* name, uint8_t phase, uint32_t value);
+
+/***********************************************************************
+* @brief    Names the calling thread in the trace
+*
+* @param    [in] name - thread name, shortened to TRACE_THREAD_NAME_SIZE
+*
+***********************************************************************/
+void Trace_Set_Thread_Name(const char* name);
+
+/***********************************************************************
+* @brief    Writes the events of all rings as Chrome trace JSON, which
+* 			chrome://tracing and Perfetto open. Threads go on recording
+* 			while the rings are dumped
+*
+* @param    [in] fileName - path of the JSON file
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Trace_Dump(const char* fileName);
+
+#endif
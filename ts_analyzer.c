@@ -0,0 +1,585 @@
+#include "ts_analyzer.h"
+
+#define CC_UNKNOWN 0xFF
+#define NO_TABLE 0xFF
+/* Packets of a PID are shown in the snapshots after the first one */
+#define PID_SEEN 0x01
+#define PID_PCR_VALID 0x02
+#define PID_DUPLICATE 0x04
+
+/* What the PID carries, from its fixed number or from the PAT and PMT */
+#define PID_KIND_UNKNOWN 0
+#define PID_KIND_PAT 1
+#define PID_KIND_CAT 2
+#define PID_KIND_NIT 3
+#define PID_KIND_SDT 4
+#define PID_KIND_EIT 5
+#define PID_KIND_TDT 6
+#define PID_KIND_NULL 7
+#define PID_KIND_PMT 8
+#define PID_KIND_VIDEO 9
+#define PID_KIND_AUDIO 10
+#define PID_KIND_TELETEXT 11
+#define PID_KIND_SUBTITLE 12
+#define PID_KIND_NUM 13
+
+typedef struct AnalyzerPid {
+	uint64_t packets;
+	uint64_t scrambledPackets;
+	uint32_t windowPackets;
+	uint32_t continuityErrors;
+	uint32_t transportErrors;
+	uint16_t programNumber;
+	uint8_t kind;
+	uint8_t flags;
+	uint8_t lastCC;
+	/* transport_scrambling_control of the last packet */
+	uint8_t scrambling;
+	/* Table whose first section is timed, NO_TABLE if the PID carries no PSI */
+	uint8_t tableId;
+	uint32_t tables;
+	/* Stream time of the last table, in 27 MHz ticks */
+	uint64_t lastTableTime;
+	/* Microseconds */
+	uint32_t lastTableInterval;
+	uint32_t maxTableInterval;
+	uint32_t pcrs;
+	uint32_t pcrDiscontinuities;
+	uint64_t lastPcr;
+	uint64_t lastPcrPacket;
+	/* Microseconds */
+	uint32_t maxPcrInterval;
+	/* Nanoseconds the PCR was off the constant multiplex rate, in the window */
+	int32_t minPcrError;
+	int32_t maxPcrError;
+} AnalyzerPid;
+
+/***********************************************************************
+* @brief    Counts one packet of the PID and checks its continuity
+*
+* @param    [in] packet - transport packet
+* @param    [in] index - packet number in the stream
+*
+***********************************************************************/
+static void Analyze_Packet(const uint8_t* packet, uint64_t index);
+
+/***********************************************************************
+* @brief    Checks the PCR of a packet against the previous one of its
+* 			PID, the first PCR PID keeps the stream time
+*
+***********************************************************************/
+static void Analyze_Pcr(AnalyzerPid* entry, uint16_t pid, uint64_t pcr, uint8_t discontinuity, uint64_t index);
+
+/***********************************************************************
+* @brief    Times the repetition of the table which starts in the packet
+*
+***********************************************************************/
+static void Analyze_Table(AnalyzerPid* entry, const uint8_t* payload, uint32_t size, uint64_t index);
+
+/***********************************************************************
+* @brief    Returns the stream time of a packet in 27 MHz ticks
+*
+***********************************************************************/
+static uint64_t Packet_Time(uint64_t index);
+
+/***********************************************************************
+* @brief    Labels the PMT PIDs and opens their filters
+*
+***********************************************************************/
+static int32_t PAT_Section_Received(const uint8_t* section, uint16_t pid, void* userData);
+
+/***********************************************************************
+* @brief    Labels the streams of the program
+*
+***********************************************************************/
+static int32_t PMT_Section_Received(const uint8_t* section, uint16_t pid, void* userData);
+
+static void Label_Pid(uint16_t pid, uint8_t kind, uint16_t programNumber);
+
+/***********************************************************************
+* @brief    Returns microseconds of the monotonic clock
+*
+***********************************************************************/
+static uint64_t Now();
+
+static const char* kindNames[PID_KIND_NUM] = {
+	"unknown", "PAT", "CAT", "NIT", "SDT", "EIT", "TDT", "null", "PMT", "video", "audio", "teletext", "subtitle"
+};
+
+/* One entry for every PID, allocated once, about 1 MB */
+static AnalyzerPid* pids = NULL;
+/* PIDs in the order of their first packet, snapshots walk only these */
+static uint16_t seenPids[TS_NUM_OF_PIDS];
+static uint32_t numOfSeenPids = 0;
+static FILE* outputFile = NULL;
+static uint64_t intervalTicks = 0;
+static uint64_t packetIndex = 0;
+static uint64_t startTime = 0;
+static TsAnalyzerStatistics statistics;
+
+/* Stream time, kept by the first PID which carries a PCR */
+static uint16_t referencePid = NULL_PID;
+static uint64_t referenceTime = 0;
+static uint64_t referencePacket = 0;
+/* Start of the rate measurement, since the last discontinuity */
+static uint64_t rateTime = 0;
+static uint64_t ratePacket = 0;
+/* 27 MHz ticks per packet at the multiplex rate, 0 until two PCRs were seen */
+static double ticksPerPacket = 0;
+/* Monotonic clock while there is no PCR, taken once per run */
+static uint64_t wallTime = 0;
+
+/* Snapshot window */
+static uint64_t windowStart = 0;
+static uint64_t windowPackets = 0;
+
+int32_t Ts_Analyzer_Init(uint32_t interval, FILE* output)
+{
+	uint32_t filterHandle;
+	uint32_t i;
+
+	if (Psi_Cache_Init())
+	{
+		return EXIT_FAILURE;
+	}
+	pids = (AnalyzerPid*)malloc(sizeof(AnalyzerPid) * TS_NUM_OF_PIDS);
+	if (pids == NULL)
+	{
+		printf("%s(%d): Error allocating PID counters!\n", __FUNCTION__, __LINE__);
+		Psi_Cache_Deinit();
+		return EXIT_FAILURE;
+	}
+	memset(pids, 0, sizeof(AnalyzerPid) * TS_NUM_OF_PIDS);
+	for (i = 0; i < TS_NUM_OF_PIDS; i++)
+	{
+		pids[i].lastCC = CC_UNKNOWN;
+		pids[i].tableId = NO_TABLE;
+	}
+
+	/* PIDs of the fixed tables are known before the PAT */
+	Label_Pid(PAT_PID, PID_KIND_PAT, 0);
+	pids[PAT_PID].tableId = PAT_TABLE_ID;
+	Label_Pid(CAT_PID, PID_KIND_CAT, 0);
+	pids[CAT_PID].tableId = CAT_TABLE_ID;
+	Label_Pid(NIT_PID, PID_KIND_NIT, 0);
+	pids[NIT_PID].tableId = NIT_TABLE_ID;
+	Label_Pid(SDT_PID, PID_KIND_SDT, 0);
+	pids[SDT_PID].tableId = SDT_TABLE_ID;
+	Label_Pid(EIT_PID, PID_KIND_EIT, 0);
+	pids[EIT_PID].tableId = EIT_PF_ACTUAL_TABLE_ID;
+	Label_Pid(TDT_PID, PID_KIND_TDT, 0);
+	pids[TDT_PID].tableId = TDT_TABLE_ID;
+	Label_Pid(NULL_PID, PID_KIND_NULL, 0);
+
+	numOfSeenPids = 0;
+	outputFile = output;
+	intervalTicks = (uint64_t)(interval ? interval : ANALYZER_DEFAULT_INTERVAL) * (PCR_CLOCK / 1000);
+	packetIndex = 0;
+	referencePid = NULL_PID;
+	ticksPerPacket = 0;
+	startTime = Now();
+	wallTime = 0;
+	windowStart = 0;
+	windowPackets = 0;
+	memset(&statistics, 0, sizeof(statistics));
+
+	if (Ts_Demux_Set_Section_Filter(PAT_PID, PAT_TABLE_ID, 0xFF, PAT_Section_Received, NULL, &filterHandle))
+	{
+		free(pids);
+		pids = NULL;
+		Psi_Cache_Deinit();
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+int32_t Ts_Analyzer_Deinit()
+{
+	free(pids);
+	pids = NULL;
+	Psi_Cache_Deinit();
+	return EXIT_SUCCESS;
+}
+
+void Ts_Analyzer_Feed_Packets(const uint8_t* data, uint32_t numOfPackets)
+{
+	uint32_t i;
+
+	if (pids == NULL)
+	{
+		return;
+	}
+
+	/* Without a PCR all packets of the run arrived at once */
+	if (ticksPerPacket == 0)
+	{
+		wallTime = (Now() - startTime) * (PCR_CLOCK / 1000000);
+	}
+
+	for (i = 0; i < numOfPackets; i++)
+	{
+		Analyze_Packet(data + i * TS_PACKET_SIZE, packetIndex);
+		packetIndex++;
+		windowPackets++;
+		/* Rate estimate can move the time back a little, the window never ends early */
+		if (Packet_Time(packetIndex) >= windowStart + intervalTicks)
+		{
+			Ts_Analyzer_Snapshot();
+		}
+	}
+}
+
+void Ts_Analyzer_Snapshot()
+{
+	AnalyzerPid* entry;
+	uint64_t now;
+	double seconds;
+	double bitrate;
+	uint32_t i;
+	uint16_t pid;
+
+	if (pids == NULL || windowPackets == 0)
+	{
+		return;
+	}
+
+	now = Packet_Time(packetIndex);
+	if (now < windowStart)
+	{
+		now = windowStart;
+	}
+	seconds = (double)(now - windowStart) / PCR_CLOCK;
+	/* Window of a stream without PCR read at once has no duration */
+	bitrate = (seconds > 0) ? windowPackets * TS_PACKET_SIZE * 8 / seconds : 0;
+
+	/*
+	 * One JSON object per line: the multiplex over the window, then every
+	 * PID seen so far. Counters are totals, bitrates and PCR errors are of
+	 * the window
+	 */
+	fprintf(outputFile, "{\"time\":%.3f,\"duration\":%.3f,\"packets\":%llu,\"bitrate\":%.0f,"
+			"\"pcrPid\":%d,\"continuityErrors\":%u,\"transportErrors\":%u,\"pids\":[",
+			(double)now / PCR_CLOCK, seconds, (unsigned long long)statistics.packets, bitrate,
+			(referencePid != NULL_PID) ? referencePid : -1, statistics.continuityErrors,
+			statistics.transportErrors);
+	for (i = 0; i < numOfSeenPids; i++)
+	{
+		pid = seenPids[i];
+		entry = &pids[pid];
+		fprintf(outputFile, "%s{\"pid\":%d,\"type\":\"%s\",\"program\":%d,\"packets\":%llu,\"bitrate\":%.0f,"
+				"\"continuityErrors\":%u,\"transportErrors\":%u,\"scrambling\":%d,\"scrambledPackets\":%llu",
+				i ? "," : "", pid, kindNames[entry->kind], entry->programNumber, (unsigned long long)entry->packets,
+				(seconds > 0) ? entry->windowPackets * TS_PACKET_SIZE * 8 / seconds : 0,
+				entry->continuityErrors, entry->transportErrors, entry->scrambling,
+				(unsigned long long)entry->scrambledPackets);
+		if (entry->tableId != NO_TABLE)
+		{
+			fprintf(outputFile, ",\"tables\":%u,\"tableInterval\":%.1f,\"maxTableInterval\":%.1f",
+					entry->tables, entry->lastTableInterval / 1000.0, entry->maxTableInterval / 1000.0);
+		}
+		if (entry->pcrs > 0)
+		{
+			fprintf(outputFile, ",\"pcrs\":%u,\"maxPcrInterval\":%.1f,\"pcrDiscontinuities\":%u",
+					entry->pcrs, entry->maxPcrInterval / 1000.0, entry->pcrDiscontinuities);
+			/* Accuracy against the constant rate, jitter from peak to peak */
+			if (entry->minPcrError <= entry->maxPcrError)
+			{
+				fprintf(outputFile, ",\"pcrAccuracy\":%d,\"pcrJitter\":%d",
+						(entry->maxPcrError > -entry->minPcrError) ? entry->maxPcrError : -entry->minPcrError,
+						entry->maxPcrError - entry->minPcrError);
+			}
+		}
+		fprintf(outputFile, "}");
+
+		entry->windowPackets = 0;
+		entry->minPcrError = INT32_MAX;
+		entry->maxPcrError = INT32_MIN;
+	}
+	fprintf(outputFile, "]}\n");
+	fflush(outputFile);
+
+	statistics.snapshots++;
+	windowStart = now;
+	windowPackets = 0;
+}
+
+void Ts_Analyzer_Get_Statistics(TsAnalyzerStatistics* outStatistics)
+{
+	*outStatistics = statistics;
+	outStatistics->pids = numOfSeenPids;
+}
+
+void Analyze_Packet(const uint8_t* packet, uint64_t index)
+{
+	AnalyzerPid* entry;
+	uint16_t pid = ((packet[1] & 0x1F) << 8) | packet[2];
+	uint8_t adaptationFieldControl = (packet[3] >> 4) & 0x03;
+	uint8_t continuityCounter = packet[3] & 0x0F;
+	uint8_t discontinuity = 0;
+	uint32_t offset = 4;
+	uint64_t pcr;
+
+	entry = &pids[pid];
+	if (!(entry->flags & PID_SEEN))
+	{
+		entry->flags |= PID_SEEN;
+		entry->minPcrError = INT32_MAX;
+		entry->maxPcrError = INT32_MIN;
+		seenPids[numOfSeenPids++] = pid;
+	}
+	entry->packets++;
+	entry->windowPackets++;
+	statistics.packets++;
+
+	/* Header of a packet with transport_error_indicator can not be trusted */
+	if (packet[1] & 0x80)
+	{
+		entry->transportErrors++;
+		statistics.transportErrors++;
+		entry->lastCC = CC_UNKNOWN;
+		return;
+	}
+
+	entry->scrambling = packet[3] >> 6;
+	if (entry->scrambling)
+	{
+		entry->scrambledPackets++;
+	}
+
+	/*
+	 * Adaptation field:			bit
+	 * adaptation_field_length		08
+	 * discontinuity_indicator		01
+	 * random_access_indicator		01
+	 * ES_priority_indicator		01
+	 * PCR_flag						01
+	 * ...							04
+	 * program_clock_reference_base	33, reserved 6, extension 9
+	 */
+	if (adaptationFieldControl & 0x02)
+	{
+		if (packet[4] > 0)
+		{
+			discontinuity = packet[5] >> 7;
+			if ((packet[5] & 0x10) && packet[4] >= 7)
+			{
+				pcr = ((uint64_t)packet[6] << 25 | (uint64_t)packet[7] << 17 | (uint64_t)packet[8] << 9
+					   | (uint64_t)packet[9] << 1 | packet[10] >> 7) * 300
+					  + ((uint64_t)(packet[10] & 0x01) << 8 | packet[11]);
+				Analyze_Pcr(entry, pid, pcr, discontinuity, index);
+			}
+		}
+		offset += 1 + packet[4];
+	}
+
+	/* Null packets carry no counter, the counter only counts packets with payload */
+	if (pid == NULL_PID || !(adaptationFieldControl & 0x01))
+	{
+		return;
+	}
+	if (entry->lastCC != CC_UNKNOWN && !discontinuity)
+	{
+		if (continuityCounter == entry->lastCC && !(entry->flags & PID_DUPLICATE))
+		{
+			/* One duplicate packet is allowed */
+			entry->flags |= PID_DUPLICATE;
+			return;
+		}
+		if (continuityCounter != ((entry->lastCC + 1) & 0x0F))
+		{
+			entry->continuityErrors++;
+			statistics.continuityErrors++;
+		}
+	}
+	entry->flags &= ~PID_DUPLICATE;
+	entry->lastCC = continuityCounter;
+
+	if (entry->tableId != NO_TABLE && (packet[1] & 0x40) && offset < TS_PACKET_SIZE)
+	{
+		Analyze_Table(entry, packet + offset, TS_PACKET_SIZE - offset, index);
+	}
+}
+
+void Analyze_Pcr(AnalyzerPid* entry, uint16_t pid, uint64_t pcr, uint8_t discontinuity, uint64_t index)
+{
+	uint64_t interval;
+	uint64_t expected;
+	int64_t error;
+
+	entry->pcrs++;
+	if (referencePid == NULL_PID)
+	{
+		/* Stream time goes on from the monotonic clock */
+		referenceTime = Packet_Time(index);
+		referencePid = pid;
+		referencePacket = index;
+		rateTime = referenceTime;
+		ratePacket = index;
+	}
+
+	interval = (pcr + PCR_WRAP - entry->lastPcr) % PCR_WRAP;
+	if (!(entry->flags & PID_PCR_VALID) || discontinuity || interval > ANALYZER_PCR_DISCONTINUITY)
+	{
+		/* Signalled discontinuities are not errors, the first PCR has nothing to compare to */
+		if ((entry->flags & PID_PCR_VALID) && !discontinuity)
+		{
+			entry->pcrDiscontinuities++;
+			statistics.pcrDiscontinuities++;
+		}
+		if (pid == referencePid)
+		{
+			/* Rate is measured again from here */
+			referenceTime = Packet_Time(index);
+			referencePacket = index;
+			rateTime = referenceTime;
+			ratePacket = index;
+		}
+		entry->flags |= PID_PCR_VALID;
+		entry->lastPcr = pcr;
+		entry->lastPcrPacket = index;
+		return;
+	}
+
+	if (interval / (PCR_CLOCK / 1000000) > entry->maxPcrInterval)
+	{
+		entry->maxPcrInterval = interval / (PCR_CLOCK / 1000000);
+	}
+
+	/* PCR_AC: the PCR has to match its byte position at the constant multiplex rate */
+	if (ticksPerPacket > 0)
+	{
+		expected = entry->lastPcr + (uint64_t)((index - entry->lastPcrPacket) * ticksPerPacket + 0.5);
+		error = (int64_t)((pcr + PCR_WRAP - expected % PCR_WRAP) % PCR_WRAP);
+		if (error > (int64_t)(PCR_WRAP / 2))
+		{
+			error -= PCR_WRAP;
+		}
+		error = error * 1000 / (int64_t)(PCR_CLOCK / 1000000);
+		if (error < entry->minPcrError)
+		{
+			entry->minPcrError = (int32_t)error;
+		}
+		if (error > entry->maxPcrError)
+		{
+			entry->maxPcrError = (int32_t)error;
+		}
+	}
+
+	if (pid == referencePid)
+	{
+		referenceTime += interval;
+		referencePacket = index;
+		/* Average over everything since the last discontinuity */
+		ticksPerPacket = (double)(referenceTime - rateTime) / (double)(index - ratePacket);
+	}
+	entry->lastPcr = pcr;
+	entry->lastPcrPacket = index;
+}
+
+void Analyze_Table(AnalyzerPid* entry, const uint8_t* payload, uint32_t size, uint64_t index)
+{
+	uint32_t offset = 1 + payload[0];
+	uint64_t now;
+	uint32_t interval;
+
+	/*
+	 * pointer_field, then table_id 8, section_length 16,
+	 * table_id_extension 16, version 8, section_number 8.
+	 * Tables are timed by their first section
+	 */
+	if (offset + 7 > size || payload[offset] != entry->tableId
+		|| ((payload[offset + 1] & 0x80) && payload[offset + 6] != 0))
+	{
+		return;
+	}
+
+	now = Packet_Time(index);
+	if (entry->tables > 0)
+	{
+		interval = (uint32_t)((now - entry->lastTableTime) / (PCR_CLOCK / 1000000));
+		entry->lastTableInterval = interval;
+		if (interval > entry->maxTableInterval)
+		{
+			entry->maxTableInterval = interval;
+		}
+	}
+	entry->tables++;
+	entry->lastTableTime = now;
+}
+
+uint64_t Packet_Time(uint64_t index)
+{
+	if (ticksPerPacket == 0)
+	{
+		return (referencePid != NULL_PID) ? referenceTime : wallTime;
+	}
+	return referenceTime + (uint64_t)((index - referencePacket) * ticksPerPacket);
+}
+
+int32_t PAT_Section_Received(const uint8_t* section, uint16_t pid, void* userData)
+{
+	PATTable programTable[PAT_MAX_PROGRAMS];
+	uint32_t filterHandle;
+	uint32_t count;
+	uint32_t i;
+	uint16_t pmtPid;
+
+	/* Repetitions and corrupted sections are dropped by the PSI cache */
+	if (Psi_Cache_Filter_Section(section) != PSI_SECTION_NEW)
+	{
+		return EXIT_SUCCESS;
+	}
+	count = PAT_Parse(section, programTable);
+	for (i = 0; i < count; i++)
+	{
+		pmtPid = programTable[i].programMapPID;
+		if (pmtPid >= TS_NUM_OF_PIDS || pids[pmtPid].kind == PID_KIND_PMT)
+		{
+			continue;
+		}
+		/* PMT filters are opened once, the demux may run out of them on large multiplexes */
+		Label_Pid(pmtPid, PID_KIND_PMT, programTable[i].programNumber);
+		pids[pmtPid].tableId = PMT_TABLE_ID;
+		Ts_Demux_Set_Section_Filter(pmtPid, PMT_TABLE_ID, 0xFF, PMT_Section_Received, NULL, &filterHandle);
+	}
+	return EXIT_SUCCESS;
+}
+
+int32_t PMT_Section_Received(const uint8_t* section, uint16_t pid, void* userData)
+{
+	PMTTable pmt;
+	uint16_t programNumber = (uint16_t)section[3] << 8 | section[4];
+	uint32_t i;
+
+	if (Psi_Cache_Filter_Section(section) != PSI_SECTION_NEW || PMT_Parse(section, &pmt))
+	{
+		return EXIT_SUCCESS;
+	}
+	Label_Pid(pmt.videoPID, PID_KIND_VIDEO, programNumber);
+	Label_Pid(pmt.audioPID, PID_KIND_AUDIO, programNumber);
+	Label_Pid(pmt.teletextPID, PID_KIND_TELETEXT, programNumber);
+	for (i = 0; i < pmt.numOfSubtitles; i++)
+	{
+		Label_Pid(pmt.subtitles[i].elementaryPID, PID_KIND_SUBTITLE, programNumber);
+	}
+	return EXIT_SUCCESS;
+}
+
+void Label_Pid(uint16_t pid, uint8_t kind, uint16_t programNumber)
+{
+	/* PID 0 is the PAT, in the PMT it means there is no such stream */
+	if ((pid == 0 && kind != PID_KIND_PAT) || pid >= TS_NUM_OF_PIDS)
+	{
+		return;
+	}
+	pids[pid].kind = kind;
+	pids[pid].programNumber = programNumber;
+}
+
+uint64_t Now()
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
@@ -0,0 +1,88 @@
+#ifndef _TS_ANALYZER_H_
+#define _TS_ANALYZER_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "ts_demux.h"
+#include "table_parse.h"
+#include "psi_cache.h"
+
+/* PIDs which are labelled without the PAT */
+#define CAT_PID			0x0001
+#define TDT_PID			0x0014
+#define NULL_PID		0x1FFF
+#define CAT_TABLE_ID	0x01
+#define TDT_TABLE_ID	0x70
+
+/* PCR runs at 27 MHz, base of 33 bits times 300 plus the extension */
+#define PCR_CLOCK 27000000ULL
+#define PCR_WRAP (0x200000000ULL * 300)
+/* PCR intervals over 100 ms or backwards are discontinuities, as in TR 101 290 */
+#define ANALYZER_PCR_DISCONTINUITY (PCR_CLOCK / 10)
+/* Snapshot interval when none is given, in milliseconds */
+#define ANALYZER_DEFAULT_INTERVAL 1000
+
+typedef struct TsAnalyzerStatistics {
+	uint64_t packets;
+	/* PIDs which had at least one packet */
+	uint32_t pids;
+	uint32_t continuityErrors;
+	uint32_t transportErrors;
+	uint32_t pcrDiscontinuities;
+	uint32_t snapshots;
+} TsAnalyzerStatistics;
+
+/***********************************************************************
+* @brief    Analyzer initialization function, allocates the counters of
+* 			all PIDs and opens the PAT filter on the demux. The demux
+* 			has to be initialized and fed with the same packets
+*
+* @param    [in] interval - milliseconds of stream time between snapshots
+* @param    [in] output - file the JSON snapshots are written to, one
+* 						  object per line
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Ts_Analyzer_Init(uint32_t interval, FILE* output);
+
+/***********************************************************************
+* @brief    Analyzer deinitialization function, frees the counters
+*
+* @return   EXIT_SUCCESS - no error
+*
+***********************************************************************/
+int32_t Ts_Analyzer_Deinit();
+
+/***********************************************************************
+* @brief    Counts a run of synchronized packets, writes a snapshot
+* 			whenever the interval has passed. Time comes from the PCR
+* 			of the first PCR PID, from the monotonic clock until there
+* 			is one
+*
+* @param    [in] data - first packet of the run
+* @param    [in] numOfPackets - packets in the run
+*
+***********************************************************************/
+void Ts_Analyzer_Feed_Packets(const uint8_t* data, uint32_t numOfPackets);
+
+/***********************************************************************
+* @brief    Writes a snapshot of the packets since the last one, at the
+* 			end of the stream
+*
+***********************************************************************/
+void Ts_Analyzer_Snapshot();
+
+/***********************************************************************
+* @brief    Copies the totals of the analyzer
+*
+* @param    [out] statistics - structure where the counters are saved
+*
+***********************************************************************/
+void Ts_Analyzer_Get_Statistics(TsAnalyzerStatistics* statistics);
+
+#endif
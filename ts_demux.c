@@ -0,0 +1,519 @@
+#include "ts_demux.h"
+
+#define CC_UNKNOWN 0xFF
+#define STUFFING_BYTE 0xFF
+
+typedef struct SectionStream {
+	uint8_t used;
+	uint8_t lastCC;
+	uint8_t collecting;
+	uint16_t pid;
+	uint16_t sectionSize;
+	uint16_t filled;
+	uint8_t buffer[TS_MAX_SECTION_SIZE];
+} SectionStream;
+
+typedef struct SectionFilter {
+	uint8_t used;
+	uint8_t streamIndex;
+	uint8_t tableId;
+	uint8_t tableIdMask;
+	Ts_Section_Callback callback;
+	void* userData;
+} SectionFilter;
+
+typedef struct PacketConsumer {
+	uint8_t used;
+	Ts_Packet_Callback callback;
+	void* userData;
+} PacketConsumer;
+
+/***********************************************************************
+* @brief    Checks the packet header, continuity counter and pointer
+* 			field and passes the payload to the section assembler
+*
+* @param    [in] packet - pointer to transport packet
+*
+***********************************************************************/
+static void Process_Packet(const uint8_t* packet);
+
+/***********************************************************************
+* @brief    Appends payload bytes to the section which is being
+* 			reassembled, delivers every section that gets completed
+*
+* @param    [in] streamIndex - index of the PID stream
+* @param    [in] data - pointer to payload bytes
+* @param    [in] size - number of payload bytes
+* @param    [in] newSectionsAllowed - 1 if a section may start in data
+*
+***********************************************************************/
+static void Append_Section_Data(uint8_t streamIndex, const uint8_t* data, uint16_t size, uint8_t newSectionsAllowed);
+
+/***********************************************************************
+* @brief    Calls the callbacks of all filters matching the section
+*
+* @param    [in] streamIndex - index of the PID stream
+* @param    [in] section - reassembled section or section in the packet
+*
+***********************************************************************/
+static void Deliver_Section(uint8_t streamIndex, const uint8_t* section);
+
+/* Stream index + 1 for every PID, 0 if nobody listens on the PID */
+static uint8_t pidStreamIndex[TS_NUM_OF_PIDS];
+static SectionStream streams[TS_MAX_PID_STREAMS];
+static SectionFilter filters[TS_MAX_SECTION_FILTERS];
+/* Consumer index + 1 for every PID, 0 if there is no consumer */
+static uint8_t pidConsumerIndex[TS_NUM_OF_PIDS];
+static PacketConsumer consumers[TS_MAX_PACKET_CONSUMERS];
+static TsDemuxStatistics statistics;
+/* Recursive, filters may be set and freed from the section callbacks */
+static pthread_mutex_t demuxMutex;
+
+int32_t Ts_Demux_Init()
+{
+	pthread_mutexattr_t mutexAttr;
+
+	memset(pidStreamIndex, 0, sizeof(pidStreamIndex));
+	memset(streams, 0, sizeof(streams));
+	memset(filters, 0, sizeof(filters));
+	memset(pidConsumerIndex, 0, sizeof(pidConsumerIndex));
+	memset(consumers, 0, sizeof(consumers));
+	memset(&statistics, 0, sizeof(statistics));
+
+	pthread_mutexattr_init(&mutexAttr);
+	pthread_mutexattr_settype(&mutexAttr, PTHREAD_MUTEX_RECURSIVE);
+	if (pthread_mutex_init(&demuxMutex, &mutexAttr))
+	{
+		printf("%s(%d): Error initializing demux mutex!\n", __FUNCTION__, __LINE__);
+		pthread_mutexattr_destroy(&mutexAttr);
+		return EXIT_FAILURE;
+	}
+	pthread_mutexattr_destroy(&mutexAttr);
+	return EXIT_SUCCESS;
+}
+
+int32_t Ts_Demux_Deinit()
+{
+	pthread_mutex_lock(&demuxMutex);
+	memset(pidStreamIndex, 0, sizeof(pidStreamIndex));
+	memset(filters, 0, sizeof(filters));
+	memset(streams, 0, sizeof(streams));
+	memset(pidConsumerIndex, 0, sizeof(pidConsumerIndex));
+	memset(consumers, 0, sizeof(consumers));
+	pthread_mutex_unlock(&demuxMutex);
+
+	pthread_mutex_destroy(&demuxMutex);
+	return EXIT_SUCCESS;
+}
+
+int32_t Ts_Demux_Set_Section_Filter(uint16_t pid, uint8_t tableId, uint8_t tableIdMask,
+									Ts_Section_Callback callback, void* userData, uint32_t* filterHandle)
+{
+	uint32_t i;
+	uint8_t streamIndex;
+
+	if (pid >= TS_NUM_OF_PIDS || callback == NULL || filterHandle == NULL)
+	{
+		printf("%s(%d): Invalid arguments!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+
+	pthread_mutex_lock(&demuxMutex);
+
+	for (i = 0; i < TS_MAX_SECTION_FILTERS; i++)
+	{
+		if (!filters[i].used)
+		{
+			break;
+		}
+	}
+	if (i == TS_MAX_SECTION_FILTERS)
+	{
+		pthread_mutex_unlock(&demuxMutex);
+		printf("%s(%d): No free section filters!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+
+	/* Reuse the stream if somebody already listens on the PID */
+	if (pidStreamIndex[pid] == 0)
+	{
+		for (streamIndex = 0; streamIndex < TS_MAX_PID_STREAMS; streamIndex++)
+		{
+			if (!streams[streamIndex].used)
+			{
+				break;
+			}
+		}
+		if (streamIndex == TS_MAX_PID_STREAMS)
+		{
+			pthread_mutex_unlock(&demuxMutex);
+			printf("%s(%d): No free PID streams!\n", __FUNCTION__, __LINE__);
+			return EXIT_FAILURE;
+		}
+		streams[streamIndex].used = 1;
+		streams[streamIndex].pid = pid;
+		streams[streamIndex].lastCC = CC_UNKNOWN;
+		streams[streamIndex].collecting = 0;
+		pidStreamIndex[pid] = streamIndex + 1;
+	}
+
+	filters[i].streamIndex = pidStreamIndex[pid] - 1;
+	filters[i].tableId = tableId;
+	filters[i].tableIdMask = tableIdMask;
+	filters[i].callback = callback;
+	filters[i].userData = userData;
+	filters[i].used = 1;
+	*filterHandle = i;
+
+	pthread_mutex_unlock(&demuxMutex);
+	return EXIT_SUCCESS;
+}
+
+int32_t Ts_Demux_Free_Section_Filter(uint32_t filterHandle)
+{
+	uint32_t i;
+	uint8_t streamIndex;
+
+	if (filterHandle >= TS_MAX_SECTION_FILTERS)
+	{
+		printf("%s(%d): Invalid filter handle!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+
+	pthread_mutex_lock(&demuxMutex);
+
+	if (!filters[filterHandle].used)
+	{
+		pthread_mutex_unlock(&demuxMutex);
+		printf("%s(%d): Filter already freed!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+	filters[filterHandle].used = 0;
+	streamIndex = filters[filterHandle].streamIndex;
+
+	/* Release the stream when the last filter on the PID is gone */
+	for (i = 0; i < TS_MAX_SECTION_FILTERS; i++)
+	{
+		if (filters[i].used && filters[i].streamIndex == streamIndex)
+		{
+			break;
+		}
+	}
+	if (i == TS_MAX_SECTION_FILTERS)
+	{
+		pidStreamIndex[streams[streamIndex].pid] = 0;
+		streams[streamIndex].used = 0;
+	}
+
+	pthread_mutex_unlock(&demuxMutex);
+	return EXIT_SUCCESS;
+}
+
+int32_t Ts_Demux_Set_Packet_Consumer(uint16_t pid, Ts_Packet_Callback callback, void* userData)
+{
+	uint32_t i;
+
+	if (pid >= TS_NUM_OF_PIDS || callback == NULL)
+	{
+		printf("%s(%d): Invalid arguments!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+
+	pthread_mutex_lock(&demuxMutex);
+
+	if (pidConsumerIndex[pid] != 0)
+	{
+		pthread_mutex_unlock(&demuxMutex);
+		printf("%s(%d): PID %d already has a consumer!\n", __FUNCTION__, __LINE__, pid);
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < TS_MAX_PACKET_CONSUMERS; i++)
+	{
+		if (!consumers[i].used)
+		{
+			break;
+		}
+	}
+	if (i == TS_MAX_PACKET_CONSUMERS)
+	{
+		pthread_mutex_unlock(&demuxMutex);
+		printf("%s(%d): No free packet consumers!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+
+	consumers[i].callback = callback;
+	consumers[i].userData = userData;
+	consumers[i].used = 1;
+	pidConsumerIndex[pid] = i + 1;
+
+	pthread_mutex_unlock(&demuxMutex);
+	return EXIT_SUCCESS;
+}
+
+int32_t Ts_Demux_Free_Packet_Consumer(uint16_t pid)
+{
+	if (pid >= TS_NUM_OF_PIDS)
+	{
+		printf("%s(%d): Invalid PID!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+
+	pthread_mutex_lock(&demuxMutex);
+
+	if (pidConsumerIndex[pid] == 0)
+	{
+		pthread_mutex_unlock(&demuxMutex);
+		printf("%s(%d): PID %d has no consumer!\n", __FUNCTION__, __LINE__, pid);
+		return EXIT_FAILURE;
+	}
+	consumers[pidConsumerIndex[pid] - 1].used = 0;
+	pidConsumerIndex[pid] = 0;
+
+	pthread_mutex_unlock(&demuxMutex);
+	return EXIT_SUCCESS;
+}
+
+void Ts_Demux_Feed_Packets(const uint8_t* data, uint32_t numOfPackets)
+{
+	uint32_t i;
+
+	pthread_mutex_lock(&demuxMutex);
+	for (i = 0; i < numOfPackets; i++)
+	{
+		Process_Packet(data + i * TS_PACKET_SIZE);
+	}
+	statistics.packets += numOfPackets;
+	pthread_mutex_unlock(&demuxMutex);
+}
+
+void Ts_Demux_Get_Statistics(TsDemuxStatistics* outStatistics)
+{
+	pthread_mutex_lock(&demuxMutex);
+	*outStatistics = statistics;
+	pthread_mutex_unlock(&demuxMutex);
+}
+
+void Process_Packet(const uint8_t* packet)
+{
+	uint16_t pid;
+	uint8_t streamIndex;
+	uint8_t adaptationFieldControl;
+	uint8_t continuityCounter;
+	uint8_t pointerField;
+	uint16_t offset = 4;
+	uint16_t size;
+	SectionStream* stream;
+
+	pid = ((packet[1] & 0x1F) << 8) | packet[2];
+	if (packet[0] != TS_SYNC_BYTE)
+	{
+		return;
+	}
+
+	if (pidConsumerIndex[pid] != 0)
+	{
+		consumers[pidConsumerIndex[pid] - 1].callback(packet, pid, consumers[pidConsumerIndex[pid] - 1].userData);
+	}
+
+	if (pidStreamIndex[pid] == 0)
+	{
+		return;
+	}
+	streamIndex = pidStreamIndex[pid] - 1;
+	stream = &streams[streamIndex];
+
+	/* transport_error_indicator - the payload can not be trusted */
+	if (packet[1] & 0x80)
+	{
+		statistics.transportErrors++;
+		if (stream->collecting)
+		{
+			statistics.droppedSections++;
+			stream->collecting = 0;
+		}
+		stream->lastCC = CC_UNKNOWN;
+		return;
+	}
+
+	adaptationFieldControl = (packet[3] >> 4) & 0x03;
+	continuityCounter = packet[3] & 0x0F;
+
+	/* Counter is incremented only in packets with payload */
+	if (!(adaptationFieldControl & 0x01))
+	{
+		return;
+	}
+	if (adaptationFieldControl & 0x02)
+	{
+		offset += 1 + packet[4];
+		if (offset >= TS_PACKET_SIZE)
+		{
+			return;
+		}
+	}
+
+	if (stream->lastCC != CC_UNKNOWN)
+	{
+		/* Duplicate packet is sent at most once more, skip it */
+		if (continuityCounter == stream->lastCC)
+		{
+			return;
+		}
+		if (continuityCounter != ((stream->lastCC + 1) & 0x0F))
+		{
+			statistics.continuityErrors++;
+			if (stream->collecting)
+			{
+				statistics.droppedSections++;
+				stream->collecting = 0;
+			}
+		}
+	}
+	stream->lastCC = continuityCounter;
+
+	size = TS_PACKET_SIZE - offset;
+
+	/* payload_unit_start_indicator - pointer_field precedes the payload */
+	if (packet[1] & 0x40)
+	{
+		pointerField = packet[offset];
+		offset++;
+		size--;
+		if (pointerField >= size)
+		{
+			if (stream->collecting)
+			{
+				statistics.droppedSections++;
+				stream->collecting = 0;
+			}
+			return;
+		}
+
+		/* Bytes before the pointer finish the previous section */
+		if (stream->collecting)
+		{
+			Append_Section_Data(streamIndex, packet + offset, pointerField, 0);
+			if (!stream->used || stream->pid != pid)
+			{
+				return;
+			}
+			if (stream->collecting)
+			{
+				statistics.droppedSections++;
+				stream->collecting = 0;
+			}
+		}
+		Append_Section_Data(streamIndex, packet + offset + pointerField, size - pointerField, 1);
+	}
+	else if (stream->collecting)
+	{
+		Append_Section_Data(streamIndex, packet + offset, size, 0);
+	}
+}
+
+void Append_Section_Data(uint8_t streamIndex, const uint8_t* data, uint16_t size, uint8_t newSectionsAllowed)
+{
+	SectionStream* stream = &streams[streamIndex];
+	uint16_t pid = stream->pid;
+	uint16_t needed;
+	uint16_t copy;
+	uint16_t sectionSize;
+
+	while (size > 0)
+	{
+		if (!stream->collecting)
+		{
+			/* Rest of the packet is stuffing */
+			if (!newSectionsAllowed || data[0] == STUFFING_BYTE)
+			{
+				return;
+			}
+
+			/* Section fits in this packet, it is passed without copying */
+			if (size >= 3)
+			{
+				sectionSize = 3 + (((data[1] & 0x0F) << 8) | data[2]);
+				if (sectionSize <= size)
+				{
+					Deliver_Section(streamIndex, data);
+					if (!stream->used || stream->pid != pid)
+					{
+						return;
+					}
+					data += sectionSize;
+					size -= sectionSize;
+					continue;
+				}
+			}
+			stream->collecting = 1;
+			stream->filled = 0;
+			stream->sectionSize = 0;
+		}
+
+		/* Until the header is complete only 3 bytes are needed */
+		if (stream->sectionSize == 0)
+		{
+			needed = 3 - stream->filled;
+		}
+		else
+		{
+			needed = stream->sectionSize - stream->filled;
+		}
+		copy = needed < size ? needed : size;
+		memcpy(stream->buffer + stream->filled, data, copy);
+		stream->filled += copy;
+		data += copy;
+		size -= copy;
+
+		if (stream->sectionSize == 0 && stream->filled == 3)
+		{
+			/*
+			 * 3 bytes are:				bit
+			 * table_id					08
+			 * section_syntax_indicator	01
+			 * '0'						01
+			 * reserved					02
+			 * section_length			12
+			 */
+			stream->sectionSize = 3 + (((stream->buffer[1] & 0x0F) << 8) | stream->buffer[2]);
+			if (stream->sectionSize > TS_MAX_SECTION_SIZE)
+			{
+				statistics.droppedSections++;
+				stream->collecting = 0;
+				return;
+			}
+		}
+
+		if (stream->sectionSize != 0 && stream->filled == stream->sectionSize)
+		{
+			stream->collecting = 0;
+			Deliver_Section(streamIndex, stream->buffer);
+			/* Callback could have closed the last filter on the PID */
+			if (!stream->used || stream->pid != pid)
+			{
+				return;
+			}
+		}
+	}
+}
+
+void Deliver_Section(uint8_t streamIndex, const uint8_t* section)
+{
+	uint32_t i;
+	SectionStream* stream = &streams[streamIndex];
+
+	statistics.sections++;
+	for (i = 0; i < TS_MAX_SECTION_FILTERS; i++)
+	{
+		if (filters[i].used && filters[i].streamIndex == streamIndex
+			&& ((section[0] ^ filters[i].tableId) & filters[i].tableIdMask) == 0)
+		{
+			filters[i].callback(section, stream->pid, filters[i].userData);
+			if (!stream->used)
+			{
+				return;
+			}
+		}
+	}
+}
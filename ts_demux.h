@@ -0,0 +1,126 @@
+#ifndef _TS_DEMUX_H_
+#define _TS_DEMUX_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#define TS_PACKET_SIZE 188
+#define TS_SYNC_BYTE 0x47
+#define TS_NUM_OF_PIDS 8192
+
+/* Largest private section (EIT, SDT...) including the 3 byte header */
+#define TS_MAX_SECTION_SIZE 4096
+
+#define TS_MAX_PID_STREAMS 64
+#define TS_MAX_SECTION_FILTERS 64
+#define TS_MAX_PACKET_CONSUMERS 32
+
+/* Table id mask which accepts every section on the PID */
+#define TS_TABLE_ID_ANY 0x00
+
+typedef int32_t(*Ts_Section_Callback)(const uint8_t* section, uint16_t pid, void* userData);
+typedef int32_t(*Ts_Packet_Callback)(const uint8_t* packet, uint16_t pid, void* userData);
+
+typedef struct TsDemuxStatistics {
+	uint64_t packets;
+	uint64_t sections;
+	uint32_t continuityErrors;
+	uint32_t transportErrors;
+	uint32_t droppedSections;
+} TsDemuxStatistics;
+
+/***********************************************************************
+* @brief    Software demux initialization function
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Ts_Demux_Init();
+
+/***********************************************************************
+* @brief    Software demux deinitialization function, frees all filters
+*
+* @return   EXIT_SUCCESS - no error
+*
+***********************************************************************/
+int32_t Ts_Demux_Deinit();
+
+/***********************************************************************
+* @brief    Opens a section filter, every complete section on the PID
+* 			whose table id matches is handed to the callback
+*
+* @param    [in] pid - PID which carries the sections
+* @param    [in] tableId - table id to match
+* @param    [in] tableIdMask - bits of the table id that have to match,
+* 						   TS_TABLE_ID_ANY accepts all tables
+* @param    [in] callback - called with the reassembled section
+* @param    [in] userData - passed to the callback unchanged
+* @param    [out] filterHandle - handle used to free the filter
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Ts_Demux_Set_Section_Filter(uint16_t pid, uint8_t tableId, uint8_t tableIdMask,
+									Ts_Section_Callback callback, void* userData, uint32_t* filterHandle);
+
+/***********************************************************************
+* @brief    Closes a section filter, may be called from the callback
+*
+* @param    [in] filterHandle - handle returned when the filter was set
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Ts_Demux_Free_Section_Filter(uint32_t filterHandle);
+
+/***********************************************************************
+* @brief    Routes every packet of the PID to the consumer, the packet
+* 			is passed by pointer and is valid only during the call
+*
+* @param    [in] pid - PID of the packets
+* @param    [in] callback - called with each packet
+* @param    [in] userData - passed to the callback unchanged
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Ts_Demux_Set_Packet_Consumer(uint16_t pid, Ts_Packet_Callback callback, void* userData);
+
+/***********************************************************************
+* @brief    Stops routing the packets of the PID to its consumer
+*
+* @param    [in] pid - PID of the packets
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Ts_Demux_Free_Packet_Consumer(uint16_t pid);
+
+/***********************************************************************
+* @brief    Feeds whole transport packets to the demux, packets must
+* 			start with the sync byte. Sections which fit in one packet
+* 			are passed to the filters straight from data
+*
+* @param    [in] data - pointer to the first packet
+* @param    [in] numOfPackets - number of packets in data
+*
+***********************************************************************/
+void Ts_Demux_Feed_Packets(const uint8_t* data, uint32_t numOfPackets);
+
+/***********************************************************************
+* @brief    Copies the demux counters
+*
+* @param    [out] statistics - structure where the counters are saved
+*
+***********************************************************************/
+void Ts_Demux_Get_Statistics(TsDemuxStatistics* statistics);
+
+#endif
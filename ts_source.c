@@ -0,0 +1,327 @@
+#include "ts_source.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/* Sync is locked only when three sync bytes are a packet apart */
+#define TS_SYNC_CONFIRM_SIZE (3 * TS_PACKET_SIZE)
+
+/***********************************************************************
+* @brief    Maps the next window of the file or reads the next block
+* 			from the pipe, keeps the bytes which were not consumed
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+static int32_t Refill();
+
+/***********************************************************************
+* @brief    Finds the sync byte which is followed by sync bytes one and
+* 			two packets later
+*
+* @param    [in] data - pointer to unread bytes
+* @param    [in] size - number of unread bytes, at least one packet
+*
+* @return   offset of the packet, or the number of bytes that can be
+* 			skipped when there is no packet start in data
+*
+***********************************************************************/
+static uint32_t Find_Sync(const uint8_t* data, uint32_t size);
+
+/***********************************************************************
+* @brief    Vectorized search for the first 0x47 byte in data
+*
+* @param    [in] data - pointer to bytes
+* @param    [in] start - first offset to check
+* @param    [in] end - offset after the last one to check
+*
+* @return   offset of the sync byte, end if there is none
+*
+***********************************************************************/
+static uint32_t Find_Sync_Byte(const uint8_t* data, uint32_t start, uint32_t end);
+
+static int32_t sourceFileDesc = -1;
+static uint8_t isMapped = 0;
+static uint8_t endOfStream = 0;
+static uint8_t syncLocked = 0;
+static uint64_t fileSize = 0;
+/* Either the mapped window or the read buffer */
+static uint8_t* window = NULL;
+static uint32_t windowSize = 0;
+static uint32_t windowCursor = 0;
+static uint64_t windowFileOffset = 0;
+static long pageSize;
+static TsSourceStatistics statistics;
+
+int32_t Ts_Source_Open(const char* fileName)
+{
+	struct stat fileStat;
+
+	memset(&statistics, 0, sizeof(statistics));
+	endOfStream = 0;
+	syncLocked = 0;
+	window = NULL;
+	windowSize = 0;
+	windowCursor = 0;
+	windowFileOffset = 0;
+	pageSize = sysconf(_SC_PAGESIZE);
+
+	if (strcmp(fileName, TS_SOURCE_STDIN) == 0)
+	{
+		sourceFileDesc = STDIN_FILENO;
+	}
+	else
+	{
+		sourceFileDesc = open(fileName, O_RDONLY);
+		if (sourceFileDesc == -1)
+		{
+			printf("Error while opening stream (%s): %s!\n", fileName, strerror(errno));
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (fstat(sourceFileDesc, &fileStat) == -1)
+	{
+		printf("Error while reading stream info: %s!\n", strerror(errno));
+		Ts_Source_Close();
+		return EXIT_FAILURE;
+	}
+
+	isMapped = S_ISREG(fileStat.st_mode) ? 1 : 0;
+	if (isMapped)
+	{
+		fileSize = fileStat.st_size;
+		if (fileSize == 0)
+		{
+			endOfStream = 1;
+		}
+		return EXIT_SUCCESS;
+	}
+
+	/* Aligned so the kernel can copy whole pages */
+	if (posix_memalign((void**)&window, pageSize, TS_SOURCE_READ_BLOCK))
+	{
+		printf("Error allocating memory!\n");
+		window = NULL;
+		Ts_Source_Close();
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+int32_t Ts_Source_Close()
+{
+	if (window != NULL)
+	{
+		if (isMapped)
+		{
+			munmap(window, windowSize);
+		}
+		else
+		{
+			free(window);
+		}
+		window = NULL;
+	}
+
+	if (sourceFileDesc != -1 && sourceFileDesc != STDIN_FILENO)
+	{
+		close(sourceFileDesc);
+	}
+	sourceFileDesc = -1;
+	return EXIT_SUCCESS;
+}
+
+uint32_t Ts_Source_Read(const uint8_t** packets, uint32_t maxPackets)
+{
+	const uint8_t* data;
+	uint32_t available;
+	uint32_t offset;
+	uint32_t numOfPackets;
+
+	while (NON_STOP)
+	{
+		available = windowSize - windowCursor;
+		if (available < TS_SYNC_CONFIRM_SIZE && !endOfStream)
+		{
+			if (Refill())
+			{
+				return 0;
+			}
+			continue;
+		}
+
+		if (available < TS_PACKET_SIZE)
+		{
+			statistics.skippedBytes += available;
+			windowCursor = windowSize;
+			return 0;
+		}
+
+		data = window + windowCursor;
+		if (data[0] != TS_SYNC_BYTE)
+		{
+			if (syncLocked)
+			{
+				statistics.syncLosses++;
+				syncLocked = 0;
+			}
+			offset = Find_Sync(data, available);
+			statistics.skippedBytes += offset;
+			windowCursor += offset;
+			continue;
+		}
+
+		/* Packets are handed out while the sync bytes keep coming */
+		numOfPackets = 1;
+		while (numOfPackets < maxPackets
+			   && (numOfPackets + 1) * TS_PACKET_SIZE <= available
+			   && data[numOfPackets * TS_PACKET_SIZE] == TS_SYNC_BYTE)
+		{
+			numOfPackets++;
+		}
+
+		syncLocked = 1;
+		windowCursor += numOfPackets * TS_PACKET_SIZE;
+		statistics.packets += numOfPackets;
+		statistics.bytes += numOfPackets * TS_PACKET_SIZE;
+		*packets = data;
+		return numOfPackets;
+	}
+}
+
+void Ts_Source_Get_Statistics(TsSourceStatistics* outStatistics)
+{
+	*outStatistics = statistics;
+}
+
+int32_t Refill()
+{
+	uint64_t fileOffset;
+	uint32_t available = windowSize - windowCursor;
+	ssize_t ret;
+
+	if (isMapped)
+	{
+		/* New window starts at the page holding the first unread byte */
+		fileOffset = (windowFileOffset + windowCursor) & ~((uint64_t)pageSize - 1);
+		if (window != NULL)
+		{
+			munmap(window, windowSize);
+			window = NULL;
+		}
+
+		windowSize = (fileSize - fileOffset) < TS_SOURCE_MAP_WINDOW ? (fileSize - fileOffset) : TS_SOURCE_MAP_WINDOW;
+		window = mmap(NULL, windowSize, PROT_READ, MAP_PRIVATE, sourceFileDesc, fileOffset);
+		if (window == MAP_FAILED)
+		{
+			printf("Error while mapping stream: %s!\n", strerror(errno));
+			window = NULL;
+			windowSize = 0;
+			windowCursor = 0;
+			endOfStream = 1;
+			return EXIT_FAILURE;
+		}
+		madvise(window, windowSize, MADV_SEQUENTIAL);
+
+		windowCursor = windowFileOffset + windowCursor - fileOffset;
+		windowFileOffset = fileOffset;
+		if (fileOffset + windowSize == fileSize)
+		{
+			endOfStream = 1;
+		}
+		return EXIT_SUCCESS;
+	}
+
+	/* Only the incomplete tail of the previous block is moved */
+	memmove(window, window + windowCursor, available);
+	windowSize = available;
+	windowCursor = 0;
+
+	while (windowSize < TS_SYNC_CONFIRM_SIZE)
+	{
+		ret = read(sourceFileDesc, window + windowSize, TS_SOURCE_READ_BLOCK - windowSize);
+		if (ret == 0)
+		{
+			endOfStream = 1;
+			break;
+		}
+		if (ret == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			printf("Error while reading stream: %s!\n", strerror(errno));
+			endOfStream = 1;
+			return EXIT_FAILURE;
+		}
+		windowSize += ret;
+	}
+	return EXIT_SUCCESS;
+}
+
+uint32_t Find_Sync(const uint8_t* data, uint32_t size)
+{
+	/* Last offset where a whole packet still fits */
+	uint32_t last = size - TS_PACKET_SIZE;
+	uint32_t offset = 0;
+
+	while (offset <= last)
+	{
+		offset = Find_Sync_Byte(data, offset, last + 1);
+		if (offset > last)
+		{
+			break;
+		}
+
+		/* Confirmations beyond the end of data are checked on the next read */
+		if ((offset + TS_PACKET_SIZE >= size || data[offset + TS_PACKET_SIZE] == TS_SYNC_BYTE)
+			&& (offset + 2 * TS_PACKET_SIZE >= size || data[offset + 2 * TS_PACKET_SIZE] == TS_SYNC_BYTE))
+		{
+			return offset;
+		}
+		offset++;
+	}
+	return last + 1;
+}
+
+uint32_t Find_Sync_Byte(const uint8_t* data, uint32_t start, uint32_t end)
+{
+	uint32_t i = start;
+	const uint8_t* found;
+
+#if defined(__SSE2__)
+	const __m128i sync = _mm_set1_epi8(TS_SYNC_BYTE);
+	uint32_t mask;
+
+	for (; i + 16 <= end; i += 16)
+	{
+		mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + i)), sync));
+		if (mask)
+		{
+			return i + __builtin_ctz(mask);
+		}
+	}
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+	const uint8x16_t sync = vdupq_n_u8(TS_SYNC_BYTE);
+	uint64x2_t equal;
+
+	for (; i + 16 <= end; i += 16)
+	{
+		equal = vreinterpretq_u64_u8(vceqq_u8(vld1q_u8(data + i), sync));
+		if (vgetq_lane_u64(equal, 0) | vgetq_lane_u64(equal, 1))
+		{
+			break;
+		}
+	}
+#endif
+
+	/* Tail, or the exact position inside the matching NEON block */
+	found = memchr(data + i, TS_SYNC_BYTE, end - i);
+	return found != NULL ? (uint32_t)(found - data) : end;
+}
@@ -0,0 +1,72 @@
+#ifndef _TS_SOURCE_H_
+#define _TS_SOURCE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ts_demux.h"
+#include "common.h"
+
+/* Part of a regular file which is mapped at once, keeps 32 bit address space usable */
+#define TS_SOURCE_MAP_WINDOW (64 * 1024 * 1024)
+/* Block read from a pipe, multiple of both packet and page size */
+#define TS_SOURCE_READ_BLOCK (4096 * TS_PACKET_SIZE)
+
+/* Name which selects the standard input */
+#define TS_SOURCE_STDIN "-"
+
+typedef struct TsSourceStatistics {
+	uint64_t bytes;
+	uint64_t packets;
+	uint64_t skippedBytes;
+	uint32_t syncLosses;
+} TsSourceStatistics;
+
+/***********************************************************************
+* @brief    Opens a transport stream source, regular files are memory
+* 			mapped, pipes and devices are read in large aligned blocks
+*
+* @param    [in] fileName - path to the stream or TS_SOURCE_STDIN
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Ts_Source_Open(const char* fileName);
+
+/***********************************************************************
+* @brief    Closes the source and unmaps the file
+*
+* @return   EXIT_SUCCESS - no error
+*
+***********************************************************************/
+int32_t Ts_Source_Close();
+
+/***********************************************************************
+* @brief    Returns the next run of consecutive synchronized packets
+* 			without copying them, the pointer stays valid until the
+* 			next call
+*
+* @param    [out] packets - pointer to the first packet of the run
+* @param    [in] maxPackets - maximum length of the run
+*
+* @return   number of packets in the run, 0 at the end of the stream
+*
+***********************************************************************/
+uint32_t Ts_Source_Read(const uint8_t** packets, uint32_t maxPackets);
+
+/***********************************************************************
+* @brief    Copies the source counters
+*
+* @param    [out] statistics - structure where the counters are saved
+*
+***********************************************************************/
+void Ts_Source_Get_Statistics(TsSourceStatistics* statistics);
+
+#endif
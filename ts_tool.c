@@ -0,0 +1,773 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include "ts_demux.h"
+#include "ts_source.h"
+#include "table_parse.h"
+#include "psi_cache.h"
+#include "service_db.h"
+#include "epg_store.h"
+#include "channel_scan.h"
+#include "channel_map.h"
+#include "teletext.h"
+#include "subtitle.h"
+#include "ts_analyzer.h"
+
+/* Host tool which runs the PSI path on a recorded transport stream */
+
+/* Packets passed to the demux under one lock */
+#define FEED_RUN_PACKETS 1024
+#define MAX_NUM_OF_PROGRAMS 256
+#define MAX_NUM_OF_SERVICES 256
+/* EIT section holds at most 4084 / 12 events */
+#define MAX_NUM_OF_EVENTS 340
+/* Recording is played again until the channel map is revalidated, like a live carousel */
+#define MAX_CHANNEL_MAP_PASSES 10
+
+typedef struct ProgramInfo {
+	PATTable pat;
+	PMTTable pmt;
+	uint8_t pmtReceived;
+	uint32_t filterHandle;
+} ProgramInfo;
+
+/***********************************************************************
+* @brief    Section callback for the PAT, opens a filter for every new
+* 			PMT
+*
+***********************************************************************/
+static int32_t PAT_Section_Received(const uint8_t* section, uint16_t pid, void* userData);
+
+/***********************************************************************
+* @brief    Section callback for the PMT of one program
+*
+***********************************************************************/
+static int32_t PMT_Section_Received(const uint8_t* section, uint16_t pid, void* userData);
+
+/***********************************************************************
+* @brief    Section callback for the SDT, saves the service names
+*
+***********************************************************************/
+static int32_t SDT_Section_Received(const uint8_t* section, uint16_t pid, void* userData);
+
+/***********************************************************************
+* @brief    Section callback for the NIT, saves the channel numbers
+*
+***********************************************************************/
+static int32_t NIT_Section_Received(const uint8_t* section, uint16_t pid, void* userData);
+
+/***********************************************************************
+* @brief    Section callback for the EIT, adds the events to the batch
+*
+***********************************************************************/
+static int32_t EIT_Section_Received(const uint8_t* section, uint16_t pid, void* userData);
+
+/***********************************************************************
+* @brief    Reports the PSI tables which were acquired or changed
+*
+***********************************************************************/
+static void Table_Version_Changed(const uint8_t* section, void* userData);
+
+/***********************************************************************
+* @brief    Runs a channel scan on the opened source and reports how far
+* 			into the stream the PAT and all PMTs were complete
+*
+* @param    [in] maxPmtFilters - PMT filters open at the same time
+*
+* @return   EXIT_SUCCESS - scan completed
+* @return   EXIT_FAILURE - stream ended before the scan completed
+*
+***********************************************************************/
+static int32_t Run_Scan(uint32_t maxPmtFilters);
+
+/***********************************************************************
+* @brief    Loads the channel map and prints how long after the start of
+* 			the process the channel list was usable
+*
+* @param    [in] fileName - path to the channel map
+* @param    [in] processStart - time at the start of main
+*
+***********************************************************************/
+static void Load_Channel_Map(const char* fileName, const struct timespec* processStart);
+
+/***********************************************************************
+* @brief    Prints a page of the teletext cache, control codes as spaces
+*
+* @param    [in] pageNumber - page from 0x100 to 0x8FF
+*
+***********************************************************************/
+static void Print_Teletext_Page(uint16_t pageNumber);
+
+/***********************************************************************
+* @brief    Subtitle callback, prints the display sets as they are
+* 			decoded
+*
+***********************************************************************/
+static void Subtitle_Displayed(const SubtitleOverlay* overlay, void* argument);
+
+/***********************************************************************
+* @brief    Analyzer mode, writes JSON snapshots of the PIDs in one pass
+* 			over the source
+*
+* @param    [in] fileName - file of the snapshots, TS_SOURCE_STDIN for
+* 							the standard output
+* @param    [in] interval - milliseconds of stream time between snapshots
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+static int32_t Run_Analyzer(const char* fileName, uint32_t interval);
+
+static ProgramInfo programs[MAX_NUM_OF_PROGRAMS];
+static uint32_t numOfPrograms = 0;
+static EITEvent eventTable[MAX_NUM_OF_EVENTS];
+/* Start of the first present event, used as the time of the stream */
+static uint32_t streamTime = 0;
+/* Page printed at the end, the teletext of the first program which has it is decoded */
+static uint16_t teletextPage = TELETEXT_NO_PAGE;
+static uint16_t teletextPID = 0;
+/* Subtitles of the first program which has them are decoded and printed */
+static uint8_t subtitleMode = 0;
+static uint16_t subtitlePID = 0;
+
+int32_t main(int32_t argc, char** argv)
+{
+	const uint8_t* packets;
+	uint32_t numOfPackets;
+	uint32_t i;
+	uint32_t filterHandle;
+	ServiceEntry service;
+	struct timespec processStart;
+	struct timespec start;
+	struct timespec end;
+	double seconds;
+	TsDemuxStatistics statistics;
+	TsSourceStatistics sourceStatistics;
+	PsiCacheStatistics cacheStatistics;
+	EpgStoreStatistics epgStatistics;
+	EITEvent presentEvent;
+	int32_t option;
+	uint8_t scanMode = 0;
+	const char* analyzerFile = NULL;
+	uint32_t analyzerInterval = ANALYZER_DEFAULT_INTERVAL;
+	uint32_t maxPmtFilters = CHANNEL_SCAN_ALL_FILTERS;
+	const char* channelMapFile = NULL;
+	uint32_t passes = 1;
+	uint32_t mapState;
+	int32_t ret;
+	ChannelMapStatistics mapStatistics;
+	SubtitleStatistics subtitleStatistics;
+
+	clock_gettime(CLOCK_MONOTONIC, &processStart);
+
+	while ((option = getopt(argc, argv, "sf:m:t:ua:i:")) != -1)
+	{
+		switch (option)
+		{
+			case 'm':
+				channelMapFile = optarg;
+				break;
+			case 's':
+				scanMode = 1;
+				break;
+			case 'f':
+				maxPmtFilters = atoi(optarg);
+				break;
+			case 't':
+				teletextPage = strtoul(optarg, NULL, 16);
+				break;
+			case 'u':
+				subtitleMode = 1;
+				break;
+			case 'a':
+				analyzerFile = optarg;
+				break;
+			case 'i':
+				analyzerInterval = atoi(optarg);
+				break;
+			default:
+				optind = argc;
+				break;
+		}
+	}
+	if (optind != argc - 1)
+	{
+		printf("Usage: %s [-s [-f max PMT filters]] [-m channel map] [-t teletext page] [-u] [-a snapshot file [-i snapshot ms]] <file.ts | ->\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	/* Channel list is usable before anything is demuxed */
+	if (channelMapFile != NULL)
+	{
+		Channel_Map_Init();
+		Load_Channel_Map(channelMapFile, &processStart);
+	}
+
+	if (Ts_Source_Open(argv[optind]))
+	{
+		return EXIT_FAILURE;
+	}
+
+	if (scanMode)
+	{
+		Ts_Demux_Init();
+		Channel_Scan_Init();
+		ret = Run_Scan(maxPmtFilters);
+		Channel_Scan_Deinit();
+		Ts_Demux_Deinit();
+		Ts_Source_Close();
+		return ret;
+	}
+
+	if (analyzerFile != NULL)
+	{
+		ret = Run_Analyzer(analyzerFile, analyzerInterval);
+		Ts_Source_Close();
+		return ret;
+	}
+
+	Ts_Demux_Init();
+	if (teletextPage != TELETEXT_NO_PAGE && Teletext_Init(NULL, NULL))
+	{
+		Ts_Demux_Deinit();
+		Ts_Source_Close();
+		return EXIT_FAILURE;
+	}
+	/* Without a clock display sets are printed as soon as they are decoded */
+	if (subtitleMode && Subtitle_Init(NULL, Subtitle_Displayed, NULL) == EXIT_SUCCESS)
+	{
+		/* File is read faster than it is decoded, every PES has to wait for a buffer */
+		Subtitle_Set_Blocking(1);
+	}
+	else if (subtitleMode)
+	{
+		if (teletextPage != TELETEXT_NO_PAGE)
+		{
+			Teletext_Deinit();
+		}
+		Ts_Demux_Deinit();
+		Ts_Source_Close();
+		return EXIT_FAILURE;
+	}
+	Psi_Cache_Init();
+	Psi_Cache_Register_Change_Callback(Table_Version_Changed, NULL);
+	Service_Db_Init();
+	Epg_Store_Init();
+	Ts_Demux_Set_Section_Filter(PAT_PID, PAT_TABLE_ID, 0xFF, PAT_Section_Received, NULL, &filterHandle);
+	Ts_Demux_Set_Section_Filter(SDT_PID, SDT_TABLE_ID, 0xFF, SDT_Section_Received, NULL, &filterHandle);
+	Ts_Demux_Set_Section_Filter(NIT_PID, NIT_TABLE_ID, 0xFF, NIT_Section_Received, NULL, &filterHandle);
+	Ts_Demux_Set_Section_Filter(EIT_PID, EIT_PF_ACTUAL_TABLE_ID, 0xFE, EIT_Section_Received, NULL, &filterHandle);
+	Ts_Demux_Set_Section_Filter(EIT_PID, EIT_SCHEDULE_ACTUAL_TABLE_ID, 0xF0, EIT_Section_Received, NULL, &filterHandle);
+	Ts_Demux_Set_Section_Filter(EIT_PID, EIT_SCHEDULE_OTHER_TABLE_ID, 0xF0, EIT_Section_Received, NULL, &filterHandle);
+	if (channelMapFile != NULL)
+	{
+		Channel_Scan_Init();
+		Channel_Map_Start_Revalidation(channelMapFile, NULL);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	/* Packets are demuxed straight from the mapped file */
+	while (NON_STOP)
+	{
+		while ((numOfPackets = Ts_Source_Read(&packets, FEED_RUN_PACKETS)) > 0)
+		{
+			Ts_Demux_Feed_Packets(packets, numOfPackets);
+			/* Events of the whole run become visible at once */
+			Epg_Store_Commit();
+		}
+
+		if (channelMapFile == NULL || passes == MAX_CHANNEL_MAP_PASSES || strcmp(argv[optind], TS_SOURCE_STDIN) == 0)
+		{
+			break;
+		}
+		mapState = Channel_Map_Get_State();
+		if (mapState != CHANNEL_MAP_NONE && mapState != CHANNEL_MAP_UNVERIFIED)
+		{
+			break;
+		}
+		/* Revalidation thread gets time to open its filters */
+		usleep(10000);
+		Ts_Source_Close();
+		Ts_Source_Open(argv[optind]);
+		passes++;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	Ts_Source_Get_Statistics(&sourceStatistics);
+	Ts_Source_Close();
+
+	if (channelMapFile != NULL)
+	{
+		Channel_Map_Stop_Revalidation();
+		Channel_Map_Get_Statistics(&mapStatistics);
+		switch (mapStatistics.state)
+		{
+			case CHANNEL_MAP_VALID:
+				printf("Channel map is valid, checked in %u ms\n", mapStatistics.validationTime);
+				break;
+			case CHANNEL_MAP_UPDATED:
+				printf("Channel map updated to %u channels (transport_stream_id %d, PAT version %d) in %u ms\n",
+					   mapStatistics.numOfChannels, mapStatistics.transportStreamId, mapStatistics.patVersion,
+					   mapStatistics.validationTime);
+				break;
+			default:
+				printf("Channel map could not be revalidated after %u passes\n", passes);
+				break;
+		}
+		Channel_Map_Deinit();
+		Channel_Scan_Deinit();
+	}
+
+	for (i = 0; i < numOfPrograms; i++)
+	{
+		if (programs[i].pmtReceived)
+		{
+			printf("Program %5d PMT PID %4d: video PID %4d, audio PID %4d%s%s%s\n",
+				   programs[i].pat.programNumber, programs[i].pat.programMapPID,
+				   programs[i].pmt.videoPID, programs[i].pmt.audioPID,
+				   programs[i].pmt.teletext ? ", TXT" : "",
+				   programs[i].pmt.numOfSubtitles ? ", SUB " : "",
+				   programs[i].pmt.numOfSubtitles ? programs[i].pmt.subtitles[0].language : "");
+		}
+		else
+		{
+			printf("Program %5d PMT PID %4d: no PMT received\n",
+				   programs[i].pat.programNumber, programs[i].pat.programMapPID);
+		}
+	}
+
+	for (i = 0; i < Service_Db_Get_Count(); i++)
+	{
+		Service_Db_Get_Service(i, &service);
+		printf("LCN %4d program %5d type 0x%02X%s: %s\n", service.logicalChannelNumber,
+			   service.programNumber, service.serviceType, service.visible ? "" : " (hidden)",
+			   service.serviceName);
+		if (Epg_Store_Get_Event_At(service.programNumber, streamTime, &presentEvent) == EXIT_SUCCESS)
+		{
+			printf("    now: %s (%u min)\n", presentEvent.eventName, presentEvent.duration / 60);
+			if (Epg_Store_Get_Events(service.programNumber, presentEvent.startTime + presentEvent.duration,
+									 presentEvent.startTime + presentEvent.duration + 24 * 3600, &presentEvent, 1))
+			{
+				printf("    next: %s (%u min)\n", presentEvent.eventName, presentEvent.duration / 60);
+			}
+		}
+	}
+
+	Ts_Demux_Get_Statistics(&statistics);
+	seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	printf("Packets: %llu, sections: %llu, CC errors: %u, TEI errors: %u, dropped sections: %u\n",
+		   (unsigned long long)statistics.packets, (unsigned long long)statistics.sections,
+		   statistics.continuityErrors, statistics.transportErrors, statistics.droppedSections);
+	Psi_Cache_Get_Statistics(&cacheStatistics);
+	printf("PSI sections new: %llu, repeated: %llu, corrupted: %u, version changes: %u\n",
+		   (unsigned long long)cacheStatistics.newSections, (unsigned long long)cacheStatistics.repeatedSections,
+		   cacheStatistics.corruptedSections, cacheStatistics.versionChanges);
+	Epg_Store_Get_Statistics(&epgStatistics);
+	printf("EPG services: %u, events: %u, strings: %u (%u bytes, %llu shared), commits: %u, compactions: %u, dropped: %u, memory: %u KB\n",
+		   epgStatistics.numOfServices, epgStatistics.numOfEvents, epgStatistics.numOfStrings,
+		   epgStatistics.stringBytes, (unsigned long long)epgStatistics.internedStrings, epgStatistics.commits,
+		   epgStatistics.compactions, epgStatistics.droppedEvents, epgStatistics.memorySize / 1024);
+	ret = EXIT_SUCCESS;
+	if (epgStatistics.memorySize >= EPG_MEMORY_TARGET)
+	{
+		printf("EPG store uses %u KB, over the %u KB target!\n", epgStatistics.memorySize / 1024,
+			   EPG_MEMORY_TARGET / 1024);
+		ret = EXIT_FAILURE;
+	}
+	printf("Sync losses: %u, skipped bytes: %llu\n", sourceStatistics.syncLosses,
+		   (unsigned long long)sourceStatistics.skippedBytes);
+	if (seconds > 0)
+	{
+		printf("Demuxed %llu bytes in %.3f s (%.1f Mbit/s)\n", (unsigned long long)sourceStatistics.bytes,
+			   seconds, sourceStatistics.bytes * 8 / seconds / 1e6);
+	}
+
+	if (teletextPage != TELETEXT_NO_PAGE)
+	{
+		Print_Teletext_Page(teletextPage);
+		Teletext_Deinit();
+	}
+	if (subtitleMode)
+	{
+		/* Deinit decodes the queued PES first, the counters are complete after it */
+		Subtitle_Deinit();
+		Subtitle_Get_Statistics(&subtitleStatistics);
+		printf("Subtitle PID %d: PES packets %u, dropped %u, CC errors %u, segments %u, segment errors %u, "
+			   "epochs %u, display sets %u, dropped %u, longest decode %u us\n", subtitlePID,
+			   subtitleStatistics.pesPackets, subtitleStatistics.droppedPes, subtitleStatistics.continuityErrors,
+			   subtitleStatistics.segments, subtitleStatistics.segmentErrors, subtitleStatistics.epochs,
+			   subtitleStatistics.displaySets, subtitleStatistics.droppedDisplaySets,
+			   subtitleStatistics.maxDecodeTime);
+	}
+
+	Epg_Store_Deinit();
+	Service_Db_Deinit();
+	Psi_Cache_Deinit();
+	Ts_Demux_Deinit();
+	return ret;
+}
+
+int32_t Run_Scan(uint32_t maxPmtFilters)
+{
+	const uint8_t* packets;
+	uint32_t numOfPackets;
+	uint32_t i;
+	uint32_t state = CHANNEL_SCAN_WAITING_PAT;
+	uint64_t packetCount = 0;
+	uint64_t patPackets = 0;
+	ChannelScanResult result;
+
+	if (Channel_Scan_Start(maxPmtFilters))
+	{
+		return EXIT_FAILURE;
+	}
+
+	/* Packets are fed one by one so that the point of completion is exact */
+	while (state != CHANNEL_SCAN_COMPLETE && (numOfPackets = Ts_Source_Read(&packets, FEED_RUN_PACKETS)) > 0)
+	{
+		for (i = 0; i < numOfPackets && state != CHANNEL_SCAN_COMPLETE; i++)
+		{
+			Ts_Demux_Feed_Packets(packets + i * TS_PACKET_SIZE, 1);
+			packetCount++;
+			state = Channel_Scan_Get_State();
+			if (state != CHANNEL_SCAN_WAITING_PAT && patPackets == 0)
+			{
+				patPackets = packetCount;
+			}
+		}
+	}
+	Channel_Scan_Stop();
+	Channel_Scan_Get_Result(&result);
+
+	for (i = 0; i < result.numOfPrograms; i++)
+	{
+		if (result.programs[i].pmtReceived)
+		{
+			printf("Program %5d PMT PID %4d: video PID %4d, audio PID %4d%s%s%s\n",
+				   result.programs[i].pat.programNumber, result.programs[i].pat.programMapPID,
+				   result.programs[i].pmt.videoPID, result.programs[i].pmt.audioPID,
+				   result.programs[i].pmt.teletext ? ", TXT" : "",
+				   result.programs[i].pmt.numOfSubtitles ? ", SUB " : "",
+				   result.programs[i].pmt.numOfSubtitles ? result.programs[i].pmt.subtitles[0].language : "");
+		}
+		else
+		{
+			printf("Program %5d PMT PID %4d: no PMT received\n",
+				   result.programs[i].pat.programNumber, result.programs[i].pat.programMapPID);
+		}
+	}
+
+	printf("PAT complete after %llu packets\n", (unsigned long long)patPackets);
+	if (result.state != CHANNEL_SCAN_COMPLETE)
+	{
+		printf("Scan incomplete: %u of %u PMTs received in %llu packets\n", result.numOfReceived,
+			   result.numOfPrograms, (unsigned long long)packetCount);
+		return EXIT_FAILURE;
+	}
+	printf("Scan complete: %u programs after %llu packets, %u ms, at most %u PMT filters open\n",
+		   result.numOfPrograms, (unsigned long long)packetCount, result.scanTime, result.maxOpenFilters);
+	return EXIT_SUCCESS;
+}
+
+int32_t Run_Analyzer(const char* fileName, uint32_t interval)
+{
+	FILE* file = stdout;
+	const uint8_t* packets;
+	uint32_t numOfPackets;
+	struct timespec start;
+	struct timespec end;
+	double seconds;
+	TsAnalyzerStatistics statistics;
+	TsSourceStatistics sourceStatistics;
+
+	if (strcmp(fileName, TS_SOURCE_STDIN) != 0)
+	{
+		file = fopen(fileName, "w");
+		if (file == NULL)
+		{
+			printf("%s(%d): Error opening %s (%s)!\n", __FUNCTION__, __LINE__, fileName, strerror(errno));
+			return EXIT_FAILURE;
+		}
+	}
+
+	Ts_Demux_Init();
+	if (Ts_Analyzer_Init(interval, file))
+	{
+		Ts_Demux_Deinit();
+		if (file != stdout)
+		{
+			fclose(file);
+		}
+		return EXIT_FAILURE;
+	}
+
+	/* Demux only assembles the PAT and PMTs which label the PIDs */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	while ((numOfPackets = Ts_Source_Read(&packets, FEED_RUN_PACKETS)) > 0)
+	{
+		Ts_Demux_Feed_Packets(packets, numOfPackets);
+		Ts_Analyzer_Feed_Packets(packets, numOfPackets);
+	}
+	Ts_Analyzer_Snapshot();
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	Ts_Analyzer_Get_Statistics(&statistics);
+	Ts_Source_Get_Statistics(&sourceStatistics);
+	seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	/* Snapshots may go to stdout, the summary must not end up between them */
+	fprintf(stderr, "Analyzed %llu packets on %u PIDs: CC errors %u, TEI errors %u, PCR discontinuities %u, "
+			"sync losses %u, snapshots %u\n", (unsigned long long)statistics.packets, statistics.pids,
+			statistics.continuityErrors, statistics.transportErrors, statistics.pcrDiscontinuities,
+			sourceStatistics.syncLosses, statistics.snapshots);
+	if (seconds > 0)
+	{
+		fprintf(stderr, "Analyzed %llu bytes in %.3f s (%.1f Mbit/s)\n", (unsigned long long)sourceStatistics.bytes,
+				seconds, sourceStatistics.bytes * 8 / seconds / 1e6);
+	}
+
+	Ts_Analyzer_Deinit();
+	Ts_Demux_Deinit();
+	if (file != stdout)
+	{
+		fclose(file);
+	}
+	return EXIT_SUCCESS;
+}
+
+void Load_Channel_Map(const char* fileName, const struct timespec* processStart)
+{
+	const ChannelMapEntry* channels;
+	uint32_t numOfChannels;
+	uint32_t i;
+	struct timespec now;
+	ChannelMapStatistics mapStatistics;
+
+	if (Channel_Map_Load(fileName))
+	{
+		printf("No usable channel map, it is built by the revalidation\n");
+		return;
+	}
+	numOfChannels = Channel_Map_Get_Channels(&channels);
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	Channel_Map_Get_Statistics(&mapStatistics);
+
+	printf("Channel map: %u channels usable %.3f ms after start (mapped and checked in %u us)\n", numOfChannels,
+		   (now.tv_sec - processStart->tv_sec) * 1e3 + (now.tv_nsec - processStart->tv_nsec) / 1e6,
+		   mapStatistics.loadTime);
+	for (i = 0; i < numOfChannels; i++)
+	{
+		printf("Map LCN %4d program %5d PMT PID %4d: video PID %4d, audio PID %4d: %s\n",
+			   channels[i].logicalChannelNumber, channels[i].programNumber, channels[i].programMapPID,
+			   channels[i].videoPID, channels[i].audioPID, channels[i].serviceName);
+	}
+}
+
+int32_t PAT_Section_Received(const uint8_t* section, uint16_t pid, void* userData)
+{
+	PATTable programTable[MAX_NUM_OF_PROGRAMS];
+	uint32_t count;
+	uint32_t i;
+	uint32_t j;
+
+	/* Repetitions of the same PAT are not parsed again */
+	if (Psi_Cache_Filter_Section(section) != PSI_SECTION_NEW)
+	{
+		return EXIT_SUCCESS;
+	}
+
+	count = PAT_Parse(section, programTable);
+	Service_Db_Update_PAT(programTable, count);
+	for (i = 0; i < count && numOfPrograms < MAX_NUM_OF_PROGRAMS; i++)
+	{
+		for (j = 0; j < numOfPrograms; j++)
+		{
+			if (programs[j].pat.programNumber == programTable[i].programNumber)
+			{
+				break;
+			}
+		}
+		if (j < numOfPrograms)
+		{
+			continue;
+		}
+
+		programs[numOfPrograms].pat = programTable[i];
+		if (Ts_Demux_Set_Section_Filter(programTable[i].programMapPID, PMT_TABLE_ID, 0xFF,
+										PMT_Section_Received, &programs[numOfPrograms],
+										&programs[numOfPrograms].filterHandle))
+		{
+			continue;
+		}
+		numOfPrograms++;
+	}
+	return EXIT_SUCCESS;
+}
+
+int32_t PMT_Section_Received(const uint8_t* section, uint16_t pid, void* userData)
+{
+	ProgramInfo* program = (ProgramInfo*)userData;
+	uint16_t programNumber = (section[3] << 8) | section[4];
+
+	/* Several programs can share one PMT PID */
+	if (programNumber != program->pat.programNumber
+		|| Psi_Cache_Filter_Section(section) != PSI_SECTION_NEW)
+	{
+		return EXIT_SUCCESS;
+	}
+
+	if (PMT_Parse(section, &program->pmt) == EXIT_SUCCESS)
+	{
+		program->pmtReceived = 1;
+		if (teletextPage != TELETEXT_NO_PAGE && teletextPID == 0 && program->pmt.teletextPID != 0)
+		{
+			teletextPID = program->pmt.teletextPID;
+			Ts_Demux_Set_Packet_Consumer(teletextPID, Teletext_Packet_Received, NULL);
+		}
+		if (subtitleMode && subtitlePID == 0 && program->pmt.numOfSubtitles > 0)
+		{
+			subtitlePID = program->pmt.subtitles[0].elementaryPID;
+			Subtitle_Select_Page(program->pmt.subtitles[0].compositionPageId,
+								 program->pmt.subtitles[0].ancillaryPageId);
+			Ts_Demux_Set_Packet_Consumer(subtitlePID, Subtitle_Packet_Received, NULL);
+		}
+	}
+	return EXIT_SUCCESS;
+}
+
+int32_t SDT_Section_Received(const uint8_t* section, uint16_t pid, void* userData)
+{
+	SDTService serviceTable[MAX_NUM_OF_SERVICES];
+	uint32_t count;
+
+	if (Psi_Cache_Filter_Section(section) != PSI_SECTION_NEW)
+	{
+		return EXIT_SUCCESS;
+	}
+
+	count = SDT_Parse(section, serviceTable, MAX_NUM_OF_SERVICES);
+	Service_Db_Update_SDT(serviceTable, count);
+	return EXIT_SUCCESS;
+}
+
+int32_t NIT_Section_Received(const uint8_t* section, uint16_t pid, void* userData)
+{
+	NITService serviceTable[MAX_NUM_OF_SERVICES];
+	uint32_t count;
+
+	if (Psi_Cache_Filter_Section(section) != PSI_SECTION_NEW)
+	{
+		return EXIT_SUCCESS;
+	}
+
+	count = NIT_Parse(section, serviceTable, MAX_NUM_OF_SERVICES);
+	Service_Db_Update_NIT(serviceTable, count);
+	return EXIT_SUCCESS;
+}
+
+int32_t EIT_Section_Received(const uint8_t* section, uint16_t pid, void* userData)
+{
+	uint32_t count;
+	uint32_t i;
+
+	if (Psi_Cache_Filter_Section(section) != PSI_SECTION_NEW)
+	{
+		return EXIT_SUCCESS;
+	}
+
+	count = EIT_Parse(section, eventTable, MAX_NUM_OF_EVENTS);
+	/* Section 0 of the present/following table is the present event */
+	if (streamTime == 0 && section[0] == EIT_PF_ACTUAL_TABLE_ID && section[6] == 0)
+	{
+		for (i = 0; i < count; i++)
+		{
+			if (eventTable[i].startTime != 0)
+			{
+				streamTime = eventTable[i].startTime;
+				break;
+			}
+		}
+	}
+	Epg_Store_Add_Events(eventTable, count);
+	return EXIT_SUCCESS;
+}
+
+void Table_Version_Changed(const uint8_t* section, void* userData)
+{
+	/* Every EIT sub table has its own version, they are not printed */
+	if (section[0] >= EIT_PF_ACTUAL_TABLE_ID)
+	{
+		return;
+	}
+	printf("Table 0x%02X extension %d: version %d\n", section[0], (section[3] << 8) | section[4], (section[5] >> 1) & 0x1F);
+}
+
+void Print_Teletext_Page(uint16_t pageNumber)
+{
+	TeletextPage page;
+	TeletextStatistics statistics;
+	char line[TELETEXT_COLUMNS + 1];
+	uint32_t row;
+	uint32_t column;
+
+	Teletext_Get_Statistics(&statistics);
+	printf("Teletext PID %d: PES packets %u, packets %u, pages %u, cached %u, evicted %u, "
+		   "Hamming errors %u, parity errors %u, CC errors %u\n", teletextPID, statistics.pesPackets,
+		   statistics.packets, statistics.pages, statistics.cachedPages, statistics.evictions,
+		   statistics.hammingErrors, statistics.parityErrors, statistics.continuityErrors);
+	if (Teletext_Get_Page(pageNumber, TELETEXT_ANY_SUBPAGE, &page))
+	{
+		printf("Teletext page %03X was not received\n", pageNumber);
+		return;
+	}
+
+	printf("Teletext page %03X/%04X, control bits 0x%04X, character set 0x%02X, received %u times\n",
+		   page.pageNumber, page.subpage, page.controlBits, page.characterSet, page.receptions);
+	for (row = 0; row < TELETEXT_ROWS; row++)
+	{
+		if (!(page.rowMask & (1 << row)))
+		{
+			continue;
+		}
+		for (column = 0; column < TELETEXT_COLUMNS; column++)
+		{
+			line[column] = (page.rows[row][column] < 0x20 || page.rows[row][column] > 0x7E) ? ' ' : page.rows[row][column];
+		}
+		line[TELETEXT_COLUMNS] = '\0';
+		printf("%2u|%s|\n", row, line);
+	}
+	for (row = 0; row < TELETEXT_LINKS; row++)
+	{
+		if (page.links[row] != TELETEXT_NO_PAGE)
+		{
+			printf("Link %u: %03X\n", row, page.links[row]);
+		}
+	}
+}
+
+void Subtitle_Displayed(const SubtitleOverlay* overlay, void* argument)
+{
+	uint32_t i;
+	uint32_t opaque = 0;
+
+	if (overlay == NULL)
+	{
+		printf("Subtitles removed\n");
+		return;
+	}
+
+	for (i = 0; i < (uint32_t)(overlay->width * overlay->height); i++)
+	{
+		if (overlay->pixels[i] >> 24)
+		{
+			opaque++;
+		}
+	}
+	printf("Subtitles at PTS %llu: %dx%d at %d,%d of %dx%d, %u visible pixels, timeout %u s\n",
+		   (unsigned long long)overlay->pts, overlay->width, overlay->height, overlay->x, overlay->y,
+		   overlay->displayWidth, overlay->displayHeight, opaque, overlay->timeout);
+	Subtitle_Release_Overlay(overlay);
+}
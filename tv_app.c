@@ -1,24 +1,566 @@
 #include <stdio.h>
 #include <time.h>
+#include <unistd.h>
 #include "graphic.h"
+#include "osd_directfb.h"
+#include "remote.h"
+#include "key_dispatch.h"
+#include "zapper.h"
+#include "zap_file.h"
+#include "zap_tdp.h"
+#include "channel_map.h"
+#include "teletext.h"
+#include "subtitle.h"
+#include "trace.h"
+
+/* Volume steps of the OSD */
+#define VOLUME_MAX 10
+#define VOLUME_DEFAULT 5
+/* Trace of the tracepoints, written on SIGUSR1 and at exit */
+#define TRACE_FILE "/tmp/tv_app_trace.json"
+/* Channels of the last session, next to the application because /tmp does not survive a reboot */
+#define CHANNEL_MAP_FILE "tv_app_channels.map"
+/* Page shown first when teletext is opened */
+#define TELETEXT_INDEX_PAGE 0x100
+#define TELETEXT_PAGE_DIGITS 3
+
+/***********************************************************************
+* @brief    Maps the channels of the last session and gives them to
+* 			the zapper, so the first channel starts before the PAT
+*
+* @param    [in] startTime - Latency_Now() at the start of main
+*
+***********************************************************************/
+static void Load_Channel_Map(uint64_t startTime);
+
+/***********************************************************************
+* @brief    Writes the channel list of the live PAT to the channel map
+* 			file when it differs from the mapped one. Called before
+* 			the zapper is deinitialized
+*
+***********************************************************************/
+static void Save_Channel_Map();
+
+/***********************************************************************
+* @brief    Zapper callback, shows the banner of the new channel
+*
+***********************************************************************/
+static void Channel_Changed(const ZapperChannel* channel, void* argument);
+
+/***********************************************************************
+* @brief    Handler of the channel and digit keys
+*
+***********************************************************************/
+static void Channel_Key_Pressed(const KeyEvent* event, void* argument);
+
+/***********************************************************************
+* @brief    Handler of the teletext key, opens and closes the teletext,
+* 			and of the subtitle key, turns the subtitles on and off
+*
+***********************************************************************/
+static void Text_Key_Pressed(const KeyEvent* event, void* argument);
+
+/***********************************************************************
+* @brief    Teletext callback, shows the page again when a newer copy
+* 			of the shown page was received
+*
+***********************************************************************/
+static void Teletext_Page_Received(uint16_t pageNumber, uint16_t subpage, void* argument);
+
+/***********************************************************************
+* @brief    Shows a page of the teletext cache, only the page number
+* 			when it was not received yet
+*
+* @param    [in] pageNumber - page from 0x100 to 0x8FF
+*
+***********************************************************************/
+static void Show_Teletext_Page(uint16_t pageNumber);
+
+/***********************************************************************
+* @brief    Subtitle callback, shows the display set which is due
+*
+***********************************************************************/
+static void Subtitle_Displayed(const SubtitleOverlay* overlay, void* argument);
+
+/***********************************************************************
+* @brief    Gives a drawn overlay back to the subtitle decoder, called
+* 			by the graphic module
+*
+***********************************************************************/
+static void Release_Subtitle(void* argument);
+
+/***********************************************************************
+* @brief    Handler of the volume keys
+*
+***********************************************************************/
+static void Volume_Key_Pressed(const KeyEvent* event, void* argument);
+
+/***********************************************************************
+* @brief    Handler of the power keys, ends the application
+*
+***********************************************************************/
+static void Power_Key_Pressed(const KeyEvent* event, void* argument);
+
+static uint8_t volume = VOLUME_DEFAULT;
+static uint8_t muted = 0;
+static uint8_t running = 1;
+/* Shown teletext page, TELETEXT_NO_PAGE while teletext is closed */
+static uint16_t teletextPage = TELETEXT_NO_PAGE;
+static uint16_t teletextEntry = 0;
+static uint8_t teletextDigits = 0;
+/* Page callbacks come from the demux thread, keys from the main one */
+static pthread_mutex_t teletextMutex = PTHREAD_MUTEX_INITIALIZER;
+/* Display sets come from the subtitle thread, the key from the main one */
+static uint8_t subtitlesOn = 1;
+/* Zapper reads them in Zapper_Init */
+static ZapperChannel seededChannels[ZAPPER_MAX_CHANNELS];
+static ChannelMapEntry savedChannels[CHANNEL_MAP_MAX_CHANNELS];
+
+int32_t main(int32_t argc, char** argv)
+{
+	const ZapBackend* backend;
+	GraphicStatistics statistics;
+	ZapperStatistics zapperStatistics;
+	uint64_t startTime = Latency_Now();
+
+	Trace_Init(TRACE_FILE, SIGUSR1, 1);
+
+	/* Transport stream file stands in for the tuner, to try the application without a signal */
+	if (argc > 1)
+	{
+		if (Zap_File_Set_Stream(argv[1], ZAP_FILE_DEFAULT_BITRATE, TS_MAX_SECTION_FILTERS))
+		{
+			return EXIT_FAILURE;
+		}
+		backend = Zap_File_Get_Backend();
+	}
+	else
+	{
+		backend = Zap_Tdp_Get_Backend();
+	}
+
+	Graphic_Set_Backend(Osd_DirectFB_Get_Backend());
+	if (Graphic_Init())
+	{
+		return EXIT_FAILURE;
+	}
+	Graphic_Get_Statistics(&statistics);
+	printf("Startup: fonts %u us, images %u us (%u bytes)\n",
+		   statistics.fontLoadTime, statistics.spriteLoadTime, statistics.spriteAtlasSize);
+
+	if (Remote_Init(REMOTE_INPUT_DIRECTORY) || Key_Dispatch_Init())
+	{
+		Graphic_Deinit();
+		return EXIT_FAILURE;
+	}
+	Key_Dispatch_Subscribe(KEY_CLASS_CHANNEL | KEY_CLASS_DIGIT, Channel_Key_Pressed, NULL);
+	Key_Dispatch_Subscribe(KEY_CLASS_VOLUME, Volume_Key_Pressed, NULL);
+	Key_Dispatch_Subscribe(KEY_CLASS_POWER, Power_Key_Pressed, NULL);
+	Key_Dispatch_Subscribe(KEY_CLASS_NAVIGATION, Text_Key_Pressed, NULL);
+
+	/* Teletext is decoded on the demux thread of the backend which supports packet consumers */
+	if (Teletext_Init(Teletext_Page_Received, NULL) == EXIT_SUCCESS)
+	{
+		Zapper_Set_Stream_Consumer(ZAPPER_STREAM_TELETEXT, Teletext_Packet_Received, NULL);
+	}
+	/* Subtitles are timed by the clock of the backend, shown as soon as they are decoded without one */
+	if (Subtitle_Init(backend->Get_Stc, Subtitle_Displayed, NULL) == EXIT_SUCCESS)
+	{
+		Zapper_Set_Stream_Consumer(ZAPPER_STREAM_SUBTITLE, Subtitle_Packet_Received, NULL);
+	}
+
+	if (Channel_Map_Init() == EXIT_SUCCESS)
+	{
+		Load_Channel_Map(startTime);
+	}
+	if (Zapper_Init(backend, ZAPPER_PREFETCH_DISTANCE, Channel_Changed, NULL))
+	{
+		Channel_Map_Deinit();
+		Subtitle_Deinit();
+		Teletext_Deinit();
+		Key_Dispatch_Deinit();
+		Remote_Deinit();
+		Graphic_Deinit();
+		return EXIT_FAILURE;
+	}
+
+	while (running)
+	{
+		Key_Dispatch_Process(-1);
+	}
+
+	Zapper_Get_Statistics(&zapperStatistics);
+	Save_Channel_Map();
+	Zapper_Deinit();
+	Channel_Map_Deinit();
+	Subtitle_Deinit();
+	Teletext_Deinit();
+	Key_Dispatch_Deinit();
+	Remote_Deinit();
+
+	Graphic_Get_Statistics(&statistics);
+	printf("Frames: %u, average frame %llu us, longest frame %llu us, idle render CPU %u.%u%%\n",
+		   statistics.frames, (unsigned long long)statistics.averageFrameTime,
+		   (unsigned long long)statistics.maxFrameTime, statistics.idleCpuLoad / 10, statistics.idleCpuLoad % 10);
+	printf("Fades: %u frames, average %llu us, longest %llu us, longest interval %llu us, cache renders %u\n",
+		   statistics.animationFrames, (unsigned long long)statistics.averageAnimationDrawTime,
+		   (unsigned long long)statistics.maxAnimationDrawTime,
+		   (unsigned long long)statistics.maxAnimationInterval, statistics.cacheRenders);
+	printf("Zaps: %u, warm %u, cold %u, longest %u us\n", zapperStatistics.zaps, zapperStatistics.warmZaps,
+		   zapperStatistics.coldZaps, zapperStatistics.maxZapTime);
+	Latency_Dump();
 
-int32_t main()
-{	
-	infoElements input;
-	
-	input.channel = 2;
-	input.teletext = 1;
-	input.audioPID = 201;
-	input.videoPID = 0;
-	
-	Graphic_Init();
-	
-	Show_Info_Banner(input);
-	Show_Volume(2);
-	
-	sleep(5);
-	
 	Graphic_Deinit();
 	return 0;
 }
 
+void Load_Channel_Map(uint64_t startTime)
+{
+	const ChannelMapEntry* channels;
+	ChannelMapStatistics mapStatistics;
+	uint32_t numOfChannels;
+	uint32_t i;
+
+	if (Channel_Map_Load(CHANNEL_MAP_FILE))
+	{
+		return;
+	}
+	numOfChannels = Channel_Map_Get_Channels(&channels);
+	if (numOfChannels > ZAPPER_MAX_CHANNELS)
+	{
+		numOfChannels = ZAPPER_MAX_CHANNELS;
+	}
+	for (i = 0; i < numOfChannels; i++)
+	{
+		memset(&seededChannels[i], 0, sizeof(ZapperChannel));
+		seededChannels[i].channelNumber = i + 1;
+		seededChannels[i].programNumber = channels[i].programNumber;
+		seededChannels[i].programMapPID = channels[i].programMapPID;
+		memcpy(seededChannels[i].serviceName, channels[i].serviceName, SERVICE_NAME_SIZE);
+		seededChannels[i].pmt.videoPID = channels[i].videoPID;
+		seededChannels[i].pmt.audioPID = channels[i].audioPID;
+		seededChannels[i].pmt.pcrPID = channels[i].pcrPID;
+		seededChannels[i].pmt.teletextPID = channels[i].teletextPID;
+		seededChannels[i].pmt.teletext = (channels[i].teletextPID != 0);
+	}
+	if (Zapper_Set_Channel_List(seededChannels, numOfChannels))
+	{
+		return;
+	}
+	Channel_Map_Get_Statistics(&mapStatistics);
+	printf("Channel map: %u channels usable %llu ms after start (mapped in %u us)\n", numOfChannels,
+		   (unsigned long long)((Latency_Now() - startTime) / 1000), mapStatistics.loadTime);
+}
+
+void Save_Channel_Map()
+{
+	const ChannelMapEntry* mappedChannels;
+	ChannelMapStatistics mapStatistics;
+	ZapperChannel channel;
+	ServiceEntry service;
+	uint16_t transportStreamId;
+	uint8_t patVersion;
+	uint32_t numOfMappedChannels;
+	uint32_t numOfChannels;
+	uint32_t i;
+
+	/* Nothing to compare against before the live PAT */
+	if (Zapper_Get_Transport_Stream(&transportStreamId, &patVersion))
+	{
+		return;
+	}
+	numOfChannels = Zapper_Get_Number_Of_Channels();
+	if (numOfChannels > CHANNEL_MAP_MAX_CHANNELS)
+	{
+		numOfChannels = CHANNEL_MAP_MAX_CHANNELS;
+	}
+	/* Padding is written to the file and checksummed too */
+	memset(savedChannels, 0, numOfChannels * sizeof(ChannelMapEntry));
+	for (i = 0; i < numOfChannels; i++)
+	{
+		if (Zapper_Get_Channel_At(i + 1, &channel))
+		{
+			break;
+		}
+		savedChannels[i].programNumber = channel.programNumber;
+		savedChannels[i].programMapPID = channel.programMapPID;
+		savedChannels[i].videoPID = channel.pmt.videoPID;
+		savedChannels[i].audioPID = channel.pmt.audioPID;
+		savedChannels[i].pcrPID = channel.pmt.pcrPID;
+		savedChannels[i].teletextPID = channel.pmt.teletext ? channel.pmt.teletextPID : 0;
+		memcpy(savedChannels[i].serviceName, channel.serviceName, SERVICE_NAME_SIZE);
+		if (Service_Db_Find_By_Program(channel.programNumber, &service) == EXIT_SUCCESS)
+		{
+			savedChannels[i].logicalChannelNumber = service.logicalChannelNumber;
+			savedChannels[i].serviceType = service.serviceType;
+			savedChannels[i].visible = service.visible;
+		}
+	}
+	numOfChannels = i;
+
+	numOfMappedChannels = Channel_Map_Get_Channels(&mappedChannels);
+	Channel_Map_Get_Statistics(&mapStatistics);
+	if (numOfMappedChannels == numOfChannels && mapStatistics.transportStreamId == transportStreamId
+		&& mapStatistics.patVersion == patVersion
+		&& !memcmp(mappedChannels, savedChannels, numOfChannels * sizeof(ChannelMapEntry)))
+	{
+		return;
+	}
+	if (Channel_Map_Save(CHANNEL_MAP_FILE, transportStreamId, patVersion, savedChannels, numOfChannels) == EXIT_SUCCESS)
+	{
+		printf("Channel map: %u channels saved\n", numOfChannels);
+	}
+}
+
+void Channel_Changed(const ZapperChannel* channel, void* argument)
+{
+	infoElements input;
+
+	/* Pages of the previous channel are removed from the cache */
+	Teletext_Reset();
+	pthread_mutex_lock(&teletextMutex);
+	if (teletextPage != TELETEXT_NO_PAGE)
+	{
+		teletextPage = TELETEXT_NO_PAGE;
+		Hide_Teletext();
+	}
+	pthread_mutex_unlock(&teletextMutex);
+
+	/* Subtitles of the previous channel are removed by the decoder, also the ones still waiting for their PTS */
+	if (channel->pmt.numOfSubtitles > 0)
+	{
+		Subtitle_Select_Page(channel->pmt.subtitles[0].compositionPageId,
+							 channel->pmt.subtitles[0].ancillaryPageId);
+	}
+	else
+	{
+		Subtitle_Deselect_Page();
+	}
+
+	memset(&input, 0, sizeof(input));
+	input.channel = channel->channelNumber;
+	input.teletext = channel->pmt.teletext;
+	input.audioPID = channel->pmt.audioPID;
+	input.videoPID = channel->pmt.videoPID;
+	snprintf(input.serviceName, INFO_NAME_SIZE, "%s", channel->serviceName);
+	Show_Info_Banner(input);
+}
+
+void Channel_Key_Pressed(const KeyEvent* event, void* argument)
+{
+	uint16_t pageNumber;
+	int32_t digit = -1;
+
+	if (event->action == KEY_ACTION_RELEASE)
+	{
+		return;
+	}
+
+	if (event->code >= KEY_1 && event->code <= KEY_9)
+	{
+		digit = event->code - KEY_1 + 1;
+	}
+	else if (event->code == KEY_0)
+	{
+		digit = 0;
+	}
+	else if (event->code >= KEY_NUMERIC_0 && event->code <= KEY_NUMERIC_9)
+	{
+		digit = event->code - KEY_NUMERIC_0;
+	}
+
+	/* While teletext is open the channel keys turn pages and the digits enter page numbers */
+	pthread_mutex_lock(&teletextMutex);
+	if (teletextPage != TELETEXT_NO_PAGE)
+	{
+		if (event->code == KEY_CHANNELUP || event->code == KEY_PAGEUP ||
+			event->code == KEY_CHANNELDOWN || event->code == KEY_PAGEDOWN)
+		{
+			pageNumber = Teletext_Next_Page(teletextPage,
+				(event->code == KEY_CHANNELUP || event->code == KEY_PAGEUP) ? 1 : -1);
+			if (pageNumber != TELETEXT_NO_PAGE)
+			{
+				teletextDigits = 0;
+				Show_Teletext_Page(pageNumber);
+			}
+		}
+		else if (digit >= 0 && event->action == KEY_ACTION_PRESS)
+		{
+			/* Page numbers start with the magazine 1 to 8 */
+			if (teletextDigits > 0 || (digit >= 1 && digit <= TELETEXT_MAGAZINES))
+			{
+				teletextEntry = (teletextEntry << 4) | digit;
+				teletextDigits++;
+			}
+			if (teletextDigits == TELETEXT_PAGE_DIGITS)
+			{
+				teletextDigits = 0;
+				Show_Teletext_Page(teletextEntry);
+				teletextEntry = 0;
+			}
+		}
+		pthread_mutex_unlock(&teletextMutex);
+		return;
+	}
+	pthread_mutex_unlock(&teletextMutex);
+
+	switch (event->code)
+	{
+		case KEY_CHANNELUP:
+		case KEY_PAGEUP:
+			Zapper_Channel_Up();
+			break;
+		case KEY_CHANNELDOWN:
+		case KEY_PAGEDOWN:
+			Zapper_Channel_Down();
+			break;
+		default:
+			/* Held digits are not entered again */
+			if (event->action == KEY_ACTION_PRESS && digit >= 0)
+			{
+				Zapper_Enter_Digit(digit);
+			}
+			break;
+	}
+}
+
+void Volume_Key_Pressed(const KeyEvent* event, void* argument)
+{
+	if (event->action == KEY_ACTION_RELEASE)
+	{
+		return;
+	}
+
+	switch (event->code)
+	{
+		case KEY_VOLUMEUP:
+			muted = 0;
+			if (volume < VOLUME_MAX)
+			{
+				volume++;
+			}
+			break;
+		case KEY_VOLUMEDOWN:
+			muted = 0;
+			if (volume > 0)
+			{
+				volume--;
+			}
+			break;
+		case KEY_MUTE:
+			if (event->action == KEY_ACTION_PRESS)
+			{
+				muted = !muted;
+			}
+			break;
+	}
+	Show_Volume(muted ? 0 : volume);
+}
+
+void Power_Key_Pressed(const KeyEvent* event, void* argument)
+{
+	if (event->action == KEY_ACTION_PRESS)
+	{
+		running = 0;
+	}
+}
+
+void Text_Key_Pressed(const KeyEvent* event, void* argument)
+{
+	if (event->action != KEY_ACTION_PRESS)
+	{
+		return;
+	}
+
+	if (event->code == KEY_SUBTITLE)
+	{
+		if (__atomic_xor_fetch(&subtitlesOn, 1, __ATOMIC_RELAXED) == 0)
+		{
+			Hide_Subtitle();
+		}
+		return;
+	}
+	if (event->code != KEY_TEXT)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&teletextMutex);
+	if (teletextPage == TELETEXT_NO_PAGE)
+	{
+		Show_Teletext_Page(TELETEXT_INDEX_PAGE);
+	}
+	else
+	{
+		teletextPage = TELETEXT_NO_PAGE;
+		Hide_Teletext();
+	}
+	teletextDigits = 0;
+	teletextEntry = 0;
+	pthread_mutex_unlock(&teletextMutex);
+}
+
+void Teletext_Page_Received(uint16_t pageNumber, uint16_t subpage, void* argument)
+{
+	pthread_mutex_lock(&teletextMutex);
+	if (pageNumber == teletextPage)
+	{
+		Show_Teletext_Page(pageNumber);
+	}
+	pthread_mutex_unlock(&teletextMutex);
+}
+
+void Show_Teletext_Page(uint16_t pageNumber)
+{
+	TeletextPage page;
+	teletextElements input;
+	char header[TELETEXT_COLUMNS];
+
+	memset(&input, ' ', sizeof(input));
+	if (Teletext_Get_Page(pageNumber, TELETEXT_ANY_SUBPAGE, &page) == EXIT_SUCCESS)
+	{
+		memcpy(input.rows, page.rows, sizeof(input.rows));
+	}
+
+	/* Header starts with the page number, in green like on the receivers */
+	snprintf(header, sizeof(header), "%cP%03X   ", 0x02, pageNumber);
+	memcpy(input.rows[0], header, TELETEXT_HEADER_COLUMN);
+
+	teletextPage = pageNumber;
+	Show_Teletext(&input);
+}
+
+void Subtitle_Displayed(const SubtitleOverlay* overlay, void* argument)
+{
+	subtitleElements input;
+
+	if (overlay == NULL)
+	{
+		if (__atomic_load_n(&subtitlesOn, __ATOMIC_RELAXED))
+		{
+			Hide_Subtitle();
+		}
+		return;
+	}
+	if (!__atomic_load_n(&subtitlesOn, __ATOMIC_RELAXED))
+	{
+		Subtitle_Release_Overlay(overlay);
+		return;
+	}
+
+	input.displayWidth = overlay->displayWidth;
+	input.displayHeight = overlay->displayHeight;
+	input.x = overlay->x;
+	input.y = overlay->y;
+	input.width = overlay->width;
+	input.height = overlay->height;
+	input.pixels = overlay->pixels;
+	input.Release = Release_Subtitle;
+	input.releaseArgument = (void*)overlay;
+	Show_Subtitle(&input);
+}
+
+void Release_Subtitle(void* argument)
+{
+	Subtitle_Release_Overlay((const SubtitleOverlay*)argument);
+}
@@ -0,0 +1,44 @@
+#ifndef _ZAP_BACKEND_H_
+#define _ZAP_BACKEND_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "ts_demux.h"
+
+/*
+ * Tuner, demux and player operations used by the zapper. Section
+ * callbacks are called on a thread of the backend with the section
+ * starting at its table id, and may open and free filters. The other
+ * functions are called from one zapper thread at a time.
+ */
+typedef struct ZapBackend {
+	const char* name;
+	/* Tunes to the transport stream */
+	int32_t (*Init)();
+	void (*Deinit)();
+	/* Section filters which can be open at the same time */
+	uint32_t (*Get_Max_Section_Filters)();
+	int32_t (*Set_Section_Filter)(uint16_t pid, uint8_t tableId, Ts_Section_Callback callback, void* userData,
+								  uint32_t* filterHandle);
+	int32_t (*Free_Section_Filter)(uint32_t filterHandle);
+	/*
+	 * Replaces the played streams, PID 0 leaves the decoder stopped.
+	 * The clock is recovered from the PCR_PID of the program
+	 */
+	int32_t (*Play)(uint16_t videoPID, uint16_t audioPID, uint16_t pcrPID);
+	/*
+	 * Passes the transport packets of a PID to the callback on a thread
+	 * of the backend. NULL when the demux outputs only sections
+	 */
+	int32_t (*Set_Packet_Consumer)(uint16_t pid, Ts_Packet_Callback callback, void* userData);
+	int32_t (*Free_Packet_Consumer)(uint16_t pid);
+	/*
+	 * 33 bit system time clock of the played streams in 90 kHz ticks,
+	 * which the PTS are compared to. EXIT_FAILURE until the played
+	 * streams carried a PCR, NULL when the backend can not tell
+	 */
+	int32_t (*Get_Stc)(uint64_t* stc);
+} ZapBackend;
+
+#endif
@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include "zapper.h"
+#include "zap_file.h"
+#include "latency.h"
+
+/* Host benchmark of channel changes on a transport stream file */
+
+#define BENCH_DEFAULT_ZAPS 20
+/* Time spent on a channel before the next zap, like someone zapping through */
+#define BENCH_DEFAULT_DWELL_MS 500
+/* Longest wait for the first channel and for one zap */
+#define BENCH_START_TIMEOUT_MS 5000
+#define BENCH_ZAP_TIMEOUT_MS 5000
+
+/***********************************************************************
+* @brief    Zaps through the channels of the stream, mostly up with a
+* 			step down now and then, and prints the zap times
+*
+* @param    [in] fileName - path to the transport stream
+* @param    [in] bitrate - bits per second the stream is fed with
+* @param    [in] maxFilters - section filters of the emulated receiver
+* @param    [in] prefetchDistance - channels prefetched on each side
+* @param    [in] numOfZaps - number of channel changes
+* @param    [in] dwell - milliseconds on each channel
+* @param    [out] coldZaps - zaps which waited for their PMT
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+static int32_t Run_Zaps(const char* fileName, uint32_t bitrate, uint32_t maxFilters, uint32_t prefetchDistance,
+						uint32_t numOfZaps, uint32_t dwell, uint32_t* coldZaps);
+
+/***********************************************************************
+* @brief    Sleeps for the given number of milliseconds
+*
+***********************************************************************/
+static void Sleep_Milliseconds(uint32_t milliseconds);
+
+int32_t main(int32_t argc, char** argv)
+{
+	int32_t option;
+	uint32_t bitrate = ZAP_FILE_DEFAULT_BITRATE;
+	uint32_t maxFilters = TS_MAX_SECTION_FILTERS;
+	uint32_t prefetchDistance = ZAPPER_PREFETCH_DISTANCE;
+	uint32_t numOfZaps = BENCH_DEFAULT_ZAPS;
+	uint32_t dwell = BENCH_DEFAULT_DWELL_MS;
+	uint32_t coldZaps;
+
+	while ((option = getopt(argc, argv, "b:f:d:n:w:")) != -1)
+	{
+		switch (option)
+		{
+			case 'b':
+				bitrate = strtoul(optarg, NULL, 10);
+				break;
+			case 'f':
+				maxFilters = strtoul(optarg, NULL, 10);
+				break;
+			case 'd':
+				prefetchDistance = strtoul(optarg, NULL, 10);
+				break;
+			case 'n':
+				numOfZaps = strtoul(optarg, NULL, 10);
+				break;
+			case 'w':
+				dwell = strtoul(optarg, NULL, 10);
+				break;
+			default:
+				optind = argc;
+				break;
+		}
+	}
+	if (optind != argc - 1 || prefetchDistance == 0)
+	{
+		printf("Usage: %s [-b bitrate] [-f max section filters] [-d prefetch distance] [-n zaps] [-w dwell ms] <file.ts>\n",
+			   argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	/* Without prefetch first, it is what the prefetch is measured against */
+	if (Run_Zaps(argv[optind], bitrate, maxFilters, 0, numOfZaps, dwell, &coldZaps)
+		|| Run_Zaps(argv[optind], bitrate, maxFilters, prefetchDistance, numOfZaps, dwell, &coldZaps))
+	{
+		return EXIT_FAILURE;
+	}
+	if (coldZaps > 0)
+	{
+		printf("%u zaps waited for their PMT with prefetch!\n", coldZaps);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+int32_t Run_Zaps(const char* fileName, uint32_t bitrate, uint32_t maxFilters, uint32_t prefetchDistance,
+				 uint32_t numOfZaps, uint32_t dwell, uint32_t* coldZaps)
+{
+	ZapperStatistics before;
+	ZapperStatistics after;
+	ZapFileStatistics fileStatistics;
+	LatencySummary summary;
+	uint32_t timeouts = 0;
+	uint32_t i;
+
+	if (Zap_File_Set_Stream(fileName, bitrate, maxFilters)
+		|| Zapper_Init(Zap_File_Get_Backend(), prefetchDistance, NULL, NULL))
+	{
+		return EXIT_FAILURE;
+	}
+	if (Zapper_Wait(BENCH_START_TIMEOUT_MS))
+	{
+		printf("No channel started in %u ms!\n", BENCH_START_TIMEOUT_MS);
+		Zapper_Deinit();
+		return EXIT_FAILURE;
+	}
+	printf("%u channels, prefetch distance %u, %u section filters\n",
+		   Zapper_Get_Number_Of_Channels(), prefetchDistance, maxFilters);
+
+	/* First channel is always cold, only the zaps are measured */
+	Sleep_Milliseconds(dwell);
+	Zapper_Get_Statistics(&before);
+	Latency_Reset();
+	for (i = 0; i < numOfZaps; i++)
+	{
+		if (i % 4 == 3)
+		{
+			Zapper_Channel_Down();
+		}
+		else
+		{
+			Zapper_Channel_Up();
+		}
+		if (Zapper_Wait(BENCH_ZAP_TIMEOUT_MS))
+		{
+			timeouts++;
+		}
+		Sleep_Milliseconds(dwell);
+	}
+	Zapper_Get_Statistics(&after);
+	Zap_File_Get_Statistics(&fileStatistics);
+	Latency_Get_Summary(LATENCY_ZAP, &summary);
+	Zapper_Deinit();
+
+	*coldZaps = after.coldZaps - before.coldZaps;
+	printf("  zaps %u, warm %u, cold %u, timeouts %u\n", after.zaps - before.zaps,
+		   after.warmZaps - before.warmZaps, *coldZaps, timeouts);
+	printf("  zap time p50 %u us, p90 %u us, p99 %u us, max %u us\n",
+		   summary.p50, summary.p90, summary.p99, summary.max);
+	printf("  PMT sections %u, parsed %u, filter rotations %u, most open filters %u\n",
+		   after.pmtSections, after.pmtParses, after.filterRotations, after.maxOpenFilters);
+	printf("  stream packets %llu, loops %u, longest stream start after play %u us\n",
+		   (unsigned long long)fileStatistics.packets, fileStatistics.loops, fileStatistics.maxStartDelay);
+	return (timeouts > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+void Sleep_Milliseconds(uint32_t milliseconds)
+{
+	struct timespec delay;
+
+	delay.tv_sec = milliseconds / 1000;
+	delay.tv_nsec = (milliseconds % 1000) * 1000000;
+	while (nanosleep(&delay, &delay) == -1 && errno == EINTR);
+}
@@ -0,0 +1,381 @@
+#include "zap_file.h"
+
+/***********************************************************************
+* @brief    Opens the stream and starts the feeding thread
+*
+***********************************************************************/
+static int32_t File_Init();
+
+/***********************************************************************
+* @brief    Stops the feeding thread and closes the stream
+*
+***********************************************************************/
+static void File_Deinit();
+
+/***********************************************************************
+* @brief    Returns the filter limit given with the stream
+*
+***********************************************************************/
+static uint32_t File_Get_Max_Section_Filters();
+
+/***********************************************************************
+* @brief    Opens a section filter of the software demux
+*
+***********************************************************************/
+static int32_t File_Set_Section_Filter(uint16_t pid, uint8_t tableId, Ts_Section_Callback callback, void* userData,
+									   uint32_t* filterHandle);
+
+/***********************************************************************
+* @brief    Frees a section filter of the software demux
+*
+***********************************************************************/
+static int32_t File_Free_Section_Filter(uint32_t filterHandle);
+
+/***********************************************************************
+* @brief    Routes the packets of the PIDs to the packet counter, and
+* 			of the PCR PID to the clock
+*
+***********************************************************************/
+static int32_t File_Play(uint16_t videoPID, uint16_t audioPID, uint16_t pcrPID);
+
+/***********************************************************************
+* @brief    Routes the packets of the PID to the consumer
+*
+***********************************************************************/
+static int32_t File_Set_Packet_Consumer(uint16_t pid, Ts_Packet_Callback callback, void* userData);
+
+/***********************************************************************
+* @brief    Stops routing the packets of the PID to its consumer
+*
+***********************************************************************/
+static int32_t File_Free_Packet_Consumer(uint16_t pid);
+
+/***********************************************************************
+* @brief    Returns the PCR of the played streams advanced by the time
+* 			since it was fed
+*
+***********************************************************************/
+static int32_t File_Get_Stc(uint64_t* stc);
+
+/***********************************************************************
+* @brief    Packet consumer of the played PIDs, measures when the
+* 			streams start and keeps the last PCR of the PCR PID
+*
+***********************************************************************/
+static int32_t Media_Packet_Received(const uint8_t* packet, uint16_t pid, void* userData);
+
+/***********************************************************************
+* @brief    Feeding thread, passes the stream to the demux at its
+* 			bitrate and starts it again at its end
+*
+***********************************************************************/
+static void* Feed_Task();
+
+/***********************************************************************
+* @brief    Returns microseconds of the monotonic clock
+*
+***********************************************************************/
+static uint64_t Now();
+
+static const ZapBackend fileBackend = {
+	"file",
+	File_Init,
+	File_Deinit,
+	File_Get_Max_Section_Filters,
+	File_Set_Section_Filter,
+	File_Free_Section_Filter,
+	File_Play,
+	File_Set_Packet_Consumer,
+	File_Free_Packet_Consumer,
+	File_Get_Stc
+};
+
+static const char* streamName = NULL;
+static uint32_t streamBitrate = ZAP_FILE_UNPACED;
+static uint32_t filterLimit = TS_MAX_SECTION_FILTERS;
+static pthread_t feedThread;
+static uint8_t feeding = 0;
+/* Played streams, guarded by the mutex */
+static pthread_mutex_t playMutex = PTHREAD_MUTEX_INITIALIZER;
+static uint16_t playedVideoPID = 0;
+static uint16_t playedAudioPID = 0;
+/* PCR_PID of the program, 0 when it is one of the played streams or there is none */
+static uint16_t playedPcrPID = 0;
+static uint16_t clockPID = 0;
+/* Bit 0 video, bit 1 audio, set until the stream starts */
+static uint8_t waitingStreams = 0;
+static uint64_t playTime = 0;
+/* Last PCR base of the played streams and when it was fed, pcrTime 0 if none */
+static uint64_t pcrBase = 0;
+static uint64_t pcrTime = 0;
+static ZapFileStatistics statistics;
+
+int32_t Zap_File_Set_Stream(const char* fileName, uint32_t bitrate, uint32_t maxSectionFilters)
+{
+	if (fileName == NULL || maxSectionFilters == 0 || maxSectionFilters > TS_MAX_SECTION_FILTERS)
+	{
+		printf("%s(%d): Invalid arguments!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+	streamName = fileName;
+	streamBitrate = bitrate;
+	filterLimit = maxSectionFilters;
+	return EXIT_SUCCESS;
+}
+
+const ZapBackend* Zap_File_Get_Backend()
+{
+	return &fileBackend;
+}
+
+void Zap_File_Get_Statistics(ZapFileStatistics* outStatistics)
+{
+	pthread_mutex_lock(&playMutex);
+	outStatistics->playedPackets = statistics.playedPackets;
+	outStatistics->lastStartDelay = statistics.lastStartDelay;
+	outStatistics->maxStartDelay = statistics.maxStartDelay;
+	pthread_mutex_unlock(&playMutex);
+	/* Feeding thread counts without the mutex */
+	outStatistics->packets = __atomic_load_n(&statistics.packets, __ATOMIC_RELAXED);
+	outStatistics->loops = __atomic_load_n(&statistics.loops, __ATOMIC_RELAXED);
+}
+
+int32_t File_Init()
+{
+	if (streamName == NULL)
+	{
+		printf("%s(%d): Stream is not set!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+
+	memset(&statistics, 0, sizeof(statistics));
+	playedVideoPID = 0;
+	playedAudioPID = 0;
+	playedPcrPID = 0;
+	clockPID = 0;
+	waitingStreams = 0;
+
+	if (Ts_Demux_Init())
+	{
+		return EXIT_FAILURE;
+	}
+	if (Ts_Source_Open(streamName))
+	{
+		Ts_Demux_Deinit();
+		return EXIT_FAILURE;
+	}
+
+	__atomic_store_n(&feeding, 1, __ATOMIC_RELEASE);
+	if (pthread_create(&feedThread, NULL, Feed_Task, NULL))
+	{
+		printf("%s(%d): Error creating feed thread!\n", __FUNCTION__, __LINE__);
+		feeding = 0;
+		Ts_Source_Close();
+		Ts_Demux_Deinit();
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+void File_Deinit()
+{
+	__atomic_store_n(&feeding, 0, __ATOMIC_RELEASE);
+	pthread_join(feedThread, NULL);
+
+	File_Play(0, 0, 0);
+	Ts_Source_Close();
+	Ts_Demux_Deinit();
+}
+
+uint32_t File_Get_Max_Section_Filters()
+{
+	return filterLimit;
+}
+
+int32_t File_Set_Section_Filter(uint16_t pid, uint8_t tableId, Ts_Section_Callback callback, void* userData,
+								uint32_t* filterHandle)
+{
+	return Ts_Demux_Set_Section_Filter(pid, tableId, 0xFF, callback, userData, filterHandle);
+}
+
+int32_t File_Free_Section_Filter(uint32_t filterHandle)
+{
+	return Ts_Demux_Free_Section_Filter(filterHandle);
+}
+
+int32_t File_Play(uint16_t videoPID, uint16_t audioPID, uint16_t pcrPID)
+{
+	uint16_t oldVideoPID;
+	uint16_t oldAudioPID;
+	uint16_t oldPcrPID;
+	int32_t ret = EXIT_SUCCESS;
+
+	if (pcrPID == PMT_NO_PCR_PID)
+	{
+		pcrPID = 0;
+	}
+
+	pthread_mutex_lock(&playMutex);
+	oldVideoPID = playedVideoPID;
+	oldAudioPID = playedAudioPID;
+	oldPcrPID = playedPcrPID;
+	playedVideoPID = videoPID;
+	playedAudioPID = (audioPID != videoPID) ? audioPID : 0;
+	clockPID = pcrPID;
+	playedPcrPID = (pcrPID != videoPID && pcrPID != audioPID) ? pcrPID : 0;
+	waitingStreams = (playedVideoPID ? 0x01 : 0) | (playedAudioPID ? 0x02 : 0);
+	playTime = Now();
+	pcrTime = 0;
+	pthread_mutex_unlock(&playMutex);
+
+	/* Demux calls the consumers with its lock held, so it is not called under the play mutex */
+	if (oldVideoPID)
+	{
+		Ts_Demux_Free_Packet_Consumer(oldVideoPID);
+	}
+	if (oldAudioPID)
+	{
+		Ts_Demux_Free_Packet_Consumer(oldAudioPID);
+	}
+	if (oldPcrPID)
+	{
+		Ts_Demux_Free_Packet_Consumer(oldPcrPID);
+	}
+	if (videoPID && Ts_Demux_Set_Packet_Consumer(videoPID, Media_Packet_Received, NULL))
+	{
+		ret = EXIT_FAILURE;
+	}
+	if (audioPID && audioPID != videoPID && Ts_Demux_Set_Packet_Consumer(audioPID, Media_Packet_Received, NULL))
+	{
+		ret = EXIT_FAILURE;
+	}
+	/* Program may carry its PCR on a PID of its own */
+	if (pcrPID && pcrPID != videoPID && pcrPID != audioPID
+		&& Ts_Demux_Set_Packet_Consumer(pcrPID, Media_Packet_Received, NULL))
+	{
+		ret = EXIT_FAILURE;
+	}
+	return ret;
+}
+
+int32_t File_Set_Packet_Consumer(uint16_t pid, Ts_Packet_Callback callback, void* userData)
+{
+	return Ts_Demux_Set_Packet_Consumer(pid, callback, userData);
+}
+
+int32_t File_Free_Packet_Consumer(uint16_t pid)
+{
+	return Ts_Demux_Free_Packet_Consumer(pid);
+}
+
+int32_t File_Get_Stc(uint64_t* stc)
+{
+	int32_t ret = EXIT_FAILURE;
+
+	pthread_mutex_lock(&playMutex);
+	if (pcrTime != 0)
+	{
+		/* Microseconds to 90 kHz ticks */
+		*stc = (pcrBase + (Now() - pcrTime) * 9 / 100) & PCR_BASE_MASK;
+		ret = EXIT_SUCCESS;
+	}
+	pthread_mutex_unlock(&playMutex);
+	return ret;
+}
+
+int32_t Media_Packet_Received(const uint8_t* packet, uint16_t pid, void* userData)
+{
+	uint32_t delay;
+
+	pthread_mutex_lock(&playMutex);
+	if (pid == playedVideoPID || pid == playedAudioPID)
+	{
+		statistics.playedPackets++;
+	}
+	/* Adaptation field with the PCR flag, the 33 bit base is enough for the PTS */
+	if (pid == clockPID && (packet[3] & 0x20) && packet[4] >= 7 && (packet[5] & 0x10))
+	{
+		pcrBase = (uint64_t)packet[6] << 25 | (uint64_t)packet[7] << 17 | (uint64_t)packet[8] << 9 |
+				  (uint64_t)packet[9] << 1 | packet[10] >> 7;
+		pcrTime = Now();
+	}
+	/* payload_unit_start_indicator, the decoder can start there */
+	if (waitingStreams && (packet[1] & 0x40))
+	{
+		if (pid == playedVideoPID)
+		{
+			waitingStreams &= ~0x01;
+		}
+		if (pid == playedAudioPID)
+		{
+			waitingStreams &= ~0x02;
+		}
+		if (!waitingStreams)
+		{
+			delay = (uint32_t)(Now() - playTime);
+			statistics.lastStartDelay = delay;
+			if (delay > statistics.maxStartDelay)
+			{
+				statistics.maxStartDelay = delay;
+			}
+		}
+	}
+	pthread_mutex_unlock(&playMutex);
+	return EXIT_SUCCESS;
+}
+
+void* Feed_Task()
+{
+	const uint8_t* packets;
+	uint32_t numOfPackets;
+	uint64_t fedPackets = 0;
+	uint64_t startTime = Now();
+	uint64_t dueTime;
+	struct timespec due;
+	uint8_t emptyRead = 0;
+
+	while (__atomic_load_n(&feeding, __ATOMIC_ACQUIRE))
+	{
+		numOfPackets = Ts_Source_Read(&packets, ZAP_FILE_FEED_PACKETS);
+		if (numOfPackets == 0)
+		{
+			/* Stream without a single packet would loop forever */
+			if (emptyRead)
+			{
+				printf("%s(%d): Stream has no packets!\n", __FUNCTION__, __LINE__);
+				break;
+			}
+			emptyRead = 1;
+			Ts_Source_Close();
+			if (Ts_Source_Open(streamName))
+			{
+				break;
+			}
+			__atomic_add_fetch(&statistics.loops, 1, __ATOMIC_RELAXED);
+			continue;
+		}
+		emptyRead = 0;
+
+		if (streamBitrate != ZAP_FILE_UNPACED)
+		{
+			/* Time the packets are due at, so sleeping late does not slow the stream down */
+			dueTime = startTime + fedPackets * TS_PACKET_SIZE * 8 * 1000000 / streamBitrate;
+			due.tv_sec = dueTime / 1000000;
+			due.tv_nsec = (dueTime % 1000000) * 1000;
+			while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, NULL) == EINTR);
+		}
+
+		Ts_Demux_Feed_Packets(packets, numOfPackets);
+		fedPackets += numOfPackets;
+		__atomic_add_fetch(&statistics.packets, numOfPackets, __ATOMIC_RELAXED);
+	}
+	return NULL;
+}
+
+uint64_t Now()
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
@@ -0,0 +1,72 @@
+#ifndef _ZAP_FILE_H_
+#define _ZAP_FILE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include "zap_backend.h"
+#include "ts_demux.h"
+#include "ts_source.h"
+#include "table_parse.h"
+
+/* Packets passed to the demux at once, the pacing granularity */
+#define ZAP_FILE_FEED_PACKETS 16
+/* Bitrate of a DVB-T multiplex */
+#define ZAP_FILE_DEFAULT_BITRATE 8000000
+/* Bitrate which feeds the stream as fast as it can be read */
+#define ZAP_FILE_UNPACED 0
+/* PCR base and PTS are 33 bit */
+#define PCR_BASE_MASK 0x1FFFFFFFFULL
+
+typedef struct ZapFileStatistics {
+	uint64_t packets;
+	/* Times the stream was played from its start again */
+	uint32_t loops;
+	/* Packets of the played PIDs */
+	uint64_t playedPackets;
+	/* Microseconds from Play until a payload unit started on each played PID */
+	uint32_t lastStartDelay;
+	uint32_t maxStartDelay;
+} ZapFileStatistics;
+
+/***********************************************************************
+* @brief    Sets the stream of the file backend, called before the
+* 			backend is initialized
+*
+* @param    [in] fileName - path to the transport stream, it is played
+* 							in a loop like a broadcast carousel
+* @param    [in] bitrate - bits per second the stream is fed with,
+* 						   ZAP_FILE_UNPACED feeds it without waiting
+* @param    [in] maxSectionFilters - filters the backend offers, up to
+* 									 TS_MAX_SECTION_FILTERS, so the
+* 									 limits of a receiver can be tried
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Zap_File_Set_Stream(const char* fileName, uint32_t bitrate, uint32_t maxSectionFilters);
+
+/***********************************************************************
+* @brief    Returns the backend which stands in for the tuner with a
+* 			transport stream file and the software demux. Played streams
+* 			are not decoded, only their packets are counted
+*
+* @return   backend - pointer to the backend functions
+*
+***********************************************************************/
+const ZapBackend* Zap_File_Get_Backend();
+
+/***********************************************************************
+* @brief    Copies the file backend counters
+*
+* @param    [out] outStatistics - structure where the counters are saved
+*
+***********************************************************************/
+void Zap_File_Get_Statistics(ZapFileStatistics* outStatistics);
+
+#endif
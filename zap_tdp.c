@@ -0,0 +1,278 @@
+#include "zap_tdp.h"
+/* Not in the header, its ERROR clashes with the macro of graphic.h and remote.h */
+#include "tdp_api.h"
+
+/***********************************************************************
+* @brief    Tunes to the multiplex and opens the player source
+*
+***********************************************************************/
+static int32_t Tdp_Init();
+
+/***********************************************************************
+* @brief    Removes the streams and deinitializes the player and the
+* 			tuner
+*
+***********************************************************************/
+static void Tdp_Deinit();
+
+/***********************************************************************
+* @brief    Returns 1, the demux has one section filter
+*
+***********************************************************************/
+static uint32_t Tdp_Get_Max_Section_Filters();
+
+/***********************************************************************
+* @brief    Opens the section filter of the demux
+*
+***********************************************************************/
+static int32_t Tdp_Set_Section_Filter(uint16_t pid, uint8_t tableId, Ts_Section_Callback callback, void* userData,
+									  uint32_t* filterHandle);
+
+/***********************************************************************
+* @brief    Frees the section filter of the demux
+*
+***********************************************************************/
+static int32_t Tdp_Free_Section_Filter(uint32_t filterHandle);
+
+/***********************************************************************
+* @brief    Replaces the player streams. The player recovers the clock
+* 			from the source by itself, the PCR PID is not used
+*
+***********************************************************************/
+static int32_t Tdp_Play(uint16_t videoPID, uint16_t audioPID, uint16_t pcrPID);
+
+/***********************************************************************
+* @brief    Tuner callback, signals the lock
+*
+***********************************************************************/
+static int32_t Tuner_Status_Received(t_LockStatus status);
+
+/***********************************************************************
+* @brief    Demux callback, passes the section to the zapper callback
+*
+***********************************************************************/
+static int32_t Section_Received(uint8_t* buffer);
+
+static const ZapBackend tdpBackend = {
+	"tdp",
+	Tdp_Init,
+	Tdp_Deinit,
+	Tdp_Get_Max_Section_Filters,
+	Tdp_Set_Section_Filter,
+	Tdp_Free_Section_Filter,
+	Tdp_Play,
+	/* Demux of the receiver has only section filters, teletext and subtitles are not available */
+	NULL,
+	NULL,
+	NULL
+};
+
+static uint32_t playerHandle = 0;
+static uint32_t sourceHandle = 0;
+static uint32_t videoStreamHandle = 0;
+static uint32_t audioStreamHandle = 0;
+static uint8_t videoStreamOpen = 0;
+static uint8_t audioStreamOpen = 0;
+static uint8_t tunerLocked = 0;
+static pthread_mutex_t tunerMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t tunerCondition = PTHREAD_COND_INITIALIZER;
+/* Filter of the demux, the callback does not say which PID the section is on */
+static pthread_mutex_t filterMutex = PTHREAD_MUTEX_INITIALIZER;
+static Ts_Section_Callback filterCallback = NULL;
+static void* filterUserData = NULL;
+static uint16_t filterPID = 0;
+static uint32_t demuxFilterHandle = 0;
+static uint8_t filterOpen = 0;
+
+const ZapBackend* Zap_Tdp_Get_Backend()
+{
+	return &tdpBackend;
+}
+
+int32_t Tdp_Init()
+{
+	struct timespec deadline;
+
+	if (Tuner_Init() != NO_ERROR)
+	{
+		printf("%s(%d): Error initializing tuner!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+	Tuner_Register_Status_Callback(Tuner_Status_Received);
+
+	tunerLocked = 0;
+	if (Tuner_Lock_To_Frequency(ZAP_TDP_FREQUENCY, ZAP_TDP_BANDWIDTH, DVB_T) != NO_ERROR)
+	{
+		printf("%s(%d): Error locking to frequency!\n", __FUNCTION__, __LINE__);
+		Tuner_Unregister_Status_Callback(Tuner_Status_Received);
+		Tuner_Deinit();
+		return EXIT_FAILURE;
+	}
+
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += ZAP_TDP_LOCK_TIMEOUT;
+	pthread_mutex_lock(&tunerMutex);
+	while (!tunerLocked)
+	{
+		if (pthread_cond_timedwait(&tunerCondition, &tunerMutex, &deadline) == ETIMEDOUT)
+		{
+			break;
+		}
+	}
+	pthread_mutex_unlock(&tunerMutex);
+	if (!tunerLocked)
+	{
+		printf("%s(%d): Tuner did not lock!\n", __FUNCTION__, __LINE__);
+		Tuner_Unregister_Status_Callback(Tuner_Status_Received);
+		Tuner_Deinit();
+		return EXIT_FAILURE;
+	}
+
+	if (Player_Init(&playerHandle) != NO_ERROR || Player_Source_Open(playerHandle, &sourceHandle) != NO_ERROR)
+	{
+		printf("%s(%d): Error opening player source!\n", __FUNCTION__, __LINE__);
+		Tuner_Unregister_Status_Callback(Tuner_Status_Received);
+		Tuner_Deinit();
+		return EXIT_FAILURE;
+	}
+	Demux_Register_Section_Filter_Callback(Section_Received);
+	return EXIT_SUCCESS;
+}
+
+void Tdp_Deinit()
+{
+	Tdp_Play(0, 0, 0);
+	Demux_Unregister_Section_Filter_Callback(Section_Received);
+	Player_Source_Close(playerHandle, sourceHandle);
+	Player_Deinit(playerHandle);
+	Tuner_Unregister_Status_Callback(Tuner_Status_Received);
+	Tuner_Deinit();
+}
+
+uint32_t Tdp_Get_Max_Section_Filters()
+{
+	return 1;
+}
+
+int32_t Tdp_Set_Section_Filter(uint16_t pid, uint8_t tableId, Ts_Section_Callback callback, void* userData,
+							   uint32_t* filterHandle)
+{
+	pthread_mutex_lock(&filterMutex);
+	if (filterOpen)
+	{
+		pthread_mutex_unlock(&filterMutex);
+		printf("%s(%d): Section filter is in use!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+	/* Set before the filter, sections may arrive right away */
+	filterCallback = callback;
+	filterUserData = userData;
+	filterPID = pid;
+	filterOpen = 1;
+	pthread_mutex_unlock(&filterMutex);
+
+	if (Demux_Set_Filter(playerHandle, pid, tableId, &demuxFilterHandle) != NO_ERROR)
+	{
+		printf("%s(%d): Error setting demux filter!\n", __FUNCTION__, __LINE__);
+		pthread_mutex_lock(&filterMutex);
+		filterOpen = 0;
+		pthread_mutex_unlock(&filterMutex);
+		return EXIT_FAILURE;
+	}
+	*filterHandle = demuxFilterHandle;
+	return EXIT_SUCCESS;
+}
+
+int32_t Tdp_Free_Section_Filter(uint32_t filterHandle)
+{
+	pthread_mutex_lock(&filterMutex);
+	if (!filterOpen || filterHandle != demuxFilterHandle)
+	{
+		pthread_mutex_unlock(&filterMutex);
+		printf("%s(%d): Invalid filter handle!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+	filterOpen = 0;
+	pthread_mutex_unlock(&filterMutex);
+
+	/* Not under the mutex, the demux may be waiting for the callback to return */
+	if (Demux_Free_Filter(playerHandle, filterHandle) != NO_ERROR)
+	{
+		printf("%s(%d): Error freeing demux filter!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+int32_t Tdp_Play(uint16_t videoPID, uint16_t audioPID, uint16_t pcrPID)
+{
+	int32_t ret = EXIT_SUCCESS;
+
+	if (videoStreamOpen)
+	{
+		Player_Stream_Remove(playerHandle, sourceHandle, videoStreamHandle);
+		videoStreamOpen = 0;
+	}
+	if (audioStreamOpen)
+	{
+		Player_Stream_Remove(playerHandle, sourceHandle, audioStreamHandle);
+		audioStreamOpen = 0;
+	}
+
+	if (videoPID)
+	{
+		if (Player_Stream_Create(playerHandle, sourceHandle, videoPID, VIDEO_TYPE_MPEG2, &videoStreamHandle) == NO_ERROR)
+		{
+			videoStreamOpen = 1;
+		}
+		else
+		{
+			printf("%s(%d): Error creating video stream!\n", __FUNCTION__, __LINE__);
+			ret = EXIT_FAILURE;
+		}
+	}
+	if (audioPID)
+	{
+		if (Player_Stream_Create(playerHandle, sourceHandle, audioPID, AUDIO_TYPE_MPEG_AUDIO, &audioStreamHandle) == NO_ERROR)
+		{
+			audioStreamOpen = 1;
+		}
+		else
+		{
+			printf("%s(%d): Error creating audio stream!\n", __FUNCTION__, __LINE__);
+			ret = EXIT_FAILURE;
+		}
+	}
+	return ret;
+}
+
+int32_t Tuner_Status_Received(t_LockStatus status)
+{
+	if (status == STATUS_LOCKED)
+	{
+		pthread_mutex_lock(&tunerMutex);
+		tunerLocked = 1;
+		pthread_cond_signal(&tunerCondition);
+		pthread_mutex_unlock(&tunerMutex);
+	}
+	return 0;
+}
+
+int32_t Section_Received(uint8_t* buffer)
+{
+	Ts_Section_Callback callback;
+	void* userData;
+	uint16_t pid;
+
+	pthread_mutex_lock(&filterMutex);
+	callback = filterOpen ? filterCallback : NULL;
+	userData = filterUserData;
+	pid = filterPID;
+	pthread_mutex_unlock(&filterMutex);
+
+	if (callback != NULL)
+	{
+		callback(buffer, pid, userData);
+	}
+	return 0;
+}
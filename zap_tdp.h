@@ -0,0 +1,28 @@
+#ifndef _ZAP_TDP_H_
+#define _ZAP_TDP_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include "zap_backend.h"
+
+/* Multiplex the receiver tunes to */
+#define ZAP_TDP_FREQUENCY 818000000
+#define ZAP_TDP_BANDWIDTH 8
+/* Seconds to wait for the tuner lock */
+#define ZAP_TDP_LOCK_TIMEOUT 10
+
+/***********************************************************************
+* @brief    Returns the backend of the receiver. Its demux has a single
+* 			section filter, so the zapper moves it between the PMTs
+*
+* @return   backend - pointer to the backend functions
+*
+***********************************************************************/
+const ZapBackend* Zap_Tdp_Get_Backend();
+
+#endif
@@ -0,0 +1,1306 @@
+#include "zapper.h"
+
+/* Requested channel and the prefetched ones around it */
+#define WINDOW_SIZE (2 * ZAPPER_MAX_PREFETCH_DISTANCE + 1)
+#define NO_CHANNEL 0xFFFFFFFF
+
+typedef struct ZapEntry {
+	PATTable pat;
+	PMTTable pmt;
+	uint8_t pmtValid;
+	/* Microseconds when the PMT was last received */
+	uint64_t pmtTime;
+	/* Filter is opened and freed only by the zapper thread */
+	uint8_t filterOpen;
+	/* Section arrived since the filter was opened */
+	uint8_t refreshed;
+	uint32_t filterHandle;
+} ZapEntry;
+
+typedef struct StreamConsumer {
+	Ts_Packet_Callback callback;
+	void* userData;
+	/* PID the consumer is set on, 0 if none */
+	uint16_t pid;
+} StreamConsumer;
+
+/***********************************************************************
+* @brief    Section callback for the PAT, adds the channels
+*
+***********************************************************************/
+static int32_t PAT_Section_Received(const uint8_t* section, uint16_t pid, void* userData);
+
+/***********************************************************************
+* @brief    Section callback for the SDT, saves the service names in the
+* 			service database
+*
+***********************************************************************/
+static int32_t SDT_Section_Received(const uint8_t* section, uint16_t pid, void* userData);
+
+/***********************************************************************
+* @brief    Section callback for the PMTs, userData is the ZapEntry.
+* 			Parses the section only when the PSI cache has not seen it
+* 			or the entry has no PMT yet, and wakes up the
+* 			zapper thread when there is something to do
+*
+***********************************************************************/
+static int32_t PMT_Section_Received(const uint8_t* section, uint16_t pid, void* userData);
+
+/***********************************************************************
+* @brief    Zapper thread, starts the requested channel as soon as its
+* 			PMT is parsed and moves the PMT filters with the channel.
+* 			Backend is called only from this thread, never under the
+* 			zapper mutex
+*
+***********************************************************************/
+static void* Zap_Task();
+
+/***********************************************************************
+* @brief    Moves the stream consumers to the streams of the channel.
+* 			Called from the zapper thread, without the zapper mutex
+*
+* @param    [in] pmt - streams of the channel, NULL frees the consumers
+*
+***********************************************************************/
+static void Update_Stream_Consumers(const PMTTable* pmt);
+
+/***********************************************************************
+* @brief    Requests a channel. Called with the zapper mutex locked
+*
+* @param    [in] index - index of the channel
+* @param    [in] direction - 1 up, -1 down, 0 a channel by its number
+* @param    [in] inputTime - time of the key, 0 if there was none
+*
+***********************************************************************/
+static void Request_Channel(uint32_t index, int32_t direction, uint64_t inputTime);
+
+/***********************************************************************
+* @brief    Lists the requested channel and its neighbours, the ones
+* 			most likely to be requested next first. Called with the
+* 			zapper mutex locked
+*
+* @param    [out] window - indexes of the channels, WINDOW_SIZE elements
+*
+* @return   number of channels in the window
+*
+***********************************************************************/
+static uint32_t Build_Window(uint32_t* window);
+
+/***********************************************************************
+* @brief    Decides which PMT filters are freed and which are opened.
+* 			With enough filters the whole window is filtered all the
+* 			time, otherwise filters move on after a section, to the
+* 			channel whose PMT is the oldest. Called with the zapper
+* 			mutex locked
+*
+* @param    [out] closeHandles - handles of the filters to free
+* @param    [out] numClose - number of filters to free
+* @param    [out] openEntries - indexes of the channels to filter
+* @param    [out] numOpen - number of filters to open
+*
+***********************************************************************/
+static void Plan_Filters(uint32_t* closeHandles, uint32_t* numClose, uint32_t* openEntries, uint32_t* numOpen);
+
+/***********************************************************************
+* @brief    Replaces the channel list with the programs of the live PAT.
+* 			Programs which kept their PMT PID keep their PMT, requested
+* 			and playing channels are found again by program number.
+* 			Called from the zapper thread with the zapper mutex locked,
+* 			after the PMT filters were closed
+*
+***********************************************************************/
+static void Rebuild_Channels();
+
+/***********************************************************************
+* @brief    Fills the channel structure of an entry
+*
+***********************************************************************/
+static void Fill_Channel(uint32_t index, ZapperChannel* channel);
+
+/***********************************************************************
+* @brief    Timer callback, requests the channel whose digits were
+* 			entered
+*
+***********************************************************************/
+static void Digit_Timeout(void* argument);
+
+/***********************************************************************
+* @brief    Timer callback, the PAT filter is opened again to look for
+* 			a new version when there are too few filters to keep it
+*
+***********************************************************************/
+static void Pat_Check_Timeout(void* argument);
+
+static const ZapBackend* zapBackend = NULL;
+static ZapEntry entries[ZAPPER_MAX_CHANNELS];
+static uint32_t numOfChannels = 0;
+static uint32_t prefetch = ZAPPER_PREFETCH_DISTANCE;
+static uint32_t numOfOpenFilters = 0;
+static uint32_t patFilterHandle;
+static uint8_t patFilterOpen = 0;
+/* Channel list is usable, from the live PAT or from an earlier session */
+static uint8_t patComplete = 0;
+/* All sections of the PAT version being read were received */
+static uint8_t livePatComplete = 0;
+/* At least one live PAT was complete, its version is in livePatVersion */
+static uint8_t livePatReceived = 0;
+/* Live PAT is complete, the zapper thread builds the channel list from it */
+static uint8_t patChanged = 0;
+/* Complete PAT was seen since the PAT filter was opened */
+static uint8_t patCheckDone = 0;
+/* Set by the timer, the PAT filter is opened again */
+static uint8_t patCheckDue = 0;
+static TimerEntry patTimer;
+/* Bit per PAT section_number */
+static uint8_t patSections[32];
+static PATTable livePrograms[ZAPPER_MAX_CHANNELS];
+static uint32_t numOfLivePrograms = 0;
+static uint16_t collectingTransportStreamId = 0;
+/* 0xFF before the first section */
+static uint8_t collectingPatVersion = 0xFF;
+static uint16_t liveTransportStreamId = 0;
+static uint8_t livePatVersion = 0;
+static ZapEntry rebuiltEntries[ZAPPER_MAX_CHANNELS];
+/* Channel list set before the initialization */
+static const ZapperChannel* seedChannels = NULL;
+static uint32_t numOfSeedChannels = 0;
+/* SDT takes a filter only until all of its sections are received */
+static uint32_t sdtFilterHandle;
+static uint8_t sdtFilterOpen = 0;
+static uint8_t sdtComplete = 0;
+static uint8_t sdtSections[32];
+/* Requested channel is the center of the window */
+static uint32_t requestedChannel = 0;
+static uint8_t requestPending = 0;
+static uint8_t requestWarm = 0;
+static uint64_t requestTime = 0;
+/* Key which requested the channel, 0 if there was none */
+static uint64_t requestInputTime = 0;
+static int32_t zapDirection = 0;
+static uint32_t playingChannel = NO_CHANNEL;
+static PMTTable playingPmt;
+static Zapper_Callback zapCallback = NULL;
+static void* zapArgument = NULL;
+static TimerEntry digitTimer;
+static uint32_t digitValue = 0;
+static uint32_t digitCount = 0;
+static uint64_t digitInputTime = 0;
+static ZapperStatistics statistics;
+static StreamConsumer streamConsumers[ZAPPER_NUM_STREAMS];
+static uint8_t running = 0;
+static uint8_t work = 0;
+static pthread_t zapThread;
+static pthread_mutex_t zapMutex;
+static pthread_cond_t workCondition;
+static pthread_cond_t playCondition;
+
+int32_t Zapper_Init(const ZapBackend* backend, uint32_t prefetchDistance, Zapper_Callback callback, void* argument)
+{
+	pthread_condattr_t conditionAttributes;
+	SDTService seedService;
+	uint32_t filterHandle;
+	uint32_t i;
+
+	if (backend == NULL || prefetchDistance > ZAPPER_MAX_PREFETCH_DISTANCE)
+	{
+		printf("%s(%d): Invalid arguments!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+
+	if (pthread_mutex_init(&zapMutex, NULL))
+	{
+		printf("%s(%d): Error initializing zapper mutex!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+	pthread_cond_init(&workCondition, NULL);
+	/* Timeouts are measured on the monotonic clock */
+	pthread_condattr_init(&conditionAttributes);
+	pthread_condattr_setclock(&conditionAttributes, CLOCK_MONOTONIC);
+	pthread_cond_init(&playCondition, &conditionAttributes);
+	pthread_condattr_destroy(&conditionAttributes);
+
+	memset(entries, 0, sizeof(entries));
+	memset(patSections, 0, sizeof(patSections));
+	memset(sdtSections, 0, sizeof(sdtSections));
+	memset(&statistics, 0, sizeof(statistics));
+	zapBackend = backend;
+	prefetch = prefetchDistance;
+	zapCallback = callback;
+	zapArgument = argument;
+	numOfOpenFilters = 0;
+	livePatComplete = 0;
+	livePatReceived = 0;
+	patChanged = 0;
+	patCheckDone = 0;
+	patCheckDue = 0;
+	numOfLivePrograms = 0;
+	collectingPatVersion = 0xFF;
+	sdtFilterOpen = 0;
+	sdtComplete = 0;
+	playingChannel = NO_CHANNEL;
+	digitCount = 0;
+	digitValue = 0;
+	for (i = 0; i < ZAPPER_NUM_STREAMS; i++)
+	{
+		streamConsumers[i].pid = 0;
+	}
+	/* Channels of an earlier session are zapped to before the PAT arrives */
+	for (i = 0; i < numOfSeedChannels; i++)
+	{
+		entries[i].pat.programNumber = seedChannels[i].programNumber;
+		entries[i].pat.programMapPID = seedChannels[i].programMapPID;
+		entries[i].pmt = seedChannels[i].pmt;
+		entries[i].pmtValid = (seedChannels[i].pmt.videoPID != 0 || seedChannels[i].pmt.audioPID != 0);
+	}
+	numOfChannels = numOfSeedChannels;
+	patComplete = (numOfSeedChannels > 0);
+	/* First channel is started as soon as it is known */
+	Request_Channel(0, 0, 0);
+
+	if (Timer_Service_Init())
+	{
+		pthread_cond_destroy(&playCondition);
+		pthread_cond_destroy(&workCondition);
+		pthread_mutex_destroy(&zapMutex);
+		return EXIT_FAILURE;
+	}
+	Timer_Init(&digitTimer, Digit_Timeout, NULL);
+	Timer_Init(&patTimer, Pat_Check_Timeout, NULL);
+
+	/* Repetitions of the PAT and PMTs are dropped by the cache before they are parsed */
+	if (Psi_Cache_Init())
+	{
+		Timer_Service_Deinit();
+		pthread_cond_destroy(&playCondition);
+		pthread_cond_destroy(&workCondition);
+		pthread_mutex_destroy(&zapMutex);
+		return EXIT_FAILURE;
+	}
+	if (Service_Db_Init())
+	{
+		Psi_Cache_Deinit();
+		Timer_Service_Deinit();
+		pthread_cond_destroy(&playCondition);
+		pthread_cond_destroy(&workCondition);
+		pthread_mutex_destroy(&zapMutex);
+		return EXIT_FAILURE;
+	}
+	/* Names of the earlier session are shown until the SDT is received */
+	memset(&seedService, 0, sizeof(seedService));
+	for (i = 0; i < numOfSeedChannels; i++)
+	{
+		if (seedChannels[i].serviceName[0] != '\0')
+		{
+			seedService.serviceId = seedChannels[i].programNumber;
+			memcpy(seedService.serviceName, seedChannels[i].serviceName, SERVICE_NAME_SIZE);
+			Service_Db_Update_SDT(&seedService, 1);
+		}
+	}
+	seedChannels = NULL;
+	numOfSeedChannels = 0;
+
+	if (zapBackend->Init() || zapBackend->Get_Max_Section_Filters() == 0)
+	{
+		printf("%s(%d): Error initializing %s backend!\n", __FUNCTION__, __LINE__, zapBackend->name);
+		Service_Db_Deinit();
+		Psi_Cache_Deinit();
+		Timer_Service_Deinit();
+		pthread_cond_destroy(&playCondition);
+		pthread_cond_destroy(&workCondition);
+		pthread_mutex_destroy(&zapMutex);
+		return EXIT_FAILURE;
+	}
+
+	/* Thread is not started yet, so the PAT filter does not wait for a PMT filter to be freed */
+	running = 1;
+	if (zapBackend->Set_Section_Filter(PAT_PID, PAT_TABLE_ID, PAT_Section_Received, NULL, &filterHandle))
+	{
+		printf("%s(%d): Error setting PAT filter!\n", __FUNCTION__, __LINE__);
+		running = 0;
+		zapBackend->Deinit();
+		Service_Db_Deinit();
+		Psi_Cache_Deinit();
+		Timer_Service_Deinit();
+		pthread_cond_destroy(&playCondition);
+		pthread_cond_destroy(&workCondition);
+		pthread_mutex_destroy(&zapMutex);
+		return EXIT_FAILURE;
+	}
+	pthread_mutex_lock(&zapMutex);
+	patFilterHandle = filterHandle;
+	patFilterOpen = 1;
+	/* PAT may already be complete */
+	work = 1;
+	pthread_mutex_unlock(&zapMutex);
+
+	if (pthread_create(&zapThread, NULL, Zap_Task, NULL))
+	{
+		printf("%s(%d): Error creating zapper thread!\n", __FUNCTION__, __LINE__);
+		pthread_mutex_lock(&zapMutex);
+		running = 0;
+		pthread_mutex_unlock(&zapMutex);
+		zapBackend->Free_Section_Filter(filterHandle);
+		patFilterOpen = 0;
+		zapBackend->Deinit();
+		Service_Db_Deinit();
+		Psi_Cache_Deinit();
+		Timer_Service_Deinit();
+		pthread_cond_destroy(&playCondition);
+		pthread_cond_destroy(&workCondition);
+		pthread_mutex_destroy(&zapMutex);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+int32_t Zapper_Set_Stream_Consumer(uint32_t stream, Ts_Packet_Callback callback, void* userData)
+{
+	if (stream >= ZAPPER_NUM_STREAMS)
+	{
+		printf("%s(%d): Invalid stream %u!\n", __FUNCTION__, __LINE__, stream);
+		return EXIT_FAILURE;
+	}
+	streamConsumers[stream].callback = callback;
+	streamConsumers[stream].userData = userData;
+	streamConsumers[stream].pid = 0;
+	return EXIT_SUCCESS;
+}
+
+int32_t Zapper_Set_Channel_List(const ZapperChannel* channels, uint32_t numOfChannelsInList)
+{
+	if ((channels == NULL && numOfChannelsInList > 0) || numOfChannelsInList > ZAPPER_MAX_CHANNELS)
+	{
+		printf("%s(%d): Invalid arguments!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+	seedChannels = channels;
+	numOfSeedChannels = numOfChannelsInList;
+	return EXIT_SUCCESS;
+}
+
+int32_t Zapper_Deinit()
+{
+	uint32_t i;
+
+	pthread_mutex_lock(&zapMutex);
+	running = 0;
+	pthread_cond_signal(&workCondition);
+	pthread_cond_broadcast(&playCondition);
+	pthread_mutex_unlock(&zapMutex);
+	pthread_join(zapThread, NULL);
+	Timer_Stop(&digitTimer);
+	Timer_Stop(&patTimer);
+
+	/* Zapper thread is stopped, nothing else changes the filters */
+	if (patFilterOpen)
+	{
+		zapBackend->Free_Section_Filter(patFilterHandle);
+		patFilterOpen = 0;
+	}
+	if (sdtFilterOpen)
+	{
+		zapBackend->Free_Section_Filter(sdtFilterHandle);
+		sdtFilterOpen = 0;
+	}
+	for (i = 0; i < numOfChannels; i++)
+	{
+		if (entries[i].filterOpen)
+		{
+			zapBackend->Free_Section_Filter(entries[i].filterHandle);
+			entries[i].filterOpen = 0;
+		}
+	}
+	numOfOpenFilters = 0;
+	Update_Stream_Consumers(NULL);
+	zapBackend->Deinit();
+
+	Service_Db_Deinit();
+	Psi_Cache_Deinit();
+	Timer_Service_Deinit();
+	pthread_cond_destroy(&playCondition);
+	pthread_cond_destroy(&workCondition);
+	pthread_mutex_destroy(&zapMutex);
+	return EXIT_SUCCESS;
+}
+
+int32_t Zapper_Set_Channel(uint32_t channelNumber)
+{
+	pthread_mutex_lock(&zapMutex);
+	if (!patComplete || channelNumber == 0 || channelNumber > numOfChannels)
+	{
+		pthread_mutex_unlock(&zapMutex);
+		printf("%s(%d): Channel %u does not exist!\n", __FUNCTION__, __LINE__, channelNumber);
+		return EXIT_FAILURE;
+	}
+	Request_Channel(channelNumber - 1, 0, Latency_Get_Input_Time());
+	pthread_mutex_unlock(&zapMutex);
+	return EXIT_SUCCESS;
+}
+
+int32_t Zapper_Channel_Up()
+{
+	pthread_mutex_lock(&zapMutex);
+	if (!patComplete || numOfChannels == 0)
+	{
+		pthread_mutex_unlock(&zapMutex);
+		return EXIT_FAILURE;
+	}
+	/* Relative to the requested channel, so quick presses do not wait for each other */
+	Request_Channel((requestedChannel + 1) % numOfChannels, 1, Latency_Get_Input_Time());
+	pthread_mutex_unlock(&zapMutex);
+	return EXIT_SUCCESS;
+}
+
+int32_t Zapper_Channel_Down()
+{
+	pthread_mutex_lock(&zapMutex);
+	if (!patComplete || numOfChannels == 0)
+	{
+		pthread_mutex_unlock(&zapMutex);
+		return EXIT_FAILURE;
+	}
+	Request_Channel((requestedChannel + numOfChannels - 1) % numOfChannels, -1, Latency_Get_Input_Time());
+	pthread_mutex_unlock(&zapMutex);
+	return EXIT_SUCCESS;
+}
+
+int32_t Zapper_Enter_Digit(uint8_t digit)
+{
+	uint8_t complete;
+
+	if (digit > 9)
+	{
+		printf("%s(%d): Invalid arguments!\n", __FUNCTION__, __LINE__);
+		return EXIT_FAILURE;
+	}
+
+	pthread_mutex_lock(&zapMutex);
+	digitValue = digitValue * 10 + digit;
+	digitCount++;
+	/* Zap time of a number is measured from its last digit */
+	digitInputTime = Latency_Get_Input_Time();
+	complete = (digitCount == ZAPPER_MAX_DIGITS);
+	pthread_mutex_unlock(&zapMutex);
+
+	if (complete)
+	{
+		Timer_Stop(&digitTimer);
+		Digit_Timeout(NULL);
+		return EXIT_SUCCESS;
+	}
+	return Timer_Start(&digitTimer, ZAPPER_DIGIT_TIMEOUT);
+}
+
+int32_t Zapper_Wait(uint32_t timeout)
+{
+	struct timespec deadline;
+	int32_t ret = EXIT_SUCCESS;
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += timeout / 1000;
+	deadline.tv_nsec += (timeout % 1000) * 1000000;
+	if (deadline.tv_nsec >= 1000000000)
+	{
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	pthread_mutex_lock(&zapMutex);
+	while (running && (requestPending || playingChannel != requestedChannel))
+	{
+		if (pthread_cond_timedwait(&playCondition, &zapMutex, &deadline) == ETIMEDOUT)
+		{
+			break;
+		}
+	}
+	if (requestPending || playingChannel != requestedChannel)
+	{
+		ret = EXIT_FAILURE;
+	}
+	pthread_mutex_unlock(&zapMutex);
+	return ret;
+}
+
+uint32_t Zapper_Get_Number_Of_Channels()
+{
+	uint32_t count;
+
+	pthread_mutex_lock(&zapMutex);
+	count = patComplete ? numOfChannels : 0;
+	pthread_mutex_unlock(&zapMutex);
+	return count;
+}
+
+int32_t Zapper_Get_Channel(ZapperChannel* outChannel)
+{
+	pthread_mutex_lock(&zapMutex);
+	if (playingChannel == NO_CHANNEL)
+	{
+		pthread_mutex_unlock(&zapMutex);
+		return EXIT_FAILURE;
+	}
+	Fill_Channel(playingChannel, outChannel);
+	outChannel->pmt = playingPmt;
+	pthread_mutex_unlock(&zapMutex);
+	return EXIT_SUCCESS;
+}
+
+int32_t Zapper_Get_Channel_At(uint32_t channelNumber, ZapperChannel* outChannel)
+{
+	pthread_mutex_lock(&zapMutex);
+	if (!patComplete || channelNumber == 0 || channelNumber > numOfChannels)
+	{
+		pthread_mutex_unlock(&zapMutex);
+		return EXIT_FAILURE;
+	}
+	Fill_Channel(channelNumber - 1, outChannel);
+	if (!entries[channelNumber - 1].pmtValid)
+	{
+		memset(&outChannel->pmt, 0, sizeof(PMTTable));
+	}
+	pthread_mutex_unlock(&zapMutex);
+	return EXIT_SUCCESS;
+}
+
+int32_t Zapper_Get_Transport_Stream(uint16_t* transportStreamId, uint8_t* patVersion)
+{
+	int32_t ret = EXIT_FAILURE;
+
+	pthread_mutex_lock(&zapMutex);
+	if (livePatReceived)
+	{
+		*transportStreamId = liveTransportStreamId;
+		*patVersion = livePatVersion;
+		ret = EXIT_SUCCESS;
+	}
+	pthread_mutex_unlock(&zapMutex);
+	return ret;
+}
+
+void Zapper_Get_Statistics(ZapperStatistics* outStatistics)
+{
+	pthread_mutex_lock(&zapMutex);
+	*outStatistics = statistics;
+	pthread_mutex_unlock(&zapMutex);
+}
+
+int32_t PAT_Section_Received(const uint8_t* section, uint16_t pid, void* userData)
+{
+	PATTable programTable[PAT_MAX_PROGRAMS];
+	uint32_t count;
+	uint32_t i;
+	uint32_t j;
+	uint8_t sectionNumber = section[6];
+	uint8_t lastSectionNumber = section[7];
+	uint8_t version = (section[5] >> 1) & 0x1F;
+	uint8_t known;
+	int32_t status;
+
+	/* Sections with wrong CRC_32 are waited for again */
+	status = Psi_Cache_Filter_Section(section);
+	if (status == PSI_SECTION_CORRUPTED || status == PSI_SECTION_NOT_APPLICABLE)
+	{
+		return EXIT_SUCCESS;
+	}
+
+	pthread_mutex_lock(&zapMutex);
+	if (!running)
+	{
+		pthread_mutex_unlock(&zapMutex);
+		return EXIT_SUCCESS;
+	}
+	known = (patSections[sectionNumber / 8] & (1 << (sectionNumber % 8))) != 0;
+	/* Repetition of the complete PAT ends a check, nothing changed */
+	if (status == PSI_SECTION_REPEATED && known)
+	{
+		if (livePatComplete && !patCheckDone)
+		{
+			patCheckDone = 1;
+			work = 1;
+			pthread_cond_signal(&workCondition);
+		}
+		pthread_mutex_unlock(&zapMutex);
+		return EXIT_SUCCESS;
+	}
+	/* New version, or a changed section of the read one, is read from the start */
+	if (status == PSI_SECTION_NEW && (livePatComplete || version != collectingPatVersion))
+	{
+		memset(patSections, 0, sizeof(patSections));
+		numOfLivePrograms = 0;
+		livePatComplete = 0;
+		collectingPatVersion = version;
+	}
+	else if (known || version != collectingPatVersion)
+	{
+		pthread_mutex_unlock(&zapMutex);
+		return EXIT_SUCCESS;
+	}
+	count = PAT_Parse(section, programTable);
+	patSections[sectionNumber / 8] |= 1 << (sectionNumber % 8);
+	collectingTransportStreamId = (section[3] << 8) | section[4];
+
+	/* Channels in use are not touched here, the zapper thread moves them to the new list */
+	for (i = 0; i < count && numOfLivePrograms < ZAPPER_MAX_CHANNELS; i++)
+	{
+		for (j = 0; j < numOfLivePrograms; j++)
+		{
+			if (livePrograms[j].programNumber == programTable[i].programNumber)
+			{
+				break;
+			}
+		}
+		if (j == numOfLivePrograms)
+		{
+			livePrograms[numOfLivePrograms++] = programTable[i];
+		}
+	}
+
+	for (i = 0; i <= lastSectionNumber; i++)
+	{
+		if (!(patSections[i / 8] & (1 << (i % 8))))
+		{
+			break;
+		}
+	}
+	if (i > lastSectionNumber)
+	{
+		livePatComplete = 1;
+		livePatReceived = 1;
+		liveTransportStreamId = collectingTransportStreamId;
+		livePatVersion = collectingPatVersion;
+		patChanged = 1;
+		patCheckDone = 1;
+		work = 1;
+		pthread_cond_signal(&workCondition);
+	}
+	pthread_mutex_unlock(&zapMutex);
+	return EXIT_SUCCESS;
+}
+
+int32_t SDT_Section_Received(const uint8_t* section, uint16_t pid, void* userData)
+{
+	SDTService serviceTable[ZAPPER_MAX_SDT_SERVICES];
+	uint32_t count;
+	uint32_t i;
+	uint8_t sectionNumber = section[6];
+	uint8_t lastSectionNumber = section[7];
+	int32_t status;
+
+	status = Psi_Cache_Filter_Section(section);
+	if (status == PSI_SECTION_CORRUPTED || status == PSI_SECTION_NOT_APPLICABLE)
+	{
+		return EXIT_SUCCESS;
+	}
+
+	pthread_mutex_lock(&zapMutex);
+	if (!running || sdtComplete || (sdtSections[sectionNumber / 8] & (1 << (sectionNumber % 8))))
+	{
+		pthread_mutex_unlock(&zapMutex);
+		return EXIT_SUCCESS;
+	}
+	count = SDT_Parse(section, serviceTable, ZAPPER_MAX_SDT_SERVICES);
+	Service_Db_Update_SDT(serviceTable, count);
+	sdtSections[sectionNumber / 8] |= 1 << (sectionNumber % 8);
+
+	for (i = 0; i <= lastSectionNumber; i++)
+	{
+		if (!(sdtSections[i / 8] & (1 << (i % 8))))
+		{
+			break;
+		}
+	}
+	if (i > lastSectionNumber)
+	{
+		/* Filter goes back to the PMTs */
+		sdtComplete = 1;
+		work = 1;
+		pthread_cond_signal(&workCondition);
+	}
+	pthread_mutex_unlock(&zapMutex);
+	return EXIT_SUCCESS;
+}
+
+int32_t PMT_Section_Received(const uint8_t* section, uint16_t pid, void* userData)
+{
+	ZapEntry* entry = (ZapEntry*)userData;
+	uint16_t programNumber = (section[3] << 8) | section[4];
+	uint16_t sectionLength = ((section[1] & 0x0F) << 8) | section[2];
+	int32_t status;
+	PMTTable pmt;
+
+	/* PMT PID may carry the PMTs of other programs too */
+	if (programNumber != entry->pat.programNumber || sectionLength < 13 || sectionLength > PSI_MAX_SECTION_LENGTH)
+	{
+		return EXIT_SUCCESS;
+	}
+	status = Psi_Cache_Filter_Section(section);
+	if (status == PSI_SECTION_CORRUPTED || status == PSI_SECTION_NOT_APPLICABLE)
+	{
+		return EXIT_SUCCESS;
+	}
+
+	pthread_mutex_lock(&zapMutex);
+	if (!running || !entry->filterOpen)
+	{
+		pthread_mutex_unlock(&zapMutex);
+		return EXIT_SUCCESS;
+	}
+	statistics.pmtSections++;
+
+	/* Repetition of the parsed PMT only refreshes its time */
+	if (status == PSI_SECTION_NEW || !entry->pmtValid)
+	{
+		if (PMT_Parse(section, &pmt))
+		{
+			pthread_mutex_unlock(&zapMutex);
+			return EXIT_SUCCESS;
+		}
+		entry->pmt = pmt;
+		entry->pmtValid = 1;
+		statistics.pmtParses++;
+		/* Requested channel may wait for it, or the playing one changed */
+		work = 1;
+	}
+	entry->pmtTime = Latency_Now();
+	if (!entry->refreshed)
+	{
+		/* Once per opened filter, the filter may be moved on */
+		entry->refreshed = 1;
+		work = 1;
+	}
+	if (work)
+	{
+		pthread_cond_signal(&workCondition);
+	}
+	pthread_mutex_unlock(&zapMutex);
+	return EXIT_SUCCESS;
+}
+
+void* Zap_Task()
+{
+	uint32_t closeHandles[WINDOW_SIZE + 2];
+	uint32_t openEntries[WINDOW_SIZE];
+	int32_t openResults[WINDOW_SIZE];
+	/* One more for the SDT */
+	uint32_t openHandles[WINDOW_SIZE + 1];
+	uint32_t numClose;
+	uint32_t numOpen;
+	uint32_t i;
+	uint32_t zapTime = 0;
+	uint64_t startTime = 0;
+	uint64_t inputTime = 0;
+	ZapperChannel channel;
+	uint8_t play;
+	/* Audio and video are started again, not only the other streams */
+	uint8_t restart;
+	uint8_t zap;
+	uint8_t warm = 0;
+	uint8_t openSdt;
+	uint8_t openPat;
+	int32_t sdtResult;
+	int32_t patResult;
+	uint32_t patHandle;
+	/* With enough filters the PAT filter is never closed */
+	uint8_t keepPat = zapBackend->Get_Max_Section_Filters() >= ZAPPER_PAT_MONITOR_FILTERS;
+
+	TRACE_THREAD_NAME("zapper");
+	pthread_mutex_lock(&zapMutex);
+	while (running)
+	{
+		if (!work)
+		{
+			pthread_cond_wait(&workCondition, &zapMutex);
+			continue;
+		}
+		work = 0;
+		numClose = 0;
+		numOpen = 0;
+		play = 0;
+		restart = 0;
+		zap = 0;
+		openSdt = 0;
+		openPat = 0;
+
+		/* PAT is read again later, its filter is needed for the PMTs */
+		if (patFilterOpen && patCheckDone && !keepPat)
+		{
+			closeHandles[numClose++] = patFilterHandle;
+			patFilterOpen = 0;
+			Timer_Start(&patTimer, ZAPPER_PAT_CHECK_INTERVAL);
+		}
+		if (patChanged)
+		{
+			/* Filters point to the entries which are about to move */
+			for (i = 0; i < numOfChannels; i++)
+			{
+				if (entries[i].filterOpen)
+				{
+					closeHandles[numClose++] = entries[i].filterHandle;
+					entries[i].filterOpen = 0;
+				}
+			}
+			numOfOpenFilters = 0;
+			Rebuild_Channels();
+			patChanged = 0;
+		}
+		if (sdtComplete && sdtFilterOpen)
+		{
+			closeHandles[numClose++] = sdtFilterHandle;
+			sdtFilterOpen = 0;
+		}
+		if (patComplete && requestPending && requestedChannel < numOfChannels && entries[requestedChannel].pmtValid)
+		{
+			requestPending = 0;
+			playingChannel = requestedChannel;
+			startTime = requestTime;
+			inputTime = requestInputTime;
+			warm = requestWarm;
+			play = 1;
+			restart = 1;
+			zap = 1;
+		}
+		else if (!requestPending && playingChannel != NO_CHANNEL && entries[playingChannel].pmtValid
+				 && memcmp(&entries[playingChannel].pmt, &playingPmt, sizeof(PMTTable)))
+		{
+			/* PMT of the playing channel changed, only changed audio and video are started again */
+			inputTime = 0;
+			play = 1;
+			restart = (entries[playingChannel].pmt.videoPID != playingPmt.videoPID
+					   || entries[playingChannel].pmt.audioPID != playingPmt.audioPID
+					   || entries[playingChannel].pmt.pcrPID != playingPmt.pcrPID);
+		}
+		if (play)
+		{
+			playingPmt = entries[playingChannel].pmt;
+			Fill_Channel(playingChannel, &channel);
+		}
+		/* Check waits for a zap in progress, Plan_Filters frees a PMT filter for it */
+		if (patCheckDue && !patFilterOpen && !requestPending
+			&& zapBackend->Get_Max_Section_Filters() > sdtFilterOpen)
+		{
+			patCheckDue = 0;
+			patCheckDone = 0;
+			patFilterOpen = 1;
+			openPat = 1;
+		}
+		if (patComplete)
+		{
+			Plan_Filters(closeHandles, &numClose, openEntries, &numOpen);
+			/* Plan_Filters leaves a filter for the SDT once the first channel plays */
+			if (!sdtComplete && !sdtFilterOpen && !requestPending
+				&& numOfOpenFilters + patFilterOpen < zapBackend->Get_Max_Section_Filters())
+			{
+				sdtFilterOpen = 1;
+				openSdt = 1;
+			}
+		}
+		pthread_mutex_unlock(&zapMutex);
+
+		/* Filters are freed first, a receiver may have only one */
+		for (i = 0; i < numClose; i++)
+		{
+			zapBackend->Free_Section_Filter(closeHandles[i]);
+		}
+		if (play)
+		{
+			if (restart)
+			{
+				zapBackend->Play(channel.pmt.videoPID, channel.pmt.audioPID, channel.pmt.pcrPID);
+			}
+			Update_Stream_Consumers(&channel.pmt);
+			zapTime = (uint32_t)(Latency_Now() - startTime);
+		}
+		for (i = 0; i < numOpen; i++)
+		{
+			openResults[i] = zapBackend->Set_Section_Filter(entries[openEntries[i]].pat.programMapPID, PMT_TABLE_ID,
+															PMT_Section_Received, &entries[openEntries[i]],
+															&openHandles[i]);
+		}
+		if (openSdt)
+		{
+			sdtResult = zapBackend->Set_Section_Filter(SDT_PID, SDT_TABLE_ID, SDT_Section_Received, NULL,
+													   &openHandles[numOpen]);
+		}
+		if (openPat)
+		{
+			patResult = zapBackend->Set_Section_Filter(PAT_PID, PAT_TABLE_ID, PAT_Section_Received, NULL, &patHandle);
+		}
+
+		pthread_mutex_lock(&zapMutex);
+		if (openPat)
+		{
+			if (patResult)
+			{
+				printf("%s(%d): Error setting PAT filter!\n", __FUNCTION__, __LINE__);
+				patFilterOpen = 0;
+				Timer_Start(&patTimer, ZAPPER_PAT_CHECK_INTERVAL);
+			}
+			else
+			{
+				patFilterHandle = patHandle;
+			}
+		}
+		if (openSdt)
+		{
+			if (sdtResult)
+			{
+				printf("%s(%d): Error setting SDT filter!\n", __FUNCTION__, __LINE__);
+				sdtFilterOpen = 0;
+			}
+			else
+			{
+				sdtFilterHandle = openHandles[numOpen];
+			}
+		}
+		for (i = 0; i < numOpen; i++)
+		{
+			if (openResults[i])
+			{
+				printf("%s(%d): Error setting PMT filter on PID %d!\n", __FUNCTION__, __LINE__,
+					   entries[openEntries[i]].pat.programMapPID);
+				entries[openEntries[i]].filterOpen = 0;
+				numOfOpenFilters--;
+				continue;
+			}
+			entries[openEntries[i]].filterHandle = openHandles[i];
+		}
+		if (zap)
+		{
+			statistics.zaps++;
+			if (warm)
+			{
+				statistics.warmZaps++;
+			}
+			else
+			{
+				statistics.coldZaps++;
+			}
+			statistics.lastZapTime = zapTime;
+			if (zapTime > statistics.maxZapTime)
+			{
+				statistics.maxZapTime = zapTime;
+			}
+			Latency_Record(LATENCY_ZAP, zapTime);
+			pthread_cond_broadcast(&playCondition);
+		}
+		pthread_mutex_unlock(&zapMutex);
+
+		if (play && zapCallback != NULL)
+		{
+			/* OSD changes of the callback are measured from the key */
+			Latency_Set_Input_Time(inputTime);
+			zapCallback(&channel, zapArgument);
+			Latency_Set_Input_Time(0);
+		}
+		pthread_mutex_lock(&zapMutex);
+	}
+	pthread_mutex_unlock(&zapMutex);
+	return NULL;
+}
+
+void Update_Stream_Consumers(const PMTTable* pmt)
+{
+	StreamConsumer* consumer;
+	uint16_t pid;
+	uint32_t i;
+
+	if (zapBackend->Set_Packet_Consumer == NULL)
+	{
+		return;
+	}
+
+	for (i = 0; i < ZAPPER_NUM_STREAMS; i++)
+	{
+		consumer = &streamConsumers[i];
+		pid = 0;
+		if (pmt != NULL && consumer->callback != NULL)
+		{
+			switch (i)
+			{
+				case ZAPPER_STREAM_TELETEXT:
+					pid = pmt->teletextPID;
+					break;
+				case ZAPPER_STREAM_SUBTITLE:
+					/* First subtitles of the PMT, the language is not selectable yet */
+					pid = pmt->numOfSubtitles ? pmt->subtitles[0].elementaryPID : 0;
+					break;
+			}
+		}
+		if (pid == consumer->pid)
+		{
+			continue;
+		}
+		if (consumer->pid != 0)
+		{
+			zapBackend->Free_Packet_Consumer(consumer->pid);
+		}
+		consumer->pid = pid;
+		if (pid != 0 && zapBackend->Set_Packet_Consumer(pid, consumer->callback, consumer->userData))
+		{
+			printf("%s(%d): Error setting packet consumer on PID %d!\n", __FUNCTION__, __LINE__, pid);
+			consumer->pid = 0;
+		}
+	}
+}
+
+void Request_Channel(uint32_t index, int32_t direction, uint64_t inputTime)
+{
+	requestedChannel = index;
+	requestPending = 1;
+	requestWarm = (index < numOfChannels) && entries[index].pmtValid;
+	requestInputTime = inputTime;
+	requestTime = inputTime ? inputTime : Latency_Now();
+	zapDirection = direction;
+	work = 1;
+	pthread_cond_signal(&workCondition);
+}
+
+uint32_t Build_Window(uint32_t* window)
+{
+	uint32_t size = 0;
+	uint32_t distance;
+	uint32_t candidate;
+	uint32_t i;
+	uint32_t j;
+	int32_t side;
+
+	window[size++] = requestedChannel;
+	for (i = 0; i < 2 * prefetch; i++)
+	{
+		if (zapDirection == 0)
+		{
+			/* Both sides are as likely, nearest channels first */
+			distance = i / 2 + 1;
+			side = (i % 2) ? -1 : 1;
+		}
+		else
+		{
+			/* Zapping usually goes on the same way */
+			distance = i % prefetch + 1;
+			side = (i < prefetch) ? zapDirection : -zapDirection;
+		}
+		distance %= numOfChannels;
+		candidate = (side > 0) ? (requestedChannel + distance) % numOfChannels
+							   : (requestedChannel + numOfChannels - distance) % numOfChannels;
+
+		/* Few channels wrap around into each other */
+		for (j = 0; j < size; j++)
+		{
+			if (window[j] == candidate)
+			{
+				break;
+			}
+		}
+		if (j == size)
+		{
+			window[size++] = candidate;
+		}
+	}
+	return size;
+}
+
+void Plan_Filters(uint32_t* closeHandles, uint32_t* numClose, uint32_t* openEntries, uint32_t* numOpen)
+{
+	uint32_t window[WINDOW_SIZE];
+	uint8_t inWindow[ZAPPER_MAX_CHANNELS];
+	uint32_t windowSize;
+	uint32_t budget;
+	uint32_t best;
+	uint32_t candidate;
+	uint32_t i;
+	uint8_t rotating;
+
+	if (numOfChannels == 0)
+	{
+		return;
+	}
+
+	windowSize = Build_Window(window);
+	memset(inWindow, 0, sizeof(inWindow));
+	for (i = 0; i < windowSize; i++)
+	{
+		inWindow[window[i]] = 1;
+	}
+	/* Once the first channel plays, one filter is kept for the SDT until it is complete */
+	budget = patFilterOpen + ((!sdtComplete && !requestPending) ? 1 : sdtFilterOpen);
+	budget = (zapBackend->Get_Max_Section_Filters() > budget) ? zapBackend->Get_Max_Section_Filters() - budget : 0;
+	rotating = windowSize > budget;
+
+	for (i = 0; i < numOfChannels; i++)
+	{
+		if (!entries[i].filterOpen || (inWindow[i] && !(rotating && entries[i].refreshed)))
+		{
+			continue;
+		}
+		if (inWindow[i])
+		{
+			statistics.filterRotations++;
+		}
+		closeHandles[(*numClose)++] = entries[i].filterHandle;
+		entries[i].filterOpen = 0;
+		numOfOpenFilters--;
+	}
+
+	/* Filters over the budget are taken from the least likely channels,
+	   the current one only while a PAT check takes the last filter */
+	for (i = windowSize; i > (budget ? 1 : 0) && numOfOpenFilters > budget; i--)
+	{
+		candidate = window[i - 1];
+		if (entries[candidate].filterOpen)
+		{
+			closeHandles[(*numClose)++] = entries[candidate].filterHandle;
+			entries[candidate].filterOpen = 0;
+			numOfOpenFilters--;
+		}
+	}
+
+	/* Requested channel without a PMT takes the filter of the least likely one */
+	if (requestPending && !entries[requestedChannel].pmtValid && !entries[requestedChannel].filterOpen
+		&& numOfOpenFilters >= budget)
+	{
+		for (i = windowSize; i > 1; i--)
+		{
+			candidate = window[i - 1];
+			if (entries[candidate].filterOpen)
+			{
+				closeHandles[(*numClose)++] = entries[candidate].filterHandle;
+				entries[candidate].filterOpen = 0;
+				numOfOpenFilters--;
+				break;
+			}
+		}
+	}
+
+	while (numOfOpenFilters < budget)
+	{
+		best = NO_CHANNEL;
+		for (i = 0; i < windowSize; i++)
+		{
+			candidate = window[i];
+			if (entries[candidate].filterOpen)
+			{
+				continue;
+			}
+			/* Missing PMTs first, then the oldest one, ties go to the more likely channel */
+			if (best == NO_CHANNEL || (entries[candidate].pmtValid ? entries[candidate].pmtTime : 0)
+									  < (entries[best].pmtValid ? entries[best].pmtTime : 0))
+			{
+				best = candidate;
+			}
+		}
+		if (best == NO_CHANNEL)
+		{
+			break;
+		}
+		entries[best].filterOpen = 1;
+		entries[best].refreshed = 0;
+		numOfOpenFilters++;
+		openEntries[(*numOpen)++] = best;
+	}
+
+	if (numOfOpenFilters > statistics.maxOpenFilters)
+	{
+		statistics.maxOpenFilters = numOfOpenFilters;
+	}
+}
+
+void Rebuild_Channels()
+{
+	uint32_t requestedIndex = NO_CHANNEL;
+	uint32_t playingIndex = NO_CHANNEL;
+	uint32_t oldNumOfChannels = numOfChannels;
+	uint32_t i;
+	uint32_t j;
+
+	for (i = 0; i < numOfLivePrograms; i++)
+	{
+		memset(&rebuiltEntries[i], 0, sizeof(ZapEntry));
+		rebuiltEntries[i].pat = livePrograms[i];
+		for (j = 0; j < numOfChannels; j++)
+		{
+			if (entries[j].pat.programNumber != livePrograms[i].programNumber)
+			{
+				continue;
+			}
+			/* PMT is still usable when it is on the same PID */
+			if (entries[j].pat.programMapPID == livePrograms[i].programMapPID)
+			{
+				rebuiltEntries[i].pmt = entries[j].pmt;
+				rebuiltEntries[i].pmtValid = entries[j].pmtValid;
+				rebuiltEntries[i].pmtTime = entries[j].pmtTime;
+			}
+			if (j == requestedChannel)
+			{
+				requestedIndex = i;
+			}
+			if (j == playingChannel)
+			{
+				playingIndex = i;
+			}
+			break;
+		}
+	}
+
+	memcpy(entries, rebuiltEntries, numOfLivePrograms * sizeof(ZapEntry));
+	numOfChannels = numOfLivePrograms;
+	patComplete = 1;
+	playingChannel = playingIndex;
+	if (requestedIndex != NO_CHANNEL)
+	{
+		requestedChannel = requestedIndex;
+	}
+	else if (requestedChannel < oldNumOfChannels && numOfChannels > 0)
+	{
+		/* Program is gone, the channel at the same number is started instead */
+		Request_Channel((requestedChannel < numOfChannels) ? requestedChannel : 0, zapDirection, requestInputTime);
+	}
+	statistics.channelListUpdates++;
+}
+
+void Fill_Channel(uint32_t index, ZapperChannel* channel)
+{
+	ServiceEntry service;
+
+	channel->channelNumber = index + 1;
+	channel->programNumber = entries[index].pat.programNumber;
+	channel->programMapPID = entries[index].pat.programMapPID;
+	channel->serviceName[0] = '\0';
+	if (Service_Db_Find_By_Program(channel->programNumber, &service) == EXIT_SUCCESS)
+	{
+		memcpy(channel->serviceName, service.serviceName, SERVICE_NAME_SIZE);
+	}
+	channel->pmt = entries[index].pmt;
+}
+
+void Pat_Check_Timeout(void* argument)
+{
+	pthread_mutex_lock(&zapMutex);
+	patCheckDue = 1;
+	work = 1;
+	pthread_cond_signal(&workCondition);
+	pthread_mutex_unlock(&zapMutex);
+}
+
+void Digit_Timeout(void* argument)
+{
+	uint32_t number;
+	uint32_t count;
+
+	pthread_mutex_lock(&zapMutex);
+	number = digitValue;
+	count = digitCount;
+	digitValue = 0;
+	digitCount = 0;
+	if (count > 0)
+	{
+		if (patComplete && number > 0 && number <= numOfChannels)
+		{
+			Request_Channel(number - 1, 0, digitInputTime);
+		}
+		else
+		{
+			printf("%s(%d): Channel %u does not exist!\n", __FUNCTION__, __LINE__, number);
+		}
+	}
+	pthread_mutex_unlock(&zapMutex);
+}
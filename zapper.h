@@ -0,0 +1,237 @@
+#ifndef _ZAPPER_H_
+#define _ZAPPER_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include "zap_backend.h"
+#include "table_parse.h"
+#include "crc32.h"
+#include "psi_cache.h"
+#include "service_db.h"
+#include "timer_service.h"
+#include "latency.h"
+
+#define ZAPPER_MAX_CHANNELS 256
+/* Channels on each side of the current one whose PMT is kept parsed */
+#define ZAPPER_PREFETCH_DISTANCE 2
+#define ZAPPER_MAX_PREFETCH_DISTANCE 8
+/* Digit entry, the number is taken after the timeout or the last digit */
+#define ZAPPER_MAX_DIGITS 3
+#define ZAPPER_DIGIT_TIMEOUT 2000
+/* PAT filter stays open for new versions with this many section filters,
+   with fewer the PAT is read again every ZAPPER_PAT_CHECK_INTERVAL milliseconds */
+#define ZAPPER_PAT_MONITOR_FILTERS 3
+#define ZAPPER_PAT_CHECK_INTERVAL 5000
+/* Streams of the playing channel passed to consumers, besides video and audio */
+#define ZAPPER_STREAM_TELETEXT 0
+#define ZAPPER_STREAM_SUBTITLE 1
+#define ZAPPER_NUM_STREAMS 2
+/* Services of one SDT section */
+#define ZAPPER_MAX_SDT_SERVICES 256
+
+typedef struct ZapperChannel {
+	/* Channels are numbered from 1 in the order of the PAT */
+	uint32_t channelNumber;
+	uint16_t programNumber;
+	uint16_t programMapPID;
+	/* From the SDT, empty until it is received */
+	char serviceName[SERVICE_NAME_SIZE];
+	PMTTable pmt;
+} ZapperChannel;
+
+/* Called on the zapper thread after the streams of a channel were started */
+typedef void(*Zapper_Callback)(const ZapperChannel* channel, void* argument);
+
+typedef struct ZapperStatistics {
+	uint32_t zaps;
+	/* Zaps whose PMT was already parsed when they were requested */
+	uint32_t warmZaps;
+	uint32_t coldZaps;
+	/* Microseconds from the request until the streams were started */
+	uint32_t lastZapTime;
+	uint32_t maxZapTime;
+	uint32_t pmtSections;
+	/* Sections which changed the PMT, repetitions are not parsed again */
+	uint32_t pmtParses;
+	/* Filters moved to another channel when there are too few for the window */
+	uint32_t filterRotations;
+	uint32_t maxOpenFilters;
+	/* Channel lists built from the live PAT, the first one included */
+	uint32_t channelListUpdates;
+} ZapperStatistics;
+
+/***********************************************************************
+* @brief    Zapper initialization function, tunes the backend, reads
+* 			the PAT and starts the first channel when its PMT arrives.
+* 			The SDT is read after the first channel is started, service
+* 			names are kept in the service database. A new version of
+* 			the PAT rebuilds the channel list
+*
+* @param    [in] backend - demux and player of the receiver
+* @param    [in] prefetchDistance - channels on each side of the current
+* 									one whose PMT is kept parsed, up to
+* 									ZAPPER_MAX_PREFETCH_DISTANCE
+* @param    [in] callback - called after each channel change, may be NULL
+* @param    [in] argument - passed to the callback
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Zapper_Init(const ZapBackend* backend, uint32_t prefetchDistance, Zapper_Callback callback, void* argument);
+
+/***********************************************************************
+* @brief    Sets the consumer of a stream of the playing channel, called
+* 			before the zapper is initialized. The consumer is moved to
+* 			the PID of the stream on every channel change, when the
+* 			backend passes packets
+*
+* @param    [in] stream - ZAPPER_STREAM_ of the stream
+* @param    [in] callback - called with each packet, NULL for none
+* @param    [in] userData - passed to the callback
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Zapper_Set_Stream_Consumer(uint32_t stream, Ts_Packet_Callback callback, void* userData);
+
+/***********************************************************************
+* @brief    Sets the channel list of an earlier session, called before
+* 			the zapper is initialized. Its channels are zapped to at
+* 			once, without waiting for the PAT. When the live PAT
+* 			arrives with other programs, the list is replaced
+*
+* @param    [in] channels - channels in channel number order, a PMT
+* 							without video and audio PIDs is not known.
+* 							Has to stay valid until Zapper_Init
+* @param    [in] numOfChannels - number of channels
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - too many channels
+*
+***********************************************************************/
+int32_t Zapper_Set_Channel_List(const ZapperChannel* channels, uint32_t numOfChannels);
+
+/***********************************************************************
+* @brief    Zapper deinitialization function, stops the zapper thread,
+* 			frees the filters and deinitializes the backend
+*
+* @return   EXIT_SUCCESS - no error
+*
+***********************************************************************/
+int32_t Zapper_Deinit();
+
+/***********************************************************************
+* @brief    Requests a channel change without waiting for it. When
+* 			called from a key handler, the zap time is measured from
+* 			the key
+*
+* @param    [in] channelNumber - channel from 1
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - channel does not exist or the PAT is not
+* 						   received yet
+*
+***********************************************************************/
+int32_t Zapper_Set_Channel(uint32_t channelNumber);
+
+/***********************************************************************
+* @brief    Requests the next channel, after the last one is the first
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - PAT is not received yet
+*
+***********************************************************************/
+int32_t Zapper_Channel_Up();
+
+/***********************************************************************
+* @brief    Requests the previous channel, before the first one is the
+* 			last
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - PAT is not received yet
+*
+***********************************************************************/
+int32_t Zapper_Channel_Down();
+
+/***********************************************************************
+* @brief    Adds a digit to the channel number being entered. The
+* 			channel is requested after ZAPPER_MAX_DIGITS digits or
+* 			ZAPPER_DIGIT_TIMEOUT milliseconds after the last digit
+*
+* @param    [in] digit - 0 to 9
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - error
+*
+***********************************************************************/
+int32_t Zapper_Enter_Digit(uint8_t digit);
+
+/***********************************************************************
+* @brief    Waits until the requested channel is playing
+*
+* @param    [in] timeout - milliseconds to wait
+*
+* @return   EXIT_SUCCESS - channel is playing
+* @return   EXIT_FAILURE - timeout
+*
+***********************************************************************/
+int32_t Zapper_Wait(uint32_t timeout);
+
+/***********************************************************************
+* @brief    Returns the number of channels, 0 until the PAT is received
+*
+***********************************************************************/
+uint32_t Zapper_Get_Number_Of_Channels();
+
+/***********************************************************************
+* @brief    Copies the channel which is playing
+*
+* @param    [out] outChannel - structure where the channel is saved
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - no channel is playing
+*
+***********************************************************************/
+int32_t Zapper_Get_Channel(ZapperChannel* outChannel);
+
+/***********************************************************************
+* @brief    Copies a channel of the list
+*
+* @param    [in] channelNumber - channel from 1
+* @param    [out] outChannel - structure where the channel is saved, its
+* 							   PMT is zero when it was not received yet
+*
+* @return   EXIT_SUCCESS - no error
+* @return   EXIT_FAILURE - channel does not exist
+*
+***********************************************************************/
+int32_t Zapper_Get_Channel_At(uint32_t channelNumber, ZapperChannel* outChannel);
+
+/***********************************************************************
+* @brief    Returns the transport_stream_id and version of the live PAT
+*
+* @param    [out] transportStreamId - transport_stream_id of the PAT
+* @param    [out] patVersion - version_number of the PAT
+*
+* @return   EXIT_SUCCESS - channel list is from the live PAT
+* @return   EXIT_FAILURE - live PAT is not received yet
+*
+***********************************************************************/
+int32_t Zapper_Get_Transport_Stream(uint16_t* transportStreamId, uint8_t* patVersion);
+
+/***********************************************************************
+* @brief    Copies the zapper statistics
+*
+* @param    [out] outStatistics - structure where the statistics are saved
+*
+***********************************************************************/
+void Zapper_Get_Statistics(ZapperStatistics* outStatistics);
+
+#endif